@@ -86,7 +86,9 @@ int main(int argc, char *argv[])
     double phi = inj_dft[0]->phi;
     
     get_Fstat_logL(orbit_dft, data_dft, f, fdot, theta, phi, &logL_X_dft, &logL_AE_dft, Fparams);
-    logL_AE_dwt = get_Fstat_logL_wavelet(orbit_dwt, data_dwt, f, fdot, theta, phi);
+    struct FstatWaveletWorkspace *fws = alloc_Fstat_wavelet_workspace(orbit_dwt, data_dwt);
+    logL_AE_dwt = get_Fstat_logL_wavelet(orbit_dwt, data_dwt, f, fdot, theta, phi, fws);
+    free_Fstat_wavelet_workspace(fws);
     
     printf("logL_AE_dft = %lg, logL_AE_dwt = %lg\n", logL_AE_dft, logL_AE_dwt);
     printf("proposal_dft = %lg, proposal_dwt = %lg\n", exp(sqrt(2*logL_AE_dft)), exp(sqrt(2*logL_AE_dwt)));
@@ -55,7 +55,7 @@ for(size_t n=0; n<NP; n++)
 int main(int argc, char* argv[])
 {
     // chain file
-    FILE *chainFile=NULL;
+    struct ChainFile *chainFile=NULL;
     
     // dimension of model
     size_t NP = 0;
@@ -112,7 +112,7 @@ int main(int argc, char* argv[])
         switch(c)
         {
             case 'f':
-                chainFile = fopen(optarg,"r");
+                chainFile = open_chain_file(optarg, NULL, 0, NULL, "r");
                 break;
             case 'h': // help
                 printUsage(program);
@@ -138,11 +138,13 @@ int main(int argc, char* argv[])
         }
     }
     
-    /* count lines in file */
-    char* line;
-    char lineBuffer[BUFFER_SIZE];
-    while((line = fgets(lineBuffer, BUFFER_SIZE, chainFile)) != NULL) NMCMC++;
-    rewind(chainFile);
+    /* count samples in file */
+    NMCMC = (size_t)chainFile->Nrow;
+    if(chainFile->Ncol < (int)NP)
+    {
+        fprintf(stderr,"chain file has %i columns, fewer than --nparams %i\n",chainFile->Ncol,(int)NP);
+        exit(1);
+    }
     
     //thin chain
     NMCMC /= NTHIN;
@@ -178,21 +180,20 @@ int main(int argc, char* argv[])
 
     /* parse chain file */
     double value;
-    char *column;
+    double *row = double_vector(chainFile->Ncol);
     for(size_t i=0; i<NMCMC; i++)
     {
-        for(size_t j=0; j<NTHIN; j++) line = fgets(lineBuffer, BUFFER_SIZE, chainFile);
-        
-        column=strtok(line," ");
+        for(size_t j=0; j<NTHIN; j++) read_chain_row(chainFile, row);
         
         for(size_t n=0; n<NP; n++)
         {
-            sscanf(column, "%lg", &value);
+            value = row[n];
             if(LFLAG[n]) value = log(value);
             params[n][i] = value;
-            column=strtok(NULL," ");
         }
     }
+    free_double_vector(row);
+    close_chain_file(chainFile);
     
     
     /* Get max and min for each parameter */
@@ -31,6 +31,40 @@ static void print_usage()
     exit(0);
 }
 
+/* Sampler state shared by every chain's block of steps, see run_chain_blocks() */
+struct NoiseChainBlock
+{
+    struct Orbit *orbit;
+    struct Data *data;
+    struct Noise **psd;
+    struct InstrumentModel **inst_model;
+    struct InstrumentModel **inst_trial;
+    struct ForegroundModel **conf_model;
+    struct ForegroundModel **conf_trial;
+    struct Chain *chain;
+    struct Flags *flags;
+};
+
+/* One block of MCMC steps for chain ic */
+static void noise_chain_block(void *arg, int ic)
+{
+    struct NoiseChainBlock *block = arg;
+    struct Chain *chain = block->chain;
+    struct Flags *flags = block->flags;
+    
+    struct Noise *psd_ptr = block->psd[chain->index[ic]];
+    struct InstrumentModel *inst_model_ptr = block->inst_model[chain->index[ic]];
+    struct InstrumentModel *inst_trial_ptr = block->inst_trial[chain->index[ic]];
+    struct ForegroundModel *conf_model_ptr = block->conf_model[chain->index[ic]];
+    struct ForegroundModel *conf_trial_ptr = block->conf_trial[chain->index[ic]];
+    
+    for(int mc=0; mc<10; mc++)
+    {
+        noise_instrument_model_mcmc(block->orbit, block->data, inst_model_ptr, inst_trial_ptr, conf_model_ptr, psd_ptr, chain, flags, ic);
+        if(flags->confNoise) noise_foreground_model_mcmc(block->data, inst_model_ptr, conf_model_ptr, conf_trial_ptr, psd_ptr, chain, flags, ic);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     fprintf(stdout, "\n================= NOISE MCMC ================\n");
@@ -149,9 +183,10 @@ int main(int argc, char *argv[])
         foregroundChainFile = fopen(filename,"w");
     }
     
-    int numThreads;
     int step = 0;
-    int NC = chain->NC;
+    
+    //state for each chain's block of steps
+    struct NoiseChainBlock block = {orbit, data, psd, inst_model, inst_trial, conf_model, conf_trial, chain, flags};
     
     #pragma omp parallel num_threads(flags->threads)
     {
@@ -160,36 +195,15 @@ int main(int argc, char *argv[])
         //Save individual thread number
         threadID = omp_get_thread_num();
         
-        //Only one thread runs this section
-        if(threadID==0)  numThreads = omp_get_num_threads();
-        
-        #pragma omp barrier
-        
         /* The MCMC loop */
         for(; step<flags->NMCMC;)
         {
             #pragma omp barrier
             
-            // (parallel) loop over chains
-            for(int ic=threadID; ic<NC; ic+=numThreads)
-            {
-                struct Noise *psd_ptr = psd[chain->index[ic]];
-                struct InstrumentModel *inst_model_ptr = inst_model[chain->index[ic]];
-                struct InstrumentModel *inst_trial_ptr = inst_trial[chain->index[ic]];
-                struct ForegroundModel *conf_model_ptr = conf_model[chain->index[ic]];
-                struct ForegroundModel *conf_trial_ptr = conf_trial[chain->index[ic]];
-
-                for(int mc=0; mc<10; mc++)
-                {
-                    noise_instrument_model_mcmc(orbit, data, inst_model_ptr, inst_trial_ptr, conf_model_ptr, psd_ptr, chain, flags, ic);
-                    if(flags->confNoise) noise_foreground_model_mcmc(data, inst_model_ptr, conf_model_ptr, conf_trial_ptr, psd_ptr, chain, flags, ic);
-                }
-            }// end (parallel) loop over chains
-            
-            //Next section is single threaded. Every thread must get here before continuing
-            
-            #pragma omp barrier
+            // (parallel) loop over chains, returns when every chain has finished its block
+            run_chain_blocks(chain, noise_chain_block, &block);
             
+            //Next section is single threaded
             if(threadID==0)
             {
                 noise_ptmcmc(inst_model, chain, flags);
@@ -272,6 +286,10 @@ int main(int argc, char *argv[])
     print_whitened_data(data, inst_model[chain->index[0]]->psd, filename);
 
     
+    //print timing summary of hot paths
+    sprintf(filename,"%s/profile.dat",flags->runDir);
+    write_profile(filename);
+    
     //print total run time
     stop = time(NULL);
     
@@ -31,6 +31,32 @@ static void print_usage()
     exit(0);
 }
 
+/* Sampler state shared by every chain's block of steps, see run_chain_blocks() */
+struct SplineChainBlock
+{
+    struct Orbit *orbit;
+    struct Data *data;
+    struct SplineModel **model;
+    struct Chain *chain;
+    struct Flags *flags;
+};
+
+/* One block of MCMC steps for chain ic */
+static void spline_chain_block(void *arg, int ic)
+{
+    struct SplineChainBlock *block = arg;
+    struct Chain *chain = block->chain;
+    
+    struct SplineModel *model_ptr = block->model[chain->index[ic]];
+    for(int mc=0; mc<10; mc++)
+    {
+        if(rand_r_U_0_1(&chain->r[ic])<0.9)
+            noise_spline_model_mcmc(block->orbit, block->data, model_ptr, chain, block->flags, ic);
+        else
+            noise_spline_model_rjmcmc(block->orbit, block->data, model_ptr, chain, block->flags, ic);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     fprintf(stdout, "\n============= NOISE SPLINE MCMC =============\n");
@@ -104,9 +130,10 @@ int main(int argc, char *argv[])
     sprintf(filename,"%s/chain_file.dat",chain->chainDir);
     FILE *chainFile = fopen(filename,"w");
 
-    int numThreads;
     int step = 0;
-    int NC = chain->NC;
+    
+    //state for each chain's block of steps
+    struct SplineChainBlock block = {orbit, data, model, chain, flags};
     
     #pragma omp parallel num_threads(flags->threads)
     {
@@ -114,35 +141,16 @@ int main(int argc, char *argv[])
         //Save individual thread number
         threadID = omp_get_thread_num();
         
-        //Only one thread runs this section
-        if(threadID==0)  numThreads = omp_get_num_threads();
-        
-        #pragma omp barrier
-        
         /* The MCMC loop */
         for(; step<flags->NMCMC;)
         {
             
             #pragma omp barrier
             
-            // (parallel) loop over chains
-            for(int ic=threadID; ic<NC; ic+=numThreads)
-            {
-                struct SplineModel *model_ptr = model[chain->index[ic]];
-                for(int mc=0; mc<10; mc++)
-                {
-                    
-                    if(rand_r_U_0_1(&chain->r[ic])<0.9)
-                        noise_spline_model_mcmc(orbit, data, model_ptr, chain, flags, ic);
-                    else
-                        noise_spline_model_rjmcmc(orbit, data, model_ptr, chain, flags, ic);
-                }
-            }// end (parallel) loop over chains
-            
-            //Next section is single threaded. Every thread must get here before continuing
-            
-            #pragma omp barrier
+            // (parallel) loop over chains, returns when every chain has finished its block
+            run_chain_blocks(chain, spline_chain_block, &block);
             
+            //Next section is single threaded
             if(threadID==0)
             {
                 spline_ptmcmc(model, chain, flags);
@@ -196,6 +204,10 @@ int main(int argc, char *argv[])
     for(int ic=0; ic<chain->NC; ic++) free_spline_model(model[ic]);
     free(model);
     
+    //print timing summary of hot paths
+    sprintf(filename,"%s/profile.dat",flags->runDir);
+    write_profile(filename);
+    
     //print total run time
     stop = time(NULL);
     
@@ -220,37 +220,19 @@ void parse_catalog(int argc, char **argv, struct Data *data, struct Orbit *orbit
 }
 
 
-static int safe_scan_source_params(struct Data *data, struct Source *source, FILE *fptr)
+static int safe_scan_source_params(struct Data *data, struct Source *source, struct ChainFile *chain_file, double *row)
 {
-
-    int check = 0;
-    check+=fscanf(fptr,"%lg",&source->f0);
-    check+=fscanf(fptr,"%lg",&source->dfdt);
-    check+=fscanf(fptr,"%lg",&source->amp);
-    check+=fscanf(fptr,"%lg",&source->phi);
-    check+=fscanf(fptr,"%lg",&source->costheta);
-    check+=fscanf(fptr,"%lg",&source->cosi);
-    check+=fscanf(fptr,"%lg",&source->psi);
-    check+=fscanf(fptr,"%lg",&source->phi0);
-    if(UCB_MODEL_NP>8)
-        check+=fscanf(fptr,"%lg",&source->d2fdt2);
+    if(read_chain_row(chain_file, row)) return 1;
     
-    if(!check)
-    {
-        return 1;
-    }
-    
-    //map to parameter names (just to make code readable)
-    map_params_to_array(source, source->params, data->T);
+    unpack_source_params(data, source, row);
     return 0;
-
 }
 
 static void source_waveform_wrapper(struct Source *source, struct Data *data, struct Orbit *orbit)
 {
-    source->tdi = malloc(sizeof(struct TDI));
-    alloc_tdi(source->tdi,data->N, data->Nchannel);
     ucb_alignment(orbit, data, source);
+    source->tdi = malloc(sizeof(struct TDI));
+    alloc_tdi(source->tdi, 2*source->BW, data->Nchannel);
     ucb_waveform(orbit, data->format, data->T, data->t0, source->params, UCB_MODEL_NP, source->tdi->X, source->tdi->Y, source->tdi->Z ,source->tdi->A, source->tdi->E, source->BW, data->Nchannel);
 }
 
@@ -286,7 +268,13 @@ int main(int argc, char *argv[])
     data_old->qmax = data_old->qmin + data->NFFT;
     
     //File containing chain samples
-    FILE *chain_file = fopen(data->fileName,"r");
+    struct ChainFile *chain_file = open_chain_file(data->fileName, NULL, 0, NULL, "r");
+    if(chain_file->Ncol<UCB_MODEL_NP)
+    {
+        fprintf(stderr,"Error reading %s\n",data->fileName);
+        exit(1);
+    }
+    double *row = double_vector(chain_file->Ncol);
     
     //Orbits
     /* Load spacecraft ephemerides */
@@ -331,18 +319,11 @@ int main(int argc, char *argv[])
     
     struct Source *sample = NULL;
     sample = malloc(sizeof *sample);
-    alloc_source(sample, data->N, data->Nchannel);
+    alloc_source(sample, data->Nchannel);
     
     
-    //count lines in chain file
-    int N=0;
-
-    char *line;
-    char buffer[16384];
-
-    while( (line=fgets(buffer, 16384, chain_file)) != NULL) N++;
-
-    rewind(chain_file);
+    //count samples in chain file
+    int N = (int)chain_file->Nrow;
     
     
     //selection criteria for catalog entries
@@ -431,11 +412,12 @@ int main(int argc, char *argv[])
     {
         
         //parse source in first sample of chain file
-        check = safe_scan_source_params(data, sample, chain_file);
+        check = safe_scan_source_params(data, sample, chain_file, row);
         if(!check)
         {
             //Book-keeping of waveform in time-frequency volume
             ucb_alignment(orbit, data, sample);
+            clear_source_tdi(sample, 2*sample->BW);
             
             //calculate waveform model of sample
             ucb_waveform(orbit, data->format, data->T, data->t0, sample->params, UCB_MODEL_NP, sample->tdi->X, sample->tdi->Y, sample->tdi->Z, sample->tdi->A, sample->tdi->E, sample->BW, data->Nchannel);
@@ -458,50 +440,92 @@ int main(int argc, char *argv[])
     //prevent multiple templates being added to the same source (only relevent for low SNR, low match threshold)
     int *entryFlag = malloc(NMAX*sizeof(int));
     
+    //chain samples are read in blocks and their waveforms computed as a batch
+    int NBLOCK   = 1024/DMAX + 1;
+    int NSAMPLES = NBLOCK*DMAX;
+    struct Source **samples = malloc(NSAMPLES*sizeof(struct Source *));
+    int *sampleFlag = malloc(NSAMPLES*sizeof(int));
+    double **batch_params = malloc(NSAMPLES*sizeof(double *));
+    struct TDI **batch_tdi = malloc(NSAMPLES*sizeof(struct TDI *));
+    int *batch_BW = malloc(NSAMPLES*sizeof(int));
+    for(int k=0; k<NSAMPLES; k++)
+    {
+        samples[k] = malloc(sizeof(struct Source));
+        alloc_source(samples[k], data->Nchannel);
+    }
+    
     fprintf(stdout,"\nLooping over chain file\n");
-    for(int i=1; i<IMAX; i++)
+    for(int istart=1; istart<IMAX; istart+=NBLOCK)
     {
-        if(IMAX>100 && i%(IMAX/100)==0)printProgress((double)i/(double)IMAX);
-        
-        for(int n=0; n<N; n++) entryFlag[n] = 0;
+        int istop = (istart+NBLOCK < IMAX) ? istart+NBLOCK : IMAX;
+        int Nbatch = 0;
         
-        //check each source in chain sample
-        for(int d=0; d<DMAX; d++)
+        //parse block of chain samples and flag the ones to be matched
+        for(int i=istart; i<istop; i++)
         {
-            //parse source parameters
-            check = safe_scan_source_params(data, sample, chain_file);
-            
-            if(!check)
+            for(int d=0; d<DMAX; d++)
             {
+                int k = (i-istart)*DMAX + d;
+                sample = samples[k];
+                sampleFlag[k] = 0;
+                
+                //parse source parameters
+                check = safe_scan_source_params(data, sample, chain_file, row);
+                if(check) continue;
+                
                 //find where the source fits in the measurement band
                 ucb_alignment(orbit, data, sample);
                 
-                //calculate waveform model of sample
-                ucb_waveform(orbit, data->format, data->T, data->t0, sample->params, UCB_MODEL_NP, sample->tdi->X, sample->tdi->Y, sample->tdi->Z, sample->tdi->A, sample->tdi->E, sample->BW, data->Nchannel);
-                
                 double q_sample = sample->f0 * data->T;
                 
                 if(q_sample < data->qmin+data->qpad || q_sample > data->qmax-data->qpad) continue;
                 
                 if(i%downsample!=0) continue;
                 
+                sampleFlag[k] = 1;
+                clear_source_tdi(sample, 2*sample->BW);
+                batch_params[Nbatch] = sample->params;
+                batch_tdi[Nbatch]    = sample->tdi;
+                batch_BW[Nbatch]     = sample->BW;
+                Nbatch++;
+            }
+        }
+        
+        //calculate waveform models of samples
+        ucb_waveform_batch(orbit, select_LISA_tdi(data->format), data->T, data->t0, batch_params, UCB_MODEL_NP, batch_tdi, batch_BW, Nbatch, data->Nchannel);
+        
+        for(int i=istart; i<istop; i++)
+        {
+            if(IMAX>100 && i%(IMAX/100)==0)printProgress((double)i/(double)IMAX);
+            
+            for(int n=0; n<N; n++) entryFlag[n] = 0;
+            
+            //check each source in chain sample
+            for(int d=0; d<DMAX; d++)
+            {
+                int k = (i-istart)*DMAX + d;
+                if(!sampleFlag[k]) continue;
+                sample = samples[k];
+                
+                double q_sample = sample->f0 * data->T;
+                
                 //calculate match of sample and all entries
                 matchFlag = 0;
                 for(int n=0; n<catalog->N; n++)
                 {
                     entry = catalog->entry[n];
-                    
+                
                     //check frequency separation
                     double q_entry  = entry->source[0]->f0 * data->T;
-                    
+                
                     if( fabs(q_entry-q_sample) > dqmax ) Match = -1.0;
-                    
+                
                     //calculate match
                     else
                     {
                         Match = waveform_match(sample, entry->source[0], noise);
                     }
-                    
+                
                     if(Match > tolerance && !entryFlag[n])
                     {
                         matchFlag = 1;
@@ -512,27 +536,34 @@ int main(int argc, char *argv[])
                         entry->distance[entry->Nchain] = Distance;
                         entry->stepFlag[i] = 1;
                         append_sample_to_entry(entry, sample, IMAX, data->N, data->Nchannel);
-                        
+                    
                         //stop looping over entries in catalog
                         break;
                     }
-                    
-                }//end loop over catalog entries
-                
                 
+                }//end loop over catalog entries
+            
+            
                 //if the match tolerence is never met, add as new source
                 if(!matchFlag)
                 {
                     entryFlag[catalog->N]=1;
                     create_new_source(catalog, sample, noise, i, IMAX, data->N, data->Nchannel);
                 }
-                
-            }
-        }//end loop over sources in chain sample
-        
+            
+            }//end loop over sources in chain sample
+        }
     }//end loop over chain
+    
+    for(int k=0; k<NSAMPLES; k++) free_source(samples[k]);
+    free(samples);
+    free(sampleFlag);
+    free(batch_params);
+    free(batch_tdi);
+    free(batch_BW);
     fprintf(stdout,"\n");
-    fclose(chain_file);
+    close_chain_file(chain_file);
+    free_double_vector(row);
     free(entryFlag);
     
     
@@ -622,7 +653,7 @@ int main(int argc, char *argv[])
         out = fopen( filename, "w");
         
         struct Source *b=entry->source[0];
-        int N = b->tdi->N;
+        int N = data->N;
         double *b_A = malloc(N*sizeof(double));
         double *b_E = malloc(N*sizeof(double));
         for(int i=0; i<N; i++)
@@ -699,11 +730,11 @@ int main(int argc, char *argv[])
         
         struct Source *old_catalog_entry = NULL;
         old_catalog_entry = malloc(sizeof(struct Source));
-        alloc_source(old_catalog_entry, data->N, data->Nchannel);
+        alloc_source(old_catalog_entry, data->Nchannel);
         
         struct Source *new_catalog_entry = NULL;
         new_catalog_entry = malloc(sizeof(struct Source));
-        alloc_source(new_catalog_entry, data->N, data->Nchannel);
+        alloc_source(new_catalog_entry, data->Nchannel);
         
         
         int Nsource = 0;
@@ -723,6 +754,7 @@ int main(int argc, char *argv[])
             
             //find where the source fits in the measurement band
             ucb_alignment(orbit, data_old, old_catalog_entry);
+            clear_source_tdi(old_catalog_entry, 2*old_catalog_entry->BW);
             
             //find central bin of catalog event for current data
             double q_old_catalog_entry = old_catalog_entry->f0 * data_old->T;
@@ -755,6 +787,7 @@ int main(int argc, char *argv[])
 
                 //re-align where the source fits in the (old) measurement band
                 ucb_alignment(orbit, data_old, new_catalog_entry);
+                clear_source_tdi(new_catalog_entry, 2*new_catalog_entry->BW);
                 
                 //calculate waveform of entry at Tcatalog
                 ucb_waveform(orbit, data->format, data_old->T, data->t0, new_catalog_entry->params, UCB_MODEL_NP, new_catalog_entry->tdi->X, new_catalog_entry->tdi->Y, new_catalog_entry->tdi->Z, new_catalog_entry->tdi->A, new_catalog_entry->tdi->E, new_catalog_entry->BW, data->Nchannel);
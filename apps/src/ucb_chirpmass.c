@@ -61,9 +61,15 @@ int main(int argc, char* argv[])
     return 1;
   }
   
-  FILE *ifile = fopen(argv[1],"r");
+  struct ChainFile *ifile = open_chain_file(argv[1], NULL, 0, NULL, "r");
   
   int NP = atoi(argv[2]);
+  if(ifile->Ncol<NP)
+  {
+    fprintf(stderr,"Error reading %s\n",argv[1]);
+    exit(1);
+  }
+  double *row = malloc(ifile->Ncol*sizeof(double));
   
   int tideFlag   = 0;
   double alpha0  = 0.0;
@@ -112,34 +118,21 @@ int main(int argc, char* argv[])
    12) fddot
    */
   
-  double A=0,phi=0.0,theta=0,cosi=0,psi=0,phase=0;
+  double A=0,phi=0.0,theta=0,cosi=0;
     double f = 0.0;
     double fdot = 0.0;
     double fddot = 0.0;
   double Mc,B;
-    int check;
-  while(!feof(ifile))
+  while(!read_chain_row(ifile, row))
   {
-    if(NP==9)
-    {
-        check = fscanf(ifile,"%lg%lg%lg%lg%lg%lg%lg%lg%lg",&f,&fdot,&A,&phi,&theta,&cosi,&psi,&phase,&fddot);
-        if(!check)
-        {
-            fprintf(stderr,"Error reading %s\n",argv[1]);
-            exit(1);
-        }
-    }
-    if(NP==8)
-    {
-      check = fscanf(ifile,"%lg%lg%lg%lg%lg%lg%lg%lg",&f,&fdot,&A,&phi,&theta,&cosi,&psi,&phase);
-        if(!check)
-        {
-            fprintf(stderr,"Error reading %s\n",argv[1]);
-            exit(1);
-        }
-
-      fddot = 11.0/3.0*fdot*fdot/f;
-    }
+    f     = row[0];
+    fdot  = row[1];
+    A     = row[2];
+    phi   = row[3];
+    theta = row[4];
+    cosi  = row[5];
+    if(NP==9) fddot = row[8];
+    if(NP==8) fddot = 11.0/3.0*fdot*fdot/f;
     
     //get tides
     if(tideFlag)
@@ -161,6 +154,8 @@ int main(int argc, char* argv[])
       if(Mc==Mc && B==B) fprintf(ofile,"%.12g %.12g %.12g %.12g\n",M_fdot(f,fdot),M_fddot(f,fddot),M_fdot_fddot(f,fdot,fddot),beta(f,fdot,fddot));
     }
   }
+  free(row);
+  close_chain_file(ifile);
   
   return 0;
 }
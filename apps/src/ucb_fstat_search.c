@@ -0,0 +1,644 @@
+/*
+ * Copyright 2025 Tyson B. Littenberg
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ @file ucb_fstat_search.c
+ \brief All-sky F-statistic search app `ucb_fstat_search`
+
+ Fast first pass over the full band ahead of the RJMCMC. The band is split
+ into blocks of frequency bins which are dealt out to the MPI processes.
+ Each process maximizes the F-statistic over a sky grid and a chirp mass scan
+ of the frequency derivative, with the sky pixels shared between OpenMP
+ threads, and keeps the loudest local maxima of each block in a bounded heap.
+ Root merges the candidates into a catalog cache file for `--catalog`,
+ `--update`, or `ucb_grid`.
+ */
+
+#include <mpi.h>
+
+#include <glass_utils.h>
+#include <glass_ucb.h>
+
+#define FSTAT_SEARCH_NCOL 9 //!<f0 dfdt amp phi costheta cosi psi phi0 SNR
+
+/* Search settings */
+struct FstatSearch
+{
+    int Nblock;         //frequency bins per block
+    int Ncandidate;     //candidates kept per block
+    int Nsky;           //minimum number of sky bins in cos(colatitude)
+    double sky_density; //sky bins per radian of Doppler phase
+    int Nfdot;          //chirp mass cells of the fdot scan
+    int Nsep;           //bins on either side of a candidate it must beat
+    double SNRmin;      //detection threshold
+};
+
+/* Loudest grid cell of a frequency bin */
+struct FstatCandidate
+{
+    double logL;
+    double f0;
+    double fdot;
+    double costheta;
+    double phi;
+};
+
+static void print_usage()
+{
+    print_glass_usage();
+    print_ucb_usage();
+
+    fprintf(stdout,"       ===== F-statistic search ===== \n");
+    fprintf(stdout,"       --block-size  : frequency bins per block (512)      \n");
+    fprintf(stdout,"       --candidates  : candidates kept per block (10)      \n");
+    fprintf(stdout,"       --sky-bins    : minimum cos(colatitude) bins (10)   \n");
+    fprintf(stdout,"       --sky-density : sky bins per radian of Doppler phase (1)\n");
+    fprintf(stdout,"       --fdot-bins   : chirp mass bins for fdot scan (10)  \n");
+    fprintf(stdout,"       --separation  : bins between candidates (4)         \n");
+    fprintf(stdout,"       --snr-min     : detection threshold (7)             \n");
+    fprintf(stdout,"\n");
+    fprintf(stdout,"EXAMPLE:\n");
+    fprintf(stdout,"mpirun -np 4 ucb_fstat_search --h5-data [path to]/LDC2_sangria_training_v2.h5 --sangria --fmin 0.001 --fmax 0.01 --duration 31457280\n");
+    fprintf(stdout,"\n");
+
+    exit(0);
+}
+
+static void parse_fstat_search_args(int argc, char **argv, struct FstatSearch *search)
+{
+    //Set defaults
+    search->Nblock      = 512;
+    search->Ncandidate  = 10;
+    search->Nsky        = 10;
+    search->sky_density = 1.0;
+    search->Nfdot       = 10;
+    search->Nsep        = 4;
+    search->SNRmin      = 7.0;
+
+    static struct option long_options[] =
+    {
+        {"block-size",  required_argument, 0, 0},
+        {"candidates",  required_argument, 0, 0},
+        {"sky-bins",    required_argument, 0, 0},
+        {"sky-density", required_argument, 0, 0},
+        {"fdot-bins",   required_argument, 0, 0},
+        {"separation",  required_argument, 0, 0},
+        {"snr-min",     required_argument, 0, 0},
+        {0, 0, 0, 0}
+    };
+
+    opterr = 0;
+    int opt=0;
+    int long_index=0;
+
+    //copy argv since getopt permutes order
+    char **argv_copy=malloc((argc+1) * sizeof *argv_copy);
+    copy_argv(argc,argv,argv_copy);
+
+    while ((opt = getopt_long_only(argc, argv_copy,"", long_options, &long_index )) != -1)
+    {
+        switch (opt)
+        {
+            case 0:
+                if(strcmp("block-size",  long_options[long_index].name) == 0) search->Nblock      = atoi(optarg);
+                if(strcmp("candidates",  long_options[long_index].name) == 0) search->Ncandidate  = atoi(optarg);
+                if(strcmp("sky-bins",    long_options[long_index].name) == 0) search->Nsky        = atoi(optarg);
+                if(strcmp("sky-density", long_options[long_index].name) == 0) search->sky_density = atof(optarg);
+                if(strcmp("fdot-bins",   long_options[long_index].name) == 0) search->Nfdot       = atoi(optarg);
+                if(strcmp("separation",  long_options[long_index].name) == 0) search->Nsep        = atoi(optarg);
+                if(strcmp("snr-min",     long_options[long_index].name) == 0) search->SNRmin      = atof(optarg);
+                break;
+            default:
+                break;
+        }
+    }
+
+    if(search->Nblock<1 || search->Ncandidate<1 || search->Nsky<1 || search->Nfdot<1 || search->Nsep<1)
+    {
+        fprintf(stderr,"Error: --block-size, --candidates, --sky-bins, --fdot-bins and --separation must be positive\n");
+        exit(1);
+    }
+
+    //reset opt counter
+    optind = 0;
+
+    //free placeholder for argvs
+    for(int i=0; i<=argc; i++)free(argv_copy[i]);
+    free(argv_copy);
+}
+
+static void share_data(struct TDI *tdi_full, int root, int procID)
+{
+    //first tell all processes how large the dataset is
+    MPI_Bcast(&tdi_full->N, 1, MPI_INT, root, MPI_COMM_WORLD);
+
+    //all but root process need to allocate memory for TDI structure
+    if(procID!=root) alloc_tdi(tdi_full, tdi_full->N, N_TDI_CHANNELS);
+
+    //now broadcast contents of TDI structure
+    MPI_Bcast(&tdi_full->delta, 1, MPI_DOUBLE, root, MPI_COMM_WORLD);
+    MPI_Bcast(tdi_full->X, tdi_full->N, MPI_DOUBLE, root, MPI_COMM_WORLD);
+    MPI_Bcast(tdi_full->Y, tdi_full->N, MPI_DOUBLE, root, MPI_COMM_WORLD);
+    MPI_Bcast(tdi_full->Z, tdi_full->N, MPI_DOUBLE, root, MPI_COMM_WORLD);
+    MPI_Bcast(tdi_full->A, tdi_full->N, MPI_DOUBLE, root, MPI_COMM_WORLD);
+    MPI_Bcast(tdi_full->E, tdi_full->N, MPI_DOUBLE, root, MPI_COMM_WORLD);
+}
+
+/* copy the segment of the full data starting at bin qmin into data */
+static void select_block(struct Data *data, struct TDI *tdi_full, int qmin)
+{
+    if(qmin < 0 || 2*qmin + data->N > tdi_full->N)
+    {
+        fprintf(stderr,"Error: search block [%g,%g] Hz is outside of the data\n",(double)qmin/data->T,(double)(qmin+data->NFFT)/data->T);
+        exit(1);
+    }
+
+    data->qmin = qmin;
+    data->qmax = qmin + data->NFFT;
+    data->fmin = (double)data->qmin/data->T;
+    data->fmax = (double)data->qmax/data->T;
+
+    for(int n=0; n<data->N; n++)
+    {
+        int m = 2*qmin + n;
+        data->tdi->X[n] = tdi_full->X[m];
+        data->tdi->Y[n] = tdi_full->Y[m];
+        data->tdi->Z[n] = tdi_full->Z[m];
+        data->tdi->A[n] = tdi_full->A[m];
+        data->tdi->E[n] = tdi_full->E[m];
+    }
+    copy_tdi(data->tdi, data->dft);
+}
+
+/* keep the Nmax loudest candidates in a min-heap on logL */
+static void candidate_heap_push(struct FstatCandidate *heap, int *N, int Nmax, struct FstatCandidate *c)
+{
+    int i;
+
+    if(*N < Nmax)
+    {
+        //sift new leaf up
+        i = (*N)++;
+        while(i>0 && heap[(i-1)/2].logL > c->logL)
+        {
+            heap[i] = heap[(i-1)/2];
+            i = (i-1)/2;
+        }
+        heap[i] = *c;
+    }
+    else if(c->logL > heap[0].logL)
+    {
+        //replace quietest candidate and sift it down
+        i = 0;
+        while(2*i+1 < *N)
+        {
+            int k = 2*i+1;
+            if(k+1 < *N && heap[k+1].logL < heap[k].logL) k++;
+            if(heap[k].logL >= c->logL) break;
+            heap[i] = heap[k];
+            i = k;
+        }
+        heap[i] = *c;
+    }
+}
+
+/* F-statistic of one cell maximized over fdot = 0 and a chirp mass scan, as in the F-statistic proposal */
+static double fstat_search_cell(struct Orbit *orbit, struct Data *data, int Nfdot, double f, double costheta, double phi, struct FstatWorkspace *fws, double *fdot_max)
+{
+    double d_Mc = (1.1 - 0.1)/Nfdot; //scan over chirp mass range [0.1:1.1] Msolar
+
+    double logL = get_Fstat_logL_sky(orbit, data, f, 0, costheta, phi, fws);
+    double logLmax = logL;
+    *fdot_max = 0.0;
+
+    if(logL>1)
+    {
+        for(int n=0; n<Nfdot; n++)
+        {
+            double fdot = ucb_fdot(0.1+n*d_Mc, f);
+
+            logL = get_Fstat_logL_sky(orbit, data, f, fdot, costheta, phi, fws);
+
+            if(logL>logLmax)
+            {
+                logLmax = logL;
+                *fdot_max = fdot;
+            }
+
+            if(logL<1) break;
+        }
+    }
+
+    return logLmax;
+}
+
+/* search bins [qstart,qstop) of the data segment for the loudest local maxima of the F-statistic */
+static void search_block(struct Orbit *orbit, struct Data *data, struct FstatSearch *search, struct FstatWorkspace **fws, int threads, int qstart, int qstop, struct FstatCandidate *heap, int *Nheap)
+{
+    //neighbors on either side are evaluated to compare candidates at the block edges
+    int q0 = qstart - search->Nsep;
+    int Nf = qstop - qstart + 2*search->Nsep;
+
+    //sky grid resolves the Doppler phase at the top of the block
+    int n_theta = (int)ceil(search->sky_density*PI2*((double)qstop/data->T)*AU/CLIGHT);
+    if(n_theta < search->Nsky) n_theta = search->Nsky;
+    int n_phi = 2*n_theta;
+
+    double d_theta = 2./(double)n_theta;
+    double d_phi = PI2/(double)n_phi;
+
+    //loudest cell of each bin found by each thread
+    struct FstatCandidate **best = malloc(threads*sizeof(struct FstatCandidate *));
+    for(int t=0; t<threads; t++) best[t] = calloc(Nf,sizeof(struct FstatCandidate));
+
+    #pragma omp parallel num_threads(threads)
+    {
+        struct FstatWorkspace *ws = fws[omp_get_thread_num()];
+        struct FstatCandidate *b = best[omp_get_thread_num()];
+
+        //sky pixels are shared between threads, frequency is fastest to reuse the sky geometry
+        #pragma omp for collapse(2) schedule(static)
+        for(int j=0; j<n_theta; j++)
+        {
+            for(int k=0; k<n_phi; k++)
+            {
+                double costheta = -1. + (double)j*d_theta + d_theta/2;
+                double phi = (double)k*d_phi + d_phi/2;
+
+                for(int i=0; i<Nf; i++)
+                {
+                    double fdot;
+                    double f = ((double)(q0+i) + 0.5)/data->T;
+                    double logL = fstat_search_cell(orbit, data, search->Nfdot, f, costheta, phi, ws, &fdot);
+
+                    if(logL > b[i].logL)
+                    {
+                        b[i].logL     = logL;
+                        b[i].f0       = f;
+                        b[i].fdot     = fdot;
+                        b[i].costheta = costheta;
+                        b[i].phi      = phi;
+                    }
+                }
+            }
+        }
+    }
+
+    for(int t=1; t<threads; t++)
+        for(int i=0; i<Nf; i++)
+            if(best[t][i].logL > best[0][i].logL) best[0][i] = best[t][i];
+
+    //local maxima above threshold, ties go to the lower bin
+    double logLmin = 0.5*search->SNRmin*search->SNRmin;
+    for(int i=search->Nsep; i<Nf-search->Nsep; i++)
+    {
+        if(best[0][i].logL < logLmin) continue;
+
+        int peak = 1;
+        for(int d=1; d<=search->Nsep; d++)
+        {
+            if(best[0][i-d].logL >= best[0][i].logL || best[0][i+d].logL > best[0][i].logL)
+            {
+                peak = 0;
+                break;
+            }
+        }
+        if(peak) candidate_heap_push(heap, Nheap, search->Ncandidate, &best[0][i]);
+    }
+
+    for(int t=0; t<threads; t++) free(best[t]);
+    free(best);
+}
+
+/* Fisher matrix approximation to the posterior of a candidate as a single mode GMM in catalog units */
+static void write_candidate_gmm(struct Data *data, struct Model *model, struct Source *source, char *filename)
+{
+    int N = UCB_MODEL_NP;
+
+    //params array to physical units of the catalog GMMs
+    double scale[UCB_MODEL_NP];
+    for(int i=0; i<N; i++) scale[i] = 1.0;
+    scale[0] = data->T;
+    if(UCB_MODEL_NP>7) scale[7] = data->T*data->T;
+    if(UCB_MODEL_NP>8) scale[8] = data->T*data->T*data->T;
+
+    struct MVG *mode = malloc(sizeof(struct MVG));
+    alloc_MVG(mode, N);
+
+    //Fisher matrix regularized by the variance of the uniform priors, then inverted
+    for(int i=0; i<N; i++)
+    {
+        for(int j=0; j<N; j++) mode->C[i][j] = source->fisher_matrix[i][j];
+        double width = model->prior[i][1] - model->prior[i][0];
+        mode->C[i][i] += 12./(width*width);
+    }
+    invert_matrix(mode->C, N);
+
+    for(int i=0; i<N; i++)
+    {
+        for(int j=0; j<N; j++) mode->C[i][j] /= scale[i]*scale[j];
+
+        mode->minmax[i][0] = model->prior[i][0]/scale[i];
+        mode->minmax[i][1] = model->prior[i][1]/scale[i];
+
+        //grid cells can sit just outside the prior, e.g. the fdot scan
+        double x = source->params[i];
+        if(x < model->prior[i][0]) x = model->prior[i][0];
+        if(x > model->prior[i][1]) x = model->prior[i][1];
+        mode->mu[i] = x/scale[i];
+    }
+
+    decompose_matrix(mode->C, mode->Cinv, mode->L, &mode->detC, N);
+    matrix_eigenstuff(mode->C, mode->evectors, mode->evalues, N);
+    mode->p = 1.0;
+    mode->Neff = 1.0;
+
+    size_t NMODE = 1;
+    FILE *fptr = fopen(filename,"wb");
+    fwrite(&NMODE, sizeof NMODE, 1, fptr);
+    write_MVG(mode, fptr);
+    fclose(fptr);
+
+    free_MVG(mode);
+}
+
+/* maximize extrinsic parameters of a candidate and write its catalog entry, returns its row of the candidate table */
+static void write_candidate(struct Orbit *orbit, struct Data *data, struct Model *model, struct FstatCandidate *c, char *outdir, double *row)
+{
+    char filename[MAXSTRINGSIZE];
+
+    struct Source *source = malloc(sizeof(struct Source));
+    alloc_source(source, data->Nchannel);
+
+    double *params = source->params;
+    params[0] = c->f0*data->T;
+    params[1] = c->costheta;
+    params[2] = c->phi;
+    params[7] = c->fdot*data->T*data->T;
+
+    //maximum likelihood amplitude, inclination, polarization and phase
+    double xmax[UCB_MODEL_NP];
+    get_Fstat_xmax(orbit, data, params, xmax);
+    params[3] = xmax[3];
+    params[4] = xmax[4];
+    params[5] = fmod(xmax[5] + M_PI, M_PI);
+    params[6] = fmod(xmax[6] + PI2, PI2);
+    map_array_to_params(source, params, data->T);
+
+    //name source based on frequency, as in ucb_catalog
+    char name[MAXSTRINGSIZE];
+    sprintf(name,"FST%010li",(long)(source->f0*1e10));
+
+    sprintf(filename,"%s/%s_params.dat",outdir,name);
+    FILE *fptr = fopen(filename,"w");
+    print_source_params(data,source,fptr);
+    fprintf(fptr,"\n");
+    fclose(fptr);
+
+    ucb_fisher(orbit, data, source, data->noise);
+    sprintf(filename,"%s/%s_gmm.bin",outdir,name);
+    write_candidate_gmm(data, model, source, filename);
+
+    row[0] = source->f0;
+    row[1] = source->dfdt;
+    row[2] = source->amp;
+    row[3] = source->phi;
+    row[4] = source->costheta;
+    row[5] = source->cosi;
+    row[6] = source->psi;
+    row[7] = source->phi0;
+    row[8] = sqrt(2.*c->logL);
+
+    free_source(source);
+}
+
+int main(int argc, char *argv[])
+{
+    int Nproc, procID;
+    int root = 0; //root process
+
+    MPI_Init(&argc, &argv); //start parallelization
+
+    /* get process ID, and total number of processes */
+    MPI_Comm_size(MPI_COMM_WORLD, &Nproc);
+    MPI_Comm_rank(MPI_COMM_WORLD, &procID);
+
+    if(procID==root)
+    {
+        fprintf(stdout, "\n============= UCB F-STATISTIC SEARCH ============\n");
+        print_LISA_ASCII_art(stdout);
+    }
+    if(argc==1) print_usage();
+
+    /* Allocate data structures */
+    struct Flags *flags = malloc(sizeof(struct Flags));
+    struct Orbit *orbit = malloc(sizeof(struct Orbit));
+    struct Chain *chain = malloc(sizeof(struct Chain));
+    struct Data  *data  = malloc(sizeof(struct Data));
+    struct FstatSearch *search = malloc(sizeof(struct FstatSearch));
+
+    /* Parse command line and set defaults/flags */
+    parse_data_args(argc,argv,data,orbit,flags,chain,"fourier");
+    parse_ucb_args(argc,argv,flags);
+    parse_fstat_search_args(argc,argv,search);
+    if(flags->help) print_usage();
+
+    if(!flags->strainData)
+    {
+        if(procID==root) fprintf(stderr,"Error: ucb_fstat_search requires --data or --h5-data\n");
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* F-statistic uses the noise-orthogonal A and E channels */
+    data->Nchannel = 2;
+
+    /* Search band without the padding added by parse_data_args() */
+    int q_lo = (int)(data->fmin*data->T) + data->qpad;
+    int q_hi = q_lo + data->NFFT - 2*data->qpad;
+    int Nblocks = (q_hi - q_lo + search->Nblock - 1)/search->Nblock;
+
+    /* Blocks are padded to hold the filters of sources at their edges */
+    int pad = (data->qpad > 0) ? data->qpad : search->Nblock/4;
+    if(pad < search->Nsep) pad = search->Nsep;
+    data->qpad = pad;
+    data->NFFT = search->Nblock + 2*pad;
+    data->N    = 2*data->NFFT;
+
+    /* Setup output directories */
+    char outdir[MAXSTRINGSIZE];
+    sprintf(outdir,"%s/catalog_fstat",flags->runDir);
+    if(procID==root)
+    {
+        mkdir(flags->runDir,S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        mkdir(outdir,S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+    }
+
+    /* Initialize data structures */
+    alloc_data(data, flags);
+
+    /* Initialize LISA orbit model */
+    initialize_orbit(data, orbit, flags);
+
+    /* Root reads the full data set and shares it with everyone */
+    struct TDI *tdi_full = malloc(sizeof(struct TDI));
+    if(procID==root)
+    {
+        if(flags->hdf5Data)
+        {
+            struct TDI *tdi_full_dwt = malloc(sizeof(struct TDI));
+            ReadHDF5(data, tdi_full, tdi_full_dwt, flags);
+            free_tdi(tdi_full_dwt);
+        }
+        else ReadASCII(data, tdi_full);
+    }
+    share_data(tdi_full, root, procID);
+
+    if(procID==root && !flags->quiet)
+    {
+        fprintf(stdout,"\n==== F-statistic search ====\n");
+        fprintf(stdout,"  band       = [%g,%g] Hz\n",(double)q_lo/data->T,(double)q_hi/data->T);
+        fprintf(stdout,"  blocks     = %i x %i bins on %i processes\n",Nblocks,search->Nblock,Nproc);
+        fprintf(stdout,"  candidates = %i per block with SNR > %g\n",search->Ncandidate,search->SNRmin);
+    }
+
+    /* Uniform priors set the support of the candidate GMMs */
+    struct Model *model = malloc(sizeof(struct Model));
+    alloc_model(data,model,1);
+
+    /* Per-thread F-statistic workspaces share the spacecraft positions */
+    double *sc = ucb_spacecraft_positions(orbit, data->T, data->t0, ucb_max_bandwidth(data->NFFT));
+    struct FstatWorkspace **fws = malloc(flags->threads*sizeof(struct FstatWorkspace *));
+    for(int t=0; t<flags->threads; t++) fws[t] = alloc_Fstat_workspace(data, sc);
+
+    struct FstatCandidate *heap = malloc(search->Ncandidate*sizeof(struct FstatCandidate));
+
+    /* Blocks are dealt out round-robin */
+    int Nlocal = 0;
+    for(int b=procID; b<Nblocks; b+=Nproc) Nlocal++;
+
+    double *rows = malloc((Nlocal*search->Ncandidate*FSTAT_SEARCH_NCOL+1)*sizeof(double));
+    int Nrow = 0;
+
+    int done = 0;
+    for(int b=procID; b<Nblocks; b+=Nproc)
+    {
+        int qstart = q_lo + b*search->Nblock;
+        int qstop  = (qstart + search->Nblock < q_hi) ? qstart + search->Nblock : q_hi;
+
+        select_block(data, tdi_full, qstart - pad);
+        GetNoiseModel(data, orbit, flags);
+        set_uniform_prior(flags, model, data, 0);
+
+        int Nheap = 0;
+        search_block(orbit, data, search, fws, flags->threads, qstart, qstop, heap, &Nheap);
+
+        for(int n=0; n<Nheap; n++)
+        {
+            write_candidate(orbit, data, model, &heap[n], outdir, rows+Nrow*FSTAT_SEARCH_NCOL);
+            Nrow++;
+        }
+
+        done++;
+        if(procID==root && !flags->quiet) printProgress((double)done/(double)Nlocal);
+    }
+    if(procID==root && !flags->quiet) fprintf(stdout,"\n");
+
+    for(int t=0; t<flags->threads; t++) free_Fstat_workspace(fws[t]);
+    free(fws);
+    free(sc);
+    free(heap);
+
+    /* Merge candidates on root */
+    int *counts = NULL;
+    int *displs = NULL;
+    double *all = NULL;
+    int Nsend = Nrow*FSTAT_SEARCH_NCOL;
+    int Ntotal = 0;
+
+    if(procID==root) counts = int_vector(Nproc);
+    MPI_Gather(&Nsend, 1, MPI_INT, counts, 1, MPI_INT, root, MPI_COMM_WORLD);
+
+    if(procID==root)
+    {
+        displs = int_vector(Nproc);
+        for(int n=0; n<Nproc; n++)
+        {
+            displs[n] = Ntotal;
+            Ntotal += counts[n];
+        }
+        all = malloc((Ntotal+1)*sizeof(double));
+    }
+    MPI_Gatherv(rows, Nsend, MPI_DOUBLE, all, counts, displs, MPI_DOUBLE, root, MPI_COMM_WORLD);
+
+    if(procID==root)
+    {
+        int Ncand = Ntotal/FSTAT_SEARCH_NCOL;
+
+        //sort by frequency
+        double *f = double_vector(Ncand+1);
+        int *index = int_vector(Ncand+1);
+        for(int n=0; n<Ncand; n++) f[n] = all[n*FSTAT_SEARCH_NCOL];
+        index_sort(index, f, Ncand);
+
+        char path[MAXSTRINGSIZE];
+        if(realpath(outdir,path)==NULL) strcpy(path,outdir);
+
+        char filename[MAXSTRINGSIZE];
+        sprintf(filename,"%s/fstat_candidates.dat",flags->runDir);
+        FILE *table = fopen(filename,"w");
+        sprintf(filename,"%s/entries.dat",outdir);
+        FILE *entries = fopen(filename,"w");
+        sprintf(filename,"%s/fstat_catalog.cache",flags->runDir);
+        FILE *cache = fopen(filename,"w");
+
+        for(int n=0; n<Ncand; n++)
+        {
+            double *row = all + index[n]*FSTAT_SEARCH_NCOL;
+
+            char name[MAXSTRINGSIZE];
+            sprintf(name,"FST%010li",(long)(row[0]*1e10));
+
+            fprintf(table,"%.16g ",row[0]);
+            for(int i=1; i<FSTAT_SEARCH_NCOL; i++) fprintf(table,"%.12g ",row[i]);
+            fprintf(table,"\n");
+
+            //no posterior yet, so every candidate enters with unit evidence
+            fprintf(entries,"%s %lg %lg\n",name,row[8],1.0);
+            fprintf(cache,"%s %.16g %lg %lg %s/\n",name,row[0],row[8],1.0,path);
+        }
+
+        fclose(table);
+        fclose(entries);
+        fclose(cache);
+
+        if(!flags->quiet) fprintf(stdout,"found %i candidates, see %s\n",Ncand,filename);
+
+        free_double_vector(f);
+        free_int_vector(index);
+        free_int_vector(counts);
+        free_int_vector(displs);
+        free(all);
+    }
+
+    free(rows);
+    free_model(model);
+    free_tdi(tdi_full);
+
+    MPI_Finalize();//ends the parallelization
+
+    return 0;
+}
@@ -23,7 +23,16 @@
 
 int main(int argc, char* argv[])
 {
-    FILE *cachefile = fopen("ucb_catalog.cache","r");
+    //catalog cache file, e.g. from ucb_catalog or ucb_fstat_search
+    char cachename[256] = "ucb_catalog.cache";
+    if(argc>1) sprintf(cachename,"%s",argv[1]);
+    
+    FILE *cachefile = fopen(cachename,"r");
+    if(cachefile==NULL)
+    {
+        fprintf(stderr,"Error opening %s\n",cachename);
+        exit(1);
+    }
     char name[256];
     char path[256];
     double snr;
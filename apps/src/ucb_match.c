@@ -91,25 +91,15 @@ int main(int argc, char *argv[])
     
     //allocate memory for two sources and noise
     struct Source *src1 = malloc(sizeof(struct Source));
-    alloc_source(src1, data->N, 2);
+    alloc_source(src1, 2);
     
     struct Source *src2 = malloc(sizeof(struct Source));
-    alloc_source(src2, data->N, 2);
+    alloc_source(src2, 2);
     
     struct Noise *noise = malloc(sizeof(struct Noise));
     alloc_noise(noise, data->NFFT, 1, 2);
     
     
-    for(int n=0; n<data->N; n++)
-    {
-        src1->tdi->A[n] = 0.0;
-        src1->tdi->E[n] = 0.0;
-        src1->tdi->X[n] = 0.0;
-        src2->tdi->A[n] = 0.0;
-        src2->tdi->E[n] = 0.0;
-        src2->tdi->X[n] = 0.0;
-    }
-    
     //Get noise spectrum for data segment
     for(int n=0; n<data->NFFT; n++)
     {
@@ -145,14 +135,9 @@ int main(int argc, char *argv[])
     
     while(!feof(chain_file2))
     {
-        for(int n=0; n<data->N; n++)
-        {
-            src2->tdi->A[n] = 0.0;
-            src2->tdi->E[n] = 0.0;
-        }
-        
         scan_source_params(data, src2, chain_file2);
         ucb_alignment(orbit, data, src2);
+        clear_source_tdi(src2, 2*src2->BW);
         ucb_waveform(orbit, data->format, data->T, data->t0, src2->params, UCB_MODEL_NP, src2->tdi->X, src2->tdi->Y, src2->tdi->Z, src2->tdi->A, src2->tdi->E, src2->BW, 2);
 
         max_match=-INFINITY;
@@ -163,14 +148,9 @@ int main(int argc, char *argv[])
             
             if( fabs(src1->params[0] - src2->params[0]) < 20.)
             {
-                for(int n=0; n<data->N; n++)
-                {
-                    src1->tdi->A[n] = 0.0;
-                    src1->tdi->E[n] = 0.0;
-                }
-                
                 //Book-keeping of injection time-frequency volume
                 ucb_alignment(orbit, data, src1);
+                clear_source_tdi(src1, 2*src1->BW);
                 ucb_waveform(orbit, data->format, data->T, data->t0, src1->params, UCB_MODEL_NP, src1->tdi->X, src1->tdi->Y,src1->tdi->Z, src1->tdi->A, src1->tdi->E, src1->BW, 2);
                                 
                 match = waveform_match(src1, src2, noise);
@@ -37,6 +37,57 @@ static void print_usage()
     exit(0);
 }
 
+/* Sampler state shared by every chain's block of steps, see run_chain_blocks() */
+struct UCBChainBlock
+{
+    struct Orbit *orbit;
+    struct Data *data;
+    struct Model **model;
+    struct Model **trial;
+    struct Chain *chain;
+    struct Flags *flags;
+    struct Prior *prior;
+    struct Proposal **proposal;
+};
+
+/* One block of MCMC steps for chain ic */
+static void ucb_chain_block(void *arg, int ic)
+{
+    struct UCBChainBlock *block = arg;
+    struct Orbit *orbit = block->orbit;
+    struct Data *data = block->data;
+    struct Chain *chain = block->chain;
+    struct Flags *flags = block->flags;
+    struct Prior *prior = block->prior;
+    struct Proposal **proposal = block->proposal;
+    
+    struct Model *model_ptr = block->model[chain->index[ic]];
+    struct Model *trial_ptr = block->trial[chain->index[ic]];
+    copy_model(model_ptr,trial_ptr);
+
+    for(int steps=0; steps < 500; steps++)
+    {
+        //reverse jump birth/death or split/merge moves
+        if(rand_r_U_0_1(&chain->r[ic])<0.1 && flags->rj)
+        {
+            ucb_rjmcmc(orbit, data, model_ptr, trial_ptr, chain, flags, prior, proposal, ic);
+        }
+        //fixed dimension parameter updates
+        else
+        {
+            ucb_mcmc(orbit, data, model_ptr, trial_ptr, chain, flags, prior, proposal, ic);
+        }
+
+        if( (flags->strainData || flags->simNoise) && !flags->psd)
+            noise_model_mcmc(orbit, data, model_ptr, trial_ptr, chain, flags, ic);
+
+    }//loop over MCMC steps
+
+    //update fisher matrix for each chain
+    for(int n=0; n<model_ptr->Nlive; n++)
+        ucb_fisher(orbit, data, model_ptr->source[n], data->noise);
+}
+
 /**
  * This is the main function
  *
@@ -157,28 +208,11 @@ int main(int argc, char *argv[])
     {
         fprintf(stdout,"\n=============== Checkpointing ===============\n");
         
-        //check for files needed to resume
-        FILE *fptr = NULL;
-        int file_error = 0;
-        
-        for(int ic=0; ic<chain->NC; ic++)
-        {
-            sprintf(filename,"%s/checkpoint/chain_state_%i.dat",flags->runDir,ic);
-            
-            if( (fptr = fopen(filename,"r")) == NULL )
-            {
-                fprintf(stderr,"Warning: Could not checkpoint run state\n");
-                fprintf(stderr,"         Parameter file %s does not exist\n",filename);
-                file_error++;
-                break;
-            }
-        }
-        
-        //if all of the files exist resume run from checkpointed state
-        if(!file_error)
+        //if the checkpoint exists resume run from checkpointed state
+        if(check_chain_state(chain))
         {
             fprintf(stdout,"   Checkpoint files found. Resuming chain\n");
-            restore_chain_state(orbit, data, model, chain, flags, &mcmc_start);
+            restore_chain_state(orbit, data, model, chain, flags, proposal, &mcmc_start);
         }
         fprintf(stdout,"============================================\n\n");
     }
@@ -207,6 +241,13 @@ int main(int argc, char *argv[])
     //For saving the number of threads actually given
     int numThreads;
     int mcmc = mcmc_start;
+    
+    //background writer for chain files and checkpoints
+    struct UCBOutput *output = alloc_ucb_output(data, flags, chain, DMAX);
+    
+    //state for each chain's block of steps
+    struct UCBChainBlock block = {orbit, data, model, trial, chain, flags, prior, proposal};
+    
     #pragma omp parallel num_threads(flags->threads)
     {
         int threadID;
@@ -229,46 +270,19 @@ int main(int argc, char *argv[])
             
             
             #pragma omp barrier
-            // (parallel) loop over chains
-            for(int ic=threadID; ic<NC; ic+=numThreads)
-            {
-                
-                //loop over frequency segments
-                struct Model *model_ptr = model[chain->index[ic]];
-                struct Model *trial_ptr = trial[chain->index[ic]];
-                copy_model(model_ptr,trial_ptr);
-
-                for(int steps=0; steps < 500; steps++)
-                {
-                    //reverse jump birth/death or split/merge moves
-                    if(rand_r_U_0_1(&chain->r[ic])<0.1 && flags->rj)
-                    {
-                        ucb_rjmcmc(orbit, data, model_ptr, trial_ptr, chain, flags, prior, proposal, ic);
-                    }
-                    //fixed dimension parameter updates
-                    else
-                    {
-                            ucb_mcmc(orbit, data, model_ptr, trial_ptr, chain, flags, prior, proposal, ic);
-                    }  
-
-                    if( (flags->strainData || flags->simNoise) && !flags->psd)
-                        noise_model_mcmc(orbit, data, model_ptr, trial_ptr, chain, flags, ic);
-
-                }//loop over MCMC steps
-
-                //update fisher matrix for each chain
-                for(int n=0; n<model_ptr->Nlive; n++)
-                    ucb_fisher(orbit, data, model_ptr->source[n], data->noise);
-                
-            }// end (parallel) loop over chains
+            // (parallel) loop over chains, returns when every chain has finished its block
+            run_chain_blocks(chain, ucb_chain_block, &block);
             
-            //Next section is single threaded. Every thread must get here before continuing
-            #pragma omp barrier
+            //Next section is single threaded
             if(threadID==0){
                 ptmcmc(model,chain,flags);
                 adapt_temperature_ladder(chain, mcmc+flags->NBURN);
+                if(flags->adaptProposals && flags->burnin) adapt_proposal_weights(proposal, UCB_PROPOSAL_NPROP, 0);
+                if(flags->delayedAcceptance && flags->burnin) adapt_proposal_screening(proposal, UCB_PROPOSAL_NPROP, 0);
                 
-                print_chain_files(data, model, chain, flags, mcmc);
+                //chain files, waveform draws and checkpoints are written by the output thread
+                struct UCBOutputRecord *record = begin_ucb_output(output);
+                record->step = mcmc;
                 
                 //track maximum log Likelihood
                 if(mcmc%100)
@@ -277,11 +291,7 @@ int main(int argc, char *argv[])
                 }
                 
                 //store reconstructed waveform
-                if(!flags->quiet) 
-                {
-                    print_waveform_draw(data, model[chain->index[0]], flags);
-                    print_psd_draw(data, model[chain->index[0]], flags);
-                }
+                record->draw = !flags->quiet;
                 
                 //update run status
                 if(mcmc%data->downsample==0)
@@ -295,14 +305,15 @@ int main(int argc, char *argv[])
                     }
                     
                     //save chain state to resume sampler
-                    save_chain_state(data, model, chain, flags, mcmc);
+                    record->checkpoint = 1;
+                    record->state_step = mcmc;
                     
                 }
                 
                 //dump waveforms to file, update avgLogL for thermodynamic integration
                 if(mcmc>0 && mcmc%data->downsample==0)
                 {
-                    save_waveforms(data, model[chain->index[0]], mcmc/data->downsample);
+                    record->waveform = mcmc/data->downsample;
                     
                     for(int ic=0; ic<NC; ic++)
                     {
@@ -311,6 +322,8 @@ int main(int argc, char *argv[])
                     }
                 }
                 
+                submit_ucb_output(output, model, chain, proposal);
+                
                 if(mcmc>-flags->NBURN+flags->NBURN/10. && model[0]->Neff < model[0]->Nmax && flags->rj)
                 {
                     for(int ic=0; ic<NC; ic++) model[ic]->Neff++;
@@ -327,8 +340,11 @@ int main(int argc, char *argv[])
         }// end MCMC loop
     }// End of parallelization
     
+    //finish writing the chain files before the final state
+    free_ucb_output(output);
+    
     //store final state of sampler
-    save_chain_state(data, model, chain, flags, mcmc);
+    save_chain_state(data, model, chain, flags, proposal, mcmc);
 
     //print aggregate run files/results
     print_waveforms_reconstruction(data,flags);
@@ -345,6 +361,12 @@ int main(int argc, char *argv[])
     for(int ic=0; ic<NC; ic++) fprintf(chainFile,"%lg %lg\n",1./chain->temperature[ic],chain->avgLogL[ic]/(double)(flags->NMCMC/data->downsample));
     fclose(chainFile);
     
+    free_ucb_state(model, trial, NC);
+    
+    //print timing summary of hot paths
+    sprintf(filename,"%s/profile.dat",flags->runDir);
+    write_profile(filename);
+    
     //print total run time
     stop = time(NULL);
     
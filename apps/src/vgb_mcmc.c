@@ -37,6 +37,53 @@ static void print_usage()
     exit(0);
 }
 
+/* Sampler state shared by every chain's block of steps, see run_chain_blocks() */
+struct VGBChainBlock
+{
+    struct Orbit *orbit;
+    struct Data **data_vec;
+    struct Model ***model_vec;
+    struct Model ***trial_vec;
+    struct Chain **chain_vec;
+    struct Flags *flags;
+    struct Prior **prior_vec;
+    struct Proposal ***proposal_vec;
+    int *mcmc;
+};
+
+/* One block of MCMC steps for chain ic of every verification binary */
+static void vgb_chain_block(void *arg, int ic)
+{
+    struct VGBChainBlock *block = arg;
+    struct Orbit *orbit = block->orbit;
+    struct Flags *flags = block->flags;
+    
+    //loop over verification binary segments
+    for(int n=0; n<flags->NVB; n++)
+    {
+        struct Data *data = block->data_vec[n];
+        struct Chain *chain = block->chain_vec[n];
+        
+        struct Model *model_ptr = block->model_vec[n][chain->index[ic]];
+        struct Model *trial_ptr = block->trial_vec[n][chain->index[ic]];
+        copy_model(model_ptr,trial_ptr);
+        
+        for(int steps=0; steps < 100; steps++)
+        {
+            ucb_mcmc(orbit, data, model_ptr, trial_ptr, chain, flags, block->prior_vec[n], block->proposal_vec[n], ic);
+        }//loop over MCMC steps
+        
+        //update fisher matrix for each chain
+        if(*block->mcmc%100==0)
+        {
+            for(int i=0; i<model_ptr->Nlive; i++)
+            {
+                ucb_fisher(orbit, data, model_ptr->source[i], data->noise);
+            }
+        }
+    }
+}
+
 /**
  * This is the main function
  *
@@ -140,7 +187,7 @@ int main(int argc, char *argv[])
             chain->NC = chain_vec[0]->NC;    //number of chains
         }
 
-        alloc_source(inj, data->N, data->Nchannel);
+        alloc_source(inj, data->Nchannel);
 
         data->nseed+=n;
 
@@ -229,28 +276,11 @@ int main(int argc, char *argv[])
         fprintf(stdout,"\n=============== Checkpointing ===============\n");
         for(int n=0; n<flags->NVB; n++)
         {
-            //check for files needed to resume
-            FILE *fptr = NULL;
-            int file_error = 0;
-            
-            for(int ic=0; ic<chain_vec[n]->NC; ic++)
-            {
-                sprintf(filename,"%s/chain_state_%i.dat",chain_vec[n]->chkptDir,ic);
-                
-                if( (fptr = fopen(filename,"r")) == NULL )
-                {
-                    fprintf(stderr,"Warning: Could not checkpoint run state\n");
-                    fprintf(stderr,"         Parameter file %s does not exist\n",filename);
-                    file_error++;
-                    break;
-                }
-            }
-            
-            //if all of the files exist resume run from checkpointed state
-            if(!file_error)
+            //if the checkpoint exists resume run from checkpointed state
+            if(check_chain_state(chain_vec[n]))
             {
                 fprintf(stdout,"   Checkpoint files found. Resuming chain\n");
-                restore_chain_state(orbit, data_vec[n], model_vec[n], chain_vec[n], flags, &mcmc_start);
+                restore_chain_state(orbit, data_vec[n], model_vec[n], chain_vec[n], flags, proposal_vec[n], &mcmc_start);
             }
         }
         fprintf(stdout,"============================================\n\n");
@@ -262,6 +292,9 @@ int main(int argc, char *argv[])
     //For saving the number of threads actually given
     int numThreads;
     int mcmc = mcmc_start;
+    //state for each chain's block of steps
+    struct VGBChainBlock block = {orbit, data_vec, model_vec, trial_vec, chain_vec, flags, prior_vec, proposal_vec, &mcmc};
+    
     #pragma omp parallel num_threads(flags->threads)
     {
         int threadID;
@@ -284,36 +317,10 @@ int main(int argc, char *argv[])
             }
             
             #pragma omp barrier
-            // (parallel) loop over chains
-            for(int ic=threadID; ic<NC; ic+=numThreads)
-            {
-                
-                //loop over verification binary segments
-                for(int n=0; n<flags->NVB; n++)
-                {
-                    
-                    struct Model *model_ptr = model_vec[n][chain_vec[n]->index[ic]];
-                    struct Model *trial_ptr = trial_vec[n][chain_vec[n]->index[ic]];
-                    
-                    for(int steps=0; steps < 100; steps++)
-                    {
-                        ucb_mcmc(orbit, data_vec[n], model_ptr, trial_ptr, chain_vec[n], flags, prior_vec[n], proposal_vec[n], ic);
-                    }//loop over MCMC steps
-                    
-                    //update fisher matrix for each chain
-                    if(mcmc%100==0)
-                    {
-                        for(int i=0; i<model_ptr->Nlive; i++)
-                        {
-                            ucb_fisher(orbit, data_vec[n], model_ptr->source[i], data_vec[n]->noise);
-                        }
-                    }
-                }
-                
-            }// end (parallel) loop over chains
+            // (parallel) loop over chains, returns when every chain has finished its block
+            run_chain_blocks(chain_vec[0], vgb_chain_block, &block);
             
-            //Next section is single threaded. Every thread must get here before continuing
-            #pragma omp barrier
+            //Next section is single threaded
             if(threadID==0){
                 
                 for(int n=0; n<flags->NVB; n++)
@@ -327,6 +334,8 @@ int main(int argc, char *argv[])
                     
                     ptmcmc(model,chain,flags);
                     adapt_temperature_ladder(chain, mcmc+flags->NBURN);
+                    if(flags->adaptProposals && mcmc<0) adapt_proposal_weights(proposal, UCB_PROPOSAL_NPROP, 0);
+                    if(flags->delayedAcceptance && mcmc<0) adapt_proposal_screening(proposal, UCB_PROPOSAL_NPROP, 0);
                     
                     print_chain_files(data, model, chain, flags, mcmc);
                     
@@ -351,7 +360,7 @@ int main(int argc, char *argv[])
                         }
 
                         //save chain state to resume sampler
-                        save_chain_state(data, model, chain, flags, mcmc);
+                        save_chain_state(data, model, chain, flags, proposal, mcmc);
 
                     }
 
@@ -380,6 +389,13 @@ int main(int argc, char *argv[])
     for(int n=0; n<flags->NVB; n++)
         print_waveforms_reconstruction(data_vec[n],flags);    
     
+    for(int n=0; n<flags->NVB; n++)
+        free_ucb_state(model_vec[n], trial_vec[n], NC);
+    
+    //print timing summary of hot paths
+    sprintf(filename,"%s/profile.dat",flags->runDir);
+    write_profile(filename);
+    
     //print total run time
     stop = time(NULL);
     
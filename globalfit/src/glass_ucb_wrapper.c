@@ -198,27 +198,8 @@ void initialize_ucb_sampler(struct UCBData *ucb_data)
     /* Start analysis from saved chain state */
     if(flags->resume)
     {
-        char filename[MAXSTRINGSIZE];
-        
-        //check for files needed to resume
-        FILE *fptr = NULL;
-        int file_error = 0;
-        
-        for(int ic=0; ic<chain->NC; ic++)
-        {
-            sprintf(filename,"%s/checkpoint/chain_state_%i.dat",flags->runDir,ic);
-            
-            if( (fptr = fopen(filename,"r")) == NULL )
-            {
-                fprintf(stderr,"Warning: Could not checkpoint run state for segment %i\n",ucb_data->procID);
-                fprintf(stderr,"         Parameter file %s does not exist\n",filename);
-                file_error++;
-                break;
-            }
-        }
-        
-        //if all of the files exist resume run from checkpointed state
-        if(!file_error) restore_chain_state(orbit, data, model, chain, flags, &ucb_data->mcmc_step);
+        //if the checkpoint exists resume run from checkpointed state
+        if(check_chain_state(chain)) restore_chain_state(orbit, data, model, chain, flags, proposal, &ucb_data->mcmc_step);
     }
     
     /* Store data segment in working directory */
@@ -283,7 +264,10 @@ int update_ucb_sampler(struct UCBData *ucb_data)
             //loop over frequency segments
             struct Model *model_ptr = model[chain->index[ic]];
             struct Model *trial_ptr = trial[chain->index[ic]];
-            
+
+            //data and noise have changed since the last update
+            if(model_ptr->summary) reset_summary_data(data, model_ptr->summary, model_ptr->noise);
+
             //update model likelihood using new residual
             model_ptr->logL = gaussian_log_likelihood(data, model_ptr);
             model_ptr->logLnorm = gaussian_log_likelihood_model_norm(data, model_ptr);
@@ -318,6 +302,8 @@ int update_ucb_sampler(struct UCBData *ucb_data)
     
     ptmcmc(model,chain,flags);
     adapt_temperature_ladder(chain, ucb_data->mcmc_step+flags->NBURN);
+    if(flags->adaptProposals && ucb_data->mcmc_step<0) adapt_proposal_weights(proposal, UCB_PROPOSAL_NPROP, 0);
+    if(flags->delayedAcceptance && ucb_data->mcmc_step<0) adapt_proposal_screening(proposal, UCB_PROPOSAL_NPROP, 0);
     
     if(ucb_data->mcmc_step < flags->NMCMC)
     {
@@ -335,7 +321,7 @@ int update_ucb_sampler(struct UCBData *ucb_data)
             print_sampler_state(ucb_data);
             
             //save chain state to resume sampler
-            //save_chain_state(data, model, chain, flags, ucb_data->mcmc_step);
+            //save_chain_state(data, model, chain, flags, proposal, ucb_data->mcmc_step);
         }
         
         //dump waveforms to file, update avgLogL for thermodynamic integration
@@ -424,6 +410,7 @@ void exchange_ucb_source_params(struct UCBData *ucb_data)
     }
     
     /* send to either side */
+    double prof = profile_start();
     int left_neighbor = procID-1;
     int right_neighbor = procID+1;
     if(left_neighbor>=procID_min)
@@ -458,6 +445,7 @@ void exchange_ucb_source_params(struct UCBData *ucb_data)
         MPI_Recv(&params_left, Nparams_left, MPI_DOUBLE, left_neighbor, tag, MPI_COMM_WORLD,&status);
     if(right_neighbor<=procID_max)
         MPI_Recv(&params_right, Nparams_right, MPI_DOUBLE, right_neighbor, tag, MPI_COMM_WORLD,&status);
+    profile_stop(PROFILE_MPI, prof);
     
     /* populate new model structure with neighboring waveforms */
     int Nparams_new = Nparams_left + Nparams_right;
@@ -525,6 +513,7 @@ void exchange_ucb_source_params(struct UCBData *ucb_data)
 
 int get_ucb_status(struct UCBData *ucb_data, int Nproc, int root, int procID)
 {
+    double prof = profile_start();
     int UCB_Status = 0;
     int PIDmin = ucb_data->procID_min;
     int PIDmax = ucb_data->procID_max;
@@ -548,6 +537,7 @@ int get_ucb_status(struct UCBData *ucb_data, int Nproc, int root, int procID)
     /* root node shares global status with worker nodes */
     MPI_Bcast(&UCB_Status, 1, MPI_INT, root, MPI_COMM_WORLD);
     
+    profile_stop(PROFILE_MPI, prof);
     return UCB_Status;
 }
 
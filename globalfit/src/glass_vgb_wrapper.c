@@ -101,7 +101,7 @@ void setup_vgb_data(struct VGBData *vgb_data, struct UCBData *ucb_data, struct T
         alloc_data(data, flags);
         
         /* Initialize source structure to hold EM parameters */
-        alloc_source(vgb, data->N, data->Nchannel);
+        alloc_source(vgb, data->Nchannel);
         
         /* Get source from verification binary file */
         GetVerificationBinary(data, flags, vgb, vbFile);
@@ -222,6 +222,9 @@ int update_vgb_sampler(struct VGBData *vgb_data)
                 struct Model *model_ptr = model_vec[n][chain_vec[n]->index[ic]];
                 struct Model *trial_ptr = trial_vec[n][chain_vec[n]->index[ic]];
                 
+                //data and noise have changed since the last update
+                if(model_ptr->summary) reset_summary_data(data_vec[n], model_ptr->summary, model_ptr->noise);
+                
                 model_ptr->logL = gaussian_log_likelihood(data_vec[n], model_ptr);
                 model_ptr->logLnorm = gaussian_log_likelihood_model_norm(data_vec[n], model_ptr);
 
@@ -250,6 +253,8 @@ int update_vgb_sampler(struct VGBData *vgb_data)
 
         ptmcmc(model_vec[n],chain_vec[n],flags);
         adapt_temperature_ladder(chain_vec[n], vgb_data->mcmc_step+flags->NBURN);
+        if(flags->adaptProposals && vgb_data->mcmc_step<0) adapt_proposal_weights(proposal_vec[n], UCB_PROPOSAL_NPROP, 0);
+        if(flags->delayedAcceptance && vgb_data->mcmc_step<0) adapt_proposal_screening(proposal_vec[n], UCB_PROPOSAL_NPROP, 0);
         
         if(vgb_data->mcmc_step < flags->NMCMC)
         {
@@ -274,7 +279,7 @@ int update_vgb_sampler(struct VGBData *vgb_data)
                 }
                 
                 //save chain state to resume sampler
-                save_chain_state(data, model, chain, flags, vgb_data->mcmc_step);
+                save_chain_state(data, model, chain, flags, proposal, vgb_data->mcmc_step);
                 
             }
             
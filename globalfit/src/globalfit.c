@@ -76,6 +76,7 @@ static void setup_gf_data(struct GlobalFitData *global_fit)
 
 static void share_data(struct TDI *tdi_full, int root, int procID)
 {
+    double prof = profile_start();
     //first tell all processes how large the dataset is
     MPI_Bcast(&tdi_full->N, 1, MPI_INT, root, MPI_COMM_WORLD);
 
@@ -91,6 +92,7 @@ static void share_data(struct TDI *tdi_full, int root, int procID)
     MPI_Bcast(tdi_full->E, 2*tdi_full->N, MPI_DOUBLE, root, MPI_COMM_WORLD);
     MPI_Bcast(tdi_full->T, 2*tdi_full->N, MPI_DOUBLE, root, MPI_COMM_WORLD);
     
+    profile_stop(PROFILE_MPI, prof);
 }
 
 static void dump_data(struct Data *data, struct Flags *flags)
@@ -146,6 +148,7 @@ static void share_vgb_model(struct UCBData *ucb_data,
                                struct GlobalFitData *gf,
                                int root, int procID)
 {
+    double prof = profile_start();
 
     /* get waveforms from vgb sampler and send to root */
     if(procID==1)
@@ -229,6 +232,7 @@ static void share_vgb_model(struct UCBData *ucb_data,
         MPI_Recv(gf->tdi_vgb->Z, gf->tdi_vgb->N*2, MPI_DOUBLE, root, 2, MPI_COMM_WORLD, &status);
     }*/
 
+    profile_stop(PROFILE_MPI, prof);
 }
 
 static void share_ucb_model(struct UCBData *ucb_data,
@@ -237,6 +241,7 @@ static void share_ucb_model(struct UCBData *ucb_data,
                                struct GlobalFitData *gf,
                                int root, int procID)
 {
+    double prof = profile_start();
     if(procID>=ucb_data->procID_min && procID<=ucb_data->procID_max)
     {
         struct Data *data = ucb_data->data;
@@ -335,6 +340,7 @@ static void share_ucb_model(struct UCBData *ucb_data,
         MPI_Recv(gf->tdi_ucb->Z, gf->tdi_ucb->N*2, MPI_DOUBLE, root, 2, MPI_COMM_WORLD, &status);
     }*/
 
+    profile_stop(PROFILE_MPI, prof);
 }
 
 
@@ -439,6 +445,7 @@ static void share_noise_model(struct NoiseData *noise_data,
                               int root,
                               int procID)
 {
+    double prof = profile_start();
     
     int ic = 0;
     if(procID==root)
@@ -457,6 +464,7 @@ static void share_noise_model(struct NoiseData *noise_data,
         }
     }
     MPI_Bcast(global_fit->psd->detC, global_fit->psd->N, MPI_DOUBLE, root, MPI_COMM_WORLD);
+    profile_stop(PROFILE_MPI, prof);
 }
 
 static void create_residual(struct GlobalFitData *global_fit, int UCB_Flag, int VGB_Flag, int MBH_Flag)
@@ -505,6 +513,7 @@ static void print_data_state(struct NoiseData *noise_data,
                              int MBH_Flag
                              )
 {
+    double prof = profile_start();
     if(Noise_Flag)
     {
         print_data(noise_data->data, noise_data->flags);
@@ -574,6 +583,7 @@ static void print_data_state(struct NoiseData *noise_data,
         fclose(tempFile);
         
     }*/
+    profile_stop(PROFILE_IO, prof);
 }
 
 static void print_globalfit_state(struct NoiseData *noise_data, 
@@ -586,6 +596,7 @@ static void print_globalfit_state(struct NoiseData *noise_data,
                                   FILE *fptr,
                                   int counter)
 {
+    double prof = profile_start();
     if(Noise_Flag)
         print_noise_state(noise_data, fptr, counter);
     
@@ -597,10 +608,12 @@ static void print_globalfit_state(struct NoiseData *noise_data,
     
     /*if(MBH_Flag)
         print_mbh_state(mbh_data, fptr, counter);*/
+    profile_stop(PROFILE_IO, prof);
 }
 
 static void blocked_gibbs_load_balancing(struct GlobalFitData *global_fit, int root, int procID, int Nproc)
 {
+    double prof = profile_start();
     
     double *block_time_vec=malloc(sizeof(double)*Nproc);
     
@@ -615,6 +628,7 @@ static void blocked_gibbs_load_balancing(struct GlobalFitData *global_fit, int r
     }
     MPI_Bcast(&global_fit->max_block_time, 1, MPI_DOUBLE, root, MPI_COMM_WORLD);
     free(block_time_vec);
+    profile_stop(PROFILE_MPI, prof);
 }
 
 static void print_usage()
@@ -1071,6 +1085,8 @@ int main(int argc, char *argv[])
                 
         /* evidence results */
         print_evidence(chain,flags);
+        
+        free_ucb_state(ucb_data->model, ucb_data->trial, ucb_data->chain->NC);
     }
     if(VGB_Flag)
     {
@@ -1078,6 +1094,8 @@ int main(int argc, char *argv[])
         {
             /* waveform reconstructions */
             print_waveforms_reconstruction(vgb_data->data_vec[n], vgb_data->flags);
+            
+            free_ucb_state(vgb_data->model_vec[n], vgb_data->trial_vec[n], vgb_data->chain_vec[n]->NC);
         }
     }
     if(Noise_Flag)
@@ -1094,6 +1112,11 @@ int main(int argc, char *argv[])
     
     print_data_state(noise_data,ucb_data,vgb_data,UCB_Flag,VGB_Flag,Noise_Flag,MBH_Flag);
 
+    //print timing summary of hot paths for each process
+    char profile_filename[MAXSTRINGSIZE];
+    sprintf(profile_filename,"%s/profile_%04d.dat",flags->runDir,procID);
+    write_profile(profile_filename);
+    
     //print total run time
     stop = time(NULL);
 
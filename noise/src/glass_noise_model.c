@@ -180,6 +180,7 @@ void copy_foreground_model(struct ForegroundModel *origin, struct ForegroundMode
 
 void update_spline_noise_model(struct SplineModel *model, int new_knot, int min_knot, int max_knot)
 {
+    double prof = profile_start();
     struct Noise *psd = model->psd;
     struct Noise *spline = model->spline;
     
@@ -220,11 +221,13 @@ void update_spline_noise_model(struct SplineModel *model, int new_knot, int min_
         free_cubic_spline(cspline[n]);
     }
     free(cspline);
+    profile_stop_count(PROFILE_NOISE, prof, imax-imin);
 }
 
 
 void generate_spline_noise_model(struct SplineModel *model)
 {
+    double prof = profile_start();
     struct Noise *psd = model->psd;
     struct Noise *spline = model->spline;
     
@@ -244,10 +247,12 @@ void generate_spline_noise_model(struct SplineModel *model)
         
     }
     invert_noise_covariance_matrix(psd);
+    profile_stop_count(PROFILE_NOISE, prof, psd->N);
 }
 
 void generate_instrument_noise_model(struct Orbit *orbit, struct InstrumentModel *model)
 {
+    double prof = profile_start();
     double f,f2;
     double x;
     double cosx;
@@ -392,6 +397,7 @@ void generate_instrument_noise_model(struct Orbit *orbit, struct InstrumentModel
             for(int j=0; j<model->psd->Nchannel; j++)
                 model->psd->C[i][j][n] /= 2.0;
     }
+    profile_stop_count(PROFILE_NOISE, prof, model->psd->N);
 }
 
 void generate_instrument_noise_model_wavelet(struct Wavelets *wdm, struct Orbit *orbit, struct InstrumentModel *model)
@@ -448,6 +454,7 @@ void generate_instrument_noise_model_wavelet(struct Wavelets *wdm, struct Orbit
 
 void generate_galactic_foreground_model(struct ForegroundModel *model)
 {
+    double prof = profile_start();
     double f;
     double Sgal;
     
@@ -483,6 +490,7 @@ void generate_galactic_foreground_model(struct ForegroundModel *model)
                 break;
         }
     }
+    profile_stop_count(PROFILE_NOISE, prof, model->psd->N);
 }
 
 void generate_galactic_foreground_model_wavelet(struct Wavelets *wdm, struct ForegroundModel *model)
@@ -563,6 +571,7 @@ void generate_full_covariance_matrix(struct Noise *full, struct Noise *component
 
 void generate_full_dynamic_covariance_matrix(struct Wavelets *wdm, struct InstrumentModel *inst, struct ForegroundModel *conf, struct Noise *full)
 {
+    double prof = profile_start();
     int k;
     int jmin=(int)round(inst->psd->f[0]/wdm->df);
     int jmax=(int)round(inst->psd->f[inst->psd->N-1]/wdm->df)+1; 
@@ -598,10 +607,12 @@ void generate_full_dynamic_covariance_matrix(struct Wavelets *wdm, struct Instru
             full->C[2][1][k] = full->C[1][2][k]; 
         } //loop over frequency layers
     } //loop over time slices
+    profile_stop(PROFILE_NOISE, prof);
 }
 
 static void generate_full_stationary_covariance_matrix(struct Wavelets *wdm, struct InstrumentModel *inst, struct ForegroundModel *conf, struct Noise *full)
 {
+    double prof = profile_start();
     int k;
     int jmin=(int)round(inst->psd->f[0]/wdm->df);
     int jmax=(int)round(inst->psd->f[inst->psd->N-1]/wdm->df)+1;
@@ -636,10 +647,12 @@ static void generate_full_stationary_covariance_matrix(struct Wavelets *wdm, str
             full->C[2][1][k] = full->C[1][2][k];
         }// loop over frequency layers
     }// loop over time slices
+    profile_stop(PROFILE_NOISE, prof);
 }
 
 double noise_log_likelihood(struct Data *data, struct Noise *noise)
 {
+    double prof = profile_start();
     double logL = 0.0;
     
     struct TDI *tdi = data->tdi;
@@ -667,11 +680,13 @@ double noise_log_likelihood(struct Data *data, struct Noise *noise)
     for(int n=0; n<N; n++)
         logL -= log(noise->detC[n]);
     
+    profile_stop_count(PROFILE_LIKELIHOOD, prof, N);
     return logL;
 }
 
 double noise_delta_log_likelihood(struct Data *data, struct SplineModel *model_x, struct SplineModel *model_y, double fmin, double fmax,int ic)
 {
+    double prof = profile_start();
     double dlogL = 0.0;
     
     struct TDI *tdi = data->tdi;
@@ -694,6 +709,7 @@ double noise_delta_log_likelihood(struct Data *data, struct SplineModel *model_x
     for(int n=imin; n<imin+N; n++)
         dlogL -= log(psd_y->detC[n]);
     
+    profile_stop_count(PROFILE_LIKELIHOOD, prof, N);
     return dlogL;
 }
 
@@ -30,7 +30,7 @@ void alloc_entry(struct Entry *entry, int IMAX)
     entry->match  = malloc(IMAX*sizeof(double));
     entry->distance  = malloc(IMAX*sizeof(double));
     entry->stepFlag = calloc(IMAX,sizeof(int));
-    entry->gmm = malloc(sizeof(struct GMM));
+    entry->gmm = calloc(1,sizeof(struct GMM));
 }
 
 void free_entry(struct Entry *entry, int IMAX)
@@ -42,9 +42,41 @@ void free_entry(struct Entry *entry, int IMAX)
     free(entry->stepFlag);
     for(size_t n=0; n<entry->gmm->NMODE; n++) free_MVG(entry->gmm->modes[n]);
     free(entry->gmm->modes);
+    if(entry->gmm->table) free_gmm_table(entry->gmm->table);
     free(entry->gmm);
 }
 
+struct GMM *combine_catalog_gmm(struct Catalog *catalog)
+{
+    int N = catalog->N;
+    
+    struct GMM *gmm = calloc(1,sizeof(struct GMM));
+    gmm->NParams = (size_t)UCB_MODEL_NP;
+    gmm->NMODE = 0;
+    for(int n=0; n<N; n++) gmm->NMODE += catalog->entry[n]->gmm->NMODE;
+    gmm->modes = malloc(gmm->NMODE*sizeof(struct MVG *));
+    
+    size_t m=0;
+    for(int n=0; n<N; n++)
+    {
+        for(size_t i=0; i<catalog->entry[n]->gmm->NMODE; i++)
+        {
+            gmm->modes[m] = malloc(sizeof(struct MVG));
+            alloc_MVG(gmm->modes[m], UCB_MODEL_NP);
+            copy_MVG(catalog->entry[n]->gmm->modes[i],gmm->modes[m]);
+            
+            //(clumsily) renormalize modes
+            gmm->modes[m]->p /= (double)N;
+            
+            m++;
+        }
+    }
+    
+    compile_gmm(gmm);
+    
+    return gmm;
+}
+
 void create_empty_source(struct Catalog *catalog, int NFFT, int Nchannel)
 {
     int N = catalog->N;
@@ -55,7 +87,7 @@ void create_empty_source(struct Catalog *catalog, int NFFT, int Nchannel)
     
     alloc_entry(entry,1);
     entry->source[entry->Nchain] = malloc(sizeof(struct Source));
-    alloc_source(entry->source[entry->Nchain], NFFT, Nchannel);
+    alloc_source(entry->source[entry->Nchain], Nchannel);
 
     entry->match[entry->Nchain] = 1.0;
     entry->distance[entry->Nchain] = 0.0;
@@ -74,7 +106,7 @@ void create_new_source(struct Catalog *catalog, struct Source *sample, struct No
     
     alloc_entry(entry,IMAX);
     entry->source[entry->Nchain] = malloc(sizeof(struct Source));
-    alloc_source(entry->source[entry->Nchain], NFFT, Nchannel);
+    alloc_source(entry->source[entry->Nchain], Nchannel);
     
     //add sample to the catalog as the new entry
     copy_source(sample, entry->source[entry->Nchain]);
@@ -95,6 +95,15 @@ void get_correlation_matrix(struct Data *data, struct Catalog *catalog, int *det
  */
 int gaussian_mixture_model_wrapper(double **ranges, struct Flags *flags, struct Entry *entry, char *outdir, size_t NMODE, size_t NTHIN, unsigned int *seed, double *BIC);
 
+/**
+ \brief Combine the GMMs of every entry in `catalog` into one compiled GMM.
+
+ Each entry's modes are weighted by 1/catalog->N. The frequency index of
+ the compiled table lets evaluations visit only the entries near the
+ requested frequency.
+ */
+struct GMM *combine_catalog_gmm(struct Catalog *catalog);
+
 
 
 #endif /* ucb_catalog_h */
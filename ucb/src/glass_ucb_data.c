@@ -31,6 +31,7 @@ void UCBInjectVerificationSet(struct Data *data, struct Orbit *orbit, struct Fla
 
     //Book-keeping of injection time-frequency volume
     ucb_alignment(orbit, data, inj);
+    clear_source_tdi(inj, 2*inj->BW);
 
     ucb_waveform(orbit, data->format, data->T, data->t0, inj->params, UCB_MODEL_NP, inj->tdi->X, inj->tdi->Y, inj->tdi->Z, inj->tdi->A, inj->tdi->E, inj->BW, data->Nchannel);
     
@@ -73,7 +74,7 @@ void UCBInjectVerificationSource(struct Data *data, struct Orbit *orbit, struct
     FILE *fptr;
     
     /* structure for holding injection source parameters and waveforms */
-    alloc_source(inj, data->N, data->Nchannel);
+    alloc_source(inj, data->Nchannel);
     
     /* Get injection parameters */
     double f0,dfdt,costheta,phi,m1,m2,D; //read from injection file
@@ -144,15 +145,6 @@ void UCBInjectVerificationSource(struct Data *data, struct Orbit *orbit, struct
         if(!flags->quiet)fprintf(stdout,"Frequency bins for segment [%i,%i]\n",data->qmin,data->qmax);
         if(!flags->quiet) fprintf(stdout,"   ...start time  %g\n",data->t0);
         
-        for(int n=0; n<data->N; n++)
-        {
-            inj->tdi->A[n] = 0.0;
-            inj->tdi->E[n] = 0.0;
-            inj->tdi->X[n] = 0.0;
-            inj->tdi->Y[n] = 0.0;
-            inj->tdi->Z[n] = 0.0;
-        }
-        
         //map parameters to vector
         inj->f0       = f0;
         inj->dfdt     = dfdt;
@@ -174,6 +166,7 @@ void UCBInjectVerificationSource(struct Data *data, struct Orbit *orbit, struct
         
         //Book-keeping of injection time-frequency volume
         ucb_alignment(orbit, data, inj);
+        clear_source_tdi(inj, 2*inj->BW);
         
         //Simulate gravitational wave signal
         ucb_waveform(orbit, data->format, data->T, data->t0, inj->params, 8, inj->tdi->X, inj->tdi->Y, inj->tdi->Z, inj->tdi->A, inj->tdi->E, inj->BW, 2);
@@ -306,7 +299,7 @@ void UCBInjectSimulatedSource(struct Data *data, struct Orbit *orbit, struct Fla
         {
             if(n_inj<flags->DMAX)
             {
-                alloc_source(inj_vec[n_inj], data->N, data->Nchannel);
+                alloc_source(inj_vec[n_inj], data->Nchannel);
                 inj = inj_vec[n_inj];
             }
             else
@@ -367,15 +360,6 @@ void UCBInjectSimulatedSource(struct Data *data, struct Orbit *orbit, struct Fla
                 if(!flags->quiet)fprintf(stdout,"   ...start time: %g\n",data->t0);
             }
             
-            for(int n=0; n<data->N; n++)
-            {
-                inj->tdi->A[n] = 0.0;
-                inj->tdi->E[n] = 0.0;
-                inj->tdi->X[n] = 0.0;
-                inj->tdi->Y[n] = 0.0;
-                inj->tdi->Z[n] = 0.0;
-            }
-            
             //map polarization angle into [0:pi], preserving relation to phi0
             if(psi>M_PI) psi  -= M_PI;
             if(phi0>PI2) phi0 -= PI2;
@@ -408,6 +392,7 @@ void UCBInjectSimulatedSource(struct Data *data, struct Orbit *orbit, struct Fla
             if(!strcmp("fourier",data->basis))
             {
                 ucb_alignment(orbit, data, inj);
+                clear_source_tdi(inj, 2*inj->BW);
                 if(inj->qmax < data->qmin || inj->qmin > data->qmax)
                 {
                     fprintf(stdout,"Injection %i is outside of the requested frequency segment\n",nn);
@@ -424,7 +409,10 @@ void UCBInjectSimulatedSource(struct Data *data, struct Orbit *orbit, struct Fla
             if(!strcmp("fourier",data->basis))     
                 ucb_waveform(orbit, data->format, data->T, data->t0, inj->params, UCB_MODEL_NP, inj->tdi->X, inj->tdi->Y, inj->tdi->Z, inj->tdi->A, inj->tdi->E, inj->BW, data->Nchannel);
             if(!strcmp("wavelet",data->basis)) 
+            {
+                clear_source_tdi(inj, data->N);
                 ucb_waveform_wavelet(orbit, data->wdm, data->T, data->t0, inj->params, inj->list, &inj->Nlist, inj->tdi->X, inj->tdi->Y, inj->tdi->Z);
+            }
             
             
             //Add waveform to data TDI channels
@@ -468,19 +456,34 @@ void UCBInjectSimulatedSource(struct Data *data, struct Orbit *orbit, struct Fla
             fptr=fopen(filename,"w");
             if(!strcmp("fourier",data->basis))
             {
+                //injection is stored band-local, zero outside of its bandwidth
+                double h[6];
                 for(int i=0; i<data->NFFT; i++)
                 {
                     double f = (double)(i+data->qmin)/data->T;
+                    int n = i-inj->imin;
+                    for(int m=0; m<6; m++) h[m] = 0.0;
+                    if(n>-1 && n<inj->BW)
+                    {
+                        h[0] = inj->tdi->X[2*n]; h[1] = inj->tdi->X[2*n+1];
+                        h[2] = inj->tdi->Y[2*n]; h[3] = inj->tdi->Y[2*n+1];
+                        h[4] = inj->tdi->Z[2*n]; h[5] = inj->tdi->Z[2*n+1];
+                        if(data->Nchannel==2)
+                        {
+                            h[0] = inj->tdi->A[2*n]; h[1] = inj->tdi->A[2*n+1];
+                            h[2] = inj->tdi->E[2*n]; h[3] = inj->tdi->E[2*n+1];
+                        }
+                    }
                     switch(data->Nchannel)
                     {
                         case 1:
-                            fprintf(fptr,"%.14e %.14e %.14e\n", f, inj->tdi->X[2*i],tdi->X[2*i+1]);
+                            fprintf(fptr,"%.14e %.14e %.14e\n", f, h[0], h[1]);
                             break;
                         case 2:
-                            fprintf(fptr,"%.14e %.14e %.14e %.14e %.14e\n", f, inj->tdi->A[2*i],tdi->A[2*i+1], tdi->E[2*i],tdi->E[2*i+1]);
+                            fprintf(fptr,"%.14e %.14e %.14e %.14e %.14e\n", f, h[0], h[1], h[2], h[3]);
                             break;
                         case 3:
-                            fprintf(fptr,"%.14e %.14e %.14e %.14e %.14e %.14e %.14e\n", f, inj->tdi->X[2*i],inj->tdi->X[2*i+1], inj->tdi->Y[2*i],inj->tdi->Y[2*i+1],inj->tdi->Z[2*i],inj->tdi->Z[2*i+1]);
+                            fprintf(fptr,"%.14e %.14e %.14e %.14e %.14e %.14e %.14e\n", f, h[0], h[1], h[2], h[3], h[4], h[5]);
                             break;
                     }
                 }
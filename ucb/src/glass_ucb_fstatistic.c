@@ -763,118 +763,222 @@ void get_Fstat_xmax(struct Orbit *orbit, struct Data *data, double *x, double *x
 }
 
 
-double get_Fstat_logL_wavelet(struct Orbit *orbit, struct Data *data, double f0, double fdot, double theta, double phi)
+struct FstatWaveletWorkspace *alloc_Fstat_wavelet_workspace(struct Orbit *orbit, struct Data *data)
 {
+    struct FstatWaveletWorkspace *fws = malloc(sizeof(struct FstatWaveletWorkspace));
+    
+    //filters span at most 3 frequency layers, downsampled to 4*NT samples
+    fws->Nmax = 4*data->wdm->NT;
+    fws->list = int_vector(fws->Nmax);
+    fws->filter = malloc(12*sizeof(double *));
+    for(int i=0; i<12; i++) fws->filter[i] = double_vector(fws->Nmax);
+    fws->ws = alloc_ucb_wavelet_workspace(orbit, data->wdm);
+    
+    return fws;
+}
 
+void free_Fstat_wavelet_workspace(struct FstatWaveletWorkspace *fws)
+{
+    for(int i=0; i<12; i++) free_double_vector(fws->filter[i]);
+    free(fws->filter);
+    free_int_vector(fws->list);
+    free_ucb_wavelet_workspace(fws->ws);
+    free(fws);
+}
+
+double get_Fstat_logL_wavelet(struct Orbit *orbit, struct Data *data, double f0, double fdot, double theta, double phi, struct FstatWaveletWorkspace *fws)
+{
+    int i,j,n;
+    
     /* compute filters A_i */
+    double params[UCB_MODEL_NP] = {0};
+    params[0] = f0*data->T;  //frequency
+    params[1] = cos(theta);  //ecliptic lat
+    params[2] = phi;         //ecliptic lon
+    params[7] = fdot*data->T*data->T;
+    
+    int Nlist;
+    ucb_waveform_wavelet_filters(orbit, data->wdm, data->T, data->t0, params, fws->list, &Nlist, fws->filter, fws->ws);
     
-    int Nfilter = 4;
+    //catch waveforms that are out of band
+    if(Nlist==0) return 1.0;
     
-    struct Source **A = malloc(Nfilter*(sizeof(struct Source *)));
-    for(int i=0; i<Nfilter; i++) 
+    /*
+     N_i = (s|A_i) and M_ij = (A_i|A_j) in one pass over the shared pixels
+     */
+    double N[4] = {0};
+    double M[4][4] = {{0}};
+    
+    double *d[3] = {data->tdi->X, data->tdi->Y, data->tdi->Z};
+    double ***invC = data->noise->invC;
+    
+    for(n=0; n<Nlist; n++)
     {
-        A[i] = malloc(sizeof(struct Source));
-        alloc_source(A[i],data->N,data->Nchannel);
+        int k = fws->list[n];
+        
+        double h[4][3];
+        for(i=0; i<4; i++)
+            for(int a=0; a<3; a++)
+                h[i][a] = fws->filter[3*i+a][n];
+        
+        //C^{-1} applied to data and filters
+        double Cd[3], Ch[4][3];
+        for(int a=0; a<3; a++)
+        {
+            Cd[a] = 0.0;
+            for(int b=0; b<3; b++) Cd[a] += invC[a][b][k]*d[b][k];
+            for(i=0; i<4; i++)
+            {
+                Ch[i][a] = 0.0;
+                for(int b=0; b<3; b++) Ch[i][a] += invC[a][b][k]*h[i][b];
+            }
+        }
+        
+        for(i=0; i<4; i++)
+        {
+            for(int a=0; a<3; a++) N[i] += Cd[a]*h[i][a];
+            for(j=i; j<4; j++)
+                for(int a=0; a<3; a++) M[i][j] += Ch[i][a]*h[j][a];
+        }
     }
     
-    //set parameters for each filter
-    for(int i=0; i<Nfilter; i++)
+    //Cholesky decomposition M = L L^T in place of the lower triangle
+    for(j=0; j<4; j++)
     {
-        A[i]->params[0] = f0*data->T;  //frequency
-        A[i]->params[1] = cos(theta);  //ecliptic lat
-        A[i]->params[2] = phi;         //ecliptic lon
-        A[i]->params[3] = log(2.0);    //log amplitude
-        A[i]->params[4] = cos(M_PI_2); //cos inclination
-
-        switch(i)
+        double s = M[j][j];
+        for(n=0; n<j; n++) s -= M[n][j]*M[n][j];
+        if(!(s > 0.0)) return 0.0;
+        M[j][j] = sqrt(s);
+        for(i=j+1; i<4; i++)
         {
-            case 0:
-                A[i]->params[5] = 0;      //polarization
-                A[i]->params[6] = 0;      //initial phase
-                break;
-            case 1:
-                A[i]->params[5] = M_PI_4; //polarization
-                A[i]->params[6] = M_PI;   //initial phase
-                break;
-            case 2:
-                A[i]->params[5] = 0;       //polarization
-                A[i]->params[6] = 3*M_PI_2;//initial phase
-                break;
-            case 3:
-                A[i]->params[5] = M_PI_4;  //polarization
-                A[i]->params[6] = M_PI_2;  //initial phase
-                break;
-            default:
-                break;
+            s = M[j][i];
+            for(n=0; n<j; n++) s -= M[n][i]*M[n][j];
+            M[j][i] = s/M[j][j];
         }
-
-        A[i]->params[7] = fdot*data->T*data->T;
-        if(UCB_MODEL_NP>8) A[i]->params[8] = 0.0;
-
-        map_array_to_params(A[i], A[i]->params, data->T);
-        ucb_waveform_wavelet(orbit,data->wdm,data->T, data->t0, A[i]->params, A[i]->list, &A[i]->Nlist, A[i]->tdi->X, A[i]->tdi->Y, A[i]->tdi->Z);
-
-        //catch waveforms that are out of band
-        if(A[i]->Nlist==0) return 1.0;
-        
     }
     
-    /* compute vectors N_i = (s|A_i) */
-    double *N = double_vector(Nfilter);
+    /* get logL = N * M^-1 * N = |L^{-1} N|^2 */
+    double logL = 0.0;
+    for(i=0; i<4; i++)
+    {
+        double y = N[i];
+        for(n=0; n<i; n++) y -= M[n][i]*N[n];
+        N[i] = y/M[i][i];
+        logL += N[i]*N[i];
+    }
+    
+    return logL;
+}
 
-    for(int i=0; i<Nfilter; i++)
+struct FstatWorkspace *alloc_Fstat_workspace(struct Data *data, double *sc)
+{
+    struct FstatWorkspace *fws = malloc(sizeof(struct FstatWorkspace));
+    
+    fws->BW  = ucb_max_bandwidth(data->NFFT);
+    fws->sc  = sc;
+    fws->tdi = select_LISA_tdi(data->format);
+    fws->geo = alloc_ucb_sky_geometry(fws->BW);
+    fws->ws  = alloc_ucb_waveform_workspace(fws->BW, 0);
+    
+    fws->filter = malloc(4*sizeof(struct TDI *));
+    for(int i=0; i<4; i++)
     {
-        N[i] += wavelet_nwip(data->tdi->X, A[i]->tdi->X, data->noise->invC[0][0], A[i]->list, A[i]->Nlist);
-        N[i] += wavelet_nwip(data->tdi->Y, A[i]->tdi->Y, data->noise->invC[1][1], A[i]->list, A[i]->Nlist);
-        N[i] += wavelet_nwip(data->tdi->Z, A[i]->tdi->Z, data->noise->invC[2][2], A[i]->list, A[i]->Nlist);
-        N[i] += wavelet_nwip(data->tdi->X, A[i]->tdi->Y, data->noise->invC[0][1], A[i]->list, A[i]->Nlist);
-        N[i] += wavelet_nwip(data->tdi->X, A[i]->tdi->Z, data->noise->invC[0][2], A[i]->list, A[i]->Nlist);
-        N[i] += wavelet_nwip(data->tdi->Y, A[i]->tdi->Z, data->noise->invC[1][2], A[i]->list, A[i]->Nlist);
-        N[i] += wavelet_nwip(data->tdi->Y, A[i]->tdi->X, data->noise->invC[1][0], A[i]->list, A[i]->Nlist);
-        N[i] += wavelet_nwip(data->tdi->Z, A[i]->tdi->X, data->noise->invC[2][0], A[i]->list, A[i]->Nlist);
-        N[i] += wavelet_nwip(data->tdi->Z, A[i]->tdi->Y, data->noise->invC[2][1], A[i]->list, A[i]->Nlist);
+        fws->filter[i] = malloc(sizeof(struct TDI));
+        alloc_tdi(fws->filter[i], 2*fws->BW, 2);
     }
+    
+    return fws;
+}
 
-    /* compute matrix M_ij = (A_i|A_j) */
-    double **M = double_matrix(Nfilter,Nfilter);
-    for(int i=0; i<Nfilter; i++)
+void free_Fstat_workspace(struct FstatWorkspace *fws)
+{
+    for(int i=0; i<4; i++) free_tdi(fws->filter[i]);
+    free(fws->filter);
+    free_ucb_waveform_workspace(fws->ws);
+    free_ucb_sky_geometry(fws->geo);
+    free(fws);
+}
+
+double get_Fstat_logL_sky(struct Orbit *orbit, struct Data *data, double f0, double fdot, double costheta, double phi, struct FstatWorkspace *fws)
+{
+    int i,j,n;
+    
+    //antenna pattern pieces are shared by every f and fdot at this sky location
+    if(costheta != fws->geo->costh || phi != fws->geo->phi)
+        ucb_sky_geometry(orbit, fws->sc, costheta, phi, fws->geo);
+    
+    int BW = ucb_bandwidth(orbit->L, orbit->fstar, f0, fdot, costheta, 1.e-22, data->T, data->NFFT);
+    
+    //same filter parameters as get_filters(), extrinsic parameters are set by the basis
+    double params[UCB_MODEL_NP] = {0};
+    params[0] = f0*data->T;
+    params[1] = costheta;
+    params[2] = phi;
+    params[7] = fdot*data->T*data->T;
+    
+    ucb_waveform_filters_sky(orbit, fws->tdi, data->T, data->t0, params, UCB_MODEL_NP, fws->geo, fws->filter, BW, 2, fws->ws);
+    
+    /*
+     N^{i} = (s|A^{i}) and M^{ij} = (A^{i}|A^{j}) in one pass over the filter band.
+     The basis differs from get_filters() by a permutation and scaling,
+     which leaves N^{i} M^{-1}_{ij} N^{j} unchanged.
+     */
+    double N[4] = {0};
+    double M[4][4] = {{0}};
+    
+    long q = (long)(f0*data->T) - (int)(data->fmin*data->T);
+    
+    double *AA = data->dft->A;
+    double *EE = data->dft->E;
+    double *Sn = data->noise->C[0][0];
+    
+    for(n=0; n<BW; n++)
     {
-        for(int j=0; j<Nfilter; j++) //Mij symmetric so this could be faster
+        long k = q + n - BW/2;
+        
+        if(k>0 && k<data->NFFT)
         {
-            int *list = int_vector(data->N);
-            int Nlist;
-            list_union(A[i]->list, A[j]->list, A[i]->Nlist, A[j]->Nlist, list, &Nlist);
-
-            M[i][j] += wavelet_nwip(A[i]->tdi->X, A[j]->tdi->X, data->noise->invC[0][0], list, Nlist);
-            M[i][j] += wavelet_nwip(A[i]->tdi->Y, A[j]->tdi->Y, data->noise->invC[1][1], list, Nlist);
-            M[i][j] += wavelet_nwip(A[i]->tdi->Z, A[j]->tdi->Z, data->noise->invC[2][2], list, Nlist);
-            M[i][j] += wavelet_nwip(A[i]->tdi->X, A[j]->tdi->Y, data->noise->invC[0][1], list, Nlist);
-            M[i][j] += wavelet_nwip(A[i]->tdi->X, A[j]->tdi->Z, data->noise->invC[0][2], list, Nlist);
-            M[i][j] += wavelet_nwip(A[i]->tdi->Y, A[j]->tdi->Z, data->noise->invC[1][2], list, Nlist);
-            M[i][j] += wavelet_nwip(A[i]->tdi->Y, A[j]->tdi->X, data->noise->invC[1][0], list, Nlist);
-            M[i][j] += wavelet_nwip(A[i]->tdi->Z, A[j]->tdi->X, data->noise->invC[2][0], list, Nlist);
-            M[i][j] += wavelet_nwip(A[i]->tdi->Z, A[j]->tdi->Y, data->noise->invC[2][1], list, Nlist);
-
-            free(list);
+            double w = 4.0/Sn[k];
+            double Ar[4], Ai[4], Er[4], Ei[4];
+            for(i=0; i<4; i++)
+            {
+                Ar[i] = fws->filter[i]->A[2*n];
+                Ai[i] = fws->filter[i]->A[2*n+1];
+                Er[i] = fws->filter[i]->E[2*n];
+                Ei[i] = fws->filter[i]->E[2*n+1];
+                
+                N[i] += w*(AA[2*k]*Ar[i] + AA[2*k+1]*Ai[i] + EE[2*k]*Er[i] + EE[2*k+1]*Ei[i]);
+            }
+            for(i=0; i<4; i++)
+                for(j=i; j<4; j++)
+                    M[i][j] += w*(Ar[i]*Ar[j] + Ai[i]*Ai[j] + Er[i]*Er[j] + Ei[i]*Ei[j]);
         }
     }
     
-    //invert M-matrix
-    invert_matrix(M,Nfilter);
-
-    /* get logL = N * M^-1 * N */
+    //Cholesky decomposition M = L L^T in place of the lower triangle
+    for(j=0; j<4; j++)
+    {
+        double d = M[j][j];
+        for(n=0; n<j; n++) d -= M[n][j]*M[n][j];
+        if(!(d > 0.0)) return 0.0;
+        M[j][j] = sqrt(d);
+        for(i=j+1; i<4; i++)
+        {
+            double s = M[j][i];
+            for(n=0; n<j; n++) s -= M[n][i]*M[n][j];
+            M[j][i] = s/M[j][j];
+        }
+    }
+    
+    //logL = 1/2 N^T M^{-1} N = 1/2 |L^{-1} N|^2
     double logL = 0.0;
-    for(int i=0; i<Nfilter; i++) 
-        for(int j=0; j<Nfilter; j++) 
-            logL += N[i]*M[i][j]*N[j]; //also ignoring symmetry
-
-
-    for(int i=0; i<Nfilter; i++) free_source(A[i]);
-    free(A);
-
-    free_double_vector(N);
-    free_double_matrix(M,Nfilter);
-
-    return logL;
+    for(i=0; i<4; i++)
+    {
+        double y = N[i];
+        for(n=0; n<i; n++) y -= M[n][i]*N[n];
+        N[i] = y/M[i][i];
+        logL += N[i]*N[i];
+    }
+    
+    return 0.5*logL;
 }
-
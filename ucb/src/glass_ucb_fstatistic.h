@@ -80,6 +80,95 @@ void get_Fstat_logL(struct Orbit *orbit, struct Data *data, double f0, double fd
 
 void get_Fstat_xmax(struct Orbit *orbit, struct Data *data, double *x, double *xmax);
 
-double get_Fstat_logL_wavelet(struct Orbit *orbit, struct Data *data, double f0, double fdot, double theta, double phi);
+/**
+ \brief Scratch memory for get_Fstat_logL_wavelet()
+
+ One per thread. Holds the compact filters on their shared wavelet pixels.
+ */
+struct FstatWaveletWorkspace
+{
+    int Nmax;                        //!<largest number of filter pixels
+    int *list;                       //!<wavelet pixels of the filters
+    double **filter;                 //!<channel `c` of filter `i` on the pixels, `filter[3*i+c]`
+    struct UCBWaveletWorkspace *ws;  //!<waveform scratch memory
+};
+
+/**
+ \brief Allocate FstatWaveletWorkspace for wavelet domain `data`
+ */
+struct FstatWaveletWorkspace *alloc_Fstat_wavelet_workspace(struct Orbit *orbit, struct Data *data);
+
+/**
+ \brief Free memory from alloc_Fstat_wavelet_workspace()
+ */
+void free_Fstat_wavelet_workspace(struct FstatWaveletWorkspace *fws);
+
+/**
+ \brief Allocation free F-statistic \f$ \log L \f$ of the X, Y, Z channels in the wavelet domain
+
+ The four filters come from one ucb_waveform_wavelet_filters() call and share
+ their wavelet pixels, so \f$ N^{i} \f$ and \f$ M^{ij} \f$ are accumulated
+ together over that one list before solving the 4x4 system in place.
+
+ @param orbit LISA ephemerides
+ @param data wavelet domain data and noise model
+ @param f0 frequency \f$ [{\rm Hz}] \f$
+ @param fdot frequency derivative \f$ [{\rm Hz}\ {\rm s}^{-1}] \f$
+ @param theta ecliptic co-latitude
+ @param phi ecliptic longitude
+ @param fws per-thread scratch memory from alloc_Fstat_wavelet_workspace()
+ @return \f$ N^{i} M^{-1}_{ij} N^{j} \f$, 1 if the filters are out of band, or 0 if they are degenerate
+ */
+double get_Fstat_logL_wavelet(struct Orbit *orbit, struct Data *data, double f0, double fdot, double theta, double phi, struct FstatWaveletWorkspace *fws);
+
+/**
+ \brief Scratch memory for get_Fstat_logL_sky()
+
+ One per thread. Holds the filters, the waveform scratch memory, and the
+ antenna pattern pieces of the most recent sky location so that all the
+ frequency and frequency derivative cells of a sky pixel share them.
+ */
+struct FstatWorkspace
+{
+    int BW;                          //!<largest filter bandwidth, from ucb_max_bandwidth()
+    double *sc;                      //!<spacecraft positions on BW samples, shared between threads
+    LISA_tdi_function tdi;           //!<TDI synthesis for the data format
+    struct UCBSkyGeometry *geo;      //!<sky geometry of the current sky location
+    struct UCBWaveformWorkspace *ws; //!<waveform scratch memory
+    struct TDI **filter;             //!<basis responses \f$ A^{i} \f$
+};
+
+/**
+ \brief Allocate FstatWorkspace for F-statistic grids over `data`
+
+ @param data the data being searched
+ @param sc spacecraft positions from ucb_spacecraft_positions() on ucb_max_bandwidth() samples
+ */
+struct FstatWorkspace *alloc_Fstat_workspace(struct Data *data, double *sc);
+
+/**
+ \brief Free memory from alloc_Fstat_workspace(), except the shared spacecraft positions
+ */
+void free_Fstat_workspace(struct FstatWorkspace *fws);
+
+/**
+ \brief Allocation free F-statistic \f$ \log L \f$ of the A and E channels for grid searches
+
+ Same statistic as `logL_AE` from get_Fstat_logL(). The sky geometry is only
+ recomputed when the sky location differs from the previous call with `fws`,
+ the four filters come from one ucb_waveform_filters_sky() pass, and
+ \f$ N^{i} \f$ and \f$ M^{ij} \f$ are accumulated together before solving the
+ 4x4 system in place.
+
+ @param orbit LISA ephemerides
+ @param data data and noise model
+ @param f0 frequency \f$ [{\rm Hz}] \f$
+ @param fdot frequency derivative \f$ [{\rm Hz}\ {\rm s}^{-1}] \f$
+ @param costheta cosine of ecliptic co-latitude
+ @param phi ecliptic longitude
+ @param fws per-thread scratch memory from alloc_Fstat_workspace()
+ @return \f$ \log L_{AE} \f$, or 0 if the filters are degenerate
+ */
+double get_Fstat_logL_sky(struct Orbit *orbit, struct Data *data, double f0, double fdot, double costheta, double phi, struct FstatWorkspace *fws);
 
 #endif /* ucb_fstatistic_h */
@@ -14,11 +14,16 @@
  * limitations under the License.
  */
 
+#include <unistd.h>
+
 #include <glass_utils.h>
 
+#include "glass_ucb_catalog.h"
 #include "glass_ucb_model.h"
+#include "glass_ucb_prior.h"
 #include "glass_ucb_waveform.h"
 #include "glass_ucb_io.h"
+#include "glass_ucb_proposal.h"
 
 void print_ucb_usage()
 {
@@ -44,6 +49,14 @@ void print_ucb_usage()
     fprintf(stdout,"       --update-cov  : use cov matrix proposal [filename]  \n");
     fprintf(stdout,"       --catalog     : list of known sources               \n");
     fprintf(stdout,"       --ucb-grid    : ucb frequency grid [filename]       \n");
+    fprintf(stdout,"       --adapt-proposals: tune proposal weights in burn in \n");
+    fprintf(stdout,"       --fstat-adaptive: coarse-to-fine F-stat proposal  \n");
+    fprintf(stdout,"\n");
+
+    //Likelihood
+    fprintf(stdout,"       ======== Likelihood ======== \n");
+    fprintf(stdout,"       --summary-logL: summary logL, 1-source extrinsic moves\n");
+    fprintf(stdout,"       --delayed-acceptance: screen with low-BW logL   \n");
     fprintf(stdout,"\n");
 
     //Injections
@@ -73,6 +86,10 @@ void parse_ucb_args(int argc, char **argv, struct Flags *flags)
     flags->knownSource = 0;
     flags->catalog     = 0;
     flags->grid        = 0;
+    flags->summaryLogL = 0;
+    flags->delayedAcceptance = 0;
+    flags->adaptProposals = 0;
+    flags->fstatAdaptive  = 0;
     flags->update      = 0;
     flags->updateCov   = 0;
     flags->match       = 0;
@@ -107,6 +124,10 @@ void parse_ucb_args(int argc, char **argv, struct Flags *flags)
         {"f-double-dot",no_argument, 0, 0 },
         {"detached",    no_argument, 0, 0 },
         {"cheat",       no_argument, 0, 0 },
+        {"summary-logL",no_argument, 0, 0 },
+        {"delayed-acceptance",no_argument, 0, 0 },
+        {"adapt-proposals",no_argument, 0, 0 },
+        {"fstat-adaptive",no_argument, 0, 0 },
         {0, 0, 0, 0}
     };
     
@@ -128,6 +149,10 @@ void parse_ucb_args(int argc, char **argv, struct Flags *flags)
                 //TODO: get NP back on the CLI if(strcmp("f-double-dot",long_options[long_index].name) == 0) data->NP          = 9;
                 if(strcmp("detached",    long_options[long_index].name) == 0) flags->detached   = 1;
                 if(strcmp("cheat",       long_options[long_index].name) == 0) flags->cheat      = 1;
+                if(strcmp("summary-logL",long_options[long_index].name) == 0) flags->summaryLogL= 1;
+                if(strcmp("delayed-acceptance",long_options[long_index].name) == 0) flags->delayedAcceptance = 1;
+                if(strcmp("adapt-proposals",long_options[long_index].name) == 0) flags->adaptProposals = 1;
+                if(strcmp("fstat-adaptive",long_options[long_index].name) == 0) flags->fstatAdaptive = 1;
                 if(strcmp("sources",     long_options[long_index].name) == 0)
                 {
                     flags->DMAX = atoi(optarg);
@@ -313,7 +338,7 @@ void print_ucb_catalog_script(struct Flags *flags, struct Data *data, struct Orb
     fprintf(fptr,"--padding %i ",data->qpad);
     fprintf(fptr,"--duration %f ",data->T);
     fprintf(fptr,"--start-time %f ",data->t0);
-    fprintf(fptr,"--sources $1 --chain-file chains/dimension_chain.dat.$1 ");
+    fprintf(fptr,"--sources $1 --chain-file chains/dimension_chain.%s.$1 ",chain_file_extension(flags->chainFormat));
     
     //Optional
     if(strcmp(data->format,"phase")==0)
@@ -413,47 +438,241 @@ void print_run_settings(int argc, char **argv, struct Data *data, struct Orbit *
     else                fprintf(fptr,"  RJMCMC is ........... DISABLED\n");
     if(flags->detached) fprintf(fptr,"  Mchirp prior is...... ENABLED\n");
     else                fprintf(fptr,"  Mchirp prior is...... DISABLED\n");
+    if(flags->summaryLogL) fprintf(fptr,"  Summary data logL is. ENABLED\n");
+    else                   fprintf(fptr,"  Summary data logL is. DISABLED\n");
+    if(flags->delayedAcceptance) fprintf(fptr,"  Delayed acceptance .. ENABLED\n");
+    else                         fprintf(fptr,"  Delayed acceptance .. DISABLED\n");
+    if(flags->adaptProposals) fprintf(fptr,"  Proposal adaptation.. ENABLED\n");
+    else                      fprintf(fptr,"  Proposal adaptation.. DISABLED\n");
+    if(flags->fstatAdaptive) fprintf(fptr,"  F-stat refinement.... ENABLED\n");
+    else                     fprintf(fptr,"  F-stat refinement.... DISABLED\n");
+    if(flags->profile) fprintf(fptr,"  Profiling ........... ENABLED\n");
+    else               fprintf(fptr,"  Profiling ........... DISABLED\n");
     fprintf(fptr,"\n");
     fprintf(fptr,"\n");
 }
 
-void save_chain_state(struct Data *data, struct Model **model, struct Chain *chain, struct Flags *flags, int step)
+/* binary checkpoint, see save_chain_state() */
+#define CHAIN_STATE_MAGIC "GLASSCKP"
+#define CHAIN_STATE_VERSION 3
+
+static void write_state(const void *ptr, size_t size, size_t N, FILE *fptr, const char *filename)
 {
-    char filename[128];
-    FILE *stateFile;
+    if(fwrite(ptr, size, N, fptr)!=N)
+    {
+        fprintf(stderr,"Error writing checkpoint file %s\n",filename);
+        exit(1);
+    }
+}
+
+static void read_state(void *ptr, size_t size, size_t N, FILE *fptr, const char *filename)
+{
+    if(fread(ptr, size, N, fptr)!=N)
+    {
+        fprintf(stderr,"Error reading checkpoint file %s\n",filename);
+        exit(1);
+    }
+}
+
+static void write_source_state(struct Source *source, FILE *fptr, const char *filename)
+{
+    write_state(source->params, sizeof(double), UCB_MODEL_NP, fptr, filename);
+    for(int i=0; i<UCB_MODEL_NP; i++) write_state(source->fisher_matrix[i], sizeof(double), UCB_MODEL_NP, fptr, filename);
+    for(int i=0; i<UCB_MODEL_NP; i++) write_state(source->fisher_evectr[i], sizeof(double), UCB_MODEL_NP, fptr, filename);
+    write_state(source->fisher_evalue, sizeof(double), UCB_MODEL_NP, fptr, filename);
+    write_state(&source->fisher_update_flag, sizeof(int), 1, fptr, filename);
+}
+
+static void read_source_state(struct Data *data, struct Source *source, FILE *fptr, const char *filename)
+{
+    read_state(source->params, sizeof(double), UCB_MODEL_NP, fptr, filename);
+    for(int i=0; i<UCB_MODEL_NP; i++) read_state(source->fisher_matrix[i], sizeof(double), UCB_MODEL_NP, fptr, filename);
+    for(int i=0; i<UCB_MODEL_NP; i++) read_state(source->fisher_evectr[i], sizeof(double), UCB_MODEL_NP, fptr, filename);
+    read_state(source->fisher_evalue, sizeof(double), UCB_MODEL_NP, fptr, filename);
+    read_state(&source->fisher_update_flag, sizeof(int), 1, fptr, filename);
+    
+    //map to parameter names (just to make code readable)
+    map_array_to_params(source, source->params, data->T);
+}
+
+void save_chain_state(struct Data *data, struct Model **model, struct Chain *chain, struct Flags *flags, struct Proposal **proposal, int step)
+{
+    double prof = profile_start();
+    char filename[MAXSTRINGSIZE];
+    char tempname[MAXSTRINGSIZE];
+    sprintf(filename,"%s/chain_state.bin",chain->chkptDir);
+    sprintf(tempname,"%s.tmp",filename);
+    
+    //write to temporary file and rename so a crash never leaves a partial checkpoint
+    FILE *stateFile = fopen(tempname,"wb");
+    if(stateFile==NULL)
+    {
+        fprintf(stderr,"Error opening checkpoint file %s\n",tempname);
+        exit(1);
+    }
+    
+    int header[7] = {CHAIN_STATE_VERSION, chain->NC, flags->DMAX, UCB_MODEL_NP, data->Nchannel*data->Nlayer, UCB_PROPOSAL_NPROP, step};
+    write_state(CHAIN_STATE_MAGIC, sizeof(char), 8, stateFile, tempname);
+    write_state(header, sizeof(int), 7, stateFile, tempname);
+    write_state(&chain->logLmax, sizeof(double), 1, stateFile, tempname);
+    
+    //proposal weights and screening, which are only adapted during burn in
+    for(int i=0; i<UCB_PROPOSAL_NPROP; i++)
+    {
+        write_state(&proposal[i]->weight, sizeof(double), 1, stateFile, tempname);
+        write_state(&proposal[i]->screen, sizeof(int), 1, stateFile, tempname);
+    }
+    
     for(int ic=0; ic<chain->NC; ic++)
     {
-        sprintf(filename,"%s/chain_state_%i.dat",chain->chkptDir,ic);
-        stateFile = fopen(filename,"w");
-        
         int n = chain->index[ic];
+        struct Model *m = model[n];
         
-        fprintf(stateFile,"%.12g\n",chain->logLmax);
+        //parallel tempering state
+        write_state(&chain->temperature[ic], sizeof(double), 1, stateFile, tempname);
+        write_state(&chain->acceptance[ic], sizeof(double), 1, stateFile, tempname);
+        write_state(&chain->avgLogL[ic], sizeof(double), 1, stateFile, tempname);
+        write_state(&chain->r[ic], sizeof(unsigned int), 1, stateFile, tempname);
+        write_state(chain->dimension[ic], sizeof(int), flags->DMAX, stateFile, tempname);
         
-        print_chain_state(data, chain, model[n], flags, stateFile, step);
-        print_psd_state(data, model[n], stateFile, step);
-        if(flags->calibration)
-            print_calibration_state(data, model[n], stateFile, step);
+        //model state
+        write_state(&m->Nlive, sizeof(int), 1, stateFile, tempname);
+        write_state(&m->logL, sizeof(double), 1, stateFile, tempname);
+        write_state(&m->logLnorm, sizeof(double), 1, stateFile, tempname);
+        write_state(&m->t0, sizeof(double), 1, stateFile, tempname);
+        write_state(m->noise->eta, sizeof(double), data->Nchannel*data->Nlayer, stateFile, tempname);
+        if(flags->calibration) write_state(m->calibration, sizeof(struct Calibration), 1, stateFile, tempname);
         
-        int D = model[n]->Nlive;
-        for(int i=0; i<D; i++)
+        for(int i=0; i<m->Nlive; i++) write_source_state(m->source[i], stateFile, tempname);
+    }
+    
+    fflush(stateFile);
+    fsync(fileno(stateFile));
+    fclose(stateFile);
+    
+    if(rename(tempname,filename))
+    {
+        fprintf(stderr,"Error moving checkpoint file %s to %s\n",tempname,filename);
+        exit(1);
+    }
+    
+    profile_stop(PROFILE_IO, prof);
+}
+
+int check_chain_state(struct Chain *chain)
+{
+    char filename[MAXSTRINGSIZE];
+    FILE *fptr = NULL;
+    
+    sprintf(filename,"%s/chain_state.bin",chain->chkptDir);
+    if( (fptr = fopen(filename,"r")) != NULL )
+    {
+        fclose(fptr);
+        return 1;
+    }
+    
+    //ASCII checkpoints from earlier versions
+    for(int ic=0; ic<chain->NC; ic++)
+    {
+        sprintf(filename,"%s/chain_state_%i.dat",chain->chkptDir,ic);
+        if( (fptr = fopen(filename,"r")) == NULL )
         {
-            print_source_params(data,model[n]->source[i],stateFile);
-            fprintf(stateFile,"\n");
+            fprintf(stderr,"Warning: Could not checkpoint run state\n");
+            fprintf(stderr,"         Checkpoint file %s/chain_state.bin does not exist\n",chain->chkptDir);
+            return 0;
         }
+        fclose(fptr);
+    }
+    return 1;
+}
+
+static void restore_chain_state_ascii(struct Orbit *orbit, struct Data *data, struct Model **model, struct Chain *chain, struct Flags *flags, int *step);
+
+void restore_chain_state(struct Orbit *orbit, struct Data *data, struct Model **model, struct Chain *chain, struct Flags *flags, struct Proposal **proposal, int *step)
+{
+    char filename[MAXSTRINGSIZE];
+    sprintf(filename,"%s/chain_state.bin",chain->chkptDir);
+    
+    FILE *stateFile = fopen(filename,"rb");
+    if(stateFile==NULL)
+    {
+        restore_chain_state_ascii(orbit, data, model, chain, flags, step);
+        return;
+    }
+    
+    char magic[8];
+    int header[7];
+    read_state(magic, sizeof(char), 8, stateFile, filename);
+    read_state(header, sizeof(int), 1, stateFile, filename);
+    if(memcmp(magic,CHAIN_STATE_MAGIC,8) || header[0]!=CHAIN_STATE_VERSION)
+    {
+        fprintf(stderr,"Checkpoint file %s is not a version %i GLASS chain state\n",filename,CHAIN_STATE_VERSION);
+        exit(1);
+    }
+    read_state(header+1, sizeof(int), 6, stateFile, filename);
+    if(header[1]!=chain->NC || header[2]!=flags->DMAX || header[3]!=UCB_MODEL_NP || header[4]!=data->Nchannel*data->Nlayer || header[5]!=UCB_PROPOSAL_NPROP)
+    {
+        fprintf(stderr,"Checkpoint file %s does not match run settings\n",filename);
+        fprintf(stderr,"  chains %i/%i, sources %i/%i, parameters %i/%i, noise parameters %i/%i, proposals %i/%i\n",header[1],chain->NC,header[2],flags->DMAX,header[3],UCB_MODEL_NP,header[4],data->Nchannel*data->Nlayer,header[5],UCB_PROPOSAL_NPROP);
+        exit(1);
+    }
+    *step = header[6];
+    read_state(&chain->logLmax, sizeof(double), 1, stateFile, filename);
+    
+    for(int i=0; i<UCB_PROPOSAL_NPROP; i++)
+    {
+        read_state(&proposal[i]->weight, sizeof(double), 1, stateFile, filename);
+        read_state(&proposal[i]->screen, sizeof(int), 1, stateFile, filename);
+    }
+    
+    for(int ic=0; ic<chain->NC; ic++)
+    {
+        int n = chain->index[ic];
+        struct Model *m = model[n];
         
-        fclose(stateFile);
+        //parallel tempering state
+        read_state(&chain->temperature[ic], sizeof(double), 1, stateFile, filename);
+        read_state(&chain->acceptance[ic], sizeof(double), 1, stateFile, filename);
+        read_state(&chain->avgLogL[ic], sizeof(double), 1, stateFile, filename);
+        read_state(&chain->r[ic], sizeof(unsigned int), 1, stateFile, filename);
+        read_state(chain->dimension[ic], sizeof(int), flags->DMAX, stateFile, filename);
+        
+        //model state
+        read_state(&m->Nlive, sizeof(int), 1, stateFile, filename);
+        read_state(&m->logL, sizeof(double), 1, stateFile, filename);
+        read_state(&m->logLnorm, sizeof(double), 1, stateFile, filename);
+        read_state(&m->t0, sizeof(double), 1, stateFile, filename);
+        read_state(m->noise->eta, sizeof(double), data->Nchannel*data->Nlayer, stateFile, filename);
+        if(flags->calibration) read_state(m->calibration, sizeof(struct Calibration), 1, stateFile, filename);
+        
+        //sources come with their Fisher matrices, no need to recompute
+        for(int i=0; i<m->Nlive; i++) read_source_state(data, m->source[i], stateFile, filename);
+        
+        m->kernels.generate_noise(data, m);
+        m->kernels.generate_signal(orbit, data, m, -1);
+
+        //summary data are weighted by the restored noise model
+        if(m->summary) reset_summary_data(data, m->summary, m->noise);
+        
+        if(!flags->prior)
+        {
+            m->logL = m->kernels.log_likelihood(data, m);
+            m->logLnorm = gaussian_log_likelihood_constant_norm(data, m);
+        }
+        else m->logL = m->logLnorm = 0.0;
     }
+    
+    fclose(stateFile);
 }
 
-void restore_chain_state(struct Orbit *orbit, struct Data *data, struct Model **model, struct Chain *chain, struct Flags *flags, int *step)
+static void restore_chain_state_ascii(struct Orbit *orbit, struct Data *data, struct Model **model, struct Chain *chain, struct Flags *flags, int *step)
 {
-    char filename[128];
+    char filename[MAXSTRINGSIZE];
     FILE *stateFile;
     chain->logLmax=0.0;
     for(int ic=0; ic<chain->NC; ic++)
     {
-        sprintf(filename,"%s/checkpoint/chain_state_%i.dat",flags->runDir,ic);
+        sprintf(filename,"%s/chain_state_%i.dat",chain->chkptDir,ic);
         stateFile = fopen(filename,"r");
         
         int n = chain->index[ic];
@@ -479,6 +698,9 @@ void restore_chain_state(struct Orbit *orbit, struct Data *data, struct Model **
         
         generate_noise_model(data, model[n]);
         generate_signal_model(orbit, data, model[n], -1);
+
+        //summary data are weighted by the restored noise model
+        if(model[n]->summary) reset_summary_data(data, model[n]->summary, model[n]->noise);
         
         if(!flags->prior)
         {
@@ -494,10 +716,32 @@ void restore_chain_state(struct Orbit *orbit, struct Data *data, struct Model **
 
 void print_chain_files(struct Data *data, struct Model **model, struct Chain *chain, struct Flags *flags, int step)
 {
+    double prof = profile_start();
     int i,n,ic;
+    char filename[MAXSTRINGSIZE];
+    
+    //binary chain files replace the ASCII parameter, dimension, likelihood, and temperature chains
+    int binary = strcmp(flags->chainFormat,"ascii");
+    const char *ext = chain_file_extension(flags->chainFormat);
     
     //Print logL & temperature chains
-    if(!flags->quiet)
+    if(!flags->quiet && binary)
+    {
+        double *logL = double_vector(chain->NC+1);
+        double *beta = double_vector(chain->NC+1);
+        logL[0] = beta[0] = (double)step;
+        for(ic=0; ic<chain->NC; ic++)
+        {
+            n = chain->index[ic];
+            logL[ic+1] = model[n]->logL+model[n]->logLnorm;
+            beta[ic+1] = 1./chain->temperature[ic];
+        }
+        write_chain_row(chain->likelihoodTable, logL);
+        write_chain_row(chain->temperatureTable, beta);
+        free_double_vector(logL);
+        free_double_vector(beta);
+    }
+    else if(!flags->quiet)
     {
         fprintf(chain->likelihoodFile,  "%i ",step);
         fprintf(chain->temperatureFile, "%i ",step);
@@ -532,9 +776,28 @@ void print_chain_files(struct Data *data, struct Model **model, struct Chain *ch
     
     //Print sampling parameters
     int D = model[n]->Nlive;
+    double row[UCB_MODEL_NP+2];
+    if(binary && chain->parameterTable[0]==NULL)
+    {
+        char *snr_names[] = {"snr_a","snr_n"};
+        sprintf(filename,"%s/parameter_chain.%s.0",chain->chainDir,ext);
+        chain->parameterTable[0] = open_source_chain_file(filename, flags, (flags->verbose) ? 2 : 0, snr_names);
+    }
+    if(binary && D>0 && step>0 && chain->dimensionTable[D]==NULL)
+    {
+        sprintf(filename,"%s/dimension_chain.%s.%i",chain->chainDir,ext,D);
+        chain->dimensionTable[D] = open_source_chain_file(filename, flags, 0, NULL);
+    }
+    
     for(i=0; i<D; i++)
     {
-        print_source_params(data,model[n]->source[i],chain->parameterFile[0]);
+        if(binary)
+        {
+            pack_source_params(data,model[n]->source[i],row);
+            if(step>0) write_chain_row(chain->dimensionTable[D], row);
+        }
+        else print_source_params(data,model[n]->source[i],chain->parameterFile[0]);
+        
         if(flags->verbose)
         {
             //numerical SNR
@@ -544,7 +807,17 @@ void print_chain_files(struct Data *data, struct Model **model, struct Chain *ch
             //analytic SNR
             double snr_a = analytic_snr(exp(model[n]->source[i]->params[3]), data->noise->C[0][0][0], data->sine_f_on_fstar, data->sqT);
             
-            fprintf(chain->parameterFile[0],"%lg %lg ",snr_a,snr_n);
+            if(binary)
+            {
+                row[UCB_MODEL_NP]   = snr_a;
+                row[UCB_MODEL_NP+1] = snr_n;
+            }
+            else fprintf(chain->parameterFile[0],"%lg %lg ",snr_a,snr_n);
+        }
+        if(binary)
+        {
+            write_chain_row(chain->parameterTable[0], row);
+            continue;
         }
         fprintf(chain->parameterFile[0],"\n");
         if(flags->verbose)fflush(chain->parameterFile[0]);
@@ -553,7 +826,6 @@ void print_chain_files(struct Data *data, struct Model **model, struct Chain *ch
         {
             if(chain->dimensionFile[D]==NULL)
             {
-                char filename[MAXSTRINGSIZE];
                 sprintf(filename,"%s/dimension_chain.dat.%i",chain->chainDir,D);
                 if(flags->resume)chain->dimensionFile[D] = fopen(filename,"a");
                 else             chain->dimensionFile[D] = fopen(filename,"w");
@@ -562,6 +834,7 @@ void print_chain_files(struct Data *data, struct Model **model, struct Chain *ch
             fprintf(chain->dimensionFile[D],"\n");
         }
     }
+    if(binary && flags->verbose) flush_chain_file(chain->parameterTable[0]);
     
     //Print calibration parameters
     
@@ -575,6 +848,8 @@ void print_chain_files(struct Data *data, struct Model **model, struct Chain *ch
             print_psd_state(data, model[n], chain->noiseFile[ic], step);
         }//loop over chains
     }//verbose flag
+    
+    profile_stop(PROFILE_IO, prof);
 }
 
 void scan_chain_state(struct Data *data, struct Chain *chain, struct Model *model, struct Flags *flags, FILE *fptr, int *step)
@@ -707,6 +982,48 @@ void print_source_params(struct Data *data, struct Source *source, FILE *fptr)
         fprintf(fptr,"%.12g ",source->d2fdt2);
 }
 
+void pack_source_params(struct Data *data, struct Source *source, double *row)
+{
+    //map to parameter names (just to make code readable)
+    map_array_to_params(source, source->params, data->T);
+    
+    row[0] = source->f0;
+    row[1] = source->dfdt;
+    row[2] = source->amp;
+    row[3] = source->phi;
+    row[4] = source->costheta;
+    row[5] = source->cosi;
+    row[6] = source->psi;
+    row[7] = source->phi0;
+    if(UCB_MODEL_NP>8)
+        row[8] = source->d2fdt2;
+}
+
+void unpack_source_params(struct Data *data, struct Source *source, double *row)
+{
+    source->f0       = row[0];
+    source->dfdt     = row[1];
+    source->amp      = row[2];
+    source->phi      = row[3];
+    source->costheta = row[4];
+    source->cosi     = row[5];
+    source->psi      = row[6];
+    source->phi0     = row[7];
+    if(UCB_MODEL_NP>8)
+        source->d2fdt2 = row[8];
+    
+    //map to parameter names (just to make code readable)
+    map_params_to_array(source, source->params, data->T);
+}
+
+struct ChainFile *open_source_chain_file(const char *filename, struct Flags *flags, int Nextra, char **extra)
+{
+    char *names[UCB_MODEL_NP+8] = {"f0","dfdt","amp","phi","costheta","cosi","psi","phi0","d2fdt2"};
+    for(int n=0; n<Nextra; n++) names[UCB_MODEL_NP+n] = extra[n];
+    
+    return open_chain_file(filename, flags->chainFormat, UCB_MODEL_NP+Nextra, names, (flags->resume) ? "a" : "w");
+}
+
 void scan_source_params(struct Data *data, struct Source *source, FILE *fptr)
 {
     int check = 0;
@@ -1149,4 +1466,202 @@ void print_evidence(struct Chain *chain,struct Flags *flags)
     fclose(zFile);
 }
 
+/* Writes one record using the synchronous print and save functions */
+static void write_ucb_output_record(struct UCBOutput *output, struct UCBOutputRecord *record)
+{
+    struct Data *data = output->data;
+    struct Flags *flags = output->flags;
+    
+    print_chain_files(data, record->model, &record->chain, flags, record->step);
+    
+    if(record->draw)
+    {
+        print_waveform_draw(data, record->model[0], flags);
+        print_psd_draw(data, record->model[0], flags);
+    }
+    
+    if(record->checkpoint) save_chain_state(data, record->model, &record->chain, flags, record->proposal, record->state_step);
+    
+    if(record->waveform>=0) save_waveforms(data, record->model[0], record->waveform);
+}
+
+static void *ucb_output_thread(void *arg)
+{
+    struct UCBOutput *output = arg;
+    
+    pthread_mutex_lock(&output->lock);
+    for(;;)
+    {
+        struct UCBOutputRecord *record = output->record[output->next];
+        
+        while(record->state!=1 && !output->quit) pthread_cond_wait(&output->cond, &output->lock);
+        if(record->state!=1) break;
+        
+        record->state = 2;
+        pthread_mutex_unlock(&output->lock);
+        
+        write_ucb_output_record(output, record);
+        
+        pthread_mutex_lock(&output->lock);
+        record->state = 0;
+        output->next = 1-output->next;
+        pthread_cond_broadcast(&output->cond);
+    }
+    pthread_mutex_unlock(&output->lock);
+    
+    return NULL;
+}
 
+struct UCBOutput *alloc_ucb_output(struct Data *data, struct Flags *flags, struct Chain *chain, int Nmax)
+{
+    struct UCBOutput *output = malloc(sizeof(struct UCBOutput));
+    output->data  = data;
+    output->flags = flags;
+    output->fill  = 0;
+    output->next  = 0;
+    output->quit  = 0;
+    
+    for(int i=0; i<2; i++)
+    {
+        struct UCBOutputRecord *record = malloc(sizeof(struct UCBOutputRecord));
+        record->state = 0;
+        record->model = malloc(chain->NC*sizeof(struct Model *));
+        for(int ic=0; ic<chain->NC; ic++)
+        {
+            record->model[ic] = malloc(sizeof(struct Model));
+            alloc_model(data, record->model[ic], Nmax);
+        }
+        
+        record->chain = *chain;
+        record->chain.index = int_vector(chain->NC);
+        record->chain.temperature = double_vector(chain->NC);
+        for(int ic=0; ic<chain->NC; ic++) record->chain.index[ic] = ic;
+        
+        //tempering state stored in checkpoints
+        record->chain.acceptance = double_vector(chain->NC);
+        record->chain.avgLogL = double_vector(chain->NC);
+        record->chain.dimension = int_matrix(chain->NC, flags->DMAX);
+        record->chain.r = malloc(chain->NC*sizeof(unsigned int));
+        
+        record->proposal = malloc(UCB_PROPOSAL_NPROP*sizeof(struct Proposal *));
+        for(int n=0; n<UCB_PROPOSAL_NPROP; n++) record->proposal[n] = malloc(sizeof(struct Proposal));
+        
+        output->record[i] = record;
+    }
+    
+    pthread_mutex_init(&output->lock, NULL);
+    pthread_cond_init(&output->cond, NULL);
+    if(pthread_create(&output->thread, NULL, ucb_output_thread, output))
+    {
+        fprintf(stderr,"Failed to start output thread in alloc_ucb_output()\n");
+        exit(1);
+    }
+    
+    return output;
+}
+
+struct UCBOutputRecord *begin_ucb_output(struct UCBOutput *output)
+{
+    struct UCBOutputRecord *record = output->record[output->fill];
+    
+    //time spent waiting on the writer thread
+    double prof = profile_start();
+    pthread_mutex_lock(&output->lock);
+    while(record->state!=0) pthread_cond_wait(&output->cond, &output->lock);
+    pthread_mutex_unlock(&output->lock);
+    profile_stop(PROFILE_IO, prof);
+    
+    record->step = 0;
+    record->draw = 0;
+    record->checkpoint = 0;
+    record->state_step = 0;
+    record->waveform = -1;
+    
+    return record;
+}
+
+void submit_ucb_output(struct UCBOutput *output, struct Model **model, struct Chain *chain, struct Proposal **proposal)
+{
+    double prof = profile_start();
+    struct UCBOutputRecord *record = output->record[output->fill];
+    struct Flags *flags = output->flags;
+    
+    //hot chains are only written in full to checkpoints and verbose chain files
+    int full = record->checkpoint || flags->verbose;
+    
+    for(int ic=0; ic<chain->NC; ic++)
+    {
+        struct Model *origin = model[chain->index[ic]];
+        struct Model *copy = record->model[ic];
+        
+        if(ic==0 || full) copy_model(origin, copy);
+        else
+        {
+            copy->Nlive    = origin->Nlive;
+            copy->logL     = origin->logL;
+            copy->logLnorm = origin->logLnorm;
+            copy->t0       = origin->t0;
+        }
+        record->chain.temperature[ic] = chain->temperature[ic];
+    }
+    record->chain.logLmax = chain->logLmax;
+    
+    if(record->checkpoint)
+    {
+        for(int ic=0; ic<chain->NC; ic++)
+        {
+            record->chain.acceptance[ic] = chain->acceptance[ic];
+            record->chain.avgLogL[ic] = chain->avgLogL[ic];
+            record->chain.r[ic] = chain->r[ic];
+            for(int d=0; d<flags->DMAX; d++) record->chain.dimension[ic][d] = chain->dimension[ic][d];
+        }
+        for(int n=0; n<UCB_PROPOSAL_NPROP; n++) *record->proposal[n] = *proposal[n];
+    }
+    
+    pthread_mutex_lock(&output->lock);
+    record->state = 1;
+    pthread_cond_broadcast(&output->cond);
+    pthread_mutex_unlock(&output->lock);
+    
+    output->fill = 1-output->fill;
+    
+    profile_stop(PROFILE_IO, prof);
+}
+
+void flush_ucb_output(struct UCBOutput *output)
+{
+    pthread_mutex_lock(&output->lock);
+    while(output->record[0]->state!=0 || output->record[1]->state!=0) pthread_cond_wait(&output->cond, &output->lock);
+    pthread_mutex_unlock(&output->lock);
+}
+
+void free_ucb_output(struct UCBOutput *output)
+{
+    flush_ucb_output(output);
+    
+    pthread_mutex_lock(&output->lock);
+    output->quit = 1;
+    pthread_cond_broadcast(&output->cond);
+    pthread_mutex_unlock(&output->lock);
+    
+    pthread_join(output->thread, NULL);
+    pthread_mutex_destroy(&output->lock);
+    pthread_cond_destroy(&output->cond);
+    
+    for(int i=0; i<2; i++)
+    {
+        struct UCBOutputRecord *record = output->record[i];
+        for(int ic=0; ic<record->chain.NC; ic++) free_model(record->model[ic]);
+        free(record->model);
+        free_int_vector(record->chain.index);
+        free_double_vector(record->chain.temperature);
+        free_double_vector(record->chain.acceptance);
+        free_double_vector(record->chain.avgLogL);
+        free_int_matrix(record->chain.dimension, record->chain.NC);
+        free(record->chain.r);
+        for(int n=0; n<UCB_PROPOSAL_NPROP; n++) free(record->proposal[n]);
+        free(record->proposal);
+        free(record);
+    }
+    free(output);
+}
@@ -23,6 +23,10 @@
 #ifndef ucb_io_h
 #define ucb_io_h
 
+#include <pthread.h>
+
+struct Proposal;
+
 /**
  \brief Print command line options for UCB module
  */
@@ -52,8 +56,27 @@ void print_ucb_catalog_script(struct Flags *flags, struct Data *data, struct Orb
  Print/read to file the full chain state for checkpointing
  */
 ///@{
-void save_chain_state(struct Data *data, struct Model **model, struct Chain *chain, struct Flags *flags, int step);
-void restore_chain_state(struct Orbit *orbit, struct Data *data, struct Model **model, struct Chain *chain, struct Flags *flags, int *step);
+/**
+ \brief Save the state of all chains to `Chain::chkptDir/chain_state.bin`
+ 
+ Single binary file with the temperature ladder, RNG seeds, and acceptance
+ rates of the parallel chains, the proposal weights and screening adapted
+ in burn in and, for each chain, the model and the Fisher matrices of its
+ sources. Written to a temporary file that is renamed when complete, so an
+ interrupted write leaves the previous checkpoint intact.
+ */
+void save_chain_state(struct Data *data, struct Model **model, struct Chain *chain, struct Flags *flags, struct Proposal **proposal, int step);
+
+/**
+ \brief Restore chain state saved by save_chain_state(), or from the
+ per-chain ASCII `chain_state_M.dat` files of earlier versions
+ */
+void restore_chain_state(struct Orbit *orbit, struct Data *data, struct Model **model, struct Chain *chain, struct Flags *flags, struct Proposal **proposal, int *step);
+
+/**
+ \brief Returns 1 if a checkpoint for restore_chain_state() exists in Chain::chkptDir
+ */
+int check_chain_state(struct Chain *chain);
 ///@}
 
 /** @name Chain State File
@@ -88,6 +111,19 @@ void print_source_params(struct Data *data, struct Source *source, FILE *fptr);
 void scan_source_params(struct Data *data, struct Source *source, FILE *fptr);
 ///@}
 
+/** @name Galactic Binary Chain Table
+ Pack/unpack source parameters into a row of a binary chain file, e.g. Chain::parameterTable, in the column order of print_source_params()
+ */
+///@{
+void pack_source_params(struct Data *data, struct Source *source, double *row);
+void unpack_source_params(struct Data *data, struct Source *source, double *row);
+///@}
+
+/**
+ rief Open binary chain file for source parameters with `Nextra` additional columns named `extra`
+ */
+struct ChainFile *open_source_chain_file(const char *filename, struct Flags *flags, int Nextra, char **extra);
+
 /**
  \brief Wrapper function that calls all of the chain print functions
  */
@@ -120,4 +156,75 @@ void print_psd_draw(struct Data *data, struct Model *model, struct Flags *flags)
  */
 void print_evidence(struct Chain *chain,struct Flags *flags);
 
+/**
+ \brief Snapshot of the sampler state written by the UCBOutput thread
+
+ Models are stored in temperature order, so UCBOutputRecord::chain has an identity Chain::index.
+ */
+struct UCBOutputRecord
+{
+    int state; //!<0 free, 1 waiting for the writer, 2 being written
+    
+    struct Model **model; //!<copies of the models, only logL, logLnorm, Nlive and t0 for hot chains unless needed in full
+    struct Chain chain;   //!<shallow copy of the Chain with its own Chain::index and Chain::temperature
+    struct Proposal **proposal; //!<shallow copies of the proposals, current only for checkpoints
+    
+    ///@name Output requested for this record
+    ///@{
+    int step;        //!<step for print_chain_files()
+    int draw;        //!<call print_waveform_draw() and print_psd_draw()
+    int checkpoint;  //!<call save_chain_state()
+    int state_step;  //!<step for save_chain_state()
+    int waveform;    //!<sample index for save_waveforms(), -1 to skip
+    ///@}
+};
+
+/**
+ \brief Background writer for the per-block sampler output
+
+ The sampler fills one of two UCBOutputRecord buffers with begin_ucb_output()
+ and submit_ucb_output().  A dedicated thread formats and writes the other,
+ so the sampler only waits if the writer falls more than one block behind.
+ The writer owns the Chain file pointers until flush_ucb_output() returns.
+ */
+struct UCBOutput
+{
+    pthread_t thread;     //!<writer thread
+    pthread_mutex_t lock; //!<protects UCBOutputRecord::state and UCBOutput::quit
+    pthread_cond_t cond;  //!<signals changes of UCBOutputRecord::state
+    
+    struct UCBOutputRecord *record[2]; //!<double buffer
+    int fill; //!<record the sampler fills next
+    int next; //!<record the writer takes next
+    int quit; //!<stop the writer once all records are written
+    
+    struct Data *data;   //!<data being analyzed
+    struct Flags *flags; //!<run settings
+};
+
+/**
+ \brief Allocate the output buffers for `chain->NC` models and start the writer thread
+ */
+struct UCBOutput *alloc_ucb_output(struct Data *data, struct Flags *flags, struct Chain *chain, int Nmax);
+
+/**
+ \brief Wait for a free record and reset its requested output
+ */
+struct UCBOutputRecord *begin_ucb_output(struct UCBOutput *output);
+
+/**
+ \brief Snapshot `model`, `chain`, and for checkpoints `proposal`, into the record from begin_ucb_output() and queue it for the writer
+ */
+void submit_ucb_output(struct UCBOutput *output, struct Model **model, struct Chain *chain, struct Proposal **proposal);
+
+/**
+ \brief Wait until every submitted record has been written
+ */
+void flush_ucb_output(struct UCBOutput *output);
+
+/**
+ \brief Flush the output, stop the writer thread, and free memory
+ */
+void free_ucb_output(struct UCBOutput *output);
+
 #endif /* ucb_io_h */
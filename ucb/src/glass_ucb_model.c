@@ -69,6 +69,17 @@ void alloc_model(struct Data *data, struct Model *model, int Nmax)
     //Wavelet bookkeeping
     model->Nlist = 0;
     model->list = calloc(data->N,sizeof(int));
+    
+    model->summary = NULL;
+    model->surrogate = NULL;
+    
+    select_ucb_kernels(data, &model->kernels);
+    
+    model->Ndelta = 0;
+    model->update_flag = -1;
+    model->update_source = 0;
+    model->update_imin = 0;
+    model->update_imax = 0;
 
     model->source = malloc(model->Nmax*sizeof(struct Source *));
     
@@ -87,7 +98,8 @@ void alloc_model(struct Data *data, struct Model *model, int Nmax)
     for(n=0; n<model->Nmax; n++)
     {
         model->source[n] = malloc(sizeof(struct Source));
-        alloc_source(model->source[n],data->N,data->Nchannel);
+        alloc_source(model->source[n], data->Nchannel);
+        if(!strcmp(data->basis,"wavelet")) clear_source_tdi(model->source[n],data->N);
     }
     
     model->logPriorVolume = calloc(UCB_MODEL_NP,sizeof(double));
@@ -130,11 +142,14 @@ void copy_model(struct Model *origin, struct Model *copy)
     //Model likelihood
     copy->logL           = origin->logL;
     copy->logLnorm       = origin->logLnorm;
+    copy->Ndelta         = origin->Ndelta;
 
     //Wavelet bookkeeping
     copy->Nlist = origin->Nlist;
     memcpy(copy->list,origin->list,origin->Nlist*sizeof(int));
 
+    //Trial bookkeeping
+    copy->update_flag = 0;
 }
 
 void copy_model_lite(struct Model *origin, struct Model *copy)
@@ -151,6 +166,7 @@ void copy_model_lite(struct Model *origin, struct Model *copy)
     
     //Model likelihood
     copy->logL = origin->logL;
+    copy->Ndelta = origin->Ndelta;
 
     //Wavelet bookkeeping
     copy->Nlist = origin->Nlist;
@@ -297,6 +313,7 @@ void free_model(struct Model *model)
 
     free_tdi(model->tdi);
     free_tdi(model->residual);
+    if(model->surrogate) free_tdi(model->surrogate);
     free_noise(model->noise);
     free_calibration(model->calibration);
 
@@ -305,7 +322,7 @@ void free_model(struct Model *model)
     free(model);
 }
 
-void alloc_source(struct Source *source, int N, int Nchannel)
+void alloc_source(struct Source *source, int Nchannel)
 {
     //Intrinsic
     source->m1=1.;
@@ -327,20 +344,20 @@ void alloc_source(struct Source *source, int N, int Nchannel)
     source->dfdt=0.;
     source->d2fdt2=0.;
     
-    //Book-keeping
-    source->BW   = N/2;
+    //Book-keeping (empty until ucb_alignment())
+    source->BW   = 0;
     source->qmin = 0;
-    source->qmax = N/2;
+    source->qmax = 0;
     source->imin = 0;
-    source->imax = N/2;
+    source->imax = 0;
     
     
     //Package parameters for waveform generator
     source->params=calloc(UCB_MODEL_NP,sizeof(double));
     
-    //Response
+    //Response (band-local, grown on demand)
     source->tdi = malloc(sizeof(struct TDI));
-    alloc_tdi(source->tdi,N, Nchannel);
+    alloc_tdi(source->tdi, 0, Nchannel);
     
     //Fisher
     source->fisher_matrix = malloc(UCB_MODEL_NP*sizeof(double *));
@@ -352,12 +369,106 @@ void alloc_source(struct Source *source, int N, int Nchannel)
         source->fisher_evectr[i] = calloc(UCB_MODEL_NP,sizeof(double));
     }
 
-    //Wavelet bookkeeping
+    //Wavelet bookkeeping (grown with the response)
     source->Nlist = 0;
-    source->list = calloc(N,sizeof(int));
+    source->list = NULL;
+    
+    //Extrinsic parameter filters
+    source->filter = NULL;
+    source->filter_params = calloc(UCB_MODEL_NP,sizeof(double));
+    source->filter_t0 = 0.0;
+    source->filter_BW = 0;
+    source->filter_flag = 0;
+    
+    //Reduced bandwidth response
+    source->surrogate = NULL;
+    source->surrogate_params = calloc(UCB_MODEL_NP,sizeof(double));
+    source->surrogate_t0 = 0.0;
+    source->surrogate_BW = 0;
+    source->surrogate_imin = 0;
 };
 
-void copy_source(struct Source *origin, struct Source *copy)
+static void alloc_source_filters(struct Source *source)
+{
+    source->filter = malloc(4*sizeof(struct TDI *));
+    for(int i=0; i<4; i++)
+    {
+        source->filter[i] = malloc(sizeof(struct TDI));
+        alloc_tdi(source->filter[i], source->tdi->N, source->tdi->Nchannel);
+    }
+}
+
+/* Grow a TDI structure to N samples, keeping its contents */
+static void grow_tdi(struct TDI *tdi, int N)
+{
+    struct TDI *grown = malloc(sizeof(struct TDI));
+    alloc_tdi(grown, N, tdi->Nchannel);
+    copy_tdi_segment(tdi, grown, 0, tdi->N);
+    
+    free(tdi->X); tdi->X = grown->X;
+    free(tdi->Y); tdi->Y = grown->Y;
+    free(tdi->Z); tdi->Z = grown->Z;
+    free(tdi->A); tdi->A = grown->A;
+    free(tdi->E); tdi->E = grown->E;
+    free(tdi->T); tdi->T = grown->T;
+    tdi->N = N;
+    
+    free(grown);
+}
+
+/* Make room for N samples in the source response, filters, and wavelet list */
+static void reserve_source_tdi(struct Source *source, int N)
+{
+    if(N <= source->tdi->N) return;
+    
+    source->list = realloc(source->list, N*sizeof(int));
+    memset(source->list+source->tdi->N, 0, (N-source->tdi->N)*sizeof(int));
+    
+    grow_tdi(source->tdi, N);
+    if(source->filter) for(int i=0; i<4; i++) grow_tdi(source->filter[i], N);
+}
+
+void clear_source_tdi(struct Source *source, int N)
+{
+    reserve_source_tdi(source, N);
+    
+    memset(source->tdi->X, 0, N*sizeof(double));
+    memset(source->tdi->Y, 0, N*sizeof(double));
+    memset(source->tdi->Z, 0, N*sizeof(double));
+    memset(source->tdi->A, 0, N*sizeof(double));
+    memset(source->tdi->E, 0, N*sizeof(double));
+}
+
+/* Copy the first N samples without touching the capacity of copy */
+static void copy_source_tdi(struct TDI *origin, struct TDI *copy, int N)
+{
+    memcpy(copy->X, origin->X, N*sizeof(double));
+    memcpy(copy->Y, origin->Y, N*sizeof(double));
+    memcpy(copy->Z, origin->Z, N*sizeof(double));
+    memcpy(copy->A, origin->A, N*sizeof(double));
+    memcpy(copy->E, origin->E, N*sizeof(double));
+    memcpy(copy->T, origin->T, N*sizeof(double));
+}
+
+int intrinsic_params_match(double *a, double *b)
+{
+    for(int i=0; i<UCB_MODEL_NP; i++)
+    {
+        if(i>=3 && i<=6) continue; //extrinsic
+        if(a[i] != b[i]) return 0;
+    }
+    return 1;
+}
+
+/* Intrinsic parameters, start time, and bandwidth match the last template */
+static int source_filter_match(struct Source *source, double t0)
+{
+    if(source->filter_BW != source->BW || source->filter_t0 != t0) return 0;
+    return intrinsic_params_match(source->filter_params, source->params);
+}
+
+/* Everything in Source except the response */
+static void copy_source_params(struct Source *origin, struct Source *copy)
 {
     //Intrinsic
     copy->m1 = origin->m1;
@@ -386,10 +497,6 @@ void copy_source(struct Source *origin, struct Source *copy)
     copy->imin = origin->imin;
     copy->imax = origin->imax;
     
-    //Response
-    copy_tdi(origin->tdi,copy->tdi);
-
-    
     //Fisher
     memcpy(copy->fisher_evalue, origin->fisher_evalue, UCB_MODEL_NP*sizeof(double));
     memcpy(copy->params, origin->params, UCB_MODEL_NP*sizeof(double));
@@ -404,6 +511,112 @@ void copy_source(struct Source *origin, struct Source *copy)
     copy->Nlist = origin->Nlist;
     memcpy(copy->list, origin->list, origin->Nlist*sizeof(int));
     
+    //Filters only depend on the template key, so keep the copy's if they already match
+    int keep = copy->filter_flag && copy->filter_BW == origin->filter_BW && copy->filter_t0 == origin->filter_t0 && intrinsic_params_match(copy->filter_params, origin->filter_params);
+    if(!keep)
+    {
+        copy->filter_flag = origin->filter_flag;
+        if(origin->filter_flag)
+        {
+            reserve_source_tdi(copy, 2*origin->filter_BW);
+            if(!copy->filter) alloc_source_filters(copy);
+            for(int i=0; i<4; i++) copy_source_tdi(origin->filter[i], copy->filter[i], 2*origin->filter_BW);
+        }
+    }
+    memcpy(copy->filter_params, origin->filter_params, UCB_MODEL_NP*sizeof(double));
+    copy->filter_t0 = origin->filter_t0;
+    copy->filter_BW = origin->filter_BW;
+    
+    //Same for the reduced bandwidth response
+    keep = copy->surrogate_BW == origin->surrogate_BW && copy->surrogate_t0 == origin->surrogate_t0 && !memcmp(copy->surrogate_params, origin->surrogate_params, UCB_MODEL_NP*sizeof(double));
+    if(!keep && origin->surrogate_BW)
+    {
+        if(!copy->surrogate)
+        {
+            copy->surrogate = malloc(sizeof(struct TDI));
+            alloc_tdi(copy->surrogate, 2*origin->surrogate_BW, origin->surrogate->Nchannel);
+        }
+        else if(copy->surrogate->N < 2*origin->surrogate_BW) grow_tdi(copy->surrogate, 2*origin->surrogate_BW);
+        copy_source_tdi(origin->surrogate, copy->surrogate, 2*origin->surrogate_BW);
+    }
+    memcpy(copy->surrogate_params, origin->surrogate_params, UCB_MODEL_NP*sizeof(double));
+    copy->surrogate_t0   = origin->surrogate_t0;
+    copy->surrogate_BW   = origin->surrogate_BW;
+    copy->surrogate_imin = origin->surrogate_imin;
+}
+
+void copy_source(struct Source *origin, struct Source *copy)
+{
+    reserve_source_tdi(copy, origin->tdi->N);
+    copy_source_params(origin, copy);
+    
+    //Response
+    copy_source_tdi(origin->tdi, copy->tdi, origin->tdi->N);
+}
+
+void record_model_update(struct Data *data, struct Model *model, struct Model *trial, int source_id)
+{
+    struct Source *source_x = model->source[source_id];
+    struct Source *source_y = trial->source[source_id];
+    
+    //union of the bands of the old and new source
+    int imin = (source_x->imin < source_y->imin) ? source_x->imin : source_y->imin;
+    int imax = (source_x->imin+source_x->BW > source_y->imin+source_y->BW) ? source_x->imin+source_x->BW : source_y->imin+source_y->BW;
+    
+    if(imin < 0) imin = 0;
+    if(imax > data->NFFT) imax = data->NFFT;
+    if(imax < imin) imax = imin;
+    
+    trial->update_flag   = 1;
+    trial->update_source = source_id;
+    trial->update_imin   = imin;
+    trial->update_imax   = imax;
+}
+
+/* Copy the source and bins recorded in trial from origin to copy */
+static void copy_model_update(struct Model *origin, struct Model *copy, struct Model *trial)
+{
+    struct Source *source_o = origin->source[trial->update_source];
+    struct Source *source_c = copy->source[trial->update_source];
+    
+    //only the source's band is stored
+    int N = 2*source_o->BW;
+    
+    copy_source_params(source_o, source_c);
+    reserve_source_tdi(source_c, N);
+    copy_source_tdi(source_o->tdi, source_c->tdi, N);
+    
+    //model and residual only changed in the source's band
+    N = 2*(trial->update_imax - trial->update_imin);
+    copy_tdi_segment(origin->tdi, copy->tdi, trial->update_imin, N);
+    copy_tdi_segment(origin->residual, copy->residual, trial->update_imin, N);
+    
+    copy->logL = origin->logL;
+    copy->Ndelta = origin->Ndelta;
+}
+
+void accept_model_update(struct Model *trial, struct Model *model)
+{
+    if(trial->update_flag == 1)
+    {
+        copy_model_update(trial, model, trial);
+        trial->update_flag = 0;
+    }
+    else
+    {
+        copy_model_lite(trial, model);
+        trial->update_flag = -1;
+    }
+}
+
+void reject_model_update(struct Model *model, struct Model *trial)
+{
+    if(trial->update_flag == 1)
+    {
+        copy_model_update(model, trial, trial);
+        trial->update_flag = 0;
+    }
+    else copy_model(model, trial);
 }
 
 void free_source(struct Source *source)
@@ -422,12 +635,54 @@ void free_source(struct Source *source)
 
     free(source->list);
     
+    if(source->filter)
+    {
+        for(int i=0; i<4; i++) free_tdi(source->filter[i]);
+        free(source->filter);
+    }
+    free(source->filter_params);
+    
+    if(source->surrogate) free_tdi(source->surrogate);
+    free(source->surrogate_params);
+    
     free(source);
 }
 
+/* Align the source and clear its band-local response, returns 1 if the waveform still has to be computed */
+static int prepare_source_waveform(struct Orbit *orbit, struct Data *data, struct Model *model, struct Source *source)
+{
+    map_array_to_params(source, source->params, data->T);
+    
+
+    //Book-keeping of injection time-frequency volume
+    ucb_alignment(orbit, data, source);
+    
+    clear_source_tdi(source, 2*source->BW);
+    
+    //Only extrinsic parameters changed since the last template
+    if(source_filter_match(source, model->t0))
+    {
+        if(!source->filter_flag)
+        {
+            if(!source->filter) alloc_source_filters(source);
+            ucb_waveform_filters(orbit, model->kernels.tdi, data->T, model->t0, source->params, UCB_MODEL_NP, source->filter, source->BW, data->Nchannel);
+            source->filter_flag = 1;
+        }
+        ucb_waveform_extrinsic(source->params, source->filter, source->tdi->X, source->tdi->Y, source->tdi->Z, source->tdi->A, source->tdi->E, source->BW);
+        return 0;
+    }
+    
+    memcpy(source->filter_params, source->params, UCB_MODEL_NP*sizeof(double));
+    source->filter_t0 = model->t0;
+    source->filter_BW = source->BW;
+    source->filter_flag = 0;
+    
+    return 1;
+}
+
 void generate_signal_model(struct Orbit *orbit, struct Data *data, struct Model *model, int source_id)
 {
-    int i,n;
+    int n;
 
     for(n=0; n<data->N; n++)
     {
@@ -438,41 +693,38 @@ void generate_signal_model(struct Orbit *orbit, struct Data *data, struct Model
         model->tdi->E[n]=0.0;
     }
     
+    //Sources whose waveforms need to be recomputed
+    int Nbatch = 0;
+    double **params = malloc(model->Nlive*sizeof(double *));
+    struct TDI **tdi = malloc(model->Nlive*sizeof(struct TDI *));
+    int *BW = malloc(model->Nlive*sizeof(int));
+    
     //Loop over signals in model
     for(n=0; n<model->Nlive; n++)
     {
         struct Source *source = model->source[n];
         
+        /* the source_id = -1 condition is redundent if the model->tdi structure is up to date...*/
         if(source_id==-1 || source_id==n)
         {
+            if(!prepare_source_waveform(orbit, data, model, source)) continue;
 
-            for(i=0; i<data->N; i++)
-            {
-                source->tdi->X[i]=0.0;
-                source->tdi->Y[i]=0.0;
-                source->tdi->Z[i]=0.0;
-                source->tdi->A[i]=0.0;
-                source->tdi->E[i]=0.0;
-            }
-
-            map_array_to_params(source, source->params, data->T);
-            
-
-            //Book-keeping of injection time-frequency volume
-            ucb_alignment(orbit, data, source);
-
+            params[Nbatch] = source->params;
+            tdi[Nbatch]    = source->tdi;
+            BW[Nbatch]     = source->BW;
+            Nbatch++;
         }
-        
-        //Simulate gravitational wave signal
-        /* the source_id = -1 condition is redundent if the model->tdi structure is up to date...*/
-
-        if(source_id==-1 || source_id==n) ucb_waveform(orbit, data->format, data->T, model->t0, source->params, UCB_MODEL_NP, source->tdi->X, source->tdi->Y, source->tdi->Z, source->tdi->A, source->tdi->E, source->BW, source->tdi->Nchannel);
-        
-        //Add waveform to model TDI channels
-        add_signal_model(data,model,source);
-
-        
-    }//loop over sources
+    }
+    
+    //Simulate gravitational wave signals
+    ucb_waveform_batch(orbit, model->kernels.tdi, data->T, model->t0, params, UCB_MODEL_NP, tdi, BW, Nbatch, data->Nchannel);
+    
+    //Add waveforms to model TDI channels
+    for(n=0; n<model->Nlive; n++) add_signal_model(data,model,model->source[n]);
+    
+    free(params);
+    free(tdi);
+    free(BW);
 }
 
 void generate_signal_model_wavelet(struct Orbit *orbit, struct Data *data, struct Model *model, int source_id)
@@ -642,37 +894,15 @@ void remove_signal_model_wavelet(struct Data *data, struct Model *model, struct
 
 void update_signal_model(struct Orbit *orbit, struct Data *data, struct Model *model_x, struct Model *model_y, int source_id)
 {
-    int i;
     struct Source *source_x = model_x->source[source_id];
     struct Source *source_y = model_y->source[source_id];
     
-    //subtract current nth source from  model
-    remove_signal_model(data,model_y,source_x);
+    //subtract current nth source from model, if it is live
+    if(source_id < model_x->Nlive) remove_signal_model(data,model_y,source_x);
 
     //generate proposed signal model
-    for(i=0; i<data->N; i++)
-    {
-        switch(data->Nchannel)
-        {
-            case 1:
-                source_y->tdi->X[i]=0.0;
-                break;
-            case 2:
-                source_y->tdi->A[i]=0.0;
-                source_y->tdi->E[i]=0.0;
-                break;
-            case 3:
-                source_y->tdi->X[i]=0.0;
-                source_y->tdi->Y[i]=0.0;
-                source_y->tdi->Z[i]=0.0;
-                break;
-        }
-    }
-
-    map_array_to_params(source_y, source_y->params, data->T);
-    ucb_alignment(orbit, data, source_y);
-
-    ucb_waveform(orbit, data->format, data->T, model_y->t0, source_y->params, UCB_MODEL_NP, source_y->tdi->X,source_y->tdi->Y,source_y->tdi->Z, source_y->tdi->A, source_y->tdi->E, source_y->BW, source_y->tdi->Nchannel);
+    if(prepare_source_waveform(orbit, data, model_y, source_y))
+        ucb_waveform_batch(orbit, model_y->kernels.tdi, data->T, model_y->t0, &source_y->params, UCB_MODEL_NP, &source_y->tdi, &source_y->BW, 1, source_y->tdi->Nchannel);
 
     //add proposed nth source to model
     add_signal_model(data,model_y,source_y);
@@ -707,6 +937,7 @@ void update_signal_model_wavelet(struct Orbit *orbit, struct Data *data, struct
 
 void generate_noise_model(struct Data *data, struct Model *model)
 {
+    double prof = profile_start();
     for(int n=0; n<data->NFFT; n++)
     {
         for(int i=0; i<data->Nchannel; i++)
@@ -715,10 +946,12 @@ void generate_noise_model(struct Data *data, struct Model *model)
 
     }
     invert_noise_covariance_matrix(model->noise);
+    profile_stop_count(PROFILE_NOISE, prof, data->NFFT);
 }
 
 void generate_noise_model_wavelet(struct Data *data, struct Model *model)
 {
+    double prof = profile_start();
     int Nlayers = data->Nlayer;         //number of frequency layers
     int Nslices = data->N/data->Nlayer; //number of time slices
     for(int n=0; n<Nlayers; n++)
@@ -737,6 +970,7 @@ void generate_noise_model_wavelet(struct Data *data, struct Model *model)
 
     }
     invert_noise_covariance_matrix(model->noise);
+    profile_stop_count(PROFILE_NOISE, prof, data->N);
 }
 
 void generate_calibration_model(struct Data *data, struct Model *model)
@@ -920,8 +1154,48 @@ void maximize_signal_model(struct Orbit *orbit, struct Data *data, struct Model
         free(Fparams);
     }
 }
-double gaussian_log_likelihood(struct Data *data, struct Model *model)
+/*
+ chi^2 of the N bins of r starting at array element skip, weighted by invC
+ starting at frequency bin imin.  Called with a constant Nchannel so each
+ case compiles to its own loop.
+ */
+static inline double fourier_chi2_segment(struct TDI *r, int skip, double ***invC, int imin, int N, const int Nchannel)
+{
+    double chi2 = 0.0;
+    
+    switch(Nchannel)
+    {
+        case 1:
+            chi2 += fourier_nwip(r->X+skip, r->X+skip, invC[0][0]+imin, N);
+            break;
+        case 2:
+            chi2 += fourier_nwip(r->A+skip, r->A+skip, invC[0][0]+imin, N);
+            chi2 += fourier_nwip(r->E+skip, r->E+skip, invC[1][1]+imin, N);
+            break;
+        case 3:
+            chi2 += fourier_nwip(r->X+skip, r->X+skip, invC[0][0]+imin, N);
+            chi2 += fourier_nwip(r->Y+skip, r->Y+skip, invC[1][1]+imin, N);
+            chi2 += fourier_nwip(r->Z+skip, r->Z+skip, invC[2][2]+imin, N);
+
+            chi2 += 2.0*fourier_nwip(r->X+skip, r->Y+skip, invC[0][1]+imin, N);
+            chi2 += 2.0*fourier_nwip(r->X+skip, r->Z+skip, invC[0][2]+imin, N);
+            chi2 += 2.0*fourier_nwip(r->Y+skip, r->Z+skip, invC[1][2]+imin, N);
+            break;
+    }
+    
+    return chi2;
+}
+
+/* chi^2 of residual r over frequency bins [imin,imax), where logL = -chi^2 / 2 */
+static inline double fourier_chi2(struct TDI *r, double ***invC, int imin, int imax, const int Nchannel)
+{
+    //the complex array elements to skip in the sum
+    return fourier_chi2_segment(r, 2*imin, invC, imin, imax-imin, Nchannel);
+}
+
+static inline double gaussian_log_likelihood_channels(struct Data *data, struct Model *model, const int Nchannel)
 {
+    double prof = profile_start();
     
     /*
     *
@@ -929,8 +1203,6 @@ double gaussian_log_likelihood(struct Data *data, struct Model *model)
     *
     */
     
-    double chi2 = 0.0; //chi^2, where logL = -chi^2 / 2
-    
     //loop over time segments
     struct TDI *residual = model->residual;
     
@@ -942,32 +1214,39 @@ double gaussian_log_likelihood(struct Data *data, struct Model *model)
         residual->A[i] = data->tdi->A[i] - model->tdi->A[i];
         residual->E[i] = data->tdi->E[i] - model->tdi->E[i];
     }
-            
-    switch(data->Nchannel)
-    {
-        case 1:
-            chi2 += fourier_nwip(residual->X, residual->X, model->noise->invC[0][0], data->NFFT);
-            break;
-        case 2:
-            chi2 += fourier_nwip(residual->A, residual->A, model->noise->invC[0][0], data->NFFT);
-            chi2 += fourier_nwip(residual->E, residual->E, model->noise->invC[1][1], data->NFFT);
-            break;
-        case 3:
-            chi2 += fourier_nwip(residual->X, residual->X, model->noise->invC[0][0], data->NFFT);
-            chi2 += fourier_nwip(residual->Y, residual->Y, model->noise->invC[1][1], data->NFFT);
-            chi2 += fourier_nwip(residual->Z, residual->Z, model->noise->invC[2][2], data->NFFT);
+    
+    double logL = -0.5*fourier_chi2(residual, model->noise->invC, 0, data->NFFT, Nchannel);
+    
+    profile_stop_count(PROFILE_LIKELIHOOD, prof, data->NFFT);
+    return logL;
+}
 
-            chi2 += 2.0*fourier_nwip(residual->X, residual->Y, model->noise->invC[0][1], data->NFFT);
-            chi2 += 2.0*fourier_nwip(residual->X, residual->Z, model->noise->invC[0][2], data->NFFT);
-            chi2 += 2.0*fourier_nwip(residual->Y, residual->Z, model->noise->invC[1][2], data->NFFT);
+static double gaussian_log_likelihood_X(struct Data *data, struct Model *model)
+{
+    return gaussian_log_likelihood_channels(data, model, 1);
+}
 
-            break;
+static double gaussian_log_likelihood_AE(struct Data *data, struct Model *model)
+{
+    return gaussian_log_likelihood_channels(data, model, 2);
+}
+
+static double gaussian_log_likelihood_XYZ(struct Data *data, struct Model *model)
+{
+    return gaussian_log_likelihood_channels(data, model, 3);
+}
+
+double gaussian_log_likelihood(struct Data *data, struct Model *model)
+{
+    switch(data->Nchannel)
+    {
+        case 1: return gaussian_log_likelihood_X(data, model);
+        case 2: return gaussian_log_likelihood_AE(data, model);
+        case 3: return gaussian_log_likelihood_XYZ(data, model);
         default:
             fprintf(stderr,"Unsupported number of channels in gaussian_log_likelihood()\n");
             exit(1);
     }
-
-    return -0.5*chi2;
 }
 
 double gaussian_log_likelihood_constant_norm(struct Data *data, struct Model *model)
@@ -999,119 +1278,393 @@ double gaussian_log_likelihood_model_norm(struct Data *data, struct Model *model
     return logLnorm;
 }
 
-double delta_log_likelihood(struct Data *data, struct Model *model_x, struct Model *model_y, int source_id)
+/* Noise weighted inner product over segment bins [jmin,jmax) with a and b starting at bins ia and ib */
+static double segment_nwip(struct Data *data, struct Noise *noise, struct TDI *a, int ia, struct TDI *b, int ib, int jmin, int jmax)
 {
-    /*
-    *
-    * Update residual and only sum over affected bins
-    *
-    */
-
-    double deltalogL = 0.0;
-    struct Source *source_x = model_x->source[source_id];
-    struct Source *source_y = model_y->source[source_id];
-
-    //loop over time segments
-    struct TDI *residual_x = model_x->residual;
-    struct TDI *residual_y = model_y->residual;
+    double *ac[3], *bc[3];
     
-    //add current source back into residual
-    for(int i=0; i<source_x->BW; i++)
+    switch(data->Nchannel)
     {
-        int j = i+source_x->imin;
-        if(j>-1 && j<data->NFFT)
+        case 1:
+            ac[0] = a->X;  bc[0] = b->X;
+            break;
+        case 2:
+            ac[0] = a->A;  bc[0] = b->A;
+            ac[1] = a->E;  bc[1] = b->E;
+            break;
+        case 3:
+            ac[0] = a->X;  bc[0] = b->X;
+            ac[1] = a->Y;  bc[1] = b->Y;
+            ac[2] = a->Z;  bc[2] = b->Z;
+            break;
+        default:
+            fprintf(stderr,"Unsupported number of channels in segment_nwip()\n");
+            exit(1);
+    }
+    
+    double sum = 0.0;
+    for(int c=0; c<data->Nchannel; c++)
+    {
+        for(int cc=0; cc<data->Nchannel; cc++)
         {
-            int i_re = 2*i;
-            int i_im = i_re+1;
-            int j_re = 2*j;
-            int j_im = j_re+1;
+            //same channel correlations as gaussian_log_likelihood()
+            if(c!=cc && data->Nchannel<3) continue;
             
-            residual_y->X[i_re] += source_x->tdi->X[i_re];
-            residual_y->X[i_im] += source_x->tdi->X[i_im];
-            residual_y->Y[i_re] += source_x->tdi->Y[i_re];
-            residual_y->Y[i_im] += source_x->tdi->Y[i_im];
-            residual_y->Z[i_re] += source_x->tdi->Z[i_re];
-            residual_y->Z[i_im] += source_x->tdi->Z[i_im];
-            residual_y->A[j_re] += source_x->tdi->A[i_re];
-            residual_y->A[j_im] += source_x->tdi->A[i_im];
-            residual_y->E[j_re] += source_x->tdi->E[i_re];
-            residual_y->E[j_im] += source_x->tdi->E[i_im];
+            double *invC = noise->invC[c][cc];
+            for(int j=jmin; j<jmax; j++)
+            {
+                int ka = 2*(j-ia);
+                int kb = 2*(j-ib);
+                sum += (ac[c][ka]*bc[cc][kb] + ac[c][ka+1]*bc[cc][kb+1])*invC[j];
+            }
         }
     }
+    
+    return 2.0*sum;
+}
+
+void alloc_summary_data(struct Data *data, struct SummaryData *summary, struct Noise *noise)
+{
+    summary->params = calloc(UCB_MODEL_NP,sizeof(double));
+    summary->t0 = 0.0;
+    summary->BW = 0;
+    summary->Nupdate = 0;
+    
+    reset_summary_data(data, summary, noise);
+}
+
+void reset_summary_data(struct Data *data, struct SummaryData *summary, struct Noise *noise)
+{
+    summary->dd = segment_nwip(data, noise, data->tdi, 0, data->tdi, 0, 0, data->NFFT);
+    summary->flag = 0;
+}
+
+void free_summary_data(struct SummaryData *summary)
+{
+    free(summary->params);
+    free(summary);
+}
 
-    //form proposed residual by subtracting new source
-    for(int i=0; i<source_y->BW; i++)
+/* Form the residual of model over bins [imin,imax) */
+static void residual_band(struct Data *data, struct Model *model, int imin, int imax)
+{
+    struct TDI *residual = model->residual;
+    
+    for(int i=2*imin; i<2*imax; i++)
     {
-        int j = i+source_y->imin;
-        if(j>-1 && j<data->NFFT)
+        residual->X[i] = data->tdi->X[i] - model->tdi->X[i];
+        residual->Y[i] = data->tdi->Y[i] - model->tdi->Y[i];
+        residual->Z[i] = data->tdi->Z[i] - model->tdi->Z[i];
+        residual->A[i] = data->tdi->A[i] - model->tdi->A[i];
+        residual->E[i] = data->tdi->E[i] - model->tdi->E[i];
+    }
+}
+
+int summary_data_match(struct Model *model_x, struct Model *model_y)
+{
+    if(!model_y->summary || model_y->Nlive!=1 || model_x->Nlive!=1) return 0;
+    
+    struct Source *source_x = model_x->source[0];
+    struct Source *source_y = model_y->source[0];
+    
+    //only the extrinsic parameters changed and the filters are up to date
+    return source_y->filter_flag && source_filter_match(source_y, model_y->t0) && source_x->BW == source_y->BW && intrinsic_params_match(source_x->params, source_y->params);
+}
+
+double summary_log_likelihood(struct Data *data, struct Model *model)
+{
+    struct SummaryData *summary = model->summary;
+    struct Source *source = model->source[0];
+    
+    double prof = profile_start();
+    
+    //intrinsic parameters changed, recompute N & M from the filters
+    if(!summary->flag || summary->BW != source->BW || summary->t0 != model->t0 || !intrinsic_params_match(summary->params, source->params))
+    {
+        int jmin = (source->imin > 0) ? source->imin : 0;
+        int jmax = (source->imax < data->NFFT) ? source->imax : data->NFFT;
+        
+        for(int i=0; i<4; i++)
         {
-            int i_re = 2*i;
-            int i_im = i_re+1;
-            int j_re = 2*j;
-            int j_im = j_re+1;
-            
-            residual_y->X[i_re] -= source_y->tdi->X[i_re];
-            residual_y->X[i_im] -= source_y->tdi->X[i_im];
-            residual_y->Y[i_re] -= source_y->tdi->Y[i_re];
-            residual_y->Y[i_im] -= source_y->tdi->Y[i_im];
-            residual_y->Z[i_re] -= source_y->tdi->Z[i_re];
-            residual_y->Z[i_im] -= source_y->tdi->Z[i_im];
-            residual_y->A[j_re] -= source_y->tdi->A[i_re];
-            residual_y->A[j_im] -= source_y->tdi->A[i_im];
-            residual_y->E[j_re] -= source_y->tdi->E[i_re];
-            residual_y->E[j_im] -= source_y->tdi->E[i_im];
+            summary->N[i] = segment_nwip(data, model->noise, data->tdi, 0, source->filter[i], source->imin, jmin, jmax);
+            for(int j=i; j<4; j++)
+                summary->M[i][j] = summary->M[j][i] = segment_nwip(data, model->noise, source->filter[i], source->imin, source->filter[j], source->imin, jmin, jmax);
         }
+        
+        memcpy(summary->params, source->params, UCB_MODEL_NP*sizeof(double));
+        summary->t0 = model->t0;
+        summary->BW = source->BW;
+        summary->flag = 1;
+        summary->Nupdate++;
     }
-
-    //find range of integration
-    int imin = find_min(source_x->imin,source_y->imin);
-    int imax = find_max(source_y->imin+source_y->BW,source_x->imin+source_x->BW);
     
+    double a[4];
+    ucb_filter_weights(source->params, a);
+    
+    double chi2 = summary->dd;
+    for(int i=0; i<4; i++)
+    {
+        chi2 -= 2.0*a[i]*summary->N[i];
+        for(int j=0; j<4; j++) chi2 += a[i]*a[j]*summary->M[i][j];
+    }
+    
+    //keep the residual current for the delta likelihood of later updates
+    int imin = (source->imin > 0) ? source->imin : 0;
+    int imax = (source->imin+source->BW < data->NFFT) ? source->imin+source->BW : data->NFFT;
+    residual_band(data, model, imin, imax);
+    
+    profile_stop(PROFILE_LIKELIHOOD, prof);
+    return -0.5*chi2;
+}
+
+static inline double delta_log_likelihood_band_channels(struct Data *data, struct Model *model_x, struct Model *model_y, int imin, int imax, const int Nchannel)
+{
+    /*
+    *
+    * Update residual and only sum over affected bins
+    *
+    */
+
     //keep it in bounds
     if(imax>data->NFFT)imax=data->NFFT;
     if(imin<0)imin=0;
+    if(imax<=imin) return 0.0;
 
-    //the complex array elements to skip in the sum
-    int skip=2*imin;
+    double prof = profile_start();
     
-    switch(data->Nchannel)
-    {
-        case 1:
-            deltalogL -= fourier_nwip(residual_x->X+skip, residual_x->X+skip, model_x->noise->invC[0][0]+imin, imax-imin);
-            deltalogL += fourier_nwip(residual_y->X+skip, residual_y->X+skip, model_x->noise->invC[0][0]+imin, imax-imin);
-            break;
-            
-        case 2:
-            deltalogL -= fourier_nwip(residual_x->A+skip, residual_x->A+skip, model_x->noise->invC[0][0]+imin, imax-imin);
-            deltalogL -= fourier_nwip(residual_x->E+skip, residual_x->E+skip, model_x->noise->invC[1][1]+imin, imax-imin);
+    struct TDI *residual_x = model_x->residual;
+    struct TDI *residual_y = model_y->residual;
+    
+    //form proposed residual from the proposed model
+    residual_band(data, model_y, imin, imax);
 
-            deltalogL += fourier_nwip(residual_y->A+skip, residual_y->A+skip, model_y->noise->invC[0][0]+imin, imax-imin);
-            deltalogL += fourier_nwip(residual_y->E+skip, residual_y->E+skip, model_y->noise->invC[1][1]+imin, imax-imin);
+    double deltalogL = 0.0;
+    deltalogL -= fourier_chi2(residual_x, model_x->noise->invC, imin, imax, Nchannel);
+    deltalogL += fourier_chi2(residual_y, model_y->noise->invC, imin, imax, Nchannel);
+        
+    profile_stop_count(PROFILE_LIKELIHOOD, prof, imax-imin);
+    return -0.5*deltalogL;
 
-            break;
-        case 3:
-            deltalogL -= fourier_nwip(residual_x->X+skip, residual_x->X+skip, model_x->noise->invC[0][0]+imin, imax-imin);
-            deltalogL -= fourier_nwip(residual_x->Y+skip, residual_x->Y+skip, model_x->noise->invC[1][1]+imin, imax-imin);
-            deltalogL -= fourier_nwip(residual_x->Z+skip, residual_x->Z+skip, model_x->noise->invC[2][2]+imin, imax-imin);
-            deltalogL -= 2.0*fourier_nwip(residual_x->X+skip, residual_x->Y+skip, model_x->noise->invC[0][1]+imin, imax-imin);
-            deltalogL -= 2.0*fourier_nwip(residual_x->X+skip, residual_x->Z+skip, model_x->noise->invC[0][2]+imin, imax-imin);
-            deltalogL -= 2.0*fourier_nwip(residual_x->Y+skip, residual_x->Z+skip, model_x->noise->invC[1][2]+imin, imax-imin);
-
-            deltalogL += fourier_nwip(residual_y->X+skip, residual_y->X+skip, model_y->noise->invC[0][0]+imin, imax-imin);
-            deltalogL += fourier_nwip(residual_y->Y+skip, residual_y->Y+skip, model_y->noise->invC[1][1]+imin, imax-imin);
-            deltalogL += fourier_nwip(residual_y->Z+skip, residual_y->Z+skip, model_y->noise->invC[2][2]+imin, imax-imin);
-            deltalogL += 2.0*fourier_nwip(residual_y->X+skip, residual_y->Y+skip, model_y->noise->invC[0][1]+imin, imax-imin);
-            deltalogL += 2.0*fourier_nwip(residual_y->X+skip, residual_y->Z+skip, model_y->noise->invC[0][2]+imin, imax-imin);
-            deltalogL += 2.0*fourier_nwip(residual_y->Y+skip, residual_y->Z+skip, model_y->noise->invC[1][2]+imin, imax-imin);
+}
 
-            break;
+static double delta_log_likelihood_band_X(struct Data *data, struct Model *model_x, struct Model *model_y, int imin, int imax)
+{
+    return delta_log_likelihood_band_channels(data, model_x, model_y, imin, imax, 1);
+}
+
+static double delta_log_likelihood_band_AE(struct Data *data, struct Model *model_x, struct Model *model_y, int imin, int imax)
+{
+    return delta_log_likelihood_band_channels(data, model_x, model_y, imin, imax, 2);
+}
+
+static double delta_log_likelihood_band_XYZ(struct Data *data, struct Model *model_x, struct Model *model_y, int imin, int imax)
+{
+    return delta_log_likelihood_band_channels(data, model_x, model_y, imin, imax, 3);
+}
+
+double delta_log_likelihood_band(struct Data *data, struct Model *model_x, struct Model *model_y, int imin, int imax)
+{
+    switch(data->Nchannel)
+    {
+        case 1: return delta_log_likelihood_band_X(data, model_x, model_y, imin, imax);
+        case 2: return delta_log_likelihood_band_AE(data, model_x, model_y, imin, imax);
+        case 3: return delta_log_likelihood_band_XYZ(data, model_x, model_y, imin, imax);
         default:
             fprintf(stderr,"Unsupported number of channels in delta_log_likelihood()\n");
             exit(1);
     }
+}
+
+double delta_log_likelihood(struct Data *data, struct Model *model_x, struct Model *model_y, int source_id)
+{
+    struct Source *source_x = model_x->source[source_id];
+    struct Source *source_y = model_y->source[source_id];
+
+    //find range of integration
+    int imin = find_min(source_x->imin,source_y->imin);
+    int imax = find_max(source_y->imin+source_y->BW,source_x->imin+source_x->BW);
+    
+    return (*model_y->kernels.delta_log_likelihood_band)(data, model_x, model_y, imin, imax);
+}
+
+/* Reduced bandwidth response of the source, only recomputed if its parameters changed */
+static void surrogate_source_waveform(struct Orbit *orbit, struct Data *data, struct Model *model, struct Source *source, int downsample)
+{
+    if(source->surrogate_BW && source->surrogate_t0 == model->t0 && !memcmp(source->surrogate_params, source->params, UCB_MODEL_NP*sizeof(double))) return;
+    
+    ucb_alignment(orbit, data, source);
+    
+    int BW = source->BW/downsample;
+    if(BW < 2) BW = 2;
+    
+    if(!source->surrogate)
+    {
+        source->surrogate = malloc(sizeof(struct TDI));
+        alloc_tdi(source->surrogate, 2*BW, data->Nchannel);
+    }
+    else if(source->surrogate->N < 2*BW) grow_tdi(source->surrogate, 2*BW);
+    
+    struct TDI *h = source->surrogate;
+    memset(h->X, 0, 2*BW*sizeof(double));
+    memset(h->Y, 0, 2*BW*sizeof(double));
+    memset(h->Z, 0, 2*BW*sizeof(double));
+    memset(h->A, 0, 2*BW*sizeof(double));
+    memset(h->E, 0, 2*BW*sizeof(double));
+    
+    ucb_waveform_batch(orbit, model->kernels.tdi, data->T, model->t0, &source->params, UCB_MODEL_NP, &source->surrogate, &BW, 1, data->Nchannel);
+    
+    memcpy(source->surrogate_params, source->params, UCB_MODEL_NP*sizeof(double));
+    source->surrogate_t0   = model->t0;
+    source->surrogate_BW   = BW;
+    source->surrogate_imin = (int)(source->f0*data->T) - BW/2 - data->qmin; //as in ucb_alignment()
+}
+
+/* Model::surrogate with room for N elements, allocated on first use and grown as needed */
+static struct TDI *surrogate_residual(struct Data *data, struct Model *model, int N)
+{
+    if(!model->surrogate)
+    {
+        model->surrogate = malloc(sizeof(struct TDI));
+        alloc_tdi(model->surrogate, N, data->Nchannel);
+    }
+    else if(model->surrogate->N < N) grow_tdi(model->surrogate, N);
+    
+    return model->surrogate;
+}
+
+/* Subtract the reduced bandwidth response of source from rh, which holds the bins starting at imin */
+static void subtract_surrogate_response(struct TDI *rh, int imin, struct Source *source)
+{
+    struct TDI *h = source->surrogate;
+    int offset = 2*(source->surrogate_imin - imin);
+    
+    for(int j=0; j<2*source->surrogate_BW; j++)
+    {
+        rh->X[j+offset] -= h->X[j];
+        rh->Y[j+offset] -= h->Y[j];
+        rh->Z[j+offset] -= h->Z[j];
+        rh->A[j+offset] -= h->A[j];
+        rh->E[j+offset] -= h->E[j];
+    }
+}
+
+double surrogate_delta_log_likelihood(struct Orbit *orbit, struct Data *data, struct Model *model_x, struct Model *model_y, int source_id, int downsample)
+{
+    struct Source *source_x = model_x->source[source_id];
+    struct Source *source_y = model_y->source[source_id];
+    
+    surrogate_source_waveform(orbit, data, model_x, source_x, downsample);
+    surrogate_source_waveform(orbit, data, model_y, source_y, downsample);
+    
+    double prof = profile_start();
+    
+    //union of the reduced bands
+    int imin = find_min(source_x->surrogate_imin, source_y->surrogate_imin);
+    int imax = find_max(source_x->surrogate_imin+source_x->surrogate_BW, source_y->surrogate_imin+source_y->surrogate_BW);
+    int N = imax-imin;
+    
+    /*
+     r = d - h_{-n} is the residual of the current state with the source added back,
+     the same for both states, so (r|r) cancels and we only need r - h over the band.
+     Each model keeps the scratch copy of r it is compared with
+     */
+    struct TDI *rx = surrogate_residual(data, model_x, 2*N);
+    struct TDI *ry = surrogate_residual(data, model_y, 2*N);
+    
+    for(int k=0; k<2*N; k++)
+    {
+        int i = 2*imin + k;           //element of the segment
+        int j = i - 2*source_x->imin; //element of the source's band
+        if(i<0 || i>=data->N)
+        {
+            rx->X[k] = rx->Y[k] = rx->Z[k] = rx->A[k] = rx->E[k] = 0.0;
+            continue;
+        }
         
+        rx->X[k] = model_x->residual->X[i];
+        rx->Y[k] = model_x->residual->Y[i];
+        rx->Z[k] = model_x->residual->Z[i];
+        rx->A[k] = model_x->residual->A[i];
+        rx->E[k] = model_x->residual->E[i];
+        
+        if(j >= 0 && j < 2*source_x->BW)
+        {
+            rx->X[k] += source_x->tdi->X[j];
+            rx->Y[k] += source_x->tdi->Y[j];
+            rx->Z[k] += source_x->tdi->Z[j];
+            rx->A[k] += source_x->tdi->A[j];
+            rx->E[k] += source_x->tdi->E[j];
+        }
+    }
+    copy_tdi_segment(rx, ry, 0, 2*N);
+    
+    subtract_surrogate_response(rx, imin, source_x);
+    subtract_surrogate_response(ry, imin, source_y);
+    
+    //keep it in bounds
+    int kmin = (imin < 0) ? -imin : 0;
+    int kmax = (imax > data->NFFT) ? data->NFFT-imin : N;
+    
+    double deltalogL = 0.0;
+    if(kmax > kmin)
+    {
+        deltalogL -= fourier_chi2_segment(rx, 2*kmin, model_x->noise->invC, imin+kmin, kmax-kmin, data->Nchannel);
+        deltalogL += fourier_chi2_segment(ry, 2*kmin, model_x->noise->invC, imin+kmin, kmax-kmin, data->Nchannel);
+    }
+    
+    profile_stop_count(PROFILE_LIKELIHOOD, prof, N);
     return -0.5*deltalogL;
+}
+
+double delta_log_likelihood_wavelet(struct Data *data, struct Model *model_x, struct Model *model_y, int source_id)
+{
+    struct Source *source_x = model_x->source[source_id];
+    struct Source *source_y = model_y->source[source_id];
+
+    if(source_x->Nlist+source_y->Nlist == 0) return 0.0;
+    
+    double prof = profile_start();
+    
+    //pixels where either waveform was non-zero
+    int Nlist;
+    int *list = int_vector(source_x->Nlist+source_y->Nlist);
+    list_union(source_x->list, source_y->list, source_x->Nlist, source_y->Nlist, list, &Nlist);
+    
+    struct TDI *residual_x = model_x->residual;
+    struct TDI *residual_y = model_y->residual;
 
+    //form proposed residual from the proposed model
+    for(int n=0; n<Nlist; n++)
+    {
+        int k = list[n];
+        if(k>=0 && k<data->N)
+        {
+            residual_y->X[k] = data->tdi->X[k] - model_y->tdi->X[k];
+            residual_y->Y[k] = data->tdi->Y[k] - model_y->tdi->Y[k];
+            residual_y->Z[k] = data->tdi->Z[k] - model_y->tdi->Z[k];
+        }
+    }
+    
+    double deltalogL = 0.0;
+    
+    deltalogL -= wavelet_nwip(residual_x->X, residual_x->X, model_x->noise->invC[0][0], list, Nlist);
+    deltalogL -= wavelet_nwip(residual_x->Y, residual_x->Y, model_x->noise->invC[1][1], list, Nlist);
+    deltalogL -= wavelet_nwip(residual_x->Z, residual_x->Z, model_x->noise->invC[2][2], list, Nlist);
+    deltalogL -= wavelet_nwip(residual_x->X, residual_x->Y, model_x->noise->invC[0][1], list, Nlist)*2;
+    deltalogL -= wavelet_nwip(residual_x->X, residual_x->Z, model_x->noise->invC[0][2], list, Nlist)*2;
+    deltalogL -= wavelet_nwip(residual_x->Y, residual_x->Z, model_x->noise->invC[1][2], list, Nlist)*2;
+
+    deltalogL += wavelet_nwip(residual_y->X, residual_y->X, model_y->noise->invC[0][0], list, Nlist);
+    deltalogL += wavelet_nwip(residual_y->Y, residual_y->Y, model_y->noise->invC[1][1], list, Nlist);
+    deltalogL += wavelet_nwip(residual_y->Z, residual_y->Z, model_y->noise->invC[2][2], list, Nlist);
+    deltalogL += wavelet_nwip(residual_y->X, residual_y->Y, model_y->noise->invC[0][1], list, Nlist)*2;
+    deltalogL += wavelet_nwip(residual_y->X, residual_y->Z, model_y->noise->invC[0][2], list, Nlist)*2;
+    deltalogL += wavelet_nwip(residual_y->Y, residual_y->Z, model_y->noise->invC[1][2], list, Nlist)*2;
+
+    free_int_vector(list);
+    
+    profile_stop_count(PROFILE_LIKELIHOOD, prof, Nlist);
+    return -0.5*deltalogL;
 }
 
 int update_max_log_likelihood(struct Model **model, struct Chain *chain, struct Flags *flags)
@@ -1153,6 +1706,8 @@ double gaussian_log_likelhood_wavelet(struct Data *data, struct Model *model)
     Form residual and sum
     */
 
+    double prof = profile_start();
+    
     double chi2 = 0.0;
 
     struct TDI *residual = model->residual;
@@ -1188,6 +1743,66 @@ double gaussian_log_likelhood_wavelet(struct Data *data, struct Model *model)
 
     free_int_vector(list);
     
+    profile_stop_count(PROFILE_LIKELIHOOD, prof, data->N);
     return -0.5*chi2;
 
 }
+
+void select_ucb_kernels(struct Data *data, struct UCBKernels *kernels)
+{
+    if(!strcmp(data->basis,"fourier"))
+    {
+        kernels->tdi = select_LISA_tdi(data->format);
+        
+        kernels->generate_noise  = generate_noise_model;
+        kernels->generate_signal = generate_signal_model;
+        kernels->update_signal   = update_signal_model;
+        kernels->remove_signal   = remove_signal_model;
+        
+        kernels->delta_log_likelihood = delta_log_likelihood;
+        kernels->fisher = ucb_fisher;
+        
+        switch(data->Nchannel)
+        {
+            case 1:
+                kernels->log_likelihood = gaussian_log_likelihood_X;
+                kernels->delta_log_likelihood_band = delta_log_likelihood_band_X;
+                kernels->snr = snr_X;
+                break;
+            case 2:
+                kernels->log_likelihood = gaussian_log_likelihood_AE;
+                kernels->delta_log_likelihood_band = delta_log_likelihood_band_AE;
+                kernels->snr = snr_AE;
+                break;
+            case 3:
+                kernels->log_likelihood = gaussian_log_likelihood_XYZ;
+                kernels->delta_log_likelihood_band = delta_log_likelihood_band_XYZ;
+                kernels->snr = snr_XYZ;
+                break;
+            default:
+                fprintf(stderr,"Unsupported number of channels %i in select_ucb_kernels()\n",data->Nchannel);
+                exit(1);
+        }
+    }
+    else if(!strcmp(data->basis,"wavelet"))
+    {
+        //wavelet waveforms hard-code the LDC2.1 TDI conventions
+        kernels->tdi = LISA_tdi_Sangria;
+        
+        kernels->generate_noise  = generate_noise_model_wavelet;
+        kernels->generate_signal = generate_signal_model_wavelet;
+        kernels->update_signal   = update_signal_model_wavelet;
+        kernels->remove_signal   = remove_signal_model_wavelet;
+        
+        kernels->log_likelihood = gaussian_log_likelhood_wavelet;
+        kernels->delta_log_likelihood = delta_log_likelihood_wavelet;
+        kernels->delta_log_likelihood_band = NULL;
+        kernels->snr = snr_wavelet;
+        kernels->fisher = ucb_fisher_wavelet;
+    }
+    else
+    {
+        fprintf(stderr,"Unsupported basis %s in select_ucb_kernels()\n",data->basis);
+        exit(1);
+    }
+}
@@ -26,6 +26,39 @@
 #include <stdio.h>
 
 #define UCB_MODEL_NP 8 ///< Number of source parameters for UCB model
+#define UCB_DELTA_LOGL_NMAX 1000 ///< Incremental likelihood updates before the model and likelihood are recomputed from scratch
+#define UCB_SURROGATE_DOWNSAMPLE 2 ///< Bandwidth reduction of the waveforms used by surrogate_delta_log_likelihood()
+
+struct Model;
+struct Source;
+
+/**
+\brief Basis, format, and channel specific kernels called by the samplers
+
+ Resolved once per Model by select_ucb_kernels() from Data::basis, Data::format,
+ and Data::Nchannel so that the samplers do not compare strings in the inner loop.
+ */
+struct UCBKernels
+{
+    LISA_tdi_function tdi; //!<TDI synthesis for Data::format, see select_LISA_tdi()
+    
+    ///@name Model updates
+    ///@{
+    void (*generate_noise)(struct Data*, struct Model*); //!<generate_noise_model() or generate_noise_model_wavelet()
+    void (*generate_signal)(struct Orbit*, struct Data*, struct Model*, int); //!<generate_signal_model() or generate_signal_model_wavelet()
+    void (*update_signal)(struct Orbit*, struct Data*, struct Model*, struct Model*, int); //!<update_signal_model() or update_signal_model_wavelet()
+    void (*remove_signal)(struct Data*, struct Model*, struct Source*); //!<remove_signal_model() or remove_signal_model_wavelet()
+    ///@}
+    
+    ///@name Likelihood and SNR, specialised to Data::Nchannel in the Fourier basis
+    ///@{
+    double (*log_likelihood)(struct Data*, struct Model*); //!<gaussian_log_likelihood() or gaussian_log_likelhood_wavelet()
+    double (*delta_log_likelihood)(struct Data*, struct Model*, struct Model*, int); //!<delta_log_likelihood() or delta_log_likelihood_wavelet()
+    double (*delta_log_likelihood_band)(struct Data*, struct Model*, struct Model*, int, int); //!<delta_log_likelihood_band(), NULL if the basis has no contiguous frequency band
+    double (*snr)(struct Source*, struct Noise*); //!<snr() or snr_wavelet()
+    void (*fisher)(struct Orbit*, struct Data*, struct Source*, struct Noise*); //!<ucb_fisher() or ucb_fisher_wavelet()
+    ///@}
+};
 
 /**
 \brief Hierarchical structure of UCB model
@@ -50,6 +83,7 @@ struct Model
     ///@{
     struct TDI *tdi; //!<joint signal model
     struct TDI *residual; //!<joint residual
+    struct TDI *surrogate; //!<scratch residual for surrogate_delta_log_likelihood(), NULL until first used
     ///@}
     
     ///@name Segment start time
@@ -67,6 +101,7 @@ struct Model
     ///@{
     double logL; //!<unnormalized log likelihood \f$ -(d-h|d-h)/2 \f$
     double logLnorm; //!<normalization of log likelihood \f$ \propto -\log \det C \f$
+    int Ndelta; //!<incremental updates to Model::tdi and Model::logL since they were last computed from scratch
     ///@}
 
     ///@name Wavelet bookkeeping
@@ -74,6 +109,40 @@ struct Model
     int *list; //!<list of active wavelet pixels
     int Nlist; //!<number of active wavelet pixels
     ///@}
+    
+    /// Kernels for the data basis, format, and number of channels
+    struct UCBKernels kernels;
+    
+    /// Summary data shared with the trial model, NULL to always use gaussian_log_likelihood()
+    struct SummaryData *summary;
+    
+    ///@name Trial bookkeeping
+    ///@{
+    int update_flag;   //!<trial vs. current state: 0 identical, 1 differs only in Model::update_source, -1 unknown
+    int update_source; //!<index of the source that changed
+    int update_imin;   //!<first frequency bin of Model::tdi and Model::residual that changed
+    int update_imax;   //!<last frequency bin (exclusive) of Model::tdi and Model::residual that changed
+    ///@}
+};
+
+/**
+ \brief Summary data for the likelihood of a single source.
+
+ The template is \f$ h = \sum_i a_i F_i \f$ in terms of the extrinsic parameter
+ filters of ucb_waveform_filters(), so \f$ (d-h|d-h) = (d|d) - 2 a_i N_i + a_i a_j M_{ij} \f$
+ with \f$ N_i = (d|F_i) \f$ and \f$ M_{ij} = (F_i|F_j) \f$ as in the F-statistic.
+ The summary data are recomputed when the source's intrinsic parameters change.
+ */
+struct SummaryData
+{
+    double dd;       //!<\f$ (d|d) \f$ over the segment
+    double N[4];     //!<\f$ N_i = (d|F_i) \f$
+    double M[4][4];  //!<\f$ M_{ij} = (F_i|F_j) \f$
+    double *params;  //!<source parameters of the filters, only the intrinsic ones are compared
+    double t0;       //!<start time of the filters
+    int BW;          //!<bandwidth of the filters
+    int flag;        //!<1 if N and M are up to date with params, t0, and BW
+    int Nupdate;     //!<number of times N and M have been recomputed
 };
 
 /**
@@ -84,7 +153,13 @@ struct Source
     /// Array containing parameters to be passed to ucb_waveform()
     double *params;
 
-    /// Instrument response to signal with Source::params \f$ h(\vec\theta) \f$
+    /**
+     Instrument response to signal with Source::params \f$ h(\vec\theta) \f$.
+     Fourier responses are band-local, holding the Source::BW bins starting
+     at Source::imin. Wavelet responses span the segment and are non-zero
+     at the pixels in Source::list. TDI::N is the allocated capacity,
+     grown by clear_source_tdi()
+     */
     struct TDI *tdi;
     
 
@@ -133,6 +208,26 @@ struct Source
     int fisher_update_flag; //!<1 if fisher needs update, 0 if not
     ///@}
 
+    ///@name Extrinsic parameter filters
+    ///See ucb_waveform_filters()
+    ///@{
+    struct TDI **filter;   //!<responses to the four polarization amplitudes, NULL until first used
+    double *filter_params; //!<parameters of the last template, only the intrinsic ones are compared
+    double filter_t0;      //!<start time of the last template
+    int filter_BW;         //!<bandwidth of the last template
+    int filter_flag;       //!<1 if Source::filter holds the basis for the last template, 0 if not
+    ///@}
+
+    ///@name Reduced bandwidth response
+    ///See surrogate_delta_log_likelihood()
+    ///@{
+    struct TDI *surrogate;    //!<band-local response with Source::surrogate_BW bins starting at Source::surrogate_imin, NULL until first used
+    double *surrogate_params; //!<parameters of Source::surrogate
+    double surrogate_t0;      //!<start time of Source::surrogate
+    int surrogate_BW;         //!<bandwidth of Source::surrogate, 0 if it has not been computed
+    int surrogate_imin;       //!<first frequency bin of Source::surrogate
+    ///@}
+
     ///@name Wavelet bookkeeping
     ///@{
     int *list; //!<list of active wavelet pixels
@@ -154,7 +249,10 @@ void generate_signal_model_wavelet(struct Orbit *orbit, struct Data *data, struc
 \brief Modify galactic binary model waveform
 
  Computes LISA response to signal with parameters indexed by `source_id`
- in the Model::Source, and updates meta template of all sources in the model.
+ in the Model::Source, and updates meta template of all sources in the model
+ by subtracting the source in `model_x` and adding the new one to `model_y`.
+ Only valid if `model_y` was in sync with `model_x`.  If `source_id` is
+ not live in `model_x` the new source is only added (birth move).
  */
 void update_signal_model(struct Orbit *orbit, struct Data *data, struct Model *model_x, struct Model *model_y, int source_id);
 void update_signal_model_wavelet(struct Orbit *orbit, struct Data *data, struct Model *model_x, struct Model *model_y, int source_id);
@@ -229,8 +327,79 @@ double gaussian_log_likelihood_model_norm(struct Data *data, struct Model *model
  */
 double delta_log_likelihood(struct Data *data, struct Model *model_x, struct Model *model_y, int source_id);
 
+/**
+ \brief Cheap approximation to delta_log_likelihood() from reduced bandwidth waveforms
+
+ Computes \f$ \tilde L(\theta) = (r|\tilde h(\theta)) - \frac{1}{2}(\tilde h(\theta)|\tilde h(\theta)) \f$
+ for source `source_id` in `model_x` and `model_y`, where \f$ r \f$ is the
+ residual of `model_x` with the source added back and \f$ \tilde h \f$ is the
+ response with `1/downsample` of the Source::BW bins.  Both states may only
+ differ in `source_id`.  \f$ \tilde L \f$ only depends on the source parameters
+ and the other sources, as the first stage of delayed acceptance requires.
+ The response of each source is cached in Source::surrogate.
+ @return \f$ \tilde L(y) - \tilde L(x) \f$
+ */
+double surrogate_delta_log_likelihood(struct Orbit *orbit, struct Data *data, struct Model *model_x, struct Model *model_y, int source_id, int downsample);
+
+/**
+ \brief Check if the intrinsic parameters of two UCB parameter arrays are identical
+
+ Extrinsic parameters \f$(\mathcal{A},\cos\iota,\psi,\varphi_0)\f$ are not compared.
+ @return 1 if the parameters the extrinsic parameter filters depend on match, 0 if not
+ */
+int intrinsic_params_match(double *a, double *b);
+
+/**
+ \brief Compute difference in log Likelihood when the model only changed in frequency bins `[imin,imax)`
+ 
+ Recomputes Model::residual of `model_y` in the band from Model::tdi and
+ sums the change in the likelihood over the band.  Requires the residual of
+ `model_x` to be up to date, and the same as that of `model_y` outside the band.
+ */
+double delta_log_likelihood_band(struct Data *data, struct Model *model_x, struct Model *model_y, int imin, int imax);
+
+/**
+ \brief Wavelet domain delta_log_likelihood(), summing over the union of the source's old and new pixel lists
+ */
+double delta_log_likelihood_wavelet(struct Data *data, struct Model *model_x, struct Model *model_y, int source_id);
+
 double gaussian_log_likelhood_wavelet(struct Data *data, struct Model *model);
 
+/**
+ \brief Allocates and initializes SummaryData structure for the data and noise model
+ */
+void alloc_summary_data(struct Data *data, struct SummaryData *summary, struct Noise *noise);
+
+/**
+ \brief Recomputes \f$ (d|d) \f$ and invalidates the rest of the summary data
+
+ Must be called whenever Data::tdi or the noise model change.
+ */
+void reset_summary_data(struct Data *data, struct SummaryData *summary, struct Noise *noise);
+
+/**
+ \brief Free memory for SummaryData structure
+ */
+void free_summary_data(struct SummaryData *summary);
+
+/**
+ \brief Check if summary_log_likelihood() applies to the update from model_x to model_y
+
+ True if both models have a single source, only its extrinsic parameters
+ changed, and the filters of model_y are up to date.
+ */
+int summary_data_match(struct Model *model_x, struct Model *model_y);
+
+/**
+ \brief gaussian_log_likelihood() from Model::summary
+
+ Only valid if summary_data_match() is true, recomputing \f$ N_i \f$ and \f$ M_{ij} \f$
+ if the source's intrinsic parameters changed since they were last used.
+ The residual is updated over the source's band, so the cost still scales
+ with the bandwidth but skips the noise weighted sums over it.
+ */
+double summary_log_likelihood(struct Data *data, struct Model *model);
+
 /**
  \brief Check for increase in maximum log likelihood
  */
@@ -249,12 +418,34 @@ void map_array_to_params(struct Source *source, double *params, double T);
 
 
 
+/**
+ \brief Resolve the UCBKernels for Data::basis, Data::format, and Data::Nchannel
+
+ Called by alloc_model().  Unsupported combinations are fatal here instead of deep inside the sampler.
+ */
+void select_ucb_kernels(struct Data *data, struct UCBKernels *kernels);
+
 /** @name Allocate memory for structures */
 ///@{
 void alloc_model(struct Data *data, struct Model *model, int Nmax);
-void alloc_source(struct Source *source, int N, int Nchannel);
 ///@}
 
+/**
+ \brief Allocate a Source with empty response storage
+
+ Source::tdi and Source::list are grown by clear_source_tdi() once
+ the band (Fourier) or segment (wavelet) of the response is known.
+ */
+void alloc_source(struct Source *source, int Nchannel);
+
+/**
+ \brief Zero the first `N` samples of Source::tdi, growing its storage if needed
+
+ Use `N=2*BW` after ucb_alignment() for Fourier waveforms
+ and the segment length for wavelet waveforms.
+ */
+void clear_source_tdi(struct Source *source, int N);
+
 /**
  \brief Shallow copy of Data structure
  */
@@ -267,6 +458,31 @@ void copy_model(struct Model *origin, struct Model *copy);
 void copy_model_lite(struct Model *origin, struct Model *copy);
 ///@}
 
+/**
+ \brief Record that the trial differs from the current state in one source
+ 
+ Stores the source index and the union of its old and new bands in
+ Model::update_source, Model::update_imin, and Model::update_imax
+ of the trial. Only valid if the trial was in sync with `model` before
+ `source_id` was updated with generate_signal_model().
+ */
+void record_model_update(struct Data *data, struct Model *model, struct Model *trial, int source_id);
+
+/**
+ \brief Accept the trial by copying what changed into the current state
+ 
+ Falls back to copy_model_lite() if the trial has no update record,
+ in which case the next reject_model_update() does a full copy.
+ */
+void accept_model_update(struct Model *trial, struct Model *model);
+
+/**
+ \brief Reject the trial by restoring what changed from the current state
+ 
+ Falls back to copy_model() if the trial has no update record.
+ */
+void reject_model_update(struct Model *model, struct Model *trial);
+
 /** @name Free memory for structures */
 ///@{
 void free_model(struct Model *model);
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <unistd.h>
+
 #include <glass_utils.h>
 
 #include "glass_ucb_model.h"
@@ -27,23 +29,95 @@ static double loglike(double *x, int D)
     return log(galaxy_distribution(x,GALAXY_A,GALAXY_Rb, GALAXY_Rd, GALAXY_Zd));    
 }
 
-void set_galaxy_prior(struct Flags *flags, struct Prior *prior)
+/* binary galaxy sky prior cache, see write_galaxy_prior() */
+#define GALAXY_PRIOR_MAGIC "GLASSSKY"
+#define GALAXY_PRIOR_VERSION 1
+#define GALAXY_PRIOR_NKEY 10
+
+/* everything the galaxy sky prior depends on */
+static void galaxy_prior_key(double *key, int Nth, int Nph, int MCMC, unsigned int seed, double uni)
 {
-    if(!flags->quiet)
+    key[0] = GALAXY_RGC;
+    key[1] = GALAXY_A;
+    key[2] = GALAXY_Rb;
+    key[3] = GALAXY_Rd;
+    key[4] = GALAXY_Zd;
+    key[5] = (double)Nth;
+    key[6] = (double)Nph;
+    key[7] = (double)MCMC;
+    key[8] = (double)seed;
+    key[9] = uni;
+}
+
+/*
+ store log density of the sky prior and its key, writing to a temporary file so a crash never leaves a partial prior.
+ MPI ranks build the same prior concurrently, so each writes its own temporary file and failures only skip the cache
+ */
+static void write_galaxy_prior(struct Prior *prior, double *key, char *filename)
+{
+    char tempname[MAXSTRINGSIZE+32];
+    sprintf(tempname,"%s.%i.tmp",filename,(int)getpid());
+    
+    FILE *fptr = fopen(tempname,"wb");
+    if(fptr==NULL)
     {
-        fprintf(stdout,"\n============ Galaxy model sky prior ============\n");
-        fprintf(stdout,"Monte carlo over galaxy model\n");
-        fprintf(stdout,"   Distance to GC = %g kpc\n",GALAXY_RGC);
-        fprintf(stdout,"   Disk Radius    = %g kpc\n",GALAXY_Rd);
-        fprintf(stdout,"   Disk Height    = %g kpc\n",GALAXY_Zd);
-        fprintf(stdout,"   Bulge Radius   = %g kpc\n",GALAXY_Rb);
-        fprintf(stdout,"   Bulge Fraction = %g\n",    GALAXY_A);
+        fprintf(stderr,"Warning: could not open galaxy prior cache %s\n",tempname);
+        return;
+    }
+    
+    int version = GALAXY_PRIOR_VERSION;
+    fwrite(GALAXY_PRIOR_MAGIC, sizeof(char), 8, fptr);
+    fwrite(&version, sizeof(int), 1, fptr);
+    fwrite(key, sizeof(double), GALAXY_PRIOR_NKEY, fptr);
+    fwrite(prior->skyhist, sizeof(double), prior->ncostheta*prior->nphi, fptr);
+    
+    int fail = ferror(fptr);
+    if(fclose(fptr)) fail = 1;
+    if(fail)
+    {
+        fprintf(stderr,"Warning: could not write galaxy prior cache %s\n",tempname);
+        remove(tempname);
+        return;
     }
+    
+    if(rename(tempname,filename))
+    {
+        fprintf(stderr,"Warning: could not move galaxy prior cache %s to %s\n",tempname,filename);
+        remove(tempname);
+    }
+}
+
+/* restore sky prior stored by write_galaxy_prior(), returns 0 if there is none for this galaxy model and grid */
+static int read_galaxy_prior(struct Prior *prior, double *key, char *filename)
+{
+    FILE *fptr = fopen(filename,"rb");
+    if(fptr==NULL) return 0;
+    
+    char magic[8];
+    int version;
+    double stored[GALAXY_PRIOR_NKEY];
+    int N = prior->ncostheta*prior->nphi;
+    
+    int check = fread(magic, sizeof(char), 8, fptr)==8 && !memcmp(magic,GALAXY_PRIOR_MAGIC,8) &&
+                fread(&version, sizeof(int), 1, fptr)==1 && version==GALAXY_PRIOR_VERSION &&
+                fread(stored, sizeof(double), GALAXY_PRIOR_NKEY, fptr)==GALAXY_PRIOR_NKEY &&
+                !memcmp(stored, key, GALAXY_PRIOR_NKEY*sizeof(double)) &&
+                fread(prior->skyhist, sizeof(double), N, fptr)==(size_t)N;
+    
+    fclose(fptr);
+    
+    if(!check) fprintf(stderr,"Warning: galaxy prior cache %s does not match galaxy model, rebuilding\n",filename);
+    
+    return check;
+}
+
+/* Monte Carlo over the galaxy model, binned into the log density of prior->skyhist */
+static void galaxy_sky_histogram(struct Prior *prior, int MCMC, unsigned int r, double uni)
+{
     double *x, *y;  // current and proposed parameters
     int D = 3;  // number of parameters
-    int Nth = 200;  // bins in cos theta
-    int Nph = 200;  // bins in phi
-    int MCMC=100000000;
+    int Nth = prior->ncostheta;
+    int Nph = prior->nphi;
     int j;
     int ith, iph, cnt;
     double H, dOmega;
@@ -52,32 +126,12 @@ void set_galaxy_prior(struct Flags *flags, struct Prior *prior)
     double *xe, *xg;
     double r_ec, theta, phi;
     int mc;
-    //  FILE *chain = NULL;
-    
-    if(flags->debug)
-    {
-        Nth /= 10;
-        Nph /= 10;
-        MCMC/=10;
-    }
-    
-    unsigned int r = 150914;
     
     x =  (double*)calloc(D,sizeof(double));
     xe = (double*)calloc(D,sizeof(double));
     xg = (double*)calloc(D,sizeof(double));
     y =  (double*)calloc(D,sizeof(double));
     
-    prior->skyhist = (double*)calloc((Nth*Nph),sizeof(double));
-    
-    prior->dcostheta = 2./(double)Nth;
-    prior->dphi      = 2.*M_PI/(double)Nph;
-    
-    prior->ncostheta = Nth;
-    prior->nphi      = Nph;
-    
-    prior->skymaxp = 0.0;
-    
     for(ith=0; ith< Nth; ith++)
     {
         for(iph=0; iph< Nph; iph++)
@@ -179,7 +233,6 @@ void set_galaxy_prior(struct Flags *flags, struct Prior *prior)
     
     dOmega = 4.0*M_PI/(double)(Nth*Nph);
     
-    double uni = 0.1;
     //fprintf(stderr,"\n   HACK:  setup_galaxy_prior() uni=%g\n",uni);
     yy = (1.0-uni)/(double)(cnt);
     zz = uni/(double)(Nth*Nph);
@@ -193,10 +246,79 @@ void set_galaxy_prior(struct Flags *flags, struct Prior *prior)
         {
             xx = yy*prior->skyhist[ith*Nph+iph];
             prior->skyhist[ith*Nph+iph] = log(xx + zz);
-            if(prior->skyhist[ith*Nph+iph]>prior->skymaxp) prior->skymaxp = prior->skyhist[ith*Nph+iph];
         }
     }
     
+    free(x);
+    free(y);
+    free(xe);
+    free(xg);
+}
+
+void set_galaxy_prior(struct Flags *flags, struct Prior *prior)
+{
+    if(!flags->quiet)
+    {
+        fprintf(stdout,"\n============ Galaxy model sky prior ============\n");
+        fprintf(stdout,"   Distance to GC = %g kpc\n",GALAXY_RGC);
+        fprintf(stdout,"   Disk Radius    = %g kpc\n",GALAXY_Rd);
+        fprintf(stdout,"   Disk Height    = %g kpc\n",GALAXY_Zd);
+        fprintf(stdout,"   Bulge Radius   = %g kpc\n",GALAXY_Rb);
+        fprintf(stdout,"   Bulge Fraction = %g\n",    GALAXY_A);
+    }
+    int Nth = 200;  // bins in cos theta
+    int Nph = 200;  // bins in phi
+    int MCMC=100000000;
+    unsigned int r = 150914;
+    double uni = 0.1; //fraction of prior that is uniform on the sky
+    int ith, iph;
+    double xx, yy;
+    
+    if(flags->debug)
+    {
+        Nth /= 10;
+        Nph /= 10;
+        MCMC/=10;
+    }
+    
+    prior->skyhist = (double*)calloc((Nth*Nph),sizeof(double));
+    
+    prior->dcostheta = 2./(double)Nth;
+    prior->dphi      = 2.*M_PI/(double)Nph;
+    
+    prior->ncostheta = Nth;
+    prior->nphi      = Nph;
+    
+    /*
+     The Monte Carlo only depends on the galaxy model and grid, so the
+     log density is cached in the working directory for later runs
+     */
+    double key[GALAXY_PRIOR_NKEY];
+    galaxy_prior_key(key, Nth, Nph, MCMC, r, uni);
+    
+    char filename[MAXSTRINGSIZE];
+    sprintf(filename,"galaxy_prior_%ix%i.bin",Nth,Nph);
+    
+    if(read_galaxy_prior(prior, key, filename))
+    {
+        if(!flags->quiet) fprintf(stdout,"Loaded from %s\n",filename);
+    }
+    else
+    {
+        if(!flags->quiet) fprintf(stdout,"Monte carlo over galaxy model\n");
+        galaxy_sky_histogram(prior, MCMC, r, uni);
+        write_galaxy_prior(prior, key, filename);
+    }
+    
+    prior->skymaxp = 0.0;
+    for(int k=0; k<Nth*Nph; k++) if(prior->skyhist[k]>prior->skymaxp) prior->skymaxp = prior->skyhist[k];
+    
+    //alias table of the (equal area) sky pixels for draw_from_galaxy_prior()
+    prior->skyprob  = (double*)malloc((Nth*Nph)*sizeof(double));
+    prior->skyalias = (int*)malloc((Nth*Nph)*sizeof(int));
+    for(int k=0; k<Nth*Nph; k++) prior->skyprob[k] = exp(prior->skyhist[k]);
+    alias_table(prior->skyprob, Nth*Nph, prior->skyprob, prior->skyalias);
+    
     if(flags->verbose)
     {
         FILE *fptr = fopen("skyprior.dat", "w");
@@ -213,10 +335,6 @@ void set_galaxy_prior(struct Flags *flags, struct Prior *prior)
         fclose(fptr);
     }
     
-    free(x);
-    free(y);
-    free(xe);
-    free(xg);
     if(!flags->quiet)fprintf(stdout,"\n================================================\n\n");
     fflush(stdout);
     
@@ -445,97 +563,31 @@ int check_range(double *params, double **uniform_prior)
 
 void set_gmm_prior(struct Flags *flags, struct Data *data, struct Prior *prior, struct Catalog *catalog)
 {
-    //get size of full catalog
-    int N = catalog->N;
-    
-    //allocate gmm to include the full catalog
-    prior->gmm = malloc(sizeof(struct GMM));
-    prior->gmm->NMODE = 0;
-    for(size_t n=0; n<N; n++) prior->gmm->NMODE += catalog->entry[n]->gmm->NMODE;
-    prior->gmm->modes = malloc(prior->gmm->NMODE*sizeof(struct MVG *));
-    
-    for(size_t n=0; n<prior->gmm->NMODE; n++)
-    {
-        prior->gmm->modes[n] = malloc(sizeof(struct MVG));
-        
-        alloc_MVG(prior->gmm->modes[n], UCB_MODEL_NP);
-    }
-
-    //combine modes into one GMM
-    size_t m=0;
-    for(size_t n=0; n<N; n++)
-    {
-        for(size_t i=0; i<catalog->entry[n]->gmm->NMODE; i++)
-        {
-            copy_MVG(catalog->entry[n]->gmm->modes[i],prior->gmm->modes[m]);
-
-            //(clumsily) renormalize modes
-            prior->gmm->modes[m]->p /= (double)N;
-            
-            m++;
-        }
-    }
-    
-    //prior->gmm = catalog->entry[0]->gmm;
+    //one gmm for the full catalog, indexed by frequency
+    prior->gmm = combine_catalog_gmm(catalog);
 }
 
 double evaluate_gmm_prior(struct Data *data, struct GMM *gmm, double *params)
 {
-    double *x = double_vector(UCB_MODEL_NP);
-    
-    /* pointers to GMM contents */
-    struct MVG **modes = gmm->modes;
-    size_t NMODES = gmm->NMODE;
-    
-
-    //pack parameters into source with correct units
-    struct Source *source = malloc(sizeof(struct Source));
-    alloc_source(source, data->N, data->Nchannel);
-    
-    map_array_to_params(source, params, data->T);
-    x[0] = source->f0;
-    x[1] = source->costheta;
-    x[2] = source->phi;
-    x[3] = log(source->amp);
-    x[4] = source->cosi;
-    x[5] = source->psi;
-    x[6] = source->phi0;
+    double x[UCB_MODEL_NP];
+    
+    //parameters with the units used by the GMM fit
+    struct Source source;
+    map_array_to_params(&source, params, data->T);
+    x[0] = source.f0;
+    x[1] = source.costheta;
+    x[2] = source.phi;
+    x[3] = log(source.amp);
+    x[4] = source.cosi;
+    x[5] = source.psi;
+    x[6] = source.phi0;
     if(UCB_MODEL_NP>7)
-        x[7] = source->dfdt;
+        x[7] = source.dfdt;
     if(UCB_MODEL_NP>8)
-        x[8] = source->d2fdt2;
+        x[8] = source.d2fdt2;
 
-    //map parameters to R
-    double xmin,xmax,xn,yn, logJ = 0;
-    for(size_t n=0; n<UCB_MODEL_NP; n++)
-    {
-        xmin = modes[0]->minmax[n][0];
-        xmax = modes[0]->minmax[n][1];
-        xn = x[n];
-        if(xn < xmin || xn >= xmax)
-        {            
-            //clean up
-            free_double_vector(x);
-            free_source(source);
-            return -INFINITY;
-        }
-        yn = logit(xn,xmin,xmax);
-        x[n] = yn;
-        
-        //Jacobian
-        //logJ -= log(dsigmoid(yn, xmin, xmax));
-    }
-    
-    //sum over modes
-    double P=0.0;
-    for(size_t k=0; k<NMODES; k++)
-        P += modes[k]->p*multivariate_gaussian(x,modes[k],UCB_MODEL_NP);
-    
-    //clean up
-    free_double_vector(x);
-    free_source(source);
-    
-    return log(P) + logJ;
+    //support and logit mapping are per mode, Jacobian is not included (see dsigmoid())
+    return gmm_log_density(gmm->table, x);
 }
 
 double evaluate_prior(struct Flags *flags, struct Data *data, struct Model *model, struct Prior *prior, double *params)
@@ -48,14 +48,16 @@ struct Prior
     double logPriorVolume; //!<prior volume \f$ -\sum \log(\theta_{\rm max}-\theta_{\rm min})\f$
     ///@}
 
-    ///@name Uniform prior
+    ///@name Galaxy sky prior
     ///@{
-    double *skyhist; //!<2D histogram of prior density on sky
+    double *skyhist; //!<2D histogram of log prior density on sky
     double dcostheta; //!<size of `skyhist` bins in \f$\cos\theta\f$ direction
     double dphi; //!<size of `skyhist` bins in \f$\phi\f$ direction
     double skymaxp; //!<max prior density of `skyhist`
     int ncostheta; //!<number of `skyhist` bins in \f$\cos\theta\f$ direction
     int nphi; //!<number of `skyhist` bins in \f$\phi\f$ direction
+    double *skyprob; //!<alias table probability of keeping each `skyhist` bin
+    int *skyalias; //!<alias table alternative for each `skyhist` bin
     ///@}
     
     ///@name workspace
@@ -83,6 +85,10 @@ int check_range(double *params, double **uniform_prior);
  randomly distributes points within the assumed distribution,
  and bins the points based on their sky location from Earth
  to use as a prior.
+
+ The log density is cached in `galaxy_prior_<Nth>x<Nph>.bin` in the working
+ directory, keyed by the galaxy model constants and grid, and reused by
+ later runs. An alias table of the bins is built for draw_from_galaxy_prior().
  */
 void set_galaxy_prior(struct Flags *flags, struct Prior *prior);
 
@@ -165,18 +165,55 @@ void setup_frequency_proposal(struct Data *data, struct Flags *flags)
 void print_acceptance_rates(struct Proposal **proposal, int NProp, int ic, FILE *fptr)
 {
     fprintf(fptr,"Acceptance rates for chain %i:\n", ic);
-    fprintf(fptr," MCMC\n");
+    fprintf(fptr," MCMC       [ms/trial] [accept/s] weight\n");
     for(int n=0; n<NProp; n++)
     {
-        if(proposal[n]->weight > 0) fprintf(fptr,"   %.1e  [%s]\n", (double)proposal[n]->accept[ic]/(double)proposal[n]->trial[ic],proposal[n]->name);
+        struct Proposal *p = proposal[n];
+        if(p->weight > 0) fprintf(fptr,"   %.1e  %.1e    %.1e    %.3f  [%s]\n", (double)p->accept[ic]/(double)p->trial[ic], 1e3*p->time[ic]/(double)p->trial[ic], (p->time[ic]>0) ? (double)p->accept[ic]/p->time[ic] : 0.0, p->weight, p->name);
     }
     fprintf(fptr," RJMCMC\n");
     for(int n=0; n<NProp; n++)
     {
-        if(proposal[n]->rjweight > 0) fprintf(fptr,"   %.1e  [%s]\n", (double)proposal[n]->accept[ic]/(double)proposal[n]->trial[ic],proposal[n]->name);
+        struct Proposal *p = proposal[n];
+        if(p->rjweight > 0) fprintf(fptr,"   %.1e  %.1e    %.1e    %.3f  [%s]\n", (double)p->accept[ic]/(double)p->trial[ic], 1e3*p->time[ic]/(double)p->trial[ic], (p->time[ic]>0) ? (double)p->accept[ic]/p->time[ic] : 0.0, p->rjweight, p->name);
     }
 }
 
+void adapt_proposal_weights(struct Proposal **proposal, int NProp, int ic)
+{
+    double rate[NProp];
+    double total = 0.0;
+    
+    //accepted trials per second of each proposal in use
+    for(int n=0; n<NProp; n++)
+    {
+        rate[n] = 0.0;
+        if(proposal[n]->weight0 > 0.0 && proposal[n]->time[ic] > 0.0)
+            rate[n] = (double)proposal[n]->accept[ic]/proposal[n]->time[ic];
+        total += rate[n];
+    }
+    
+    //nothing accepted yet
+    if(!(total > 0.0)) return;
+    
+    //weight by throughput, keeping a floor under each of the initial proposals
+    double norm = 0.0;
+    for(int n=0; n<NProp; n++)
+    {
+        double weight = rate[n]/total;
+        double wmin   = UCB_PROPOSAL_WEIGHT_FLOOR*proposal[n]->weight0;
+        proposal[n]->weight = (weight > wmin) ? weight : wmin;
+        norm += proposal[n]->weight;
+    }
+    for(int n=0; n<NProp; n++) proposal[n]->weight /= norm;
+}
+
+void adapt_proposal_screening(struct Proposal **proposal, int NProp, int ic)
+{
+    for(int n=0; n<NProp; n++)
+        proposal[n]->screen = ((double)proposal[n]->accept[ic]/(double)proposal[n]->trial[ic] < UCB_PROPOSAL_SCREEN_ACCEPT);
+}
+
 double draw_from_spectrum(struct Data *data, struct Model *model, struct Source *source, UNUSED struct Proposal *proposal, double *params, unsigned int *seed)
 {
     //TODO: Work in amplitude
@@ -208,19 +245,10 @@ double draw_from_gmm_prior(struct Data *data, struct Model *model, struct Source
     
     //choose which entry
     int ngmm = (int)floor(rand_r_U_0_1(seed)*proposal->Ngmm);
-    int NMODES = (int)proposal->gmm[ngmm]->NMODE;
-    
-    struct MVG **modes = proposal->gmm[ngmm]->modes;
-    struct MVG *mode = NULL;
+    struct GMM *gmm = proposal->gmm[ngmm];
     
     //pick which mode
-    int k;
-    double p = 1.;
-    do {
-        k = (int)floor(rand_r_U_0_1(seed)*NMODES);
-        mode = modes[k];
-        p = rand_r_U_0_1(seed);
-    } while (p>mode->p);
+    struct MVG *mode = gmm->modes[gmm_draw_mode(gmm->table, rand_r_U_0_1(seed))];
     
 
     //get vector of gaussian draws n;  y_i = x_mean_i + sum_j Lij^-1 * n_j
@@ -263,15 +291,21 @@ double draw_from_gmm_prior(struct Data *data, struct Model *model, struct Source
 
 double gmm_prior_density(struct Data *data, struct Model *model, struct Source *source, struct Proposal *proposal, double *params)
 {
-    double p = 0;
+    double logP[proposal->Ngmm];
+    double logPmax = -INFINITY;
     
-    /* sum over modes */
+    /* log-sum-exp over mixture models */
     for(int n=0; n<proposal->Ngmm; n++)
     {
-        p += exp(evaluate_gmm_prior(data, proposal->gmm[n], params));
+        logP[n] = evaluate_gmm_prior(data, proposal->gmm[n], params);
+        if(logP[n] > logPmax) logPmax = logP[n];
     }
+    if(logPmax == -INFINITY) return -INFINITY;
+    
+    double p = 0;
+    for(int n=0; n<proposal->Ngmm; n++) p += exp(logP[n] - logPmax);
         
-    return log(p/(double)proposal->Ngmm);
+    return logPmax + log(p/(double)proposal->Ngmm);
 }
 
 double draw_from_uniform_prior(UNUSED struct Data *data, struct Model *model, UNUSED struct Source *source, UNUSED struct Proposal *proposal, double *params, unsigned int *seed)
@@ -407,25 +441,22 @@ double draw_from_extrinsic_prior(UNUSED struct Data *data, struct Model *model,
 double draw_from_galaxy_prior(struct Model *model, struct Prior *prior, double *params, unsigned int *seed)
 {
     double **uniform_prior = model->prior;
-    double logP=-INFINITY;
-    double alpha=prior->skymaxp;
+    int k;
     
     do
     {
-        //sky location
-        params[1] = model->prior[1][0] + rand_r_U_0_1(seed)*(model->prior[1][1]-model->prior[1][0]);
-        params[2] = model->prior[2][0] + rand_r_U_0_1(seed)*(model->prior[2][1]-model->prior[2][0]);
+        //skyhist bin from the alias table, then uniform within the bin
+        k = alias_table_draw(prior->skyprob, prior->skyalias, prior->ncostheta*prior->nphi, seed);
         
-        //map costheta and phi to index of skyhist array
-        int i = (int)floor((params[1]-uniform_prior[1][0])/prior->dcostheta);
-        int j = (int)floor((params[2]-uniform_prior[2][0])/prior->dphi);
+        int i = k/prior->nphi;
+        int j = k - i*prior->nphi;
         
-        int k = i*prior->nphi + j;
+        params[1] = uniform_prior[1][0] + ((double)i + rand_r_U_0_1(seed))*prior->dcostheta;
+        params[2] = uniform_prior[2][0] + ((double)j + rand_r_U_0_1(seed))*prior->dphi;
         
-        logP = prior->skyhist[k];
-        alpha = log(rand_r_U_0_1(seed)*exp(prior->skymaxp));
-    }while(alpha>logP);
-    return logP;
+    }while(params[1]>uniform_prior[1][1] || params[2]>uniform_prior[2][1]);
+    
+    return prior->skyhist[k];
 }
 
 double draw_calibration_parameters(struct Data *data, struct Model *model, unsigned int *seed)
@@ -526,27 +557,11 @@ double draw_from_fisher(UNUSED struct Data *data, struct Model *model, struct So
 
 double draw_from_cdf(UNUSED struct Data *data, struct Model *model, struct Source *source, struct Proposal *proposal, double *params, unsigned int *seed)
 {
-    int N = proposal->size;
-    double **cdf = proposal->matrix;
-    
     for(int n=0; n<UCB_MODEL_NP; n++)
     {
-        
-        //draw n from U[0,N]
-        double c_prime = rand_r_U_0_1(seed)*(double)(N-1);
-        
-        //map to nearest sample
-        int c_minus = (int)floor(c_prime);
-        int c_plus  = c_minus+1;
-        
-        //get value of pdf at cprime
-        double p = 1./(cdf[n][c_plus] - cdf[n][c_minus]);
-        
-        //interpolate to get new parameter
-        params[n] = (c_prime - c_minus)*(1./p) + cdf[n][c_minus];
+        params[n] = quantile_table_draw(proposal->cdf[n], seed);
         
         if(params[n]<model->prior[n][0] || params[n]>=model->prior[n][1]) return -INFINITY;
-        
     }
     
     return cdf_density(data, model, source, proposal, params);
@@ -554,23 +569,13 @@ double draw_from_cdf(UNUSED struct Data *data, struct Model *model, struct Sourc
 
 double cdf_density(UNUSED struct Data *data, struct Model *model, struct Source * source, struct Proposal *proposal, double *params)
 {
-    int N = proposal->size;
-    double **cdf = proposal->matrix;
     double logP=0.0;
     
-    int i,j;
-    
     for(int n=0; n<UCB_MODEL_NP; n++)
     {
         if(params[n]<model->prior[n][0] || params[n]>=model->prior[n][1]) return -INFINITY;
         
-        //find samples either end of p-value
-        if(params[n]<cdf[n][0] || params[n]>= cdf[n][N-1]) return -INFINITY;
-        
-        i=binary_search(cdf[n],0,N,params[n]);
-        j=i+1;
-        while(cdf[n][j]==cdf[n][i]) j++;
-        logP += log(  ((double)(j-i)/N) /  (cdf[n][j]-cdf[n][i])  );
+        logP += quantile_table_log_density(proposal->cdf[n], params[n]);
     }
     return logP;
 }
@@ -758,16 +763,19 @@ void initialize_proposal(struct Orbit *orbit, struct Data *data, struct Prior *p
     
     for(int i=0; i<UCB_PROPOSAL_NPROP; i++)
     {
-        proposal[i] = malloc(sizeof(struct Proposal));
+        proposal[i] = calloc(1,sizeof(struct Proposal));
 
         proposal[i]->trial  = malloc(NC*sizeof(int));
         proposal[i]->accept = malloc(NC*sizeof(int));
+        proposal[i]->time   = malloc(NC*sizeof(double));
         
         for(int ic=0; ic<NC; ic++)
         {
             proposal[i]->trial[ic]  = 1;
             proposal[i]->accept[ic] = 0;
+            proposal[i]->time[ic]   = 0.0;
         }
+        proposal[i]->screen = 1;
         
         switch(i)
         {
@@ -800,6 +808,8 @@ void initialize_proposal(struct Orbit *orbit, struct Data *data, struct Prior *p
                 proposal[i]->vector = proposal[1]->vector;
                 proposal[i]->matrix = proposal[1]->matrix;
                 proposal[i]->tensor = proposal[1]->tensor;
+                proposal[i]->fstat  = proposal[1]->fstat;
+                proposal[i]->fstatKey = proposal[1]->fstatKey;
                 
                 proposal[i]->function = &jump_from_fstatistic;
                 proposal[i]->density  = &evaluate_fstatistic_proposal;
@@ -893,6 +903,8 @@ void initialize_proposal(struct Orbit *orbit, struct Data *data, struct Prior *p
         exit(1);
     }
     
+    for(int i=0; i<UCB_PROPOSAL_NPROP; i++) proposal[i]->weight0 = proposal[i]->weight;
+    
     if(!flags->quiet)
     {
         fprintf(stdout,"\n============ UCB Proposal Cocktail ============\n");
@@ -918,16 +930,19 @@ void initialize_vb_proposal(struct Orbit *orbit, struct Data *data, struct Prior
     
     for(int i=0; i<UCB_PROPOSAL_NPROP; i++)
     {
-        proposal[i] = malloc(sizeof(struct Proposal));
+        proposal[i] = calloc(1,sizeof(struct Proposal));
 
         proposal[i]->trial  = malloc(NC*sizeof(int));
         proposal[i]->accept = malloc(NC*sizeof(int));
+        proposal[i]->time   = malloc(NC*sizeof(double));
         
         for(int ic=0; ic<NC; ic++)
         {
             proposal[i]->trial[ic]  = 1;
             proposal[i]->accept[ic] = 0;
+            proposal[i]->time[ic]   = 0.0;
         }
+        proposal[i]->screen = 1;
         
         switch(i)
         {
@@ -1034,6 +1049,8 @@ void initialize_vb_proposal(struct Orbit *orbit, struct Data *data, struct Prior
         exit(1);
     }
     
+    for(int i=0; i<UCB_PROPOSAL_NPROP; i++) proposal[i]->weight0 = proposal[i]->weight;
+    
     if(!flags->quiet)
     {
         fprintf(stdout,"\n============ VGB Proposal Cocktail ============\n");
@@ -1051,6 +1068,374 @@ void initialize_vb_proposal(struct Orbit *orbit, struct Data *data, struct Prior
     }
 }
 
+/* F-statistic of one grid cell, maximized over a scan of chirp masses when there is evidence for a signal */
+static double fstatistic_cell(struct Orbit *orbit, struct Data *data, double f, double costheta, double phi, struct FstatWorkspace *fws)
+{
+    int n_fdot  = 10;
+    double d_fdot = (1.1 - 0.1)/n_fdot; //scan over chirp mass range [0.1:1.1] Msolar
+    
+    double logL_AE = get_Fstat_logL_sky(orbit, data, f, 0, costheta, phi, fws);
+    double logLmax = logL_AE;
+    
+    if(logL_AE>1)
+    {
+        for(int n=0; n<n_fdot; n++)
+        {
+            double fdot = ucb_fdot(0.1+n*d_fdot, f); //get fdot by scanning over chirpmass
+            
+            logL_AE = get_Fstat_logL_sky(orbit, data, f, fdot, costheta, phi, fws);
+            
+            if(logL_AE>logLmax) logLmax = logL_AE;
+            
+            if(logL_AE<1) break;
+        }
+    }
+    
+    return logLmax;
+}
+
+/* number of dense cells in coarse cell I along an axis of n dense cells */
+static int fstatistic_tree_span(int I, int r, int n)
+{
+    return (n - I*r < r) ? n - I*r : r;
+}
+
+/* proposal density in dense cell (i,j,k) from Proposal::tensor or Proposal::fstat */
+static double fstatistic_density(struct Proposal *proposal, int i, int j, int k)
+{
+    struct FstatTree *tree = proposal->fstat;
+    
+    if(!tree) return proposal->tensor[i][j][k];
+    
+    int *r = tree->r;
+    int c = ((i/r[0])*tree->n[1] + j/r[1])*tree->n[2] + k/r[2];
+    
+    if(tree->child[c]<0) return tree->coarse[c];
+    
+    return tree->fine[((tree->child[c]*r[0] + i%r[0])*r[1] + j%r[1])*r[2] + k%r[2]];
+}
+
+/* cumulative probability of the leaves of the normalized tree */
+static void setup_fstatistic_tree_leaves(struct Proposal *proposal)
+{
+    struct FstatTree *tree = proposal->fstat;
+    int *n = tree->n;
+    int *r = tree->r;
+    int Ncoarse = n[0]*n[1]*n[2];
+    int Nblock  = r[0]*r[1]*r[2];
+    int n_dense[3];
+    for(int m=0; m<3; m++) n_dense[m] = (int)proposal->matrix[m][0];
+    
+    free(tree->leaf);
+    free(tree->cdf);
+    
+    tree->Nleaf = Ncoarse - tree->Nrefined + tree->Nrefined*Nblock;
+    tree->leaf  = malloc(tree->Nleaf*sizeof(int));
+    tree->cdf   = malloc(tree->Nleaf*sizeof(double));
+    
+    double sum = 0.0;
+    int l = 0;
+    for(int c=0; c<Ncoarse; c++)
+    {
+        int I = c/(n[1]*n[2]);
+        int J = (c/n[2])%n[1];
+        int K = c%n[2];
+        
+        if(tree->child[c]<0)
+        {
+            double volume = fstatistic_tree_span(I,r[0],n_dense[0])*fstatistic_tree_span(J,r[1],n_dense[1])*fstatistic_tree_span(K,r[2],n_dense[2]);
+            sum += tree->coarse[c]*volume;
+            tree->leaf[l] = c;
+            tree->cdf[l++] = sum;
+        }
+        else
+        {
+            //dense cells clipped by the edges of the grid have zero density
+            for(int m=0; m<Nblock; m++)
+            {
+                int index = tree->child[c]*Nblock + m;
+                sum += tree->fine[index];
+                tree->leaf[l] = Ncoarse + index;
+                tree->cdf[l++] = sum;
+            }
+        }
+    }
+    for(l=0; l<tree->Nleaf; l++) tree->cdf[l] /= sum;
+    tree->cdf[tree->Nleaf-1] = 1.0;
+}
+
+/* draw dense grid coordinates {i,j,k} of a cell weighted by the leaves of Proposal::fstat */
+static void draw_fstatistic_tree(struct Proposal *proposal, double *x, unsigned int *seed)
+{
+    struct FstatTree *tree = proposal->fstat;
+    int *n = tree->n;
+    int *r = tree->r;
+    int Ncoarse = n[0]*n[1]*n[2];
+    int Nblock  = r[0]*r[1]*r[2];
+    
+    //first leaf with cdf > u
+    double u = rand_r_U_0_1(seed);
+    int lo = 0;
+    int hi = tree->Nleaf-1;
+    while(lo<hi)
+    {
+        int mid = (lo+hi)/2;
+        if(tree->cdf[mid] > u) hi = mid;
+        else lo = mid+1;
+    }
+    int leaf = tree->leaf[lo];
+    
+    if(leaf<Ncoarse)
+    {
+        int I = leaf/(n[1]*n[2]);
+        int J = (leaf/n[2])%n[1];
+        int K = leaf%n[2];
+        int ijk[3] = {I,J,K};
+        
+        //uniform over the (clipped) coarse cell
+        for(int m=0; m<3; m++)
+            x[m] = ijk[m]*r[m] + rand_r_U_0_1(seed)*fstatistic_tree_span(ijk[m],r[m],(int)proposal->matrix[m][0]);
+    }
+    else
+    {
+        int index = leaf - Ncoarse;
+        int c = tree->parent[index/Nblock];
+        int m = index%Nblock;
+        
+        x[0] = (c/(n[1]*n[2]))*r[0] + m/(r[1]*r[2])   + rand_r_U_0_1(seed);
+        x[1] = ((c/n[2])%n[1])*r[1] + (m/r[2])%r[1]   + rand_r_U_0_1(seed);
+        x[2] = (c%n[2])*r[2]        + m%r[2]          + rand_r_U_0_1(seed);
+    }
+}
+
+static void write_fstatistic_tree(struct Proposal *proposal, FILE *fptr)
+{
+    struct FstatTree *tree = proposal->fstat;
+    int Ncoarse = tree->n[0]*tree->n[1]*tree->n[2];
+    int Nblock  = tree->r[0]*tree->r[1]*tree->r[2];
+    
+    fwrite(tree->r, sizeof(int), 3, fptr);
+    fwrite(&tree->Nrefined, sizeof(int), 1, fptr);
+    fwrite(tree->coarse, sizeof(double), Ncoarse, fptr);
+    fwrite(tree->child, sizeof(int), Ncoarse, fptr);
+    fwrite(tree->fine, sizeof(double), tree->Nrefined*Nblock, fptr);
+}
+
+static int read_fstatistic_tree(struct Proposal *proposal, FILE *fptr)
+{
+    struct FstatTree *tree = proposal->fstat;
+    int r[3];
+    
+    if(fread(r, sizeof(int), 3, fptr)!=3) return 0;
+    for(int m=0; m<3; m++) if(r[m]!=tree->r[m]) return 0;
+    
+    int Ncoarse = tree->n[0]*tree->n[1]*tree->n[2];
+    int Nblock  = r[0]*r[1]*r[2];
+    
+    if(fread(&tree->Nrefined, sizeof(int), 1, fptr)!=1 || tree->Nrefined<0 || tree->Nrefined>Ncoarse) return 0;
+    tree->coarse = malloc(Ncoarse*sizeof(double));
+    tree->child  = malloc(Ncoarse*sizeof(int));
+    tree->parent = malloc((tree->Nrefined+1)*sizeof(int));
+    tree->fine   = malloc((tree->Nrefined*Nblock+1)*sizeof(double));
+    if(fread(tree->coarse, sizeof(double), Ncoarse, fptr)!=(size_t)Ncoarse) return 0;
+    if(fread(tree->child, sizeof(int), Ncoarse, fptr)!=(size_t)Ncoarse) return 0;
+    if(fread(tree->fine, sizeof(double), tree->Nrefined*Nblock, fptr)!=(size_t)(tree->Nrefined*Nblock)) return 0;
+    for(int c=0; c<Ncoarse; c++) if(tree->child[c]>=0) tree->parent[tree->child[c]] = c;
+    
+    setup_fstatistic_tree_leaves(proposal);
+    
+    return 1;
+}
+
+/* FNV-1a hash of the data and noise the F-statistic is computed from */
+static unsigned long long fstatistic_hash(struct Data *data)
+{
+    const double *array[3] = {data->dft->A, data->dft->E, data->noise->C[0][0]};
+    size_t size[3] = {2*data->NFFT*sizeof(double), 2*data->NFFT*sizeof(double), data->NFFT*sizeof(double)};
+    
+    unsigned long long hash = 14695981039346656037ULL;
+    for(int m=0; m<3; m++)
+    {
+        const unsigned char *byte = (const unsigned char *)array[m];
+        for(size_t n=0; n<size[m]; n++)
+        {
+            hash ^= byte[n];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+/* store data the F-statistic proposal was computed from in Proposal::fstatKey */
+static void set_fstatistic_key(struct Data *data, struct Proposal *proposal)
+{
+    struct FstatKey *key = proposal->fstatKey;
+    
+    memcpy(key->A, data->dft->A, 2*data->NFFT*sizeof(double));
+    memcpy(key->E, data->dft->E, 2*data->NFFT*sizeof(double));
+    memcpy(key->Sn, data->noise->C[0][0], data->NFFT*sizeof(double));
+    key->hash = fstatistic_hash(data);
+}
+
+/* flag frequency cells whose filter band saw a significant change of the whitened data since set_fstatistic_key() */
+static int fstatistic_changed_cells(struct Orbit *orbit, struct Data *data, struct Proposal *proposal, int *update)
+{
+    struct FstatKey *key = proposal->fstatKey;
+    
+    int n_f    = (int)proposal->matrix[0][0];
+    double d_f = proposal->matrix[0][1];
+    
+    double *A  = data->dft->A;
+    double *E  = data->dft->E;
+    double *Sn = data->noise->C[0][0];
+    
+    //cumulative (delta d|delta d) of whitened data
+    double *sum = malloc((data->NFFT+1)*sizeof(double));
+    sum[0] = 0.0;
+    for(int k=0; k<data->NFFT; k++)
+    {
+        double w  = 1./sqrt(Sn[k]);
+        double w0 = 1./sqrt(key->Sn[k]);
+        double dd = 0.0;
+        for(int m=2*k; m<2*k+2; m++)
+        {
+            double dA = A[m]*w - key->A[m]*w0;
+            double dE = E[m]*w - key->E[m]*w0;
+            dd += dA*dA + dE*dE;
+        }
+        sum[k+1] = sum[k] + 4.0*dd;
+    }
+    
+    int Nupdate = 0;
+    for(int i=0; i<n_f; i++)
+    {
+        //widest filter band of the cell's fdot scan in fstatistic_cell()
+        double f = data->fmin + i*d_f + d_f/2;
+        int BW = ucb_bandwidth(orbit->L, orbit->fstar, f, ucb_fdot(1.1,f), 0.0, 1.e-22, data->T, data->NFFT);
+        
+        long q = (long)(f*data->T) - (int)(data->fmin*data->T);
+        long kmin = q - BW/2;
+        long kmax = kmin + BW;
+        if(kmin<0) kmin = 0;
+        if(kmax>data->NFFT) kmax = data->NFFT;
+        
+        update[i] = (kmax>kmin && sum[kmax]-sum[kmin] > UCB_PROPOSAL_FSTAT_REBUILD_SNR2);
+        Nupdate += update[i];
+    }
+    
+    free(sum);
+    return Nupdate;
+}
+
+static void fstatistic_proposal_filename(struct Flags *flags, struct Proposal *proposal, char *filename)
+{
+    if(proposal->fstat) sprintf(filename,"%s/checkpoint/fstat_tree.bin",flags->runDir);
+    else                sprintf(filename,"%s/checkpoint/fstat_prop.bin",flags->runDir);
+}
+
+/* binary F-statistic proposal checkpoint, see write_fstatistic_proposal() */
+#define FSTAT_PROPOSAL_MAGIC "GLASSFST"
+#define FSTAT_PROPOSAL_VERSION 1
+
+/* store proposal and its FstatKey, writing to a temporary file so a crash never leaves a partial proposal */
+static void write_fstatistic_proposal(struct Flags *flags, struct Proposal *proposal)
+{
+    struct FstatKey *key = proposal->fstatKey;
+    
+    char filename[MAXSTRINGSIZE];
+    char tempname[MAXSTRINGSIZE+4];
+    fstatistic_proposal_filename(flags, proposal, filename);
+    sprintf(tempname,"%s.tmp",filename);
+    
+    FILE *fptr = fopen(tempname,"wb");
+    if(fptr==NULL)
+    {
+        fprintf(stderr,"Error opening F-statistic proposal file %s\n",tempname);
+        exit(1);
+    }
+    
+    int header[8] = {FSTAT_PROPOSAL_VERSION, key->qmin, key->NFFT, key->n[0], key->n[1], key->n[2], key->adaptive, key->version};
+    fwrite(FSTAT_PROPOSAL_MAGIC, sizeof(char), 8, fptr);
+    fwrite(header, sizeof(int), 8, fptr);
+    fwrite(&key->hash, sizeof key->hash, 1, fptr);
+    fwrite(key->A, sizeof(double), 2*key->NFFT, fptr);
+    fwrite(key->E, sizeof(double), 2*key->NFFT, fptr);
+    fwrite(key->Sn, sizeof(double), key->NFFT, fptr);
+    
+    fwrite(&proposal->norm, sizeof proposal->norm, 1, fptr);
+    fwrite(&proposal->maxp, sizeof proposal->maxp, 1, fptr);
+    if(proposal->fstat) write_fstatistic_tree(proposal, fptr);
+    else
+    {
+        for(int i=0; i<key->n[0]; i++)
+            for(int j=0; j<key->n[1]; j++)
+                fwrite(proposal->tensor[i][j], sizeof(double), key->n[2], fptr);
+    }
+    
+    if(ferror(fptr))
+    {
+        fprintf(stderr,"Error writing F-statistic proposal file %s\n",tempname);
+        exit(1);
+    }
+    fclose(fptr);
+    
+    if(rename(tempname,filename))
+    {
+        fprintf(stderr,"Error moving F-statistic proposal file %s to %s\n",tempname,filename);
+        exit(1);
+    }
+}
+
+/* restore proposal stored by write_fstatistic_proposal(), returns 0 if there is none for this segment and grid */
+static int read_fstatistic_proposal(struct Flags *flags, struct Proposal *proposal)
+{
+    struct FstatKey *key = proposal->fstatKey;
+    
+    char filename[MAXSTRINGSIZE];
+    fstatistic_proposal_filename(flags, proposal, filename);
+    
+    FILE *fptr = fopen(filename,"rb");
+    if(fptr==NULL) return 0;
+    
+    char magic[8];
+    int header[8];
+    int check = fread(magic, sizeof(char), 8, fptr)==8 && !memcmp(magic,FSTAT_PROPOSAL_MAGIC,8) &&
+                fread(header, sizeof(int), 8, fptr)==8 && header[0]==FSTAT_PROPOSAL_VERSION &&
+                header[1]==key->qmin && header[2]==key->NFFT &&
+                header[3]==key->n[0] && header[4]==key->n[1] && header[5]==key->n[2] &&
+                header[6]==key->adaptive;
+    
+    if(check)
+    {
+        key->version = header[7];
+        check = fread(&key->hash, sizeof key->hash, 1, fptr)==1 &&
+                fread(key->A, sizeof(double), 2*key->NFFT, fptr)==(size_t)(2*key->NFFT) &&
+                fread(key->E, sizeof(double), 2*key->NFFT, fptr)==(size_t)(2*key->NFFT) &&
+                fread(key->Sn, sizeof(double), key->NFFT, fptr)==(size_t)key->NFFT &&
+                fread(&proposal->norm, sizeof proposal->norm, 1, fptr)==1 &&
+                fread(&proposal->maxp, sizeof proposal->maxp, 1, fptr)==1;
+    }
+    
+    if(check)
+    {
+        if(proposal->fstat) check = read_fstatistic_tree(proposal, fptr);
+        else
+        {
+            for(int i=0; i<key->n[0]; i++)
+                for(int j=0; j<key->n[1]; j++)
+                    if(fread(proposal->tensor[i][j], sizeof(double), key->n[2], fptr)!=(size_t)key->n[2]) check = 0;
+        }
+    }
+    
+    fclose(fptr);
+    
+    if(!check) fprintf(stderr,"Warning: F-statistic proposal file %s does not match segment, rebuilding\n",filename);
+    
+    return check;
+}
+
+static void update_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Flags *flags, struct Proposal *proposal, const int *update);
+
 void setup_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Flags *flags, struct Proposal *proposal)
 {
     /*
@@ -1087,6 +1472,7 @@ void setup_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Fl
         fprintf(stdout,"   n_theta = %i\n",n_theta);
         fprintf(stdout,"   n_phi   = %i\n",n_phi);
         fprintf(stdout,"   cap     = %g\n",SNRCAP);
+        if(flags->fstatAdaptive) fprintf(stdout,"   refine  = %i x %i x %i\n",UCB_PROPOSAL_FSTAT_REFINE_F,UCB_PROPOSAL_FSTAT_REFINE_SKY,UCB_PROPOSAL_FSTAT_REFINE_SKY);
     }
             
     //allocate memory in proposal structure and pack up metadata
@@ -1108,20 +1494,37 @@ void setup_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Fl
     proposal->matrix[2][0] = (double)n_phi;
     proposal->matrix[2][1] = d_phi;
     
+    /*
+     proposal->fstat holds the sparse proposal density with --fstat-adaptive
+     - coarse cells of UCB_PROPOSAL_FSTAT_REFINE_F x UCB_PROPOSAL_FSTAT_REFINE_SKY^2 dense cells
+     */
+    if(flags->fstatAdaptive)
+    {
+        proposal->fstat = calloc(1,sizeof(struct FstatTree));
+        proposal->fstat->r[0] = UCB_PROPOSAL_FSTAT_REFINE_F;
+        proposal->fstat->r[1] = UCB_PROPOSAL_FSTAT_REFINE_SKY;
+        proposal->fstat->r[2] = UCB_PROPOSAL_FSTAT_REFINE_SKY;
+        for(int m=0; m<3; m++)
+            proposal->fstat->n[m] = ((int)proposal->matrix[m][0] + proposal->fstat->r[m] - 1)/proposal->fstat->r[m];
+    }
+    
     /*
      proposal->tensor holds the proposal density
      - n_f x n_theta x n_phi "tensor"
      */
-    proposal->tensor = malloc(n_f*sizeof(double **));
-    for(int i=0; i<n_f; i++)
+    else
     {
-        proposal->tensor[i] = malloc(n_theta*sizeof(double *));
-        for(int j=0; j<n_theta; j++)
+        proposal->tensor = malloc(n_f*sizeof(double **));
+        for(int i=0; i<n_f; i++)
         {
-            proposal->tensor[i][j] = malloc(n_phi*sizeof(double));
-            for(int k=0; k<n_phi; k++)
+            proposal->tensor[i] = malloc(n_theta*sizeof(double *));
+            for(int j=0; j<n_theta; j++)
             {
-                proposal->tensor[i][j][k] = 1.0;
+                proposal->tensor[i][j] = malloc(n_phi*sizeof(double));
+                for(int k=0; k<n_phi; k++)
+                {
+                    proposal->tensor[i][j][k] = 1.0;
+                }
             }
         }
     }
@@ -1129,57 +1532,48 @@ void setup_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Fl
     double minp = +1e60;
     proposal->maxp = -1e60;
     
-    /* compute or restore fisher-based proposal */
-    char filename[MAXSTRINGSIZE];
-    sprintf(filename,"%s/checkpoint/fstat_prop.bin",flags->runDir);
-    FILE *propFile=NULL;
-    int check=0;
-    
-    //first check if file exists
-    if( (propFile=fopen(filename,"r")) )
-    {
-        fclose(propFile);
-        check=1;
-    }
-    
-    //if we are checkpointing and the files exist, use them
-    if(flags->resume && check)
+    /*
+     proposal->fstatKey identifies the data the proposal is computed from
+     - a proposal stored for this segment and grid is reused
+     - only the frequency cells affected by changes to the data are recomputed
+     */
+    struct FstatKey *key = calloc(1,sizeof(struct FstatKey));
+    key->qmin = data->qmin;
+    key->NFFT = data->NFFT;
+    key->n[0] = n_f;
+    key->n[1] = n_theta;
+    key->n[2] = n_phi;
+    key->adaptive = flags->fstatAdaptive;
+    key->A  = malloc(2*data->NFFT*sizeof(double));
+    key->E  = malloc(2*data->NFFT*sizeof(double));
+    key->Sn = malloc(data->NFFT*sizeof(double));
+    proposal->fstatKey = key;
+    
+    if(read_fstatistic_proposal(flags, proposal))
     {
-        propFile=fopen(filename,"rb");
+        int *update = calloc(n_f,sizeof(int));
+        int Nupdate = (key->hash != fstatistic_hash(data)) ? fstatistic_changed_cells(orbit, data, proposal, update) : 0;
         
-        fread(&proposal->norm, sizeof proposal->norm, 1, propFile);
-        fread(&proposal->maxp, sizeof proposal->norm, 1, propFile);
-        for(int i=0; i<n_f; i++)
+        if(!flags->quiet) fprintf(stdout,"   restored version %i, recomputing %i/%i frequency cells\n",key->version,Nupdate,n_f);
+        
+        if(Nupdate)
         {
-            for(int j=0; j<n_theta; j++)
-            {
-                for(int k=0; k<n_phi; k++)
-                {
-                    fread(&proposal->tensor[i][j][k],sizeof proposal->tensor[i][j][k], 1, propFile);
-                }
-            }
+            update_fstatistic_proposal(orbit, data, flags, proposal, update);
+            key->version++;
+            set_fstatistic_key(data, proposal);
+            write_fstatistic_proposal(flags, proposal);
         }
-
-        fclose(propFile);
+        free(update);
     }
     
-    //if no resume flag or no checkpoint file build the proposal
+    //no stored proposal for this segment, build and store it
     else
     {
-        build_fstatistic_proposal(orbit, data, flags, proposal);
-        
-        //store checkpointing files so we can skip this expensive step on resume
-        propFile=fopen(filename,"wb");
-        fwrite(&proposal->norm, sizeof proposal->norm, 1, propFile);
-        fwrite(&proposal->maxp, sizeof proposal->norm, 1, propFile);
-        for(int i=0; i<n_f; i++)
-            for(int j=0; j<n_theta; j++)
-                for(int k=0; k<n_phi; k++)
-                    fwrite(&proposal->tensor[i][j][k],sizeof proposal->tensor[i][j][k], 1, propFile);
-        fclose(propFile);
-
-
-    }//end resume if/else
+        update_fstatistic_proposal(orbit, data, flags, proposal, NULL);
+        key->version = 0;
+        set_fstatistic_key(data, proposal);
+        write_fstatistic_proposal(flags, proposal);
+    }
 
     //print diagnostics
     if(flags->verbose)
@@ -1188,7 +1582,7 @@ void setup_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Fl
         for(int i=0; i<n_f; i++)
             for(int j=0; j<n_theta; j++)
                 for(int k=0; k<n_phi; k++)
-                    if(proposal->tensor[i][j][k]<minp) minp = proposal->tensor[i][j][k];
+                    if(fstatistic_density(proposal,i,j,k)<minp) minp = fstatistic_density(proposal,i,j,k);
 
         char dirname[MAXSTRINGSIZE];
         sprintf(dirname,"%s/fstat",flags->runDir);
@@ -1207,7 +1601,7 @@ void setup_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Fl
                 {
                     double phi = (double)k*d_phi;
                     
-                    fprintf(fptr,"%.12g %.12g %.12g\n", cos(theta), phi, proposal->tensor[i][j][k]);
+                    fprintf(fptr,"%.12g %.12g %.12g\n", cos(theta), phi, fstatistic_density(proposal,i,j,k));
                 }
                 fprintf(fptr,"\n");
             }
@@ -1220,11 +1614,9 @@ void setup_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Fl
     fflush(stdout);
 }
 
-void build_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Flags *flags, struct Proposal *proposal)
+/* dense F-statistic proposal, recomputing only frequency cells i with update[i] unless update is NULL */
+static void build_fstatistic_tensor(struct Orbit *orbit, struct Data *data, struct Flags *flags, struct Proposal *proposal, const int *update)
 {
-    //matrix to hold maximized extrinsic parameters
-    double *Fparams = calloc(4,sizeof(double));
-
     int n_f     = (int)proposal->matrix[0][0];
     int n_theta = (int)proposal->matrix[1][0];
     int n_phi   = (int)proposal->matrix[2][0];
@@ -1233,64 +1625,68 @@ void build_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Fl
     double d_theta = proposal->matrix[1][1];
     double d_phi   = proposal->matrix[2][1];
     
-    int n_fdot  = 10;
-    double d_fdot = (1.1 - 0.1)/n_fdot; //scan over chirp mass range [0.1:1.1] Msolar
-
     double norm = 0.0;
-
-    for(int i=0; i<n_f; i++)
+    
+    //cells that are kept go back to the un-normalized F-statistic
+    int n_update = n_f;
+    if(update)
     {
-        if(n_f<100)
-        {
-            if(!flags->quiet) printProgress((double)i/(double)n_f);
-        }
-        else
+        n_update = 0;
+        for(int i=0; i<n_f; i++)
         {
-            if(i%(n_f/100)==0 && !flags->quiet)printProgress((double)i/(double)n_f);
+            if(update[i]) n_update++;
+            else
+                for(int j=0; j<n_theta; j++)
+                    for(int k=0; k<n_phi; k++)
+                        proposal->tensor[i][j][k] /= proposal->norm;
         }
-        
-        double f;
-        
-        f = data->fmin + i*d_f;
+    }
+    
+    //spacecraft positions are shared by every cell of the grid
+    double *sc = ucb_spacecraft_positions(orbit, data->T, data->t0, ucb_max_bandwidth(data->NFFT));
+    
+    int n_cell = n_update*n_theta*n_phi;
+    int n_done = 0;
 
-        f += d_f/2; //evaluate logL in center of cell
+    #pragma omp parallel num_threads(flags->threads)
+    {
+        struct FstatWorkspace *fws = alloc_Fstat_workspace(data, sc);
         
-        //loop over colatitude bins
-        #pragma omp parallel for num_threads(flags->threads)
+        /*
+         all three axes are shared between threads, with frequency fastest so that
+         each thread's contiguous block reuses the sky geometry of its pixels
+         */
+        #pragma omp for collapse(3) schedule(static)
         for (int j=0; j<n_theta; j++)
         {
-            //F-statistic for TDI variabls
-            double logL_X,logL_AE, logLmax;
-
-            //loop over longitude bins
             for(int k=0; k<n_phi; k++)
             {
-                double theta = acos((-1. + (double)j*d_theta + d_theta/2)); //evaluate logL in center of cell
-                double phi = (double)k*d_phi + d_phi/2; //evaluate logL in center of cell
-                
-
-                get_Fstat_logL(orbit, data, f, 0, theta, phi, &logL_X, &logL_AE, Fparams);
-
-                logLmax = logL_AE;
-                    
-                if(logL_AE>1)
+                for(int i=0; i<n_f; i++)
                 {
-                    for(int n=0; n<n_fdot; n++)
-                    {
-                        double fdot = ucb_fdot(0.1+n*d_fdot, f); //get fdot by scanning over chirpmass
-                        
-                        get_Fstat_logL(orbit, data, f, fdot, theta, phi, &logL_X, &logL_AE, Fparams);
-                        
-                        if(logL_AE>logLmax) logLmax = logL_AE;
-
-                        if(logL_AE<1) break;
-                    }
+                    if(update && !update[i]) continue;
+                    
+                    double f = data->fmin + i*d_f + d_f/2; //evaluate logL in center of cell
+                    double costheta = -1. + (double)j*d_theta + d_theta/2;
+                    double phi = (double)k*d_phi + d_phi/2;
+                    
+                    double logLmax = fstatistic_cell(orbit, data, f, costheta, phi, fws);
+                    
+                    proposal->tensor[i][j][k] = logLmax*logLmax;
+                    
+                    int done;
+                    #pragma omp atomic capture
+                    done = ++n_done;
+                    
+                    if(!flags->quiet && omp_get_thread_num()==0 && (n_cell<100 || done%(n_cell/100)==0))
+                        printProgress((double)done/(double)n_cell);
                 }
-                proposal->tensor[i][j][k] = logLmax*logLmax;
-
-            }//end loop over longitude bins
-        }//end loop over colatitude bins
-    }//end loop over sub-bins
+            }
+        }
+        
+        free_Fstat_workspace(fws);
+    }
+    
+    free(sc);
 
     //get normalization
     for(int i=0; i<n_f; i++)
@@ -1313,8 +1709,194 @@ void build_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Fl
         for(int j=0; j<n_theta; j++)
             for(int k=0; k<n_phi; k++)
                 if(proposal->tensor[i][j][k]>proposal->maxp) proposal->maxp = proposal->tensor[i][j][k];
+}
+
+void build_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Flags *flags, struct Proposal *proposal)
+{
+    build_fstatistic_tensor(orbit, data, flags, proposal, NULL);
+}
+
+/* adaptive F-statistic proposal, recomputing only coarse frequency slabs with an update[i] unless update is NULL */
+static void build_fstatistic_tree_cells(struct Orbit *orbit, struct Data *data, struct Flags *flags, struct Proposal *proposal, const int *update)
+{
+    struct FstatTree *tree = proposal->fstat;
+    
+    int n_dense[3];
+    for(int m=0; m<3; m++) n_dense[m] = (int)proposal->matrix[m][0];
+    
+    double d_f     = proposal->matrix[0][1];
+    double d_theta = proposal->matrix[1][1];
+    double d_phi   = proposal->matrix[2][1];
+    
+    int *n = tree->n;
+    int *r = tree->r;
+    int Ncoarse = n[0]*n[1]*n[2];
+    int Nblock  = r[0]*r[1]*r[2];
+    
+    //coarse frequency slabs to recompute
+    int *slab = malloc(n[0]*sizeof(int));
+    for(int I=0; I<n[0]; I++)
+    {
+        slab[I] = (update==NULL);
+        if(update)
+            for(int i=I*r[0]; i<I*r[0]+fstatistic_tree_span(I,r[0],n_dense[0]); i++)
+                if(update[i]) slab[I] = 1;
+    }
+    
+    //old tree holds the (normalized) cells that are kept
+    double *coarse_old = tree->coarse;
+    int *child_old     = tree->child;
+    double *fine_old   = tree->fine;
+    free(tree->parent);
+    tree->coarse = malloc(Ncoarse*sizeof(double));
+    tree->child  = malloc(Ncoarse*sizeof(int));
+    tree->parent = NULL;
+    tree->fine   = NULL;
+    tree->Nrefined = 0;
+    
+    for(int c=0; c<Ncoarse; c++)
+    {
+        if(slab[c/(n[1]*n[2])]) continue;
+        tree->coarse[c] = coarse_old[c]/proposal->norm;
+        tree->child[c]  = child_old[c];
+    }
+    
+    //spacecraft positions are shared by every cell of the grid
+    double *sc = ucb_spacecraft_positions(orbit, data->T, data->t0, ucb_max_bandwidth(data->NFFT));
+    
+    #pragma omp parallel num_threads(flags->threads)
+    {
+        struct FstatWorkspace *fws = alloc_Fstat_workspace(data, sc);
+        
+        //coarse pass, evaluated at the center of each (clipped) coarse cell
+        #pragma omp for collapse(3) schedule(static)
+        for(int J=0; J<n[1]; J++)
+        {
+            for(int K=0; K<n[2]; K++)
+            {
+                for(int I=0; I<n[0]; I++)
+                {
+                    if(!slab[I]) continue;
+                    
+                    double f        = data->fmin + (I*r[0] + 0.5*fstatistic_tree_span(I,r[0],n_dense[0]))*d_f;
+                    double costheta = -1. + (J*r[1] + 0.5*fstatistic_tree_span(J,r[1],n_dense[1]))*d_theta;
+                    double phi      = (K*r[2] + 0.5*fstatistic_tree_span(K,r[2],n_dense[2]))*d_phi;
+                    
+                    double logLmax = fstatistic_cell(orbit, data, f, costheta, phi, fws);
+                    
+                    int c = (I*n[1]+J)*n[2]+K;
+                    tree->coarse[c] = logLmax*logLmax;
+                    tree->child[c]  = (logLmax > UCB_PROPOSAL_FSTAT_REFINE_LOGL) ? 1 : -1;
+                }
+            }
+        }
+        
+        //number the refined blocks
+        #pragma omp single
+        {
+            for(int c=0; c<Ncoarse; c++) if(tree->child[c]>=0) tree->child[c] = tree->Nrefined++;
+            
+            tree->parent = malloc((tree->Nrefined+1)*sizeof(int));
+            tree->fine   = calloc(tree->Nrefined*Nblock+1,sizeof(double));
+            for(int c=0; c<Ncoarse; c++) if(tree->child[c]>=0) tree->parent[tree->child[c]] = c;
+            
+            //copy refined blocks that are kept
+            for(int c=0; c<Ncoarse; c++)
+            {
+                if(tree->child[c]<0 || slab[c/(n[1]*n[2])]) continue;
+                for(int m=0; m<Nblock; m++)
+                    tree->fine[tree->child[c]*Nblock+m] = fine_old[child_old[c]*Nblock+m]/proposal->norm;
+            }
+        }
+        
+        //dense pass over the refined blocks
+        #pragma omp for collapse(4) schedule(static)
+        for(int b=0; b<tree->Nrefined; b++)
+        {
+            for(int j=0; j<r[1]; j++)
+            {
+                for(int k=0; k<r[2]; k++)
+                {
+                    for(int i=0; i<r[0]; i++)
+                    {
+                        int c = tree->parent[b];
+                        if(!slab[c/(n[1]*n[2])]) continue;
+                        
+                        int i_f     = (c/(n[1]*n[2]))*r[0] + i;
+                        int i_theta = ((c/n[2])%n[1])*r[1] + j;
+                        int i_phi   = (c%n[2])*r[2] + k;
+                        
+                        //clipped by the edges of the grid
+                        if(i_f>=n_dense[0] || i_theta>=n_dense[1] || i_phi>=n_dense[2]) continue;
+                        
+                        double f        = data->fmin + i_f*d_f + d_f/2; //evaluate logL in center of cell
+                        double costheta = -1. + (double)i_theta*d_theta + d_theta/2;
+                        double phi      = (double)i_phi*d_phi + d_phi/2;
+                        
+                        double logLmax = fstatistic_cell(orbit, data, f, costheta, phi, fws);
+                        
+                        tree->fine[((b*r[0]+i)*r[1]+j)*r[2]+k] = logLmax*logLmax;
+                    }
+                }
+            }
+        }
+        
+        free_Fstat_workspace(fws);
+    }
+    
+    free(sc);
+    free(slab);
+    free(coarse_old);
+    free(child_old);
+    free(fine_old);
+    
+    //get normalization, each leaf weighted by the number of dense cells it covers
+    double norm = 0.0;
+    for(int c=0; c<Ncoarse; c++)
+    {
+        if(tree->child[c]>=0) continue;
+        int I = c/(n[1]*n[2]);
+        int J = (c/n[2])%n[1];
+        int K = c%n[2];
+        norm += tree->coarse[c]*fstatistic_tree_span(I,r[0],n_dense[0])*fstatistic_tree_span(J,r[1],n_dense[1])*fstatistic_tree_span(K,r[2],n_dense[2]);
+    }
+    for(int m=0; m<tree->Nrefined*Nblock; m++) norm += tree->fine[m];
+    
+    //include correction for cell volume
+    proposal->norm = (n_dense[0]*n_dense[1]*n_dense[2])/norm;
+    
+    //normalize and get max
+    proposal->maxp = -1.e60;
+    for(int c=0; c<Ncoarse; c++)
+    {
+        tree->coarse[c] *= proposal->norm;
+        if(tree->child[c]<0 && tree->coarse[c]>proposal->maxp) proposal->maxp = tree->coarse[c];
+    }
+    for(int m=0; m<tree->Nrefined*Nblock; m++)
+    {
+        tree->fine[m] *= proposal->norm;
+        if(tree->fine[m]>proposal->maxp) proposal->maxp = tree->fine[m];
+    }
+    
+    setup_fstatistic_tree_leaves(proposal);
     
-    free(Fparams);
+    if(!flags->quiet)
+    {
+        fprintf(stdout,"   refined %i/%i coarse cells\n",tree->Nrefined,Ncoarse);
+        fflush(stdout);
+    }
+}
+
+void build_fstatistic_tree(struct Orbit *orbit, struct Data *data, struct Flags *flags, struct Proposal *proposal)
+{
+    build_fstatistic_tree_cells(orbit, data, flags, proposal, NULL);
+}
+
+/* recompute frequency cells i of the F-statistic proposal with update[i], or all of them if update is NULL */
+static void update_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Flags *flags, struct Proposal *proposal, const int *update)
+{
+    if(proposal->fstat) build_fstatistic_tree_cells(orbit, data, flags, proposal, update);
+    else                build_fstatistic_tensor(orbit, data, flags, proposal, update);
 }
 
 void rebuild_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Model *model, struct Flags *flags, struct Proposal *proposal)
@@ -1355,7 +1937,37 @@ void rebuild_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct
     // convert DWT to DFT
     if(!strcmp(data->basis,"wavelet")) wavelet_layer_to_fourier_transform(data);
     
-    build_fstatistic_proposal(orbit, data, flags, proposal);
+    // DFT F-stat is computed from data->dft
+    double *dftA = NULL;
+    double *dftE = NULL;
+    if(!strcmp(data->basis,"fourier"))
+    {
+        dftA = malloc(data->N*sizeof(double));
+        dftE = malloc(data->N*sizeof(double));
+        memcpy(dftA, data->dft->A, data->N*sizeof(double));
+        memcpy(dftE, data->dft->E, data->N*sizeof(double));
+        memcpy(data->dft->A, data->tdi->A, data->N*sizeof(double));
+        memcpy(data->dft->E, data->tdi->E, data->N*sizeof(double));
+    }
+    
+    // only recompute where the residual changed since the last build
+    int *update = malloc((int)proposal->matrix[0][0]*sizeof(int));
+    if(fstatistic_changed_cells(orbit, data, proposal, update))
+    {
+        update_fstatistic_proposal(orbit, data, flags, proposal, update);
+        proposal->fstatKey->version++;
+        set_fstatistic_key(data, proposal);
+        write_fstatistic_proposal(flags, proposal);
+    }
+    free(update);
+    
+    if(dftA)
+    {
+        memcpy(data->dft->A, dftA, data->N*sizeof(double));
+        memcpy(data->dft->E, dftE, data->N*sizeof(double));
+        free(dftA);
+        free(dftE);
+    }
     
     //restore data
     memcpy(data->tdi->X, Xsave, data->N*sizeof(double));
@@ -1375,14 +1987,13 @@ void rebuild_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct
 
 void setup_gmm_proposal(struct Data *data, struct Catalog *catalog, struct Proposal *proposal)
 {
-    /* size of joint gmm */
-    proposal->Ngmm = catalog->N;
+    /* one joint gmm for the catalog, indexed by frequency */
+    proposal->Ngmm = (catalog->N > 0) ? 1 : 0;
     
     /* allocate space for gmm */
     proposal->gmm = malloc(proposal->Ngmm*sizeof(struct GMM*));
     
-    /* point to different entries in catalog */
-    for(int n=0; n<proposal->Ngmm; n++) proposal->gmm[n] = catalog->entry[n]->gmm;
+    if(proposal->Ngmm) proposal->gmm[0] = combine_catalog_gmm(catalog);
 }
 
 void setup_prior_proposal(struct Flags *flags, struct Prior *prior, struct Proposal *proposal)
@@ -1411,63 +2022,49 @@ void setup_cdf_proposal(struct Data *data, struct Flags *flags, struct Proposal
      8x1D proposals from the marginalized posteriors
      */
     
-    double junk;
-    FILE *fptr=NULL;
-    
     //parse chain file
     if(!flags->quiet)fprintf(stdout,"  reading chain file %s...\n",flags->cdfFile);
-    fptr = fopen(flags->cdfFile,"r");
-    proposal->size=0;
-    while(!feof(fptr))
+    struct ChainFile *chain_file = open_chain_file(flags->cdfFile, NULL, 0, NULL, "r");
+    if(chain_file->Ncol<UCB_MODEL_NP)
     {
-        for(int j=0; j<UCB_MODEL_NP; j++)
-        {
-            int check = fscanf(fptr,"%lg",&junk);
-            if(!check)
-            {
-                fprintf(stderr,"Error reading %s\n",flags->cdfFile);
-                exit(1);
-            }
-        }
-        proposal->size++;
+        fprintf(stderr,"Error reading %s\n",flags->cdfFile);
+        exit(1);
     }
-    rewind(fptr);
-    proposal->size--;
+    proposal->size = (int)chain_file->Nrow;
     
     if(!flags->quiet)fprintf(stdout, "  samples in chain: %i\n",proposal->size);
     
-    proposal->vector = calloc(proposal->size , sizeof(double));
     proposal->matrix = malloc(UCB_MODEL_NP * sizeof(double*));
     for(int j=0; j<UCB_MODEL_NP; j++) proposal->matrix[j] = calloc(proposal->size , sizeof(double));
     
     struct Model *temp = malloc(sizeof(struct Model));
     alloc_model(data,temp,NMAX);
     
+    double *row = double_vector(chain_file->Ncol);
     for(int n=0; n<proposal->size; n++)
     {
-        scan_source_params(data, temp->source[0], fptr);
+        if(read_chain_row(chain_file, row))
+        {
+            fprintf(stderr,"Error reading %s\n",flags->cdfFile);
+            exit(1);
+        }
+        unpack_source_params(data, temp->source[0], row);
         for(int j=0; j<UCB_MODEL_NP; j++) proposal->matrix[j][n] = temp->source[0]->params[j];
     }
+    free_double_vector(row);
     free_model(temp);
     
-    //now sort each row of the matrix
+    close_chain_file(chain_file);
+    
+    //quantile table of each marginalized distribution
+    proposal->cdf = malloc(UCB_MODEL_NP*sizeof(struct QuantileTable *));
     for(int j=0; j<UCB_MODEL_NP; j++)
     {
-        //fill up proposal vector
-        for(int n=0; n<proposal->size; n++)
-            proposal->vector[n] = proposal->matrix[j][n];
-        
-        //sort it
-        double_sort(proposal->vector, proposal->size);
-        
-        //replace that row of the matrix
-        for(int n=0; n<proposal->size; n++)
-            proposal->matrix[j][n] = proposal->vector[n];
+        proposal->cdf[j] = alloc_quantile_table(proposal->matrix[j], proposal->size, UCB_PROPOSAL_NQUANTILE);
+        free(proposal->matrix[j]);
     }
-    
-    free(proposal->vector);
-    
-    fclose(fptr);
+    free(proposal->matrix);
+    proposal->matrix = NULL;
     
     if(!flags->quiet)fprintf(stdout,"\n================================================\n");
 }
@@ -1680,6 +2277,19 @@ double draw_from_fstatistic(struct Data *data, UNUSED struct Model *model, UNUSE
     //first draw from prior
     draw_from_uniform_prior(data, model, source, proposal, params, seed);
     
+    //adaptive grid is sampled directly
+    if(proposal->fstat)
+    {
+        double x[3];
+        draw_fstatistic_tree(proposal, x, seed);
+        
+        params[0] = (double)(data->qmin) + x[0]*d_f*data->T;
+        params[1] = -1. + x[1]*d_theta;
+        params[2] = x[2]*d_phi;
+        
+        return evaluate_fstatistic_proposal(data, model, source, proposal, params);
+    }
+    
     //now rejection sample on f,theta,phi
     do
     {
@@ -1724,7 +2334,20 @@ double jump_from_fstatistic(struct Data *data, struct Model *model, struct Sourc
     
     /* half the time do an fm shift, half the time completely reboot frequency */
     int fmFlag = 0;
-    if(rand_r_U_0_1(seed)<-0.5) fmFlag=1;
+    if(rand_r_U_0_1(seed)<-0.5 && !proposal->fstat) fmFlag=1;
+    
+    //adaptive grid is sampled directly
+    if(proposal->fstat)
+    {
+        double x[3];
+        draw_fstatistic_tree(proposal, x, seed);
+        
+        params[0] = (double)(data->qmin) + x[0]*d_f*data->T;
+        params[1] = -1. + x[1]*d_theta;
+        params[2] = x[2]*d_phi;
+        
+        return evaluate_fstatistic_proposal(data, model, source, proposal, params);
+    }
     
     if(fmFlag)
     {
@@ -1805,7 +2428,7 @@ double evaluate_fstatistic_proposal(struct Data *data, UNUSED struct Model *mode
     if      (i<0 || i>=n_f    ) return -INFINITY;
     else if (j<0 || j>=n_theta) return -INFINITY;
     else if (k<0 || k>=n_phi  ) return -INFINITY;
-    else logP += log(proposal->tensor[i][j][k]);
+    else logP += log(fstatistic_density(proposal,i,j,k));
     
     return logP;
 }
@@ -33,6 +33,62 @@
 #endif
 
 #define UCB_PROPOSAL_NPROP 9 ///< Number of defined proposal distributions for UCB sampler
+#define UCB_PROPOSAL_WEIGHT_FLOOR 0.1 ///< Smallest adapted proposal weight, as fraction of initial weight
+#define UCB_PROPOSAL_SCREEN_ACCEPT 0.25 ///< Acceptance rate below which trials are screened with `--delayed-acceptance`, see adapt_proposal_screening()
+#define UCB_PROPOSAL_NQUANTILE 1000 ///< Number of quantiles in each 1D marginal of the chain CDF proposal
+#define UCB_PROPOSAL_FSTAT_REFINE_F 2 ///< Dense F-statistic grid cells per coarse cell in frequency, with `--fstat-adaptive`
+#define UCB_PROPOSAL_FSTAT_REFINE_SKY 4 ///< Dense F-statistic grid cells per coarse cell in each sky coordinate, with `--fstat-adaptive`
+#define UCB_PROPOSAL_FSTAT_REFINE_LOGL 8.0 ///< Coarse F-statistic \f$\log L_{AE}\f$ above which a cell is refined, with `--fstat-adaptive`
+#define UCB_PROPOSAL_FSTAT_REBUILD_SNR2 1.0 ///< Change \f$(\delta d|\delta d)\f$ of the whitened data in the filter band of an F-statistic frequency cell above which the cell is recomputed
+
+/**
+ \brief Sparse coarse-to-fine F-statistic proposal density
+
+ The dense \f$ \{f_0,\cos\theta,\phi\} \f$ grid described by Proposal::matrix is
+ covered by coarse cells of FstatTree::r dense cells each. The F-statistic is
+ evaluated once per coarse cell and only coarse cells above
+ UCB_PROPOSAL_FSTAT_REFINE_LOGL are refined to the dense resolution, so noise
+ dominated parts of the band cost one evaluation per coarse cell.
+ Coarse cells at the upper edges of the grid are clipped to the dense grid.
+
+ The leaves (unrefined coarse cells and refined dense cells) hold the same
+ normalized density as Proposal::tensor would, and are sampled directly with FstatTree::cdf.
+ */
+struct FstatTree
+{
+    int n[3];       //!<number of coarse cells in \f$ \{f_0,\cos\theta,\phi\} \f$
+    int r[3];       //!<dense cells per coarse cell in \f$ \{f_0,\cos\theta,\phi\} \f$
+    int Nrefined;   //!<number of refined coarse cells
+    double *coarse; //!<density in coarse cell `c = (I*n[1]+J)*n[2]+K`
+    int *child;     //!<refined block of coarse cell `c`, or -1 if it is a leaf
+    int *parent;    //!<coarse cell of each refined block
+    double *fine;   //!<density in dense cell `(i,j,k)` of refined block `b`: `[((b*r[0]+i)*r[1]+j)*r[2]+k]`
+    int Nleaf;      //!<number of leaves
+    int *leaf;      //!<coarse cell `c` of each leaf, or `Ncoarse` + index in FstatTree::fine
+    double *cdf;    //!<cumulative probability of the leaves
+};
+
+/**
+ \brief Key identifying the data an F-statistic proposal was computed from
+
+ Stored with the proposal in the checkpoint directory. setup_fstatistic_proposal()
+ reuses a stored proposal for the same segment and grid, and both it and
+ rebuild_fstatistic_proposal() only recompute the frequency cells whose filter band
+ saw a change in the whitened data larger than UCB_PROPOSAL_FSTAT_REBUILD_SNR2
+ since FstatKey::A, FstatKey::E, and FstatKey::Sn were stored.
+ */
+struct FstatKey
+{
+    int qmin;     //!<first frequency bin of the segment
+    int NFFT;     //!<number of frequency bins in the segment
+    int n[3];     //!<dense grid size in \f$ \{f_0,\cos\theta,\phi\} \f$
+    int adaptive; //!<1 if the proposal is stored in a FstatTree
+    int version;  //!<residual version, number of times the proposal was updated after it was first computed
+    unsigned long long hash; //!<hash of FstatKey::A, FstatKey::E, and FstatKey::Sn
+    double *A;    //!<A channel the proposal was computed from
+    double *E;    //!<E channel the proposal was computed from
+    double *Sn;   //!<noise PSD the proposal was computed from
+};
 
 /*!
  \brief Prototype structure for proposal distributions.
@@ -64,22 +120,33 @@ struct Proposal
     
     int *trial;      //!<total number of trials for proposal
     int *accept;     //!<total number of accepted trials for proposals*/
+    double *time;    //!<total wall time [s] of trials for proposal, including the likelihood
     char name[128];  //!<string identifying proposal type
     double norm;     //!<proposal normalization
     double maxp;     //!<max value of proposal density for rejection sampling
     double weight;   //!<proposal weight [0,1] for fixed dimension moves
+    double weight0;  //!<initial value of Proposal::weight, before adapt_proposal_weights()
     double rjweight; //!<proposal weight [0,1] for trans dimensional moves
+    int screen;      //!<1 if fixed dimension trials are screened with surrogate_delta_log_likelihood() under `--delayed-acceptance`
     int size;        //!<size of proposal arrays
     double *vector;  //!<utility 1D array for proposal metadata
     double **matrix; //!<utility 2D array for proposal metadata
     double ***tensor;//!<utility 3D array for proposal metadata
+    struct FstatTree *fstat; //!<sparse F-statistic proposal with `--fstat-adaptive`, replaces Proposal::tensor
+    struct FstatKey *fstatKey; //!<data the F-statistic proposal was computed from
     
     /** @name Gaussian mixture model
      */
     ///@{
-    size_t Ngmm; //!< number of mixture models (1/source)
+    size_t Ngmm; //!< number of mixture models
     struct GMM **gmm; //!<array of individual mixture models
     ///@}
+    
+    /** @name Chain CDF
+     */
+    ///@{
+    struct QuantileTable **cdf; //!<1D marginal distribution of each parameter from the input chain
+    ///@}
 };
 
 /**
@@ -89,9 +156,33 @@ void setup_frequency_proposal(struct Data *data, struct Flags *flags);
 
 /**
  \brief Compute and print acceptance ratios for each proposal
+ 
+ Along with the acceptance rate each proposal reports its average cost per
+ trial and the number of accepted trials per second of wall time.
  */
 void print_acceptance_rates(struct Proposal **proposal, int NProp, int ic, FILE *fptr);
 
+/**
+ \brief Reweight fixed dimension proposals by accepted trials per second of chain `ic`
+ 
+ Proposal::weight becomes proportional to Proposal::accept/Proposal::time,
+ but no less than UCB_PROPOSAL_WEIGHT_FLOOR of Proposal::weight0 so that
+ every proposal in the initial cocktail stays in use.  Proposals with zero
+ initial weight are left off.  Only used during burn in, since adapting the
+ weights breaks detailed balance.
+ */
+void adapt_proposal_weights(struct Proposal **proposal, int NProp, int ic);
+
+/**
+ \brief Choose the proposals whose trials are screened by delayed acceptance from the acceptance rate of chain `ic`
+
+ Screening costs a reduced bandwidth waveform for every trial, so it only pays
+ off for proposals that are rarely accepted.  Proposal::screen is set for
+ proposals accepted less than UCB_PROPOSAL_SCREEN_ACCEPT of the time.
+ Only used during burn in, so the choice is fixed while sampling the posterior.
+ */
+void adapt_proposal_screening(struct Proposal **proposal, int NProp, int ic);
+
 /**
 \brief Fair draw from prior for each parameter
  
@@ -155,7 +246,7 @@ double draw_from_fisher(UNUSED struct Data *data, struct Model *model, struct So
 /**
  \brief Draw each parameter from 1D marginalized CDF
  
- Use CDFs constructed from chain file input at command line with --update flag to draw new parameters.  The proposal draws a p-value from \f$U[0,1]\f$ and interpolates the samples from the input chain file to find the associated parameter value.
+ Use CDFs constructed from chain file input at command line with --update flag to draw new parameters.  Each parameter is drawn independently from the quantile table of its marginalized distribution with quantile_table_draw().
  
 @param params (updates \f$\vec\theta\f$)
 @return logQ = cdf_density()
@@ -187,6 +278,7 @@ double draw_from_cov(UNUSED struct Data *data, struct Model *model, struct Sourc
  \brief Draw from 3D F-statistic distribution
  
  Uses pre-computed 3D quantized distribution to draw \f$[f_0,\cos\theta,\phi]\f$ weighted by F-statistic likelihood in each cell. Remaining parameters are drawn from the prior.
+ With `--fstat-adaptive` the cell is drawn directly from the leaves of Proposal::fstat instead of by rejection sampling.
  
  @param params (updates \f$\vec\theta\f$)
  @return logQ = evaluate_fstatistic_proposal()
@@ -244,7 +336,8 @@ double jump_from_fstatistic(struct Data *data, struct Model *model, struct Sourc
 /**
  \brief Draw sky location from galaxy prior defined in set_galaxy_prior()
  
- Rejection samples sky location parameters \f${\cos\theta,\phi}\f$ using galaxy-weighted sky prior.
+ Draws a `skyhist` bin from the alias table built by set_galaxy_prior() in \f$O(1)\f$,
+ and sky location parameters \f${\cos\theta,\phi}\f$ uniformly within it.
  
  @param params (updates \f$\cos\theta,\phi\f$)
  @return logQ = prior->skyhist[]
@@ -265,8 +358,8 @@ double draw_calibration_parameters(struct Data *data, struct Model *model, unsig
 /**
  \brief Evaluate probability density from CDF
  
- Uses binary_search() to locate input params in CDF.
- Returns approximate value of PDF by taking numerical derivative of CDF on either side of input parameters.
+ Product of the piecewise uniform densities of each parameter's quantile
+ table, see quantile_table_log_density().
  */
 double cdf_density(UNUSED struct Data *data, struct Model *model, struct Source * source, struct Proposal *proposal, UNUSED double *params);
 
@@ -285,6 +378,10 @@ void initialize_vb_proposal(struct Orbit *orbit, struct Data *data, struct Prior
 
 /**
  \brief Sets up memory for and builds 3D histogram for F-statistics proposal
+
+ A proposal stored in the checkpoint directory for the same segment and grid is
+ reused, with only the frequency cells affected by changes to the data recomputed,
+ see FstatKey.
  */
 void setup_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Flags *flags, struct Proposal *proposal);
 
@@ -302,8 +399,21 @@ TODO: adaptive grid spacing based on Fisher sub-matrix
 */
 void build_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Flags *flags, struct Proposal *proposal);
 
+/**
+ \brief Coarse-to-fine version of build_fstatistic_proposal() used with `--fstat-adaptive`
+
+ Evaluates the F-statistic on the coarse cells of Proposal::fstat, refines the
+ cells with \f$\log L_{AE}\f$ > UCB_PROPOSAL_FSTAT_REFINE_LOGL on the dense grid,
+ and normalizes the leaves the same way as the dense Proposal::tensor.
+ */
+void build_fstatistic_tree(struct Orbit *orbit, struct Data *data, struct Flags *flags, struct Proposal *proposal);
+
 /**
  \brief Rebuilds F-statistic proposal using current residual
+
+ Only frequency cells whose filter band saw a significant change in the
+ residual since the last build are recomputed, and the updated proposal is
+ stored in the checkpoint directory, see FstatKey.
  */
 void rebuild_fstatistic_proposal(struct Orbit *orbit, struct Data *data, struct Model *model, struct Flags *flags, struct Proposal *proposal);
 
@@ -326,7 +436,8 @@ void test_covariance_proposal(struct Data *data, struct Flags *flags, struct Mod
 /**
  \brief Stores CDF of chain file input with --update flag
  
- Reads chain file, sorts each marginalized distribution, and packages data into Proposal structure.
+ Reads chain file, in any format supported by open_chain_file(), and
+ builds a QuantileTable of each marginalized distribution in Proposal::cdf.
  */
 void setup_cdf_proposal(struct Data *data, struct Flags *flags, struct Proposal *proposal, int NMAX);
 
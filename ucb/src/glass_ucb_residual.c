@@ -126,72 +126,88 @@ int main(int argc, char *argv[])
     
     
     
-    for(int nn=0; nn<N; nn++)
+    //catalog is read in blocks and waveforms are computed as a batch
+    int NBLOCK = 1024;
+    struct Source **inj = malloc(NBLOCK*sizeof(struct Source *));
+    double **params = malloc(NBLOCK*sizeof(double *));
+    struct TDI **tdi = malloc(NBLOCK*sizeof(struct TDI *));
+    int *BW = malloc(NBLOCK*sizeof(int));
+    for(int n=0; n<NBLOCK; n++)
     {
-        if(N>100 && nn%(N/100)==0)printProgress( (double)nn / (double)N );
-        int check = fscanf(catalogFile,"%lg %lg %lg %lg %lg %lg %lg %lg",&f0,&dfdt,&amp,&phi,&theta,&iota,&psi,&phi0);
-        
-        if(!check)
-        {
-            fprintf(stderr,"Error reading catalogFile\n");
-            exit(1);
-        }
-        
-        //set bandwidth of data segment centered on injection
-        data->fmin = f0 - (data->NFFT/2)/data->T;
-        data->fmax = f0 + (data->NFFT/2)/data->T;
-        data->qmin = (int)(data->fmin*data->T);
-        data->qmax = data->qmin+data->NFFT;
-        
-        struct Source *inj = malloc(sizeof(struct Source));
-        alloc_source(inj, data->N, data->Nchannel);
+        inj[n] = malloc(sizeof(struct Source));
+        alloc_source(inj[n], data->Nchannel);
+    }
+    
+    for(int nstart=0; nstart<N; nstart+=NBLOCK)
+    {
+        int Nbatch = (nstart+NBLOCK < N) ? NBLOCK : N-nstart;
         
-        for(int n=0; n<data->N; n++)
+        for(int n=0; n<Nbatch; n++)
         {
-            inj->tdi->A[n] = 0.0;
-            inj->tdi->E[n] = 0.0;
-            inj->tdi->X[n] = 0.0;
+            int nn = nstart+n;
+            if(N>100 && nn%(N/100)==0)printProgress( (double)nn / (double)N );
+            int check = fscanf(catalogFile,"%lg %lg %lg %lg %lg %lg %lg %lg",&f0,&dfdt,&amp,&phi,&theta,&iota,&psi,&phi0);
+            
+            if(!check)
+            {
+                fprintf(stderr,"Error reading catalogFile\n");
+                exit(1);
+            }
+            
+            //set bandwidth of data segment centered on injection
+            data->fmin = f0 - (data->NFFT/2)/data->T;
+            data->fmax = f0 + (data->NFFT/2)/data->T;
+            data->qmin = (int)(data->fmin*data->T);
+            data->qmax = data->qmin+data->NFFT;
+            
+            //map parameters to vector
+            inj[n]->f0       = f0;
+            inj[n]->dfdt     = dfdt;
+            inj[n]->costheta = theta;
+            inj[n]->phi      = phi;
+            inj[n]->amp      = amp;
+            inj[n]->cosi     = iota;
+            inj[n]->phi0     = phi0;
+            inj[n]->psi      = psi;
+            
+            map_params_to_array(inj[n], inj[n]->params, data->T);
+            
+            //Book-keeping of injection time-frequency volume
+            ucb_alignment(orbit, data, inj[n]);
+            clear_source_tdi(inj[n], 2*inj[n]->BW);
+            
+            if(inj[n]->BW > data->NFFT) printf("WARNING:  Bandwidth %i wider than N %i at f=%.2e\n",inj[n]->BW,data->NFFT,data->fmin);
+            
+            params[n] = inj[n]->params;
+            tdi[n]    = inj[n]->tdi;
+            BW[n]     = inj[n]->BW;
         }
         
-        //map parameters to vector
-        inj->f0       = f0;
-        inj->dfdt     = dfdt;
-        inj->costheta = theta;
-        inj->phi      = phi;
-        inj->amp      = amp;
-        inj->cosi     = iota;
-        inj->phi0     = phi0;
-        inj->psi      = psi;
-        
-        map_params_to_array(inj, inj->params, data->T);
-        
-        //Book-keeping of injection time-frequency volume
-        ucb_alignment(orbit, data, inj);
-        
-        //Simulate gravitational wave signal
+        //Simulate gravitational wave signals
         double t0 = data->t0;
-        ucb_waveform(orbit, data->format, data->T, t0, inj->params, 8, inj->tdi->X, inj->tdi->Y, inj->tdi->Z, inj->tdi->A, inj->tdi->E, inj->BW, 2);
-        
+        ucb_waveform_batch(orbit, select_LISA_tdi(data->format), data->T, t0, params, 8, tdi, BW, Nbatch, 2);
         
-        if(inj->BW > data->NFFT) printf("WARNING:  Bandwidth %i wider than N %i at f=%.2e\n",inj->BW,data->NFFT,data->fmin);
-        
-        for(int n=0; n<inj->BW; n++)
+        for(int n=0; n<Nbatch; n++)
         {
-            int i = inj->qmin+n;
-            if(i>0 && i<data->NFFT)
+            for(int m=0; m<inj[n]->BW; m++)
             {
-                //        data->tdi->A[2*i]   -= inj->tdi->A[2*n];
-                //        data->tdi->E[2*i]   -= inj->tdi->E[2*n];
-                //        data->tdi->A[2*i+1] -= inj->tdi->A[2*n+1];
-                //        data->tdi->E[2*i+1] -= inj->tdi->E[2*n+1];
-                data->tdi->A[2*i]   += inj->tdi->A[2*n];
-                data->tdi->E[2*i]   += inj->tdi->E[2*n];
-                data->tdi->A[2*i+1] += inj->tdi->A[2*n+1];
-                data->tdi->E[2*i+1] += inj->tdi->E[2*n+1];
+                int i = inj[n]->qmin+m;
+                if(i>0 && i<data->NFFT)
+                {
+                    data->tdi->A[2*i]   += inj[n]->tdi->A[2*m];
+                    data->tdi->E[2*i]   += inj[n]->tdi->E[2*m];
+                    data->tdi->A[2*i+1] += inj[n]->tdi->A[2*m+1];
+                    data->tdi->E[2*i+1] += inj[n]->tdi->E[2*m+1];
+                }
             }
         }
-        free_source(inj);
     }
+    
+    for(int n=0; n<NBLOCK; n++) free_source(inj[n]);
+    free(inj);
+    free(params);
+    free(tdi);
+    free(BW);
     fprintf(stdout,"\nFinished subtracting galaxy catalog\n");
     
     //print full galaxy and density file
@@ -33,6 +33,29 @@ static double maximization_penalty(int dimension, int bandwidth)
     //return 0.0; //no penalty
 }
 
+/*
+ Recompute the model, residual, and likelihood of the current state from scratch once
+ they have had UCB_DELTA_LOGL_NMAX incremental updates, whether or not the last one was accepted
+ */
+static void refresh_model(struct Orbit *orbit, struct Data *data, struct Model *model, struct Model *trial, struct Flags *flags)
+{
+    if(model->Ndelta < UCB_DELTA_LOGL_NMAX) return;
+    
+    if(!flags->prior)
+    {
+        double logL = model->logL;
+        (*model->kernels.generate_signal)(orbit, data, model, -1);
+        model->logL = (*model->kernels.log_likelihood)(data, model);
+        
+        if(flags->debug && fabs(model->logL - logL) > 1e-6*fabs(model->logL))
+            fprintf(stderr,"Warning: incremental logL drifted by %g after %i updates\n",logL - model->logL, model->Ndelta);
+    }
+    model->Ndelta = 0;
+    
+    //trial has to be synced in full
+    trial->update_flag = -1;
+}
+
 void ptmcmc(struct Model **model, struct Chain *chain, struct Flags *flags)
 {
     int a, b;
@@ -123,6 +146,7 @@ void noise_model_mcmc(struct Orbit *orbit, struct Data *data, struct Model *mode
     struct Model *model_y = trial;
     
     copy_model(model_x,model_y);
+    model_y->update_flag = -1;
     
     //choose proposal distribution
     for(int n=0; n<data->Nchannel*data->Nlayer; n++)
@@ -135,12 +159,10 @@ void noise_model_mcmc(struct Orbit *orbit, struct Data *data, struct Model *mode
     if(!flags->prior)
     {
         //  Form master template
-        if(!strcmp("fourier",data->basis)) generate_noise_model(data, model_y);
-        if(!strcmp("wavelet",data->basis)) generate_noise_model_wavelet(data, model_y);
+        (*model_y->kernels.generate_noise)(data, model_y);
         
         //get likelihood for y
-        if(!strcmp("fourier",data->basis)) model_y->logL = gaussian_log_likelihood(data, model_y);
-        if(!strcmp("wavelet",data->basis)) model_y->logL = gaussian_log_likelhood_wavelet(data, model_y);
+        model_y->logL = (*model_y->kernels.log_likelihood)(data, model_y);
 
         //model_y->logLnorm = gaussian_log_likelihood_constant_norm(data, model_y);
         model_y->logLnorm = gaussian_log_likelihood_model_norm(data, model_y);
@@ -153,7 +175,14 @@ void noise_model_mcmc(struct Orbit *orbit, struct Data *data, struct Model *mode
     logH += logPy  - logPx; //priors
     
     loga = log(rand_r_U_0_1(&chain->r[ic]));
-    if(logH > loga) copy_model(model_y,model_x);
+    if(logH > loga)
+    {
+        copy_model(model_y,model_x);
+        model_y->update_flag = 0;
+        
+        //summary data are weighted by the noise model
+        if(model_x->summary) reset_summary_data(data, model_x->summary, model_x->noise);
+    }
     
 }
 
@@ -170,8 +199,12 @@ void ucb_mcmc(struct Orbit *orbit, struct Data *data, struct Model *model, struc
     //shorthand pointers
     struct Model *model_x = model;
     struct Model *model_y = trial;
+    struct UCBKernels *kernels = &model_y->kernels;
     
-    copy_model(model_x,model_y);
+    refresh_model(orbit, data, model_x, model_y, flags);
+    
+    //trial is left in sync with the current state unless another sampler changed it
+    if(model_y->update_flag) copy_model(model_x,model_y);
 
     //pick a source to update
     int n = (int)(rand_r_U_0_1(&chain->r[ic])*(double)model_x->Nlive);
@@ -190,9 +223,12 @@ void ucb_mcmc(struct Orbit *orbit, struct Data *data, struct Model *model, struc
     }while(proposal[nprop]->weight <= draw);
     
     proposal[nprop]->trial[ic]++;
+    double start = omp_get_wtime();
 
     //call proposal function to update source parameters
+    double prof = profile_start();
     (*proposal[nprop]->function)(data, model_x, source_y, proposal[nprop], source_y->params, &chain->r[ic]);
+    profile_stop(PROFILE_PROPOSAL, prof);
 
     //hold sky position fixed to injected value
     if(flags->fixSky)
@@ -206,8 +242,10 @@ void ucb_mcmc(struct Orbit *orbit, struct Data *data, struct Model *model, struc
     if(flags->fixFdot) source_y->params[7] = source_x->params[7];
     
     //call associated proposal density functions
+    prof = profile_start();
     logQyx = (*proposal[nprop]->density)(data, model_x, source_y, proposal[nprop], source_y->params);
     logQxy = (*proposal[nprop]->density)(data, model_x, source_x, proposal[nprop], source_x->params);
+    profile_stop(PROFILE_PROPOSAL, prof);
 
     map_array_to_params(source_y, source_y->params, data->T);
 
@@ -215,23 +253,39 @@ void ucb_mcmc(struct Orbit *orbit, struct Data *data, struct Model *model, struc
     logPx = evaluate_prior(flags, data, model_x, prior, source_x->params);
     logPy = evaluate_prior(flags, data, model_y, prior, source_y->params);
 
+    //update model and likelihood incrementally, refresh_model() recomputes them from scratch periodically
+    int delta = !flags->calibration && model_x->Nlive > 0;
+    
+    /*
+     Delayed acceptance: screen y with the reduced bandwidth likelihood and only
+     compute the full likelihood if it passes, then accept with the ratio of the
+     full and screening Hastings ratios.  Skipped for proposals that are often
+     accepted, and when only the extrinsic parameters changed since the filters
+     already make the full waveform cheap.
+     */
+    int screen = flags->delayedAcceptance && proposal[nprop]->screen && delta && kernels->delta_log_likelihood_band && !flags->prior && !intrinsic_params_match(source_x->params, source_y->params);
+    double logHs = 0.0; //(log) Hastings ratio of the screening stage
+    
+    if(logPy > -INFINITY && screen)
+    {
+        logHs += surrogate_delta_log_likelihood(orbit, data, model_x, model_y, n, UCB_SURROGATE_DOWNSAMPLE)/chain->temperature[ic];
+        logHs += logPy  - logPx;
+        logHs += logQxy - logQyx;
+        
+        //rejected without computing the full waveform
+        if(!(isfinite(logHs) && logHs > log(rand_r_U_0_1(&chain->r[ic])))) logPy = -INFINITY;
+    }
    
     if(logPy > -INFINITY)
     {
         if(!flags->prior)
         {
             //form master template
-            if(!strcmp("fourier",data->basis)) generate_signal_model(orbit, data, model_y, n);
-            if(!strcmp("wavelet",data->basis)) generate_signal_model_wavelet(orbit, data, model_y, n);  
-            //update master template
-            //update_signal_model(orbit, data, model_x, model_y, n);
-            
+            if(delta) (*kernels->update_signal)(orbit, data, model_x, model_y, n);
+            else      (*kernels->generate_signal)(orbit, data, model_y, n);
 
             //rejection sample on SNR?
-            double sn;
-            if(!strcmp("fourier",data->basis)) sn = snr(model_y->source[n], model_y->noise);
-            if(!strcmp("wavelet",data->basis)) sn = snr_wavelet(model_y->source[n], model_y->noise);
-            if(sn<5.0) logPy = -INFINITY;
+            if((*kernels->snr)(model_y->source[n], model_y->noise) < 5.0) logPy = -INFINITY;
 
             //add calibration error
             if(flags->calibration)
@@ -241,12 +295,11 @@ void ucb_mcmc(struct Orbit *orbit, struct Data *data, struct Model *model, struc
             }
             
 
-            //get likelihood for y
-            if(!strcmp("fourier",data->basis)) model_y->logL = gaussian_log_likelihood(data, model_y);
-            if(!strcmp("wavelet",data->basis)) model_y->logL = gaussian_log_likelhood_wavelet(data, model_y);
-
-            //get delta log likelihood
-            //model_y->logL = model_x->logL + delta_log_likelihood(data, model_x, model_y, n);
+            //get likelihood for y, from the summary data for extrinsic updates of a single source
+            if(delta && summary_data_match(model_x, model_y)) model_y->logL = summary_log_likelihood(data, model_y);
+            else if(delta) model_y->logL = model_x->logL + (*kernels->delta_log_likelihood)(data, model_x, model_y, n);
+            else model_y->logL = (*kernels->log_likelihood)(data, model_y);
+            model_y->Ndelta = (delta) ? model_x->Ndelta+1 : 0;
             
             /*
              H = [p(d|y)/p(d|x)]/T x p(y)/p(x) x q(x|y)/q(y|x)
@@ -255,21 +308,29 @@ void ucb_mcmc(struct Orbit *orbit, struct Data *data, struct Model *model, struc
         }
         logH += logPy  - logPx;  //priors
         logH += logQxy - logQyx; //proposals
+        logH -= logHs;           //screening stage
         
         loga = log(rand_r_U_0_1(&chain->r[ic]));
-        
-        if(isfinite(logH) && logH > loga)
-        {
-
-            proposal[nprop]->accept[ic]++;
-            copy_model_lite(model_y,model_x);
-
-        }
     }
+    
+    //x and y only differ in source n and its band of the model TDI
+    if(kernels->delta_log_likelihood_band && delta) record_model_update(data, model_x, model_y, n);
+    else model_y->update_flag = -1;
+    
+    if(logPy > -INFINITY && isfinite(logH) && logH > loga)
+    {
+        proposal[nprop]->accept[ic]++;
+        accept_model_update(model_y,model_x);
+    }
+    else reject_model_update(model_x,model_y);
+    
+    proposal[nprop]->time[ic] += omp_get_wtime() - start;
 }
 
-static void rj_birth_death(struct Orbit *orbit, struct Data *data, struct Model *model_x, struct Model *model_y, struct Chain *chain, struct Flags *flags, struct Prior *prior, struct Proposal *proposal, int ic, double *logQxy, double *logQyx, double *logPy, double *penalty)
+static void rj_birth_death(struct Orbit *orbit, struct Data *data, struct Model *model_x, struct Model *model_y, struct Chain *chain, struct Flags *flags, struct Prior *prior, struct Proposal *proposal, int ic, double *logQxy, double *logQyx, double *logPy, double *penalty, int *imin, int *imax)
 {
+    struct UCBKernels *kernels = &model_y->kernels;
+    
     /* pick birth or death move */
     if(rand_r_U_0_1(&chain->r[ic])<0.5)/* birth move */
     {
@@ -283,7 +344,9 @@ static void rj_birth_death(struct Orbit *orbit, struct Data *data, struct Model
         {
             //draw new parameters
             //TODO: insert draw from galaxy prior into draw_from_uniform_prior()
+            double prof = profile_start();
             *logQyx = (*proposal->function)(data, model_y, model_y->source[create], proposal, model_y->source[create]->params, &chain->r[ic]);
+            profile_stop(PROFILE_PROPOSAL, prof);
             *logQxy = 0;
             map_array_to_params(model_y->source[create], model_y->source[create]->params, data->T);
             
@@ -293,16 +356,20 @@ static void rj_birth_death(struct Orbit *orbit, struct Data *data, struct Model
                 *penalty = maximization_penalty(4,2*model_y->source[create]->BW);
             }
             
-            if(!strcmp("fourier",data->basis)) generate_signal_model(orbit, data, model_y, create);
-            if(!strcmp("wavelet",data->basis)) generate_signal_model_wavelet(orbit, data, model_y, create);
+            if(kernels->delta_log_likelihood_band)
+            {
+                (*kernels->update_signal)(orbit, data, model_x, model_y, create);
+                
+                //bins changed by the new source
+                *imin = model_y->source[create]->imin;
+                *imax = model_y->source[create]->imin + model_y->source[create]->BW;
+            }
+            else (*kernels->generate_signal)(orbit, data, model_y, create);
 
             //rejection sample on SNR?
             if(!flags->prior)
             {
-                double sn;
-                if(!strcmp("fourier",data->basis)) sn = snr(model_y->source[create], model_y->noise);
-                if(!strcmp("wavelet",data->basis)) sn = snr_wavelet(model_y->source[create], model_y->noise);
-                if(sn<5.0) *logPy = -INFINITY;
+                if((*kernels->snr)(model_y->source[create], model_y->noise) < 5.0) *logPy = -INFINITY;
             }
                 
 
@@ -317,13 +384,21 @@ static void rj_birth_death(struct Orbit *orbit, struct Data *data, struct Model
         
         //pick source to kill
         int kill = (int)(rand_r_U_0_1(&chain->r[ic])*(double)model_x->Nlive);
-        if(!strcmp("fourier",data->basis)) remove_signal_model(data, model_y,  model_y->source[kill]);
-        if(!strcmp("wavelet",data->basis)) remove_signal_model_wavelet(data, model_y, model_y->source[kill]);
+        (*kernels->remove_signal)(data, model_y, model_y->source[kill]);
+        
+        //bins changed by removing the source
+        if(kernels->delta_log_likelihood_band)
+        {
+            *imin = model_x->source[kill]->imin;
+            *imax = model_x->source[kill]->imin + model_x->source[kill]->BW;
+        }
         
         if(model_y->Nlive>-1)
         {
             *logQyx = 0;
+            double prof = profile_start();
             *logQxy = (*proposal->density)(data, model_y, model_y->source[kill], proposal, model_y->source[kill]->params);
+            profile_stop(PROFILE_PROPOSAL, prof);
             
             //consolodiate parameter structure
             for(int j=kill; j<model_y->Nlive; j++)
@@ -360,17 +435,7 @@ static void rj_split_merge(struct Orbit *orbit, struct Data *data, struct Model
         branch[0] = trunk;
         branch[1] = model_y->Nlive-1;
         
-        for(int n=0; n<data->N; n++)
-        {
-            for(int m=0; m<2; m++)
-            {
-                model_y->source[branch[m]]->tdi->X[n]=0.0;
-                model_y->source[branch[m]]->tdi->Y[n]=0.0;
-                model_y->source[branch[m]]->tdi->Z[n]=0.0;
-                model_y->source[branch[m]]->tdi->A[n]=0.0;
-                model_y->source[branch[m]]->tdi->E[n]=0.0;
-            }
-        }
+        for(int m=0; m<2; m++) clear_source_tdi(model_y->source[branch[m]], model_y->source[branch[m]]->tdi->N);
 
         
         if(model_y->Nlive<model_x->Neff)
@@ -379,7 +444,9 @@ static void rj_split_merge(struct Orbit *orbit, struct Data *data, struct Model
             //draw parameters for new sources (branches of trunk)
             for(int n=0; n<2; n++)
             {
+                double prof = profile_start();
                 *logQyx += (*proposal->function)(data, model_y, model_y->source[branch[n]], proposal, model_y->source[branch[n]]->params, &chain->r[ic]);
+                profile_stop(PROFILE_PROPOSAL, prof);
                 map_array_to_params(model_y->source[branch[n]], model_y->source[branch[n]]->params, data->T);
                 if(flags->maximize)
                 {
@@ -395,7 +462,9 @@ static void rj_split_merge(struct Orbit *orbit, struct Data *data, struct Model
             }
             
             //get reverse move (merge branches to trunk)
+            double prof = profile_start();
             *logQxy += (*proposal->density)(data, model_x, model_x->source[trunk], proposal, model_x->source[trunk]->params);
+            profile_stop(PROFILE_PROPOSAL, prof);
 
             if(flags->maximize)
             {
@@ -430,7 +499,9 @@ static void rj_split_merge(struct Orbit *orbit, struct Data *data, struct Model
             }
             
             //draw parameters of trunk
+            double prof = profile_start();
             *logQyx += (*proposal->function)(data, model_y, model_y->source[trunk], proposal, model_y->source[trunk]->params, &chain->r[ic]);
+            profile_stop(PROFILE_PROPOSAL, prof);
             map_array_to_params(model_y->source[trunk], model_y->source[trunk]->params, data->T);
             if(flags->maximize)
             {
@@ -447,7 +518,9 @@ static void rj_split_merge(struct Orbit *orbit, struct Data *data, struct Model
             //get reverse move (split trunk into branches)
             for(int n=0; n<2; n++)
             {
+                double prof = profile_start();
                 *logQxy += (*proposal->density)(data, model_x, model_x->source[branch[n]], proposal, model_x->source[branch[n]]->params);
+                profile_stop(PROFILE_PROPOSAL, prof);
                 
                 if(flags->maximize)
                 {
@@ -509,7 +582,9 @@ static void rj_cluster_bomb(struct Orbit *orbit, struct Data *data, struct Model
 
         
         //draw parameters and generate signal model for replacement
+        double prof = profile_start();
         *logQyx += (*proposal->function)(data, model_y, model_y->source[model_y->Nlive], proposal, model_y->source[model_y->Nlive]->params, &chain->r[ic]);
+        profile_stop(PROFILE_PROPOSAL, prof);
         
 
         if(flags->maximize)
@@ -532,7 +607,9 @@ static void rj_cluster_bomb(struct Orbit *orbit, struct Data *data, struct Model
         {
             if(C[n]==ckill)
             {
+                double prof = profile_start();
                 *logQxy += (*proposal->density)(data, model_x, model_x->source[n], proposal, model_x->source[n]->params);
+                profile_stop(PROFILE_PROPOSAL, prof);
                 if(flags->maximize)
                     *penalty += maximization_penalty(4,2*model_x->source[n]->BW);
             }
@@ -571,17 +648,25 @@ void ucb_rjmcmc(struct Orbit *orbit, struct Data *data, struct Model *model, str
     struct Model *model_x = model;
     struct Model *model_y = trial;
     
+    refresh_model(orbit, data, model_x, model_y, flags);
+    
     copy_model(model_x,model_y);
+    model_y->update_flag = -1;
     
     int nprop;
     do nprop = (int)floor((UCB_PROPOSAL_NPROP)*rand_r_U_0_1(&chain->r[ic]));
     while(proposal[nprop]->rjweight <= rand_r_U_0_1(&chain->r[ic]));
     
     proposal[nprop]->trial[ic]++;
+    double start = omp_get_wtime();
         
+    //frequency bins changed by the proposal
+    int imin = 0;
+    int imax = data->NFFT;
+    
     /* Choose birth/death move, or split/merge move */
     if( rand_r_U_0_1(&chain->r[ic]) < 1.5)/* birth/death move */
-        rj_birth_death(orbit, data, model_x, model_y, chain, flags, prior, proposal[nprop], ic, &logQxy, &logQyx, &logPy, &penalty);
+        rj_birth_death(orbit, data, model_x, model_y, chain, flags, prior, proposal[nprop], ic, &logQxy, &logQyx, &logPy, &penalty, &imin, &imax);
     else if( rand_r_U_0_1(&chain->r[ic]) < 1.5) /* birth/death move */
         rj_split_merge(orbit, data, model_x, model_y, chain, flags, prior, proposal[nprop], ic, &logQxy, &logQyx, &logPy, &penalty);
     else
@@ -610,9 +695,18 @@ void ucb_rjmcmc(struct Orbit *orbit, struct Data *data, struct Model *model, str
             apply_calibration_model(data, model_y);
         }
         
-        //get likelihood for y
-        if(!strcmp("fourier",data->basis)) model_y->logL = gaussian_log_likelihood(data, model_y);
-        if(!strcmp("wavelet",data->basis)) model_y->logL = gaussian_log_likelhood_wavelet(data, model_y);
+        //get likelihood for y, summing over the changed bins if the residual is up to date
+        struct UCBKernels *kernels = &model_y->kernels;
+        if(kernels->delta_log_likelihood_band && !flags->calibration)
+        {
+            model_y->logL = model_x->logL + (*kernels->delta_log_likelihood_band)(data, model_x, model_y, imin, imax);
+            model_y->Ndelta = model_x->Ndelta+1;
+        }
+        else
+        {
+            model_y->logL = (*kernels->log_likelihood)(data, model_y);
+            model_y->Ndelta = 0;
+        }
 
         //get likelihood difference
         dlogL = model_y->logL - model_x->logL;
@@ -659,7 +753,10 @@ void ucb_rjmcmc(struct Orbit *orbit, struct Data *data, struct Model *model, str
         }
         proposal[nprop]->accept[ic]++;
         copy_model(model_y,model_x);
+        model_y->update_flag = 0;
     }
+    
+    proposal[nprop]->time[ic] += omp_get_wtime() - start;
 }
 
 void initialize_ucb_state(struct Data *data, struct Orbit *orbit, struct Flags *flags, struct Chain *chain, struct Proposal **proposal, struct Model **model, struct Model **trial, struct Source **inj_vec)
@@ -717,8 +814,7 @@ void initialize_ucb_state(struct Data *data, struct Orbit *orbit, struct Flags *
             }
             map_array_to_params(model[ic]->source[n], model[ic]->source[n]->params, data->T);
 
-            if(!strcmp("fourier",data->basis)) ucb_fisher(orbit, data, model[ic]->source[n], data->noise);
-            if(!strcmp("wavelet",data->basis)) ucb_fisher_wavelet(orbit, data, model[ic]->source[n], data->noise);
+            (*model[ic]->kernels.fisher)(orbit, data, model[ic]->source[n], data->noise);
 
             model[ic]->source[n]->fisher_update_flag=0;
         }
@@ -731,16 +827,8 @@ void initialize_ucb_state(struct Data *data, struct Orbit *orbit, struct Flags *
         }
         
         // Form master model & compute likelihood of starting position
-        if(!strcmp("fourier",data->basis)) 
-        {
-            generate_noise_model(data, model[ic]);
-            generate_signal_model(orbit, data, model[ic], -1);
-        }
-        if(!strcmp("wavelet",data->basis)) 
-        {
-            generate_noise_model_wavelet(data, model[ic]);
-            generate_signal_model_wavelet(orbit, data, model[ic], -1);
-        }
+        (*model[ic]->kernels.generate_noise)(data, model[ic]);
+        (*model[ic]->kernels.generate_signal)(orbit, data, model[ic], -1);
 
         //calibration error
         if(flags->calibration)
@@ -751,17 +839,34 @@ void initialize_ucb_state(struct Data *data, struct Orbit *orbit, struct Flags *
         }
         if(!flags->prior)
         {
-            if(!strcmp("fourier",data->basis))model[ic]->logL = gaussian_log_likelihood(data, model[ic]);
-            if(!strcmp("wavelet",data->basis))model[ic]->logL = gaussian_log_likelhood_wavelet(data, model[ic]);
+            model[ic]->logL = (*model[ic]->kernels.log_likelihood)(data, model[ic]);
             model[ic]->logLnorm = gaussian_log_likelihood_model_norm(data,model[ic]);
         
         }
         else model[ic]->logL = model[ic]->logLnorm = 0.0;
         
+        //likelihood from summary data for single-source models
+        if(flags->summaryLogL && !strcmp("fourier",data->basis))
+        {
+            model[ic]->summary = malloc(sizeof(struct SummaryData));
+            alloc_summary_data(data, model[ic]->summary, model[ic]->noise);
+            trial[ic]->summary = model[ic]->summary;
+        }
+        
         if(ic==0) chain->logLmax += model[ic]->logL + model[ic]->logLnorm;
         
     }//end loop over chains
 
 }
 
+void free_ucb_state(struct Model **model, struct Model **trial, int NC)
+{
+    for(int ic=0; ic<NC; ic++)
+    {
+        //summary data are shared with the trial model
+        if(model[ic]->summary) free_summary_data(model[ic]->summary);
+        model[ic]->summary = trial[ic]->summary = NULL;
+    }
+}
+
 
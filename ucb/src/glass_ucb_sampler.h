@@ -76,4 +76,12 @@ void noise_model_mcmc(struct Orbit *orbit, struct Data *data, struct Model *mode
  */
 void initialize_ucb_state(struct Data *data, struct Orbit *orbit, struct Flags *flags, struct Chain *chain, struct Proposal **proposal, struct Model **model, struct Model **trial, struct Source **inj_vec);
 
+/**
+ \brief Free UCB sampler state
+ 
+ Releases the per-chain summary data allocated by initialize_ucb_state().
+ The summary is shared by each model and its trial, so it is freed once through model[ic].
+ */
+void free_ucb_state(struct Model **model, struct Model **trial, int NC);
+
 #endif /* ucb_sampler_h */
@@ -25,29 +25,69 @@ double analytic_snr(double A, double Sn, double Sf, double sqT)
     return A*sqT*Sf/sqrt(Sn); //not exactly what's in paper--calibrated against (h|h)
 }
 
-double snr(struct Source *source, struct Noise *noise)
+/* Noise weighted inner product of band-local responses starting at segment bin imin */
+static double band_nwip(double *a, double *b, double *invC, int imin, int N, int Nnoise)
+{
+    double arg = 0.0;
+    for(int i=0; i<N; i++)
+    {
+        //bins off the edge of the segment use the nearest noise level
+        int k = i+imin;
+        if(k < 0) k = 0;
+        if(k > Nnoise-1) k = Nnoise-1;
+        
+        arg += (a[2*i]*b[2*i] + a[2*i+1]*b[2*i+1])*invC[k];
+    }
+    return 2.0*arg;
+}
+
+/* SNR^2 summed over Nchannel TDI channels, called with a constant Nchannel so each case compiles separately */
+static inline double snr2_channels(struct Source *source, struct Noise *noise, const int Nchannel)
 {
     double snr2=0.0;
-    switch(source->tdi->Nchannel)
+    int imin = source->imin;
+    int N = source->BW;
+    
+    switch(Nchannel)
     {
         case 1: //Michelson
-            snr2 += fourier_nwip(source->tdi->X,source->tdi->X,noise->invC[0][0],source->tdi->N/2);
+            snr2 += band_nwip(source->tdi->X,source->tdi->X,noise->invC[0][0],imin,N,noise->N);
             break;
         case 2: //A&E
-            snr2 += fourier_nwip(source->tdi->A,source->tdi->A,noise->invC[0][0],source->tdi->N/2);
-            snr2 += fourier_nwip(source->tdi->E,source->tdi->E,noise->invC[1][1],source->tdi->N/2);
+            snr2 += band_nwip(source->tdi->A,source->tdi->A,noise->invC[0][0],imin,N,noise->N);
+            snr2 += band_nwip(source->tdi->E,source->tdi->E,noise->invC[1][1],imin,N,noise->N);
             break;
         case 3: //XYZ
-            snr2 += fourier_nwip(source->tdi->X,source->tdi->X,noise->invC[0][0],source->tdi->N/2);
-            snr2 += fourier_nwip(source->tdi->Y,source->tdi->Y,noise->invC[1][1],source->tdi->N/2);
-            snr2 += fourier_nwip(source->tdi->Z,source->tdi->Z,noise->invC[2][2],source->tdi->N/2);
-            snr2 += fourier_nwip(source->tdi->X,source->tdi->Y,noise->invC[0][1],source->tdi->N/2)*2.;
-            snr2 += fourier_nwip(source->tdi->X,source->tdi->Z,noise->invC[0][2],source->tdi->N/2)*2.;
-            snr2 += fourier_nwip(source->tdi->Y,source->tdi->Z,noise->invC[1][2],source->tdi->N/2)*2.;
+            snr2 += band_nwip(source->tdi->X,source->tdi->X,noise->invC[0][0],imin,N,noise->N);
+            snr2 += band_nwip(source->tdi->Y,source->tdi->Y,noise->invC[1][1],imin,N,noise->N);
+            snr2 += band_nwip(source->tdi->Z,source->tdi->Z,noise->invC[2][2],imin,N,noise->N);
+            snr2 += band_nwip(source->tdi->X,source->tdi->Y,noise->invC[0][1],imin,N,noise->N)*2.;
+            snr2 += band_nwip(source->tdi->X,source->tdi->Z,noise->invC[0][2],imin,N,noise->N)*2.;
+            snr2 += band_nwip(source->tdi->Y,source->tdi->Z,noise->invC[1][2],imin,N,noise->N)*2.;
             break;
     }
     
-    return(sqrt(snr2));
+    return snr2;
+}
+
+double snr_X(struct Source *source, struct Noise *noise)
+{
+    return sqrt(snr2_channels(source, noise, 1));
+}
+
+double snr_AE(struct Source *source, struct Noise *noise)
+{
+    return sqrt(snr2_channels(source, noise, 2));
+}
+
+double snr_XYZ(struct Source *source, struct Noise *noise)
+{
+    return sqrt(snr2_channels(source, noise, 3));
+}
+
+double snr(struct Source *source, struct Noise *noise)
+{
+    return(sqrt(snr2_channels(source, noise, source->tdi->Nchannel)));
 }
 
 double snr_wavelet(struct Source *source, struct Noise *noise)
@@ -126,64 +166,38 @@ double snr_prior(double SNR)
     return (3.*SNR)/(4.*SNRPEAK*SNRPEAK*dfac5);
 }
 
+/* Place the band-local A and E responses of a and b on their common band, returns its width */
+static int align_source_bands(struct Source *a, struct Source *b, int *imin, double **a_A, double **a_E, double **b_A, double **b_E)
+{
+    int i0 = (a->imin < b->imin) ? a->imin : b->imin;
+    int i1 = (a->imin+a->BW > b->imin+b->BW) ? a->imin+a->BW : b->imin+b->BW;
+    int N  = i1-i0;
+    
+    *a_A = calloc(2*N,sizeof(double));
+    *a_E = calloc(2*N,sizeof(double));
+    *b_A = calloc(2*N,sizeof(double));
+    *b_E = calloc(2*N,sizeof(double));
+    
+    memcpy(*a_A + 2*(a->imin-i0), a->tdi->A, 2*a->BW*sizeof(double));
+    memcpy(*a_E + 2*(a->imin-i0), a->tdi->E, 2*a->BW*sizeof(double));
+    memcpy(*b_A + 2*(b->imin-i0), b->tdi->A, 2*b->BW*sizeof(double));
+    memcpy(*b_E + 2*(b->imin-i0), b->tdi->E, 2*b->BW*sizeof(double));
+    
+    *imin = i0;
+    return N;
+}
+
 double waveform_match(struct Source *a, struct Source *b, struct Noise *noise)
 {
-    int N = a->tdi->N;
-    int NFFT = 2*N;
-    double match=0;
+    int imin;
+    double *a_A, *a_E, *b_A, *b_E;
+    int N = align_source_bands(a, b, &imin, &a_A, &a_E, &b_A, &b_E);
     
-    double *a_A = calloc(NFFT,sizeof(double));
-    double *a_E = calloc(NFFT,sizeof(double));
-    double *b_A = calloc(NFFT,sizeof(double));
-    double *b_E = calloc(NFFT,sizeof(double));
+    double aa = band_nwip(a_A,a_A,noise->invC[0][0],imin,N,noise->N) + band_nwip(a_E,a_E,noise->invC[1][1],imin,N,noise->N);
+    double bb = band_nwip(b_A,b_A,noise->invC[0][0],imin,N,noise->N) + band_nwip(b_E,b_E,noise->invC[1][1],imin,N,noise->N);
+    double ab = band_nwip(a_A,b_A,noise->invC[0][0],imin,N,noise->N) + band_nwip(a_E,b_E,noise->invC[1][1],imin,N,noise->N);
     
-    int qmin = a->qmin - a->imin;
-    
-    
-    //Align waveforms into arrays for summing
-    for(int i=0; i<a->BW; i++)
-    {
-        int j = i+a->qmin-qmin;
-        
-        if(j>-1 && j<N)
-        {
-            int i_re = 2*i;
-            int i_im = i_re+1;
-            int j_re = 2*j;
-            int j_im = j_re+1;
-            
-            a_A[j_re] = a->tdi->A[i_re];
-            a_A[j_im] = a->tdi->A[i_im];
-            a_E[j_re] = a->tdi->E[i_re];
-            a_E[j_im] = a->tdi->E[i_im];
-        }//check that index is in range
-    }//loop over waveform bins
-    
-    //Align waveforms into arrays for summing
-    for(int i=0; i<b->BW; i++)
-    {
-        int j = i+b->qmin-qmin;
-        
-        if(j>-1 && j<N)
-        {
-            int i_re = 2*i;
-            int i_im = i_re+1;
-            int j_re = 2*j;
-            int j_im = j_re+1;
-            
-            b_A[j_re] = b->tdi->A[i_re];
-            b_A[j_im] = b->tdi->A[i_im];
-            b_E[j_re] = b->tdi->E[i_re];
-            b_E[j_im] = b->tdi->E[i_im];
-        }//check that index is in range
-    }//loop over waveform bins
-    
-    
-    double aa = fourier_nwip(a_A,a_A,noise->invC[0][0],N) + fourier_nwip(a_E,a_E,noise->invC[1][1],N);
-    double bb = fourier_nwip(b_A,b_A,noise->invC[0][0],N) + fourier_nwip(b_E,b_E,noise->invC[1][1],N);
-    double ab = fourier_nwip(a_A,b_A,noise->invC[0][0],N) + fourier_nwip(a_E,b_E,noise->invC[1][1],N);
-    
-    match = ab/sqrt(aa*bb);
+    double match = ab/sqrt(aa*bb);
     
     free(a_A);
     free(a_E);
@@ -195,68 +209,22 @@ double waveform_match(struct Source *a, struct Source *b, struct Noise *noise)
 
 double waveform_distance(struct Source *a, struct Source *b, struct Noise *noise)
 {
-  int N = a->tdi->N;
-  int NFFT = 2*N;
-
-  double *a_A = calloc(NFFT,sizeof(double));
-  double *a_E = calloc(NFFT,sizeof(double));
-  double *b_A = calloc(NFFT,sizeof(double));
-  double *b_E = calloc(NFFT,sizeof(double));
-
-  int qmin = a->qmin - a->imin;
-
-
-  //Align waveforms into arrays for summing
-  for(int i=0; i<a->BW; i++)
-  {
-    int j = i+a->qmin-qmin;
+    int imin;
+    double *a_A, *a_E, *b_A, *b_E;
+    int N = align_source_bands(a, b, &imin, &a_A, &a_E, &b_A, &b_E);
     
-    if(j>-1 && j<N)
-    {
-      int i_re = 2*i;
-      int i_im = i_re+1;
-      int j_re = 2*j;
-      int j_im = j_re+1;
-      
-      a_A[j_re] = a->tdi->A[i_re];
-      a_A[j_im] = a->tdi->A[i_im];
-      a_E[j_re] = a->tdi->E[i_re];
-      a_E[j_im] = a->tdi->E[i_im];
-    }//check that index is in range
-  }//loop over waveform bins
-
-  //Align waveforms into arrays for summing
-  for(int i=0; i<b->BW; i++)
-  {
-    int j = i+b->qmin-qmin;
-    
-    if(j>-1 && j<N)
-    {
-      int i_re = 2*i;
-      int i_im = i_re+1;
-      int j_re = 2*j;
-      int j_im = j_re+1;
-      
-      b_A[j_re] = b->tdi->A[i_re];
-      b_A[j_im] = b->tdi->A[i_im];
-      b_E[j_re] = b->tdi->E[i_re];
-      b_E[j_im] = b->tdi->E[i_im];
-    }//check that index is in range
-  }//loop over waveform bins
-
-  
-    double aa = fourier_nwip(a_A,a_A,noise->invC[0][0],N) + fourier_nwip(a_E,a_E,noise->invC[1][1],N);
-    double bb = fourier_nwip(b_A,b_A,noise->invC[0][0],N) + fourier_nwip(b_E,b_E,noise->invC[1][1],N);
-    double ab = fourier_nwip(a_A,b_A,noise->invC[0][0],N) + fourier_nwip(a_E,b_E,noise->invC[1][1],N);
-
-  double distance = (aa + bb - 2*ab)/4.;
-
-  free(a_A);
-  free(a_E);
-  free(b_A);
-  free(b_E);
-  
-  return distance;
+    double aa = band_nwip(a_A,a_A,noise->invC[0][0],imin,N,noise->N) + band_nwip(a_E,a_E,noise->invC[1][1],imin,N,noise->N);
+    double bb = band_nwip(b_A,b_A,noise->invC[0][0],imin,N,noise->N) + band_nwip(b_E,b_E,noise->invC[1][1],imin,N,noise->N);
+    double ab = band_nwip(a_A,b_A,noise->invC[0][0],imin,N,noise->N) + band_nwip(a_E,b_E,noise->invC[1][1],imin,N,noise->N);
+    
+    double distance = (aa + bb - 2*ab)/4.;
+    
+    free(a_A);
+    free(a_E);
+    free(b_A);
+    free(b_E);
+    
+    return distance;
 }
 
 double ucb_fdot(double Mc, double f0)
@@ -320,22 +288,6 @@ void ucb_fisher(struct Orbit *orbit, struct Data *data, struct Source *source, s
 {
     //TODO:  ucb_fisher should compute joint Fisher
     int i,j,n;
-        
-    double epsilon    = 1.0e-6;
-    //double invepsilon2= 1./(2.*epsilon);
-    double invepsilon2= 1./(epsilon);
-    double invstep;
-    
-    // Plus and minus parameters:
-    double *params_p = calloc(UCB_MODEL_NP,sizeof(double));
-    //double *params_m = calloc(NP,sizeof(double));
-    
-    // Plus and minus templates for each detector:
-    struct Source *wave_p = malloc(sizeof(struct Source));
-    //struct Source *wave_m = malloc(sizeof(struct Source));
-    alloc_source(wave_p, data->N, data->Nchannel);
-
-    //alloc_source(wave_m, data->N, data->Nchannel, NP);
     
     // TDI variables to hold derivatives of h
     struct TDI **dhdx = malloc(UCB_MODEL_NP*sizeof(struct TDI *));
@@ -345,84 +297,11 @@ void ucb_fisher(struct Orbit *orbit, struct Data *data, struct Source *source, s
         alloc_tdi(dhdx[n], data->N, data->Nchannel);
     }
     
-    /* assumes all the parameters are log or angle */
-    for(i=0; i<UCB_MODEL_NP; i++)
-    {
-        //step size for derivatives
-        invstep = invepsilon2;
-        
-        // copy parameters
-        for(j=0; j<UCB_MODEL_NP; j++)
-        {
-            wave_p->params[j] = source->params[j];
-            //wave_m->params[j] = source->params[j];
-        }
-        
-        // perturb parameters
-        wave_p->params[i] += epsilon;
-        //wave_m->params[i] -= epsilon;
-        
-	    // catch when cosine parameters get pushed out of bounds
-        if(i==1 || i==4)
-        {
-            if(wave_p->params[i] > 1.0) wave_p->params[i] = 1.0;
-            //if(wave_m->params[i] <-1.0) wave_m->params[i] =-1.0;
-        }
-
-        // complete info in source structure
-        map_array_to_params(wave_p, wave_p->params, data->T);
-        //map_array_to_params(wave_m, wave_m->params, data->T);
-        
-        // clean up TDI arrays, just in case
-        for(j=0; j<data->N; j++)
-        {
-            wave_p->tdi->X[j]=0.0;
-            wave_p->tdi->Y[j]=0.0;
-            wave_p->tdi->Z[j]=0.0;
-            wave_p->tdi->A[j]=0.0;
-            wave_p->tdi->E[j]=0.0;
-//            wave_m->tdi->X[j]=0.0;
-//            wave_m->tdi->Y[j]=0.0;
-//            wave_m->tdi->Z[j]=0.0;
-//            wave_m->tdi->A[j]=0.0;
-//            wave_m->tdi->E[j]=0.0;
-        }
-        
-        // align perturbed waveforms in data array
-        ucb_alignment(orbit, data, wave_p);
-        //ucb_alignment(orbit, data, wave_m);
-        
-        // compute perturbed waveforms
-        ucb_waveform(orbit, data->format, data->T, data->t0, wave_p->params, UCB_MODEL_NP, wave_p->tdi->X, wave_p->tdi->Y, wave_p->tdi->Z, wave_p->tdi->A, wave_p->tdi->E, wave_p->BW, wave_p->tdi->Nchannel);
-        //ucb_waveform(orbit, data->format, data->T, data->t0, wave_m->params, UCB_MODEL_NP, wave_m->tdi->X, wave_m->tdi->Y, wave_m->tdi->Z, wave_m->tdi->A, wave_m->tdi->E, wave_m->BW, wave_m->tdi->Nchannel);
-
-        // central differencing derivatives of waveforms w.r.t. parameters
-        switch(source->tdi->Nchannel)
-        {
-            case 1:
-                for(n=0; n<wave_p->BW*2; n++)
-                {
-                    dhdx[i]->X[n] = (wave_p->tdi->X[n] - source->tdi->X[n])*invstep;
-                }
-                break;
-            case 2:
-                for(n=0; n<wave_p->BW*2; n++)
-                {
-                    dhdx[i]->A[n] = (wave_p->tdi->A[n] - source->tdi->A[n])*invstep;
-                    dhdx[i]->E[n] = (wave_p->tdi->E[n] - source->tdi->E[n])*invstep;
-                }
-                break;
-            case 3:
-                for(n=0; n<wave_p->BW*2; n++)
-                {
-                    dhdx[i]->X[n] = (wave_p->tdi->X[n] - source->tdi->X[n])*invstep;
-                    dhdx[i]->Y[n] = (wave_p->tdi->Y[n] - source->tdi->Y[n])*invstep;
-                    dhdx[i]->Z[n] = (wave_p->tdi->Z[n] - source->tdi->Z[n])*invstep;
-                }
-                break;
-
-        }
-    }
+    // bandwidth of source, which may not have been aligned with the data yet
+    int BW = 2*ucb_bandwidth(orbit->L, orbit->fstar, source->f0, source->dfdt, source->costheta, source->amp, data->T, data->NFFT);
+    
+    // analytic derivatives of waveform w.r.t. parameters, all in one pass
+    ucb_waveform_derivatives(orbit, data->format, data->T, data->t0, source->params, UCB_MODEL_NP, NULL, dhdx, BW, source->tdi->Nchannel);
     
     // Calculate fisher matrix
     for(i=0; i<UCB_MODEL_NP; i++)
@@ -432,22 +311,22 @@ void ucb_fisher(struct Orbit *orbit, struct Data *data, struct Source *source, s
             switch(source->tdi->Nchannel)
             {
                 case 1:
-                    source->fisher_matrix[i][j] = fourier_nwip(dhdx[i]->X, dhdx[j]->X, noise->invC[0][0], wave_p->BW);
+                    source->fisher_matrix[i][j] = fourier_nwip(dhdx[i]->X, dhdx[j]->X, noise->invC[0][0], BW);
                     break;
                 case 2:
-                    source->fisher_matrix[i][j] = fourier_nwip(dhdx[i]->A, dhdx[j]->A, noise->invC[0][0], wave_p->BW);
-                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->E, dhdx[j]->E, noise->invC[1][1], wave_p->BW);
+                    source->fisher_matrix[i][j] = fourier_nwip(dhdx[i]->A, dhdx[j]->A, noise->invC[0][0], BW);
+                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->E, dhdx[j]->E, noise->invC[1][1], BW);
                     break;
                 case 3:
-                    source->fisher_matrix[i][j] = fourier_nwip(dhdx[i]->X, dhdx[j]->X, noise->invC[0][0], wave_p->BW);
-                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->Y, dhdx[j]->Y, noise->invC[1][1], wave_p->BW);
-                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->Z, dhdx[j]->Z, noise->invC[2][2], wave_p->BW);
-                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->X, dhdx[j]->Y, noise->invC[0][1], wave_p->BW);
-                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->X, dhdx[j]->Z, noise->invC[0][2], wave_p->BW);
-                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->Y, dhdx[j]->Z, noise->invC[1][2], wave_p->BW);
-                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->Y, dhdx[j]->X, noise->invC[1][0], wave_p->BW);
-                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->Z, dhdx[j]->X, noise->invC[2][0], wave_p->BW);
-                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->Z, dhdx[j]->Y, noise->invC[2][1], wave_p->BW);
+                    source->fisher_matrix[i][j] = fourier_nwip(dhdx[i]->X, dhdx[j]->X, noise->invC[0][0], BW);
+                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->Y, dhdx[j]->Y, noise->invC[1][1], BW);
+                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->Z, dhdx[j]->Z, noise->invC[2][2], BW);
+                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->X, dhdx[j]->Y, noise->invC[0][1], BW);
+                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->X, dhdx[j]->Z, noise->invC[0][2], BW);
+                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->Y, dhdx[j]->Z, noise->invC[1][2], BW);
+                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->Y, dhdx[j]->X, noise->invC[1][0], BW);
+                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->Z, dhdx[j]->X, noise->invC[2][0], BW);
+                    source->fisher_matrix[i][j] += fourier_nwip(dhdx[i]->Z, dhdx[j]->Y, noise->invC[2][1], BW);
                     break;
             }
             if(source->fisher_matrix[i][j]!=source->fisher_matrix[i][j])
@@ -467,11 +346,6 @@ void ucb_fisher(struct Orbit *orbit, struct Data *data, struct Source *source, s
     // Calculate eigenvalues and eigenvectors of fisher matrix
     matrix_eigenstuff(source->fisher_matrix, source->fisher_evectr, source->fisher_evalue, UCB_MODEL_NP);
     
-    free(params_p);
-    //free(params_m);
-    free_source(wave_p);
-    //free_source(wave_m);
-    
     for(n=0; n<UCB_MODEL_NP; n++) free_tdi(dhdx[n]);
     free(dhdx);
 }
@@ -490,7 +364,8 @@ void ucb_fisher_wavelet(struct Orbit *orbit, struct Data *data, struct Source *s
     
     // Plus and minus templates for each detector:
     struct Source *wave_p = malloc(sizeof(struct Source));
-    alloc_source(wave_p, data->N, data->Nchannel);
+    alloc_source(wave_p, data->Nchannel);
+    clear_source_tdi(wave_p, data->N);
     
     // TDI variables to hold derivatives of h
     struct TDI **dhdx = malloc(UCB_MODEL_NP*sizeof(struct TDI *));
@@ -503,6 +378,19 @@ void ucb_fisher_wavelet(struct Orbit *orbit, struct Data *data, struct Source *s
     /* assumes all the parameters are log or angle */
     for(i=0; i<UCB_MODEL_NP; i++)
     {
+        // waveform is linear in amplitude so dh/dlogA = h
+        if(i==3)
+        {
+            for(n=0; n<source->Nlist; n++)
+            {
+                int k = source->list[n];
+                dhdx[i]->X[k] = source->tdi->X[k];
+                dhdx[i]->Y[k] = source->tdi->Y[k];
+                dhdx[i]->Z[k] = source->tdi->Z[k];
+            }
+            continue;
+        }
+        
         //step size for derivatives
         invstep = invepsilon2;
         
@@ -588,6 +476,14 @@ void ucb_fisher_wavelet(struct Orbit *orbit, struct Data *data, struct Source *s
     free(dhdx);
 }
 
+int ucb_max_bandwidth(int N)
+{
+    int Nmin = 16;
+    int Nmax = (int)pow(2,(int)log2((double)(N/2)));
+    
+    return (Nmax > Nmin) ? Nmax : Nmin;
+}
+
 int ucb_bandwidth(double L, double fstar, double f, double fdot, double costheta, double A, double T, int N)
 {
     int Nmin = 16;
@@ -628,22 +524,203 @@ void ucb_alignment(struct Orbit *orbit, struct Data *data, struct Source *source
     source->imax = source->imin + source->BW;  
 }
 
-void ucb_waveform(struct Orbit *orbit, char *format, double T, double t0, double *params, int NParams, double *X, double *Y, double *Z, double *A, double *E, int BW, int NI)
+/* Scratch memory for ucb_waveform_kernel() sized for bandwidths up to BW */
+struct UCBWaveformWorkspace
+{
+    int BW;             //largest bandwidth the workspace can hold
+    int Nderiv;         //number of parameter derivatives the workspace can hold
+    double *x, *y, *z;  //spacecraft positions
+    double *work;       //per-link transfer function pieces
+    double *dwork;      //per-link derivatives of transfer function pieces
+    double *data[6];    //slowly evolving time series for links 12, 13, 21, 23, 31, 32
+    double ***d;        //slowly evolving Fourier coefficients packaged for TDI subroutines
+    int Nfft;           //size of cached FFT plan
+    kiss_fft_cfg fft;   //cached FFT plan
+    kiss_fft_cpx *fft_in, *fft_out; //FFT buffers
+};
+
+struct UCBWaveformWorkspace *alloc_ucb_waveform_workspace(int BW, int Nderiv)
+{
+    struct UCBWaveformWorkspace *ws = malloc(sizeof(struct UCBWaveformWorkspace));
+    
+    int BW2 = 2*BW;
+    
+    ws->BW = BW;
+    ws->Nderiv = Nderiv;
+    ws->x = calloc(4,sizeof(double));
+    ws->y = calloc(4,sizeof(double));
+    ws->z = calloc(4,sizeof(double));
+    ws->work = malloc(60*BW*sizeof(double));
+    ws->dwork = (Nderiv>0) ? malloc(24*Nderiv*BW*sizeof(double)) : NULL;
+    for(int m=0; m<6; m++) ws->data[m] = calloc((BW2+1),sizeof(double));
+    
+    ws->Nfft = 0;
+    ws->fft = NULL;
+    ws->fft_in  = malloc(BW*sizeof(kiss_fft_cpx));
+    ws->fft_out = malloc(BW*sizeof(kiss_fft_cpx));
+    
+    ws->d = malloc(sizeof(double**)*4);
+    for(int i=0; i<4; i++)
+    {
+        ws->d[i] = malloc(sizeof(double*)*4);
+        for(int j=0; j<4; j++) ws->d[i][j] = calloc((BW2+1),sizeof(double));
+    }
+    
+    return ws;
+}
+
+void free_ucb_waveform_workspace(struct UCBWaveformWorkspace *ws)
+{
+    free(ws->x);
+    free(ws->y);
+    free(ws->z);
+    free(ws->work);
+    if(ws->dwork) free(ws->dwork);
+    for(int m=0; m<6; m++) free(ws->data[m]);
+    if(ws->fft) kiss_fft_free(ws->fft);
+    free(ws->fft_in);
+    free(ws->fft_out);
+    for(int i=0; i<4; i++)
+    {
+        for(int j=0; j<4; j++) free(ws->d[i][j]);
+        free(ws->d[i]);
+    }
+    free(ws->d);
+    free(ws);
+}
+
+/*
+ Derivatives of the LDC convention polarization tensors and propagation
+ direction from LISA_polarization_tensor() w.r.t. [0] costh and [1] phi
+ */
+static void ucb_polarization_tensor_derivatives(double costh, double phi, double deplus[2][4][4], double decross[2][4][4], double dk[2][4])
+{
+    double u[4],v[4];
+    double du[2][4],dv[2][4];
+    
+    //keep clear of the poles where dsinth/dcosth diverges
+    if(costh >  0.999999) costh =  0.999999;
+    if(costh < -0.999999) costh = -0.999999;
+    
+    double sinth = sqrt(1.0 - costh*costh);
+    double cosph = cos(phi);
+    double sinph = sin(phi);
+    double cotth = costh/sinth;
+    
+    u[1] =  costh*cosph;  u[2] =  costh*sinph;  u[3] = -sinth;
+    v[1] =  sinph;        v[2] = -cosph;        v[3] =  0.;
+    
+    //d/dcosth
+    du[0][1] =  cosph;        du[0][2] =  sinph;        du[0][3] = cotth;
+    dv[0][1] =  0.;           dv[0][2] =  0.;           dv[0][3] = 0.;
+    dk[0][1] =  cotth*cosph;  dk[0][2] =  cotth*sinph;  dk[0][3] = -1.;
+    
+    //d/dphi
+    du[1][1] = -costh*sinph;  du[1][2] =  costh*cosph;  du[1][3] = 0.;
+    dv[1][1] =  cosph;        dv[1][2] =  sinph;        dv[1][3] = 0.;
+    dk[1][1] =  sinth*sinph;  dk[1][2] = -sinth*cosph;  dk[1][3] = 0.;
+    
+    for(int s=0; s<2; s++)
+    {
+        for(int i=1;i<=3;i++)
+        {
+            for(int j=1;j<=3;j++)
+            {
+                deplus[s][i][j]  = dv[s][i]*v[j] + v[i]*dv[s][j] - du[s][i]*u[j] - u[i]*du[s][j];
+                decross[s][i][j] = du[s][i]*v[j] + u[i]*dv[s][j] + dv[s][i]*u[j] + v[i]*du[s][j];
+            }
+        }
+    }
+}
+
+/* In-place forward complex FFT, as glass_forward_complex_fft(), reusing the workspace plan */
+static void ucb_workspace_fft(struct UCBWaveformWorkspace *ws, double *data, int N)
+{
+    if(ws->Nfft != N)
+    {
+        if(ws->fft) kiss_fft_free(ws->fft);
+        ws->fft  = kiss_fft_alloc(N, 0, NULL, NULL);
+        ws->Nfft = N;
+    }
+    
+    for(int i=0; i<N; i++)
+    {
+        ws->fft_in[i].r = data[2*i];
+        ws->fft_in[i].i = data[2*i+1];
+    }
+    
+    double prof = profile_start();
+    kiss_fft(ws->fft, ws->fft_in, ws->fft_out);
+    profile_stop_count(PROFILE_FFT, prof, N);
+    
+    for(int i=0; i<N; i++)
+    {
+        data[2*i]   = ws->fft_out[i].r;
+        data[2*i+1] = ws->fft_out[i].i;
+    }
+}
+
+/* FFT the slowly evolving link responses and combine into TDI channels */
+static void ucb_slow_response_to_tdi(struct Orbit *orbit, LISA_tdi_function tdi, double T, double f0, long q, double *TR, double *TI, double *X, double *Y, double *Z, double *A, double *E, int BW, int NI, struct UCBWaveformWorkspace *ws)
+{
+    int i,j,n,m;
+    double invBW2 = 1./(double)(2*BW);
+    double **dataij = ws->data;
+    double ***d = ws->d;
+    
+    //Fill  time series data arrays with slowly evolving signal->
+    //dataij corresponds to fractional arm length difference yij
+    for(n=1; n<=BW; n++)
+    {
+        j = 2*n;
+        i = j-1;
+        for(m=0; m<6; m++)
+        {
+            dataij[m][i] = TR[6*(n-1)+m];
+            dataij[m][j] = TI[6*(n-1)+m];
+        }
+    }
+    
+    /*   Numerical Fourier transform of slowly evolving signal */
+    for(m=0; m<6; m++) ucb_workspace_fft(ws, dataij[m]+1, BW);
+    
+    //Unpack arrays from fft and normalize
+    for(i=1; i<=BW; i++)
+    {
+        j = i + BW;
+        d[1][2][i] = dataij[0][j]*invBW2;  d[2][1][i] = dataij[2][j]*invBW2;  d[3][1][i] = dataij[4][j]*invBW2;
+        d[1][2][j] = dataij[0][i]*invBW2;  d[2][1][j] = dataij[2][i]*invBW2;  d[3][1][j] = dataij[4][i]*invBW2;
+        d[1][3][i] = dataij[1][j]*invBW2;  d[2][3][i] = dataij[3][j]*invBW2;  d[3][2][i] = dataij[5][j]*invBW2;
+        d[1][3][j] = dataij[1][i]*invBW2;  d[2][3][j] = dataij[3][i]*invBW2;  d[3][2][j] = dataij[5][i]*invBW2;
+    }
+    
+    /*   Call subroutine for synthesizing the TDI data channels  */
+    tdi(orbit->L, orbit->fstar, T, d, f0, q, X-1, Y-1, Z-1, A-1, E-1, BW, NI);
+}
+
+/*
+ Fast-slow waveform for a single source using caller-owned scratch memory.
+ If sc is not NULL it holds spacecraft positions {x1,x2,x3,y1,y2,y3,z1,z2,z3}
+ tabulated on a time grid stride times finer than the source's BW samples.
+ If geo is not NULL it replaces sc with the sky dependent pieces of the
+ response tabulated on the same finer grid, and must not be used with dhdp.
+ If dhdp is not NULL the derivatives w.r.t. the first NParams parameters
+ are propagated through the same pass.  If filter is not NULL the responses
+ to unit DPr, DPi, DCr, DCi with phi0=0 are returned instead of the waveform.
+ */
+static void ucb_waveform_kernel(struct Orbit *orbit, LISA_tdi_function tdi, double T, double t0, double *params, int NParams, double *X, double *Y, double *Z, double *A, double *E, struct TDI **dhdp, struct TDI **filter, int BW, int NI, struct UCBWaveformWorkspace *ws, double *sc, struct UCBSkyGeometry *geo, int stride)
 {
     /*   Indicies   */
-    int i,j,n;
+    int i,j,n,m,p;
     /*   Carrier frequency bin  */
     long q;
-    /*   Bandwidth      */
-    int BW2   = BW*2;
-    double invBW2 = 1./(double)BW2;
     
     /*   Gravitational Wave location vector   */
     double k[4];
     /*   Polarization basis tensors   */
     double eplus[4][4], ecross[4][4];
     /*   Spacecraft position and separation vector   */
-    double *x, *y, *z;
+    double *x = ws->x, *y = ws->y, *z = ws->z;
     /*   Dot products   */
     double kdotx[4]={0},kdotr[4][4];
     /*   Convenient quantities   */
@@ -659,38 +736,23 @@ void ucb_waveform(struct Orbit *orbit, char *format, double T, double t0, double
     //Static quantities (Re and Im)
     double DPr, DPi, DCr, DCi;
     //Time varrying quantities (Re & Im) broken up into convenient segments
-    double TR[4][4], TI[4][4];
+    double *TR, *TI;
     //Miscellaneous constants used to speed up calculations
     double df;
-    /*   Fourier coefficients before FFT and after convolution  */
-    //Time series of slowly evolving terms at each vertex
-    double *data12, *data13, *data21, *data23, *data31, *data32;
-    //Fourier coefficients of slowly evolving terms (numerical)
-    double a12[BW2+3], a13[BW2+3], a21[BW2+3], a23[BW2+3], a31[BW2+3], a32[BW2+3];
-    //Package cij's into proper form for TDI subroutines
-    double ***d;
-    
-    /*   Allocating Arrays   */
-    x = calloc(4,sizeof(double));
-    y = calloc(4,sizeof(double));
-    z = calloc(4,sizeof(double));
-    
-    data12 = calloc((BW2+1),sizeof(double));
-    data21 = calloc((BW2+1),sizeof(double));
-    data31 = calloc((BW2+1),sizeof(double));
-    data13 = calloc((BW2+1),sizeof(double));
-    data23 = calloc((BW2+1),sizeof(double));
-    data32 = calloc((BW2+1),sizeof(double));
-    
-    d = malloc(sizeof(double**)*4);
-    for(i=0; i<4; i++)
-    {
-        d[i] = malloc(sizeof(double*)*4);
-        for(j=0; j<4; j++)
-        {
-            	d[i][j] = calloc((BW2+1),sizeof(double));
-        }
-    }
+    //Per-link transfer function pieces, link is the fast index [6*(n-1)+link]
+    int NL = 6*BW;
+    double *arg1, *arg12, *sin1, *cos1, *sin12, *cos12, *tran1r, *tran1i;
+    
+    arg1   = ws->work;
+    arg12  = ws->work + NL;
+    sin1   = ws->work + 2*NL;
+    cos1   = ws->work + 3*NL;
+    sin12  = ws->work + 4*NL;
+    cos12  = ws->work + 5*NL;
+    tran1r = ws->work + 6*NL;
+    tran1i = ws->work + 7*NL;
+    TR     = ws->work + 8*NL;
+    TI     = ws->work + 9*NL;
     
     /*   Gravitational Wave source parameters   */
     
@@ -700,7 +762,7 @@ void ucb_waveform(struct Orbit *orbit, char *format, double T, double t0, double
     amp    = exp(params[3]);
     cosi   = params[4];
     psi    = params[5];
-    phi0   = params[6];
+    phi0   = (filter) ? 0.0 : params[6];
     dfdt   = 0.0;
     d2fdt2 = 0.0;
     if(NParams>7)
@@ -729,24 +791,111 @@ void ucb_waveform(struct Orbit *orbit, char *format, double T, double t0, double
     
     LISA_polarization_tensor(costh, phi, eplus, ecross, k);
     
-    /* Main loop over signal bandwidth */
+    /*
+     Derivative bookkeeping. Each parameter p seeds the chain rule through
+     f0, dfdt, d2fdt2, phi0, the sky angles, or the polarization amplitudes.
+     The carrier bin q is held fixed.
+     */
+    int Nd = (dhdp) ? NParams : 0;
+    double dk[2][4], deplus[2][4][4], decross[2][4][4];
+    double ddplus[2][4][4], ddcross[2][4][4], dkdotr[2][4][4];
+    double dxi[2][4];
+    double df0[9]={0}, ddfdt[9]={0}, dd2fdt2[9]={0}, dphi0[9]={0};
+    double dDPr[9]={0}, dDPi[9]={0}, dDCr[9]={0}, dDCi[9]={0};
+    double *du=NULL, *dtheta=NULL, *dtran1r=NULL, *dtran1i=NULL;
+    if(Nd)
+    {
+        ucb_polarization_tensor_derivatives(costh, phi, deplus, decross, dk);
+        
+        df0[0] = 1./T;
+        dphi0[6] = 1.0;
+        if(NParams>7) ddfdt[7] = 1./(T*T);
+        if(NParams>8) dd2fdt2[8] = 1./(T*T*T);
+        
+        //d/dlogA
+        dDPr[3] = DPr;  dDPi[3] = DPi;  dDCr[3] = DCr;  dDCi[3] = DCi;
+        
+        //d/dcosi
+        double dAplus  =  amp*2.0*cosi;
+        double dAcross = -amp*2.0;
+        dDPr[4] =  dAplus*cosps;
+        dDPi[4] = -dAcross*sinps;
+        dDCr[4] = -dAplus*sinps;
+        dDCi[4] = -dAcross*cosps;
+        
+        //d/dpsi
+        dDPr[5] = -2.0*Aplus*sinps;
+        dDPi[5] = -2.0*Across*cosps;
+        dDCr[5] = -2.0*Aplus*cosps;
+        dDCi[5] =  2.0*Across*sinps;
+        
+        du      = ws->dwork;
+        dtheta  = ws->dwork +   Nd*NL;
+        dtran1r = ws->dwork + 2*Nd*NL;
+        dtran1i = ws->dwork + 3*Nd*NL;
+    }
+    
+    /* Main loop over signal bandwidth: geometry and phase arguments */
     for(n=1; n<=BW; n++)
     {
+        m = 6*(n-1);
+        
         //First time sample must be at t=0 for phasing
         t = t0 + T*(double)(n-1)/(double)BW;
         
-        //Calculate position of each spacecraft at time t
-        (*orbit->orbit_function)(orbit, t, x, y, z);
-        
-        //Form LISA detector tensor et al based on spacecraft and source location
-        LISA_detector_tensor(orbit->L,eplus,ecross,x,y,z,k,dplus,dcross,kdotr);
+        //Sky dependent pieces of the response tabulated by ucb_sky_geometry()
+        if(geo)
+        {
+            int g = (n-1)*stride;
+            int l = 0;
+            for(i=1; i<=3; i++)
+            {
+                kdotx[i] = geo->kdotx[3*g+i-1];
+                for(j=1; j<=3; j++)
+                {
+                    if(i==j) continue;
+                    kdotr[i][j]  = geo->kdotr[6*g+l];
+                    dplus[i][j]  = geo->dplus[6*g+l];
+                    dcross[i][j] = geo->dcross[6*g+l];
+                    l++;
+                }
+            }
+        }
+        else
+        {
+            //Calculate position of each spacecraft at time t
+            if(sc)
+            {
+                double *r = sc + 9*(n-1)*stride;
+                for(i=1; i<=3; i++)
+                {
+                    x[i] = r[i-1];
+                    y[i] = r[i+2];
+                    z[i] = r[i+5];
+                }
+            }
+            else (*orbit->orbit_function)(orbit, t, x, y, z);
+            
+            //Form LISA detector tensor et al based on spacecraft and source location
+            LISA_detector_tensor(orbit->L,eplus,ecross,x,y,z,k,dplus,dcross,kdotr);
+            
+            //Dot product of propogation vector with location of spacecrat i
+            for(i=1; i<=3; i++) kdotx[i] = (x[i]*k[1]+y[i]*k[2]+z[i]*k[3])/CLIGHT;
+            
+            //Detector tensor is linear in the polarization tensors and k
+            if(Nd)
+            {
+                for(int s=0; s<2; s++)
+                {
+                    LISA_detector_tensor(orbit->L,deplus[s],decross[s],x,y,z,dk[s],ddplus[s],ddcross[s],dkdotr[s]);
+                    for(i=1; i<=3; i++) dxi[s][i] = -(x[i]*dk[s][1]+y[i]*dk[s][2]+z[i]*dk[s][3])/CLIGHT;
+                }
+            }
+        }
         
         //Calculating LISA Transfer function
         for(i=1; i<=3; i++)
         {
-            //Dot product of propogation vector with location of spacecrat i
-            kdotx[i] = (x[i]*k[1]+y[i]*k[2]+z[i]*k[3])/CLIGHT;
-            
             //Wave arrival time at spacecraft i
             xi[i] = t - kdotx[i];
             
@@ -795,102 +944,345 @@ void ucb_waveform(struct Orbit *orbit, char *format, double T, double t0, double
                      *
                      https://gitlab.in2p3.fr/LISA/LDC/-/blob/develop/ldc/waveform/fastGB/GB.cc
                      */
-                    double arg1 = 0.5*fonfs[i]*(1.0 + kdotr[i][j]);
-                    
-                    //Transfer function
-                    double sinc = 0.25*sin(arg1)/arg1;
-                    
-                    //Real and imaginary pieces of time series (no complex exponential)
-                    double tran1r = aevol*(dplus[i][j]*DPr + dcross[i][j]*DCr);
-                    double tran1i = aevol*(dplus[i][j]*DPi + dcross[i][j]*DCi);
+                    arg1[m] = 0.5*fonfs[i]*(1.0 + kdotr[i][j]);
                     
                     /*
                      * Set to match Sangria LDC convention
                      * which defines the GW as e(-i Phi)
                     */
-                    //Real and imaginary components of complex exponential
-                    double tran2r = cos(arg1 - arg2);
-                    double tran2i = sin(arg1 - arg2);
-
-                    //Real & Imaginary part of the slowly evolving signal
-                    TR[i][j] = sinc*( tran1r*tran2r + tran1i*tran2i);
-                    TI[i][j] = sinc*(-tran1r*tran2i + tran1i*tran2r);
+                    arg12[m] = arg1[m] - arg2;
+                    
+                    //Real and imaginary pieces of time series (no complex exponential)
+                    if(filter)
+                    {
+                        //keep the plus and cross patterns separate for the basis responses
+                        tran1r[m] = aevol*dplus[i][j];
+                        tran1i[m] = aevol*dcross[i][j];
+                    }
+                    else
+                    {
+                        tran1r[m] = aevol*(dplus[i][j]*DPr + dcross[i][j]*DCr);
+                        tran1i[m] = aevol*(dplus[i][j]*DPi + dcross[i][j]*DCi);
+                    }
+                    
+                    //Chain rule through each of the above quantities
+                    for(p=0; p<Nd; p++)
+                    {
+                        int s = p-1; //sky parameter index
+                        int sky = (p==1 || p==2);
+                        
+                        double dxi_p   = sky ? dxi[s][i] : 0.0;
+                        double dkdotr_p= sky ? dkdotr[s][i][j] : 0.0;
+                        double ddplus_p  = sky ? ddplus[s][i][j]  : 0.0;
+                        double ddcross_p = sky ? ddcross[s][i][j] : 0.0;
+                        
+                        double df_p    = df0[p];
+                        double darg2_p = PI2*(df0[p]*xi[i] + f0*dxi_p) - dphi0[p];
+                        double daevol_p = 0.0;
+                        if(NParams>7)
+                        {
+                            df_p     += ddfdt[p]*xi[i] + dfdt*dxi_p;
+                            darg2_p  += M_PI*(ddfdt[p]*xi[i]*xi[i] + 2.0*dfdt*xi[i]*dxi_p);
+                            daevol_p  = 0.66666666666666666666*(ddfdt[p]*xi[i] - dfdt*df0[p]*xi[i]/f0 + dfdt*dxi_p)/f0;
+                        }
+                        if(NParams>8)
+                        {
+                            df_p    += 0.5*dd2fdt2[p]*xi[i]*xi[i] + d2fdt2*xi[i]*dxi_p;
+                            darg2_p += (M_PI/3.0)*(dd2fdt2[p]*xi[i]*xi[i]*xi[i] + 3.0*d2fdt2*xi[i]*xi[i]*dxi_p);
+                        }
+                        
+                        int mp = p*NL + m;
+                        du[mp]     = 0.5*(df_p/orbit->fstar*(1.0 + kdotr[i][j]) + fonfs[i]*dkdotr_p);
+                        dtheta[mp] = du[mp] - darg2_p;
+                        dtran1r[mp] = daevol_p*(dplus[i][j]*DPr + dcross[i][j]*DCr)
+                                    + aevol*(ddplus_p*DPr + ddcross_p*DCr + dplus[i][j]*dDPr[p] + dcross[i][j]*dDCr[p]);
+                        dtran1i[mp] = daevol_p*(dplus[i][j]*DPi + dcross[i][j]*DCi)
+                                    + aevol*(ddplus_p*DPi + ddcross_p*DCi + dplus[i][j]*dDPi[p] + dcross[i][j]*dDCi[p]);
+                    }
+                    
+                    m++;
                 }
             }
         }
-        
-        //Fill  time series data arrays with slowly evolving signal->
-        //dataij corresponds to fractional arm length difference yij
-        j = 2*n;
-        i = j-1;
-        data12[i] = TR[1][2];   data21[i] = TR[2][1];   data31[i] = TR[3][1];
-        data12[j] = TI[1][2];   data21[j] = TI[2][1];   data31[j] = TI[3][1];
-        data13[i] = TR[1][3];   data23[i] = TR[2][3];   data32[i] = TR[3][2];
-        data13[j] = TI[1][3];   data23[j] = TI[2][3];   data32[j] = TI[3][2];
     }
     
-    /*   Numerical Fourier transform of slowly evolving signal */
-    glass_forward_complex_fft(data12+1, BW);
-    glass_forward_complex_fft(data21+1, BW);
-    glass_forward_complex_fft(data31+1, BW);
-    glass_forward_complex_fft(data13+1, BW);
-    glass_forward_complex_fft(data23+1, BW);
-    glass_forward_complex_fft(data32+1, BW);
-     
-    //Unpack arrays from fft and normalize
-    for(i=1; i<=BW; i++)
+    /* Transfer function and complex exponential for all links and times at once */
+    sincos_array(arg1, sin1, cos1, NL);
+    sincos_array(arg12, sin12, cos12, NL);
+    
+    /* Basis responses: unit DPr & DPi use the plus pattern, unit DCr & DCi the cross pattern */
+    if(filter)
     {
-        j = i + BW;
-        a12[i] = data12[j]*invBW2;  a21[i] = data21[j]*invBW2;  a31[i] = data31[j]*invBW2;
-        a12[j] = data12[i]*invBW2;  a21[j] = data21[i]*invBW2;  a31[j] = data31[i]*invBW2;
-        a13[i] = data13[j]*invBW2;  a23[i] = data23[j]*invBW2;  a32[i] = data32[j]*invBW2;
-        a13[j] = data13[i]*invBW2;  a23[j] = data23[i]*invBW2;  a32[j] = data32[i]*invBW2;
+        for(p=0; p<4; p++)
+        {
+            double *tran = (p<2) ? tran1r : tran1i;
+            double cr = (p%2==0) ? 1.0 : 0.0;
+            double ci = 1.0 - cr;
+            
+            #pragma omp simd
+            for(m=0; m<NL; m++)
+            {
+                double sinc = 0.25*sin1[m]/arg1[m];
+                double tr = cr*tran[m];
+                double ti = ci*tran[m];
+                
+                TR[m] = sinc*( tr*cos12[m] + ti*sin12[m]);
+                TI[m] = sinc*(-tr*sin12[m] + ti*cos12[m]);
+            }
+            
+            ucb_slow_response_to_tdi(orbit, tdi, T, f0, q, TR, TI, filter[p]->X, filter[p]->Y, filter[p]->Z, filter[p]->A, filter[p]->E, BW, NI, ws);
+        }
+        return;
     }
     
-    /*   Renormalize so that the resulting time series is real   */
-    for(i=1; i<=BW2; i++)
+    #pragma omp simd
+    for(m=0; m<NL; m++)
     {
-        d[1][2][i] = a12[i];  d[2][1][i] = a21[i];  d[3][1][i] = a31[i];
-        d[1][3][i] = a13[i];  d[2][3][i] = a23[i];  d[3][2][i] = a32[i];
+        //Transfer function
+        double sinc = 0.25*sin1[m]/arg1[m];
+        
+        //Real & Imaginary part of the slowly evolving signal
+        TR[m] = sinc*( tran1r[m]*cos12[m] + tran1i[m]*sin12[m]);
+        TI[m] = sinc*(-tran1r[m]*sin12[m] + tran1i[m]*cos12[m]);
     }
     
-    /*   Call subroutines for synthesizing different TDI data channels  */
-    if(strcmp("phase",format) == 0)
-        LISA_tdi(orbit->L, orbit->fstar, T, d, f0, q, X-1, Y-1, Z-1, A-1, E-1, BW, NI);
-    else if(strcmp("frequency",format) == 0)
-        LISA_tdi_FF(orbit->L, orbit->fstar, T, d, f0, q, X-1, Y-1, Z-1, A-1, E-1, BW, NI);
-    else if(strcmp("sangria",format) == 0)
-        LISA_tdi_Sangria(orbit->L, orbit->fstar, T, d, f0, q, X-1, Y-1, Z-1, A-1, E-1, BW, NI);
-    else
+    if(X) ucb_slow_response_to_tdi(orbit, tdi, T, f0, q, TR, TI, X, Y, Z, A, E, BW, NI, ws);
+    
+    /* Derivatives of the slowly evolving signal, reusing du & dtheta for the output */
+    for(p=0; p<Nd; p++)
     {
-        fprintf(stderr,"Unsupported data format %s",format);
-        exit(1);
+        double *dTR = du + p*NL;
+        double *dTI = dtheta + p*NL;
+        double *dtr = dtran1r + p*NL;
+        double *dti = dtran1i + p*NL;
+        
+        #pragma omp simd
+        for(m=0; m<NL; m++)
+        {
+            double du_m  = dTR[m];
+            double dth   = dTI[m];
+            double sinc  = 0.25*sin1[m]/arg1[m];
+            double dsinc = 0.25*(arg1[m]*cos1[m] - sin1[m])/(arg1[m]*arg1[m])*du_m;
+            
+            //d/dp of sinc*tran1*exp(-i theta)
+            double Gr = dsinc*tran1r[m] + sinc*dtr[m] + dth*sinc*tran1i[m];
+            double Gi = dsinc*tran1i[m] + sinc*dti[m] - dth*sinc*tran1r[m];
+            
+            dTR[m] =  Gr*cos12[m] + Gi*sin12[m];
+            dTI[m] = -Gr*sin12[m] + Gi*cos12[m];
+        }
+        
+        ucb_slow_response_to_tdi(orbit, tdi, T, f0, q, dTR, dTI, dhdp[p]->X, dhdp[p]->Y, dhdp[p]->Z, dhdp[p]->A, dhdp[p]->E, BW, NI, ws);
     }
+}
+
+void ucb_waveform(struct Orbit *orbit, char *format, double T, double t0, double *params, int NParams, double *X, double *Y, double *Z, double *A, double *E, int BW, int NI)
+{
+    double prof = profile_start();
+    struct UCBWaveformWorkspace *ws = alloc_ucb_waveform_workspace(BW, 0);
+    
+    ucb_waveform_kernel(orbit, select_LISA_tdi(format), T, t0, params, NParams, X, Y, Z, A, E, NULL, NULL, BW, NI, ws, NULL, NULL, 0);
+    
+    free_ucb_waveform_workspace(ws);
+    profile_stop_count(PROFILE_WAVEFORM, prof, BW);
+}
+
+void ucb_waveform_derivatives(struct Orbit *orbit, char *format, double T, double t0, double *params, int NParams, struct TDI *h, struct TDI **dhdp, int BW, int NI)
+{
+    double prof = profile_start();
+    struct UCBWaveformWorkspace *ws = alloc_ucb_waveform_workspace(BW, NParams);
+    
+    LISA_tdi_function tdi = select_LISA_tdi(format);
+    
+    if(h) ucb_waveform_kernel(orbit, tdi, T, t0, params, NParams, h->X, h->Y, h->Z, h->A, h->E, dhdp, NULL, BW, NI, ws, NULL, NULL, 0);
+    else  ucb_waveform_kernel(orbit, tdi, T, t0, params, NParams, NULL, NULL, NULL, NULL, NULL, dhdp, NULL, BW, NI, ws, NULL, NULL, 0);
+    
+    free_ucb_waveform_workspace(ws);
+    profile_stop_count(PROFILE_WAVEFORM, prof, BW);
+}
 
-    /*   Free Arrays   */
+double *ucb_spacecraft_positions(struct Orbit *orbit, double T, double t0, int BW)
+{
+    double *x = calloc(4,sizeof(double));
+    double *y = calloc(4,sizeof(double));
+    double *z = calloc(4,sizeof(double));
+    double *sc = malloc(9*BW*sizeof(double));
+    for(int n=0; n<BW; n++)
+    {
+        double t = t0 + T*(double)n/(double)BW;
+        (*orbit->orbit_function)(orbit, t, x, y, z);
+        for(int i=1; i<=3; i++)
+        {
+            sc[9*n+i-1] = x[i];
+            sc[9*n+i+2] = y[i];
+            sc[9*n+i+5] = z[i];
+        }
+    }
     free(x);
     free(y);
     free(z);
     
-    free(data12);
-    free(data21);
-    free(data31);
-    free(data13);
-    free(data23);
-    free(data32);
+    return sc;
+}
+
+struct UCBSkyGeometry *alloc_ucb_sky_geometry(int BW)
+{
+    struct UCBSkyGeometry *geo = malloc(sizeof(struct UCBSkyGeometry));
+    
+    geo->BW     = BW;
+    geo->costh  = NAN;
+    geo->phi    = NAN;
+    geo->kdotx  = malloc(3*BW*sizeof(double));
+    geo->kdotr  = malloc(6*BW*sizeof(double));
+    geo->dplus  = malloc(6*BW*sizeof(double));
+    geo->dcross = malloc(6*BW*sizeof(double));
+    
+    return geo;
+}
+
+void free_ucb_sky_geometry(struct UCBSkyGeometry *geo)
+{
+    free(geo->kdotx);
+    free(geo->kdotr);
+    free(geo->dplus);
+    free(geo->dcross);
+    free(geo);
+}
+
+void ucb_sky_geometry(struct Orbit *orbit, double *sc, double costh, double phi, struct UCBSkyGeometry *geo)
+{
+    double k[4], eplus[4][4], ecross[4][4];
+    double x[4], y[4], z[4];
+    double kdotr[4][4], dplus[4][4], dcross[4][4];
     
-    for(i=0; i<4; i++)
+    geo->costh = costh;
+    geo->phi   = phi;
+    
+    LISA_polarization_tensor(costh, phi, eplus, ecross, k);
+    
+    for(int n=0; n<geo->BW; n++)
+    {
+        double *r = sc + 9*n;
+        for(int i=1; i<=3; i++)
+        {
+            x[i] = r[i-1];
+            y[i] = r[i+2];
+            z[i] = r[i+5];
+        }
+        
+        //same arithmetic as ucb_waveform_kernel() so the tabulated response is identical
+        LISA_detector_tensor(orbit->L,eplus,ecross,x,y,z,k,dplus,dcross,kdotr);
+        
+        int l = 0;
+        for(int i=1; i<=3; i++)
+        {
+            geo->kdotx[3*n+i-1] = (x[i]*k[1]+y[i]*k[2]+z[i]*k[3])/CLIGHT;
+            for(int j=1; j<=3; j++)
+            {
+                if(i==j) continue;
+                geo->kdotr[6*n+l]  = kdotr[i][j];
+                geo->dplus[6*n+l]  = dplus[i][j];
+                geo->dcross[6*n+l] = dcross[i][j];
+                l++;
+            }
+        }
+    }
+}
+
+void ucb_waveform_batch(struct Orbit *orbit, LISA_tdi_function tdi_function, double T, double t0, double **params, int NParams, struct TDI **tdi, int *BW, int Nsource, int NI)
+{
+    if(Nsource<1) return;
+    
+    //finest time grid needed by any source in the batch
+    int BWmax = 0;
+    for(int s=0; s<Nsource; s++) if(BW[s]>BWmax) BWmax = BW[s];
+    
+    //spacecraft positions are shared by every source whose grid nests in the finest one
+    double *sc = ucb_spacecraft_positions(orbit, T, t0, BWmax);
+    
+    #pragma omp parallel
     {
-        for(j=0; j<4; j++)
+        struct UCBWaveformWorkspace *ws = alloc_ucb_waveform_workspace(BWmax, 0);
+        
+        #pragma omp for schedule(dynamic)
+        for(int s=0; s<Nsource; s++)
         {
-            free(d[i][j]);
+            double prof = profile_start();
+            double *sc_s = (BWmax%BW[s]==0) ? sc : NULL;
+            ucb_waveform_kernel(orbit, tdi_function, T, t0, params[s], NParams, tdi[s]->X, tdi[s]->Y, tdi[s]->Z, tdi[s]->A, tdi[s]->E, NULL, NULL, BW[s], NI, ws, sc_s, NULL, BWmax/BW[s]);
+            profile_stop_count(PROFILE_WAVEFORM, prof, BW[s]);
         }
-        free(d[i]);
+        
+        free_ucb_waveform_workspace(ws);
     }
-    free(d);
     
+    free(sc);
+}
+
+void ucb_waveform_filters(struct Orbit *orbit, LISA_tdi_function tdi, double T, double t0, double *params, int NParams, struct TDI **filter, int BW, int NI)
+{
+    double prof = profile_start();
+    struct UCBWaveformWorkspace *ws = alloc_ucb_waveform_workspace(BW, 0);
+    
+    ucb_waveform_kernel(orbit, tdi, T, t0, params, NParams, NULL, NULL, NULL, NULL, NULL, NULL, filter, BW, NI, ws, NULL, NULL, 0);
     
-    return;
+    free_ucb_waveform_workspace(ws);
+    profile_stop_count(PROFILE_WAVEFORM, prof, BW);
+}
+
+void ucb_waveform_filters_sky(struct Orbit *orbit, LISA_tdi_function tdi, double T, double t0, double *params, int NParams, struct UCBSkyGeometry *geo, struct TDI **filter, int BW, int NI, struct UCBWaveformWorkspace *ws)
+{
+    double prof = profile_start();
+    
+    //fall back to the full calculation if the source's time grid does not nest in the table
+    if(BW <= geo->BW && geo->BW%BW==0)
+        ucb_waveform_kernel(orbit, tdi, T, t0, params, NParams, NULL, NULL, NULL, NULL, NULL, NULL, filter, BW, NI, ws, NULL, geo, geo->BW/BW);
+    else
+        ucb_waveform_kernel(orbit, tdi, T, t0, params, NParams, NULL, NULL, NULL, NULL, NULL, NULL, filter, BW, NI, ws, NULL, NULL, 0);
+    
+    profile_stop_count(PROFILE_WAVEFORM, prof, BW);
+}
+
+void ucb_filter_weights(double *params, double *a)
+{
+    double amp    = exp(params[3]);
+    double cosi   = params[4];
+    double psi    = params[5];
+    double phi0   = params[6];
+    double cosps  = cos(2.*psi);
+    double sinps  = sin(2.*psi);
+    double cosph0 = cos(phi0);
+    double sinph0 = sin(phi0);
+    
+    //Same polarization amplitudes as ucb_waveform()
+    double Aplus  =  amp*(1.+cosi*cosi);
+    double Across = -amp*(2.0*cosi);
+    double DPr =  Aplus*cosps;
+    double DPi = -Across*sinps;
+    double DCr = -Aplus*sinps;
+    double DCi = -Across*cosps;
+    
+    //Rotate by exp(-i phi0) to get the filter weights
+    a[0] = DPr*cosph0 + DPi*sinph0;
+    a[1] = DPi*cosph0 - DPr*sinph0;
+    a[2] = DCr*cosph0 + DCi*sinph0;
+    a[3] = DCi*cosph0 - DCr*sinph0;
+}
+
+void ucb_waveform_extrinsic(double *params, struct TDI **filter, double *X, double *Y, double *Z, double *A, double *E, int BW)
+{
+    double a[4];
+    ucb_filter_weights(params, a);
+    
+    struct TDI *F0 = filter[0], *F1 = filter[1], *F2 = filter[2], *F3 = filter[3];
+    for(int n=0; n<2*BW; n++)
+    {
+        X[n] = a[0]*F0->X[n] + a[1]*F1->X[n] + a[2]*F2->X[n] + a[3]*F3->X[n];
+        Y[n] = a[0]*F0->Y[n] + a[1]*F1->Y[n] + a[2]*F2->Y[n] + a[3]*F3->Y[n];
+        Z[n] = a[0]*F0->Z[n] + a[1]*F1->Z[n] + a[2]*F2->Z[n] + a[3]*F3->Z[n];
+        A[n] = a[0]*F0->A[n] + a[1]*F1->A[n] + a[2]*F2->A[n] + a[3]*F3->A[n];
+        E[n] = a[0]*F0->E[n] + a[1]*F1->E[n] + a[2]*F2->E[n] + a[3]*F3->E[n];
+    }
 }
 
 static void ucb_wavelet_layers(double Tobs, double *params, struct Wavelets *wdm, int *jstart, int *jwidth)
@@ -937,6 +1329,8 @@ static void ucb_wavelet_layers(double Tobs, double *params, struct Wavelets *wdm
 /* Heterodyne wavelet transform */
 void ucb_waveform_wavelet(struct Orbit *orbit, struct Wavelets *wdm, double Tobs, double t0, double *params, int *wavelet_list, int *Nwavelet, double *X, double *Y, double *Z)
 {
+    double prof = profile_start();
+    
     int Nspline = orbit->Norb;
     double dt = Tobs/(double)(Nspline-1);
     
@@ -1138,11 +1532,225 @@ void ucb_waveform_wavelet(struct Orbit *orbit, struct Wavelets *wdm, double Tobs
     free_cubic_spline(phase_interpolant);
     
     free_double_vector(window);
+    
+    profile_stop_count(PROFILE_WAVEFORM, prof, *Nwavelet);
+}
+
+struct UCBWaveletWorkspace
+{
+    int Nspline;                //number of samples on the orbit grid
+    int Nds;                    //largest number of downsampled samples, for 3 frequency layers
+    double *time_ssb;           //orbit grid
+    double *amp_ssb, *phase_ssb;//SSB amplitude and phase on orbit grid
+    double *time_sc, *phase_sc; //orbit grid shifted to S/C 1, and SSB phase there
+    double *time_ds;            //downsampled grid
+    double *time_sc_ds;         //downsampled grid shifted to S/C 1
+    double *phase_ds;           //SSB phase on downsampled grid
+    struct CubicSpline *amp_ssb_spline, *phase_ssb_spline;
+    struct CubicSpline *amp_interpolant, *phase_interpolant;
+    struct TDI *tdi_amp, *tdi_phase;
+    double *window[3];          //frequency domain windows for 1, 2, and 3 layers, NULL until needed
+};
+
+struct UCBWaveletWorkspace *alloc_ucb_wavelet_workspace(struct Orbit *orbit, struct Wavelets *wdm)
+{
+    struct UCBWaveletWorkspace *ws = malloc(sizeof(struct UCBWaveletWorkspace));
+    
+    int Nspline = orbit->Norb;
+    int Nds = 4*wdm->NT;
+    
+    ws->Nspline    = Nspline;
+    ws->Nds        = Nds;
+    ws->time_ssb   = double_vector(Nspline);
+    ws->amp_ssb    = double_vector(Nspline);
+    ws->phase_ssb  = double_vector(Nspline);
+    ws->time_sc    = double_vector(Nspline);
+    ws->phase_sc   = double_vector(Nspline);
+    ws->time_ds    = double_vector(Nds);
+    ws->time_sc_ds = double_vector(Nds);
+    ws->phase_ds   = double_vector(Nds);
+    
+    ws->amp_ssb_spline    = alloc_cubic_spline(Nspline);
+    ws->phase_ssb_spline  = alloc_cubic_spline(Nspline);
+    ws->amp_interpolant   = alloc_cubic_spline(Nspline);
+    ws->phase_interpolant = alloc_cubic_spline(Nspline);
+    
+    ws->tdi_amp   = malloc(sizeof(struct TDI));
+    ws->tdi_phase = malloc(sizeof(struct TDI));
+    alloc_tdi(ws->tdi_amp,Nspline,3);
+    alloc_tdi(ws->tdi_phase,Nspline,3);
+    
+    for(int n=0; n<3; n++) ws->window[n] = NULL;
+    
+    return ws;
+}
+
+void free_ucb_wavelet_workspace(struct UCBWaveletWorkspace *ws)
+{
+    free_double_vector(ws->time_ssb);
+    free_double_vector(ws->amp_ssb);
+    free_double_vector(ws->phase_ssb);
+    free_double_vector(ws->time_sc);
+    free_double_vector(ws->phase_sc);
+    free_double_vector(ws->time_ds);
+    free_double_vector(ws->time_sc_ds);
+    free_double_vector(ws->phase_ds);
+    
+    free_cubic_spline(ws->amp_ssb_spline);
+    free_cubic_spline(ws->phase_ssb_spline);
+    free_cubic_spline(ws->amp_interpolant);
+    free_cubic_spline(ws->phase_interpolant);
+    
+    free_tdi(ws->tdi_amp);
+    free_tdi(ws->tdi_phase);
+    
+    for(int n=0; n<3; n++) if(ws->window[n]) free_double_vector(ws->window[n]);
+    
+    free(ws);
+}
+
+/* Heterodyne wavelet transform of the F-statistic filters */
+void ucb_waveform_wavelet_filters(struct Orbit *orbit, struct Wavelets *wdm, double Tobs, double t0, double *params, int *wavelet_list, int *Nwavelet, double **filter, struct UCBWaveletWorkspace *ws)
+{
+    double prof = profile_start();
+    
+    int Nspline = orbit->Norb;
+    double dt = Tobs/(double)(Nspline-1);
+    
+    if(Nspline != ws->Nspline)
+    {
+        fprintf(stderr,"ucb_waveform_wavelet_filters: workspace allocated for %i orbit samples, not %i\n",ws->Nspline,Nspline);
+        exit(1);
+    }
+    
+    // intrinsic parameters of the filters, with phase and polarization applied below
+    double p[UCB_MODEL_NP];
+    for(int i=0; i<UCB_MODEL_NP; i++) p[i] = params[i];
+    p[3] = log(2.0);    //log amplitude
+    p[4] = cos(M_PI_2); //cos inclination
+    p[5] = 0.0;         //polarization
+    p[6] = 0.0;         //initial phase
+    if(UCB_MODEL_NP>8) p[8] = 0.0;
+    
+    // store time array for full data on orbit cadence
+    for(int i=0; i< Nspline; i++) ws->time_ssb[i] = t0 + i*dt;
+    
+    //get ucb waveform on orbit grid
+    ucb_barycenter_waveform(p, Nspline, orbit->t, ws->phase_ssb, ws->amp_ssb, Tobs);
+    
+    // get frequency layers containing signal
+    int min_layer; //bottom layer
+    int Nlayers;   //number of layers
+    ucb_wavelet_layers(Tobs, p, wdm, &min_layer, &Nlayers);
+    
+    initialize_cubic_spline(ws->amp_ssb_spline,orbit->t,ws->amp_ssb);
+    initialize_cubic_spline(ws->phase_ssb_spline,orbit->t,ws->phase_ssb);
+    
+    // get signal phase at S/C 1
+    double costh = p[1];
+    double phi   = p[2];
+    LISA_spacecraft_to_barycenter_time(orbit, costh, phi, ws->time_ssb, ws->time_sc, Nspline, -1);
+    
+    for(int i=0; i< Nspline; i++)
+        ws->phase_sc[i] = spline_interpolation(ws->phase_ssb_spline, ws->time_sc[i]);
+    
+    /*
+     Downsample waveform (i.e. shift to lower frequency layer)
+     */
+    int N_ds     = wdm->NT*(Nlayers+1); //number of downsampled data points
+    double dt_ds = wdm->dt/(double)(Nlayers+1); //downsampled data cadence
+    
+    double f0 = (min_layer-1)*wdm->df; //"carrier" frequency
+    
+    for(int i=0; i<N_ds; i++) ws->time_ds[i] = t0 + i*dt_ds;
+    
+    LISA_spacecraft_to_barycenter_time(orbit, costh, phi, ws->time_ds, ws->time_sc_ds, N_ds, -1);
+    
+    // downsampled carrier phase, less the heterodyne phase
+    for(int i=0; i<N_ds; i++)
+        ws->phase_ds[i] = spline_interpolation(ws->phase_ssb_spline, ws->time_sc_ds[i]) - PI2 * f0 * ws->time_ds[i];
+    
+    // get freqeuncy wavelet window function for downsampled data
+    double *window = ws->window[Nlayers-1];
+    if(window == NULL)
+    {
+        window = ws->window[Nlayers-1] = double_vector((wdm->NT/2+1));
+        wavelet_window_frequency(wdm, window, Nlayers);
+    }
+    
+    /*
+     The filters sharing a polarization have the same TDI response, and
+     their initial phases are a constant offset of the TDI phase
+     */
+    double psi[4]  = {0.0, M_PI_4, 0.0, M_PI_4};
+    double phi0[4] = {0.0, M_PI, 3*M_PI_2, M_PI_2};
+    
+    for(int n=0; n<2; n++)
+    {
+        LISA_spline_response(orbit, ws->time_ssb, Nspline, costh, phi, p[4], psi[n], ws->amp_ssb_spline, NULL, ws->phase_ssb_spline, ws->phase_sc, ws->tdi_amp, ws->tdi_phase);
+        
+        double *tdi_amp[3]   = {ws->tdi_amp->X, ws->tdi_amp->Y, ws->tdi_amp->Z};
+        double *tdi_phase[3] = {ws->tdi_phase->X, ws->tdi_phase->Y, ws->tdi_phase->Z};
+        
+        double cphi0[2] = {cos(phi0[n]), cos(phi0[n+2])};
+        double sphi0[2] = {sin(phi0[n]), sin(phi0[n+2])};
+        
+        for(int c=0; c<3; c++)
+        {
+            initialize_cubic_spline(ws->amp_interpolant,   ws->time_ssb, tdi_amp[c]);
+            initialize_cubic_spline(ws->phase_interpolant, ws->time_ssb, tdi_phase[c]);
+            
+            double *h0 = filter[3*n+c];
+            double *h1 = filter[3*(n+2)+c];
+            
+            for(int i=0; i<N_ds; i++)
+            {
+                double Amp   = spline_interpolation(ws->amp_interpolant, ws->time_ds[i]);
+                double Phase = spline_interpolation(ws->phase_interpolant, ws->time_ds[i]) + ws->phase_ds[i];
+                double cp = cos(Phase);
+                double sp = sin(Phase);
+                
+                // Amp*cos(Phase - phi0)
+                h0[i] = Amp*(cp*cphi0[0] + sp*sphi0[0]);
+                h1[i] = Amp*(cp*cphi0[1] + sp*sphi0[1]);
+            }
+            
+            // wavelet transform on heterodyned data using downsampled windows.
+            wavelet_transform_by_layers(wdm, min_layer, Nlayers, window, h0);
+            wavelet_transform_by_layers(wdm, min_layer, Nlayers, window, h1);
+        }
+    }
+    
+    /*
+     Properly re-index to undo the heterodyning
+    */
+    int N=0;
+    int k;
+    
+    for(int i=0; i<wdm->NT; i++)
+    {
+        for(int j=min_layer; j<min_layer+Nlayers; j++)
+        {
+            wavelet_pixel_to_index(wdm,i,j,&k);
+            
+            //check that the pixel is in range
+            if(k>=wdm->kmin && k<wdm->kmax)
+            {
+                wavelet_list[N]=k-wdm->kmin;
+                N++;
+            }
+        }
+    }
+    *Nwavelet = N;
+    
+    profile_stop_count(PROFILE_WAVEFORM, prof, *Nwavelet);
 }
 
 /* Lookup table wavelet transform */
 void ucb_waveform_wavelet_tab(struct Orbit *orbit, struct Wavelets *wdm, double Tobs, double t0, double *params, int *wavelet_list, int *Nwavelet, double *X, double *Y, double *Z)
 {
+    double prof = profile_start();
+    
     /*
     Get waveform at solar system barycenter (SSB)
     */
@@ -1334,4 +1942,5 @@ void ucb_waveform_wavelet_tab(struct Orbit *orbit, struct Wavelets *wdm, double
 
     free(reverse_list);
 
+    profile_stop_count(PROFILE_WAVEFORM, prof, *Nwavelet);
 }
@@ -35,6 +35,17 @@
  */
 double snr(struct Source *source, struct Noise *noise);
 
+/**
+ \brief snr() specialised to one (X), two (A,E), or three (X,Y,Z) TDI channels
+ 
+ Selected once by select_ucb_kernels() to match Data::Nchannel.
+ */
+///@{
+double snr_X(struct Source *source, struct Noise *noise);
+double snr_AE(struct Source *source, struct Noise *noise);
+double snr_XYZ(struct Source *source, struct Noise *noise);
+///@}
+
 /**
  \brief Signal to noise ratio in wavelet domain
  @see snr()
@@ -154,7 +165,7 @@ void ucb_barycenter_waveform(double *params, int N, double *times, double *phase
 /**
  \brief computes Fisher Information Matrix for UCB waveform parameters Source::params
  
- Computes matrix elements numerically using central differencing
+ Computes matrix elements from analytic waveform derivatives returned by ucb_waveform_derivatives()
  \f$\Gamma_{ij} = \frac{\partial h}{\partial \theta_i} \frac{\partial h}{\partial \theta_j} \f$
  and stores in Source::fisher_matrix.
  Matrix eigenvectors and eigenvalues are then computed using matrix_eigenstuff() and stored in Source::fisher_evectr and Source::fisher_evalue, respectively.
@@ -168,6 +179,8 @@ void ucb_fisher(struct Orbit *orbit, struct Data *data, struct Source *source, s
 
 /**
  \brief computes Fisher Information Matrix for UCB waveform parameters Source::params in wavelet domain
+ 
+ Amplitude derivative is analytic, the rest are computed by forward differencing ucb_waveform_wavelet().
  @see ucb_fisher()
  */
 void ucb_fisher_wavelet(struct Orbit *orbit, struct Data *data, struct Source *source, struct Noise *noise);
@@ -201,6 +214,76 @@ void ucb_alignment(struct Orbit *orbit, struct Data *data, struct Source *source
  */
 int ucb_bandwidth(double L, double fstar, double f, double fdot, double costheta, double A, double T, int N);
 
+/**
+ \brief Largest bandwidth ucb_bandwidth() returns for data length `N` [bins]
+ */
+int ucb_max_bandwidth(int N);
+
+/**
+ \brief Scratch memory for the fast-slow waveform kernel
+
+ Sized for bandwidths up to the `BW` it was allocated with and owned by one thread.
+ */
+struct UCBWaveformWorkspace;
+
+/**
+ \brief Sky dependent, frequency independent, pieces of the LISA response
+
+ The spacecraft positions, detector tensors, and projections of the propagation
+ direction only depend on the sky location and time.  Tabulated once by
+ ucb_sky_geometry() they are shared by every ucb_waveform_filters_sky() call at
+ that sky location, whatever its frequency and frequency derivative.
+ Links are stored in the order 12, 13, 21, 23, 31, 32.
+ */
+struct UCBSkyGeometry
+{
+    int BW;         //!<number of time samples
+    double costh;   //!<cosine of ecliptic co-latitude of the table, `NAN` before the first ucb_sky_geometry()
+    double phi;     //!<ecliptic longitude of the table
+    double *kdotx;  //!<\f$ \hat k\cdot x_i/c \f$ for spacecraft `i` at sample `n`: `[3*n+i-1]`
+    double *kdotr;  //!<\f$ \hat k\cdot \hat r_{ij} \f$ for each link: `[6*n+link]`
+    double *dplus;  //!<plus polarization detector tensor for each link: `[6*n+link]`
+    double *dcross; //!<cross polarization detector tensor for each link: `[6*n+link]`
+};
+
+/**
+ \brief Allocate scratch memory for waveforms of bandwidth up to `BW` with `Nderiv` parameter derivatives
+ */
+struct UCBWaveformWorkspace *alloc_ucb_waveform_workspace(int BW, int Nderiv);
+
+/**
+ \brief Free memory from alloc_ucb_waveform_workspace()
+ */
+void free_ucb_waveform_workspace(struct UCBWaveformWorkspace *ws);
+
+/**
+ \brief Spacecraft positions \f$ \{x_1,x_2,x_3,y_1,y_2,y_3,z_1,z_2,z_3\} \f$ on `BW` samples spanning `T` from `t0`
+
+ @return array of `9*BW` positions, free() when done
+ */
+double *ucb_spacecraft_positions(struct Orbit *orbit, double T, double t0, int BW);
+
+/**
+ \brief Allocate UCBSkyGeometry table of `BW` time samples
+ */
+struct UCBSkyGeometry *alloc_ucb_sky_geometry(int BW);
+
+/**
+ \brief Free memory from alloc_ucb_sky_geometry()
+ */
+void free_ucb_sky_geometry(struct UCBSkyGeometry *geo);
+
+/**
+ \brief Tabulate the sky dependent pieces of the response at \f$ (\cos\theta,\phi) \f$
+
+ @param[in] orbit LISA ephemerides
+ @param[in] sc spacecraft positions from ucb_spacecraft_positions() on UCBSkyGeometry::BW samples
+ @param[in] costh cosine of ecliptic co-latitude
+ @param[in] phi ecliptic longitude
+ @param[out] geo tabulated geometry
+ */
+void ucb_sky_geometry(struct Orbit *orbit, double *sc, double costh, double phi, struct UCBSkyGeometry *geo);
+
 /**
  \brief Galactic binary waveform generator using fast-slow decomposition first described in <a href="https://journals.aps.org/prd/abstract/10.1103/PhysRevD.76.083006">Cornish and Littenberg, PRD 76, 083006</a>.
 
@@ -226,6 +309,115 @@ int ucb_bandwidth(double L, double fstar, double f, double fdot, double costheta
  */
 void ucb_waveform(struct Orbit *orbit, char *format, double T, double t0, double params[], int NParams, double *X, double *Y, double *Z, double *A, double *E, int BW, int NI);
 
+/**
+ \brief ucb_waveform() together with its derivatives w.r.t. the source parameters
+
+ The TDI response is linear in the slowly evolving link responses, so the chain rule
+ is applied analytically to the per-link amplitude and phase and each derivative costs
+ one extra FFT and TDI combination instead of a full waveform evaluation.
+ The carrier bin \f$ q = {\rm floor}(f_0 T) \f$ is held fixed.
+
+ @param[in] orbit LISA ephemerides
+ @param[in] format TDI format, "phase" or "frequency" or "sangria"
+ @param[in] T observation time \f$ T_{\rm obs}\ [{\rm s}]\f$
+ @param[in] t0 start time of observations \f$ t_0\ [{\rm s}]\f$
+ @param[in] params[] source parameters
+ @param[in] NParams number of source parameters (7, 8, or 9)
+ @param[out] h TDI response of the source (may be NULL)
+ @param[out] dhdp[] \f$ \partial h/\partial \theta_i \f$ for the first NParams parameters
+ @param[in] BW source bandwidth [bins]
+ @param[in] NI number of interferometer channels (1 for X, 2 for A,E, 3 for X,Y,Z)
+ */
+void ucb_waveform_derivatives(struct Orbit *orbit, char *format, double T, double t0, double *params, int NParams, struct TDI *h, struct TDI **dhdp, int BW, int NI);
+
+/**
+ \brief Batched version of ucb_waveform() for many sources at once
+
+ Sources are distributed over OpenMP threads, each with its own scratch memory.
+ Spacecraft positions are computed once on the finest time grid in the batch and
+ shared by all sources whose (power of two) bandwidth nests in that grid.
+
+ Called from inside an active parallel region the batch runs on the calling thread.
+
+ @param[in] orbit LISA ephemerides
+ @param[in] tdi_function TDI synthesis for the data format, see select_LISA_tdi()
+ @param[in] T observation time \f$ T_{\rm obs}\ [{\rm s}]\f$
+ @param[in] t0 start time of observations \f$ t_0\ [{\rm s}]\f$
+ @param[in] params[] parameter vectors for each source
+ @param[in] NParams number of source parameters (7, 8, or 9)
+ @param[out] tdi[] band-limited TDI response of each source, at least 2*BW[s] long
+ @param[in] BW[] bandwidth of each source [bins]
+ @param[in] Nsource number of sources in batch
+ @param[in] NI number of interferometer channels (1 for X, 2 for A,E, 3 for X,Y,Z)
+ */
+void ucb_waveform_batch(struct Orbit *orbit, LISA_tdi_function tdi_function, double T, double t0, double **params, int NParams, struct TDI **tdi, int *BW, int Nsource, int NI);
+
+/**
+ \brief Basis responses for the extrinsic parameters of ucb_waveform()
+
+ The amplitude, inclination, polarization, and phase only enter the response through
+ the four polarization amplitudes \f$ (D_{+}^{\rm re}, D_{+}^{\rm im}, D_{\times}^{\rm re}, D_{\times}^{\rm im}) \f$
+ rotated by \f$ e^{-i\varphi_0} \f$.
+ Computes the TDI response to a unit value of each with \f$\varphi_0=0\f$, the same
+ decomposition as the F-statistic filters in get_filters().
+ The filters depend on params[0,1,2,7,8], t0, and BW.
+
+ @param[in] orbit LISA ephemerides
+ @param[in] tdi TDI synthesis for the data format, see select_LISA_tdi()
+ @param[in] T observation time \f$ T_{\rm obs}\ [{\rm s}]\f$
+ @param[in] t0 start time of observations \f$ t_0\ [{\rm s}]\f$
+ @param[in] params[] source parameters, extrinsic parameters are ignored
+ @param[in] NParams number of source parameters (7, 8, or 9)
+ @param[out] filter[4] TDI response to each basis amplitude, at least 2*BW long
+ @param[in] BW source bandwidth [bins]
+ @param[in] NI number of interferometer channels (1 for X, 2 for A,E, 3 for X,Y,Z)
+ */
+void ucb_waveform_filters(struct Orbit *orbit, LISA_tdi_function tdi, double T, double t0, double *params, int NParams, struct TDI **filter, int BW, int NI);
+
+/**
+ \brief ucb_waveform_filters() reusing tabulated sky geometry and caller-owned scratch memory
+
+ Only the frequency dependent transfer functions, phases, FFTs and TDI combinations
+ are computed, so the cost of the geometry is paid once per sky location.
+ Sources whose (power of two) bandwidth does not nest in the table fall back to the
+ full calculation.
+
+ @param[in] orbit LISA ephemerides
+ @param[in] tdi TDI synthesis for the data format, see select_LISA_tdi()
+ @param[in] T observation time \f$ T_{\rm obs}\ [{\rm s}]\f$
+ @param[in] t0 start time of observations \f$ t_0\ [{\rm s}]\f$
+ @param[in] params[] source parameters, params[1,2] must match the sky location of `geo`
+ @param[in] NParams number of source parameters (7, 8, or 9)
+ @param[in] geo sky geometry from ucb_sky_geometry()
+ @param[out] filter[4] TDI response to each basis amplitude, at least 2*BW long
+ @param[in] BW source bandwidth [bins], no larger than the workspace
+ @param[in] NI number of interferometer channels (1 for X, 2 for A,E, 3 for X,Y,Z)
+ @param ws scratch memory from alloc_ucb_waveform_workspace()
+ */
+void ucb_waveform_filters_sky(struct Orbit *orbit, LISA_tdi_function tdi, double T, double t0, double *params, int NParams, struct UCBSkyGeometry *geo, struct TDI **filter, int BW, int NI, struct UCBWaveformWorkspace *ws);
+
+/**
+ \brief Weights of the ucb_waveform_filters() basis responses
+
+ @param[in] params[] source parameters, only params[3,4,5,6] are used
+ @param[out] a[4] weights of the four filters
+ */
+void ucb_filter_weights(double *params, double *a);
+
+/**
+ \brief ucb_waveform() from the basis responses of ucb_waveform_filters()
+
+ Linear combination of the four filters weighted by the polarization amplitudes
+ of params[3,4,5,6].  Costs O(BW) instead of a full waveform evaluation.
+
+ @param[in] params[] source parameters
+ @param[in] filter[4] basis responses for the intrinsic parameters in params
+ @param[out] X,Y,Z Michelson channels
+ @param[out] A,E noise orthogonal TDI channels
+ @param[in] BW source bandwidth [bins]
+ */
+void ucb_waveform_extrinsic(double *params, struct TDI **filter, double *X, double *Y, double *Z, double *A, double *E, int BW);
+
 /**
  \brief Wavelet domain ultra compact binary waveform generators as first described in <a href="https://https://journals.aps.org/prd/abstract/10.1103/PhysRevD.102.124038">Cornish, PRD 102, 124038</a>.
 
@@ -247,6 +439,48 @@ void ucb_waveform(struct Orbit *orbit, char *format, double T, double t0, double
  */
 void ucb_waveform_wavelet(struct Orbit *orbit, struct Wavelets *wdm, double Tobs, double t0, double *params, int *wavelet_list, int *Nwavelet, double *X, double *Y, double *Z);
 
+/**
+ \brief Scratch memory for ucb_waveform_wavelet_filters()
+
+ Sized for the orbit and wavelet basis it was allocated with and owned by one thread.
+ */
+struct UCBWaveletWorkspace;
+
+/**
+ \brief Allocate scratch memory for ucb_waveform_wavelet_filters()
+ */
+struct UCBWaveletWorkspace *alloc_ucb_wavelet_workspace(struct Orbit *orbit, struct Wavelets *wdm);
+
+/**
+ \brief Free memory from alloc_ucb_wavelet_workspace()
+ */
+void free_ucb_wavelet_workspace(struct UCBWaveletWorkspace *ws);
+
+/**
+ \brief Sparse wavelet domain F-statistic filters
+
+ The four filters of get_Fstat_logL_wavelet(), ucb_waveform_wavelet() with
+ \f$ (\psi,\varphi_0) = (0,0),\ (\pi/4,\pi),\ (0,3\pi/2),\ (\pi/4,\pi/2) \f$,
+ edge-on and with \f$\log\mathcal{A}=\log 2\f$.
+ All four occupy the same wavelet pixels, so they are returned as compact
+ arrays aligned with the one `wavelet_list`.
+ The barycenter waveform and downsampling are shared by the filters, and
+ filters with the same polarization share the LISA response.
+ The filters depend on params[0,1,2,7].
+
+ @param[in] orbit LISA ephemerides
+ @param[in] wdm defines wavelet basis
+ @param[in] Tobs observation time \f$ T_{\rm obs}\ [{\rm s}]\f$
+ @param[in] t0 start time of observations \f$ t_0\ [{\rm s}]\f$
+ @param[in] params[] source parameters, extrinsic parameters are ignored
+ @param[out] wavelet_list list of active wavelet pixels
+ @param[out] Nwavelet number of active wavelet pixels
+ @param[out] filter[12] channel `c` (X,Y,Z) of filter `i` in `filter[3*i+c][n]` for pixel `wavelet_list[n]`,
+ each at least `4*wdm->NT` long
+ @param ws scratch memory from alloc_ucb_wavelet_workspace()
+ */
+void ucb_waveform_wavelet_filters(struct Orbit *orbit, struct Wavelets *wdm, double Tobs, double t0, double *params, int *wavelet_list, int *Nwavelet, double **filter, struct UCBWaveletWorkspace *ws);
+
 /**
  * @brief Wavelet domain UCB waveform using lookup table transform.
  * @see ucb_waveform_wavelet()
@@ -0,0 +1 @@
+#define GITVERSION "ff6923a"
@@ -0,0 +1,540 @@
+/*
+ * Copyright 2025 Tyson B. Littenberg
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glass_utils.h"
+
+#define CHAIN_FILE_MAGIC "GLASSCHN"
+#define CHAIN_FILE_LINE 65536 //max characters in a row of an ascii chain file
+
+static const char hdf5_signature[8] = {'\211','H','D','F','\r','\n','\032','\n'};
+
+static long binary_header_size(int Ncol)
+{
+    return 8 + 2*sizeof(int32_t) + (long)Ncol*CHAIN_FILE_NAME_SIZE;
+}
+
+static struct ChainFile *alloc_chain_file(const char *format, int Ncol, char mode)
+{
+    struct ChainFile *chain_file = malloc(sizeof(struct ChainFile));
+    sprintf(chain_file->format,"%s",format);
+    chain_file->mode    = mode;
+    chain_file->Ncol    = Ncol;
+    chain_file->Nrow    = 0;
+    chain_file->irow    = 0;
+    chain_file->fptr    = NULL;
+    chain_file->file    = -1;
+    chain_file->dataset = -1;
+    chain_file->Nbuffer = 0;
+    chain_file->ibuffer = 0;
+    chain_file->line    = NULL;
+    chain_file->buffer  = malloc(CHAIN_FILE_CHUNK*Ncol*sizeof(double));
+    chain_file->names   = malloc(Ncol*sizeof(char *));
+    for(int n=0; n<Ncol; n++) chain_file->names[n] = calloc(CHAIN_FILE_NAME_SIZE,sizeof(char));
+    return chain_file;
+}
+
+static void set_column_names(struct ChainFile *chain_file, char **names)
+{
+    for(int n=0; n<chain_file->Ncol; n++)
+    {
+        if(names!=NULL) snprintf(chain_file->names[n],CHAIN_FILE_NAME_SIZE,"%s",names[n]);
+        else            snprintf(chain_file->names[n],CHAIN_FILE_NAME_SIZE,"c%i",n);
+    }
+}
+
+static int file_exists(const char *filename)
+{
+    struct stat st;
+    return (stat(filename,&st)==0 && st.st_size>0);
+}
+
+static void check_chain_format(const char *format)
+{
+    if(strcmp(format,"ascii") && strcmp(format,"binary") && strcmp(format,"hdf5"))
+    {
+        fprintf(stderr,"Unsupported chain file format %s\n",format);
+        fprintf(stderr,"Use --chain-format ascii, binary, or hdf5\n");
+        exit(1);
+    }
+}
+
+const char *chain_file_extension(const char *format)
+{
+    if(!strcmp(format,"binary")) return "bin";
+    if(!strcmp(format,"hdf5"))   return "h5";
+    return "dat";
+}
+
+
+/* ==================================================================== */
+/*                           binary backend                             */
+/* ==================================================================== */
+
+static void write_binary_header(struct ChainFile *chain_file)
+{
+    int32_t version = CHAIN_FILE_VERSION;
+    int32_t Ncol    = chain_file->Ncol;
+    fwrite(CHAIN_FILE_MAGIC, sizeof(char), 8, chain_file->fptr);
+    fwrite(&version, sizeof(int32_t), 1, chain_file->fptr);
+    fwrite(&Ncol, sizeof(int32_t), 1, chain_file->fptr);
+    for(int n=0; n<chain_file->Ncol; n++) fwrite(chain_file->names[n], sizeof(char), CHAIN_FILE_NAME_SIZE, chain_file->fptr);
+}
+
+/* reads header of binary file at fptr, returns number of columns */
+static int read_binary_header(FILE *fptr, const char *filename)
+{
+    char magic[8];
+    int32_t version, Ncol;
+    int check = 0;
+    check += fread(magic, sizeof(char), 8, fptr);
+    check += fread(&version, sizeof(int32_t), 1, fptr);
+    check += fread(&Ncol, sizeof(int32_t), 1, fptr);
+    if(check!=10 || memcmp(magic,CHAIN_FILE_MAGIC,8) || version!=CHAIN_FILE_VERSION || Ncol<1)
+    {
+        fprintf(stderr,"Error reading header of chain file %s\n",filename);
+        exit(1);
+    }
+    return (int)Ncol;
+}
+
+static long count_binary_rows(struct ChainFile *chain_file, const char *filename)
+{
+    struct stat st;
+    stat(filename,&st);
+    long rowsize = chain_file->Ncol*sizeof(double);
+    return (st.st_size - binary_header_size(chain_file->Ncol))/rowsize;
+}
+
+static void open_binary_writer(struct ChainFile *chain_file, const char *filename)
+{
+    if(chain_file->mode=='a' && file_exists(filename))
+    {
+        chain_file->fptr = fopen(filename,"r+b");
+        int Ncol = read_binary_header(chain_file->fptr, filename);
+        if(Ncol!=chain_file->Ncol)
+        {
+            fprintf(stderr,"Can not append %i columns to chain file %s with %i columns\n",chain_file->Ncol,filename,Ncol);
+            exit(1);
+        }
+
+        //drop partial row left by an interrupted run
+        chain_file->Nrow = count_binary_rows(chain_file, filename);
+        fseek(chain_file->fptr, binary_header_size(Ncol) + chain_file->Nrow*Ncol*sizeof(double), SEEK_SET);
+    }
+    else
+    {
+        chain_file->fptr = fopen(filename,"wb");
+        if(chain_file->fptr==NULL)
+        {
+            fprintf(stderr,"Error opening chain file %s\n",filename);
+            exit(1);
+        }
+        write_binary_header(chain_file);
+    }
+}
+
+static void open_binary_reader(struct ChainFile *chain_file, const char *filename)
+{
+    for(int n=0; n<chain_file->Ncol; n++)
+    {
+        if(fread(chain_file->names[n], sizeof(char), CHAIN_FILE_NAME_SIZE, chain_file->fptr)!=CHAIN_FILE_NAME_SIZE)
+        {
+            fprintf(stderr,"Error reading header of chain file %s\n",filename);
+            exit(1);
+        }
+        chain_file->names[n][CHAIN_FILE_NAME_SIZE-1] = '\0';
+    }
+    chain_file->Nrow = count_binary_rows(chain_file, filename);
+}
+
+
+/* ==================================================================== */
+/*                            HDF5 backend                              */
+/* ==================================================================== */
+
+static void write_hdf5_column_names(struct ChainFile *chain_file)
+{
+    char *names = calloc(chain_file->Ncol*CHAIN_FILE_NAME_SIZE,sizeof(char));
+    for(int n=0; n<chain_file->Ncol; n++) memcpy(names+n*CHAIN_FILE_NAME_SIZE, chain_file->names[n], CHAIN_FILE_NAME_SIZE);
+
+    hsize_t dims[1] = {chain_file->Ncol};
+    hid_t type  = H5Tcopy(H5T_C_S1);
+    H5Tset_size(type, CHAIN_FILE_NAME_SIZE);
+    hid_t space = H5Screate_simple(1, dims, NULL);
+    hid_t attr  = H5Acreate2(chain_file->dataset, "columns", type, space, H5P_DEFAULT, H5P_DEFAULT);
+    H5Awrite(attr, type, names);
+
+    H5Aclose(attr);
+    H5Sclose(space);
+    H5Tclose(type);
+    free(names);
+}
+
+static void read_hdf5_column_names(struct ChainFile *chain_file)
+{
+    if(H5Aexists(chain_file->dataset, "columns")<=0)
+    {
+        set_column_names(chain_file, NULL);
+        return;
+    }
+
+    char *names = calloc(chain_file->Ncol*CHAIN_FILE_NAME_SIZE,sizeof(char));
+    hid_t type = H5Tcopy(H5T_C_S1);
+    H5Tset_size(type, CHAIN_FILE_NAME_SIZE);
+    hid_t attr = H5Aopen(chain_file->dataset, "columns", H5P_DEFAULT);
+    H5Aread(attr, type, names);
+    for(int n=0; n<chain_file->Ncol; n++)
+    {
+        memcpy(chain_file->names[n], names+n*CHAIN_FILE_NAME_SIZE, CHAIN_FILE_NAME_SIZE);
+        chain_file->names[n][CHAIN_FILE_NAME_SIZE-1] = '\0';
+    }
+
+    H5Aclose(attr);
+    H5Tclose(type);
+    free(names);
+}
+
+/* opens /chain dataset of file and returns its number of rows and columns */
+static hid_t open_hdf5_dataset(hid_t file, const char *filename, long *Nrow, int *Ncol)
+{
+    hid_t dataset = H5Dopen2(file, "/chain", H5P_DEFAULT);
+    if(dataset<0)
+    {
+        fprintf(stderr,"Chain file %s has no /chain dataset\n",filename);
+        exit(1);
+    }
+
+    hsize_t dims[2];
+    hid_t space = H5Dget_space(dataset);
+    if(H5Sget_simple_extent_ndims(space)!=2)
+    {
+        fprintf(stderr,"Dataset /chain in %s is not a table\n",filename);
+        exit(1);
+    }
+    H5Sget_simple_extent_dims(space, dims, NULL);
+    H5Sclose(space);
+
+    *Nrow = (long)dims[0];
+    *Ncol = (int)dims[1];
+    return dataset;
+}
+
+static void open_hdf5_writer(struct ChainFile *chain_file, const char *filename)
+{
+    if(chain_file->mode=='a' && file_exists(filename))
+    {
+        long Nrow;
+        int Ncol;
+        chain_file->file = H5Fopen(filename, H5F_ACC_RDWR, H5P_DEFAULT);
+        if(chain_file->file<0)
+        {
+            fprintf(stderr,"Error opening chain file %s\n",filename);
+            exit(1);
+        }
+        chain_file->dataset = open_hdf5_dataset(chain_file->file, filename, &Nrow, &Ncol);
+        if(Ncol!=chain_file->Ncol)
+        {
+            fprintf(stderr,"Can not append %i columns to chain file %s with %i columns\n",chain_file->Ncol,filename,Ncol);
+            exit(1);
+        }
+        chain_file->Nrow = Nrow;
+    }
+    else
+    {
+        chain_file->file = H5Fcreate(filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+        if(chain_file->file<0)
+        {
+            fprintf(stderr,"Error opening chain file %s\n",filename);
+            exit(1);
+        }
+
+        hsize_t dims[2]    = {0, chain_file->Ncol};
+        hsize_t maxdims[2] = {H5S_UNLIMITED, chain_file->Ncol};
+        hsize_t chunk[2]   = {CHAIN_FILE_CHUNK, chain_file->Ncol};
+
+        hid_t space = H5Screate_simple(2, dims, maxdims);
+        hid_t plist = H5Pcreate(H5P_DATASET_CREATE);
+        H5Pset_chunk(plist, 2, chunk);
+        if(H5Zfilter_avail(H5Z_FILTER_DEFLATE)>0)
+        {
+            H5Pset_shuffle(plist);
+            H5Pset_deflate(plist, 4);
+        }
+        chain_file->dataset = H5Dcreate2(chain_file->file, "/chain", H5T_IEEE_F64LE, space, H5P_DEFAULT, plist, H5P_DEFAULT);
+        H5Pclose(plist);
+        H5Sclose(space);
+
+        write_hdf5_column_names(chain_file);
+    }
+}
+
+static void write_hdf5_rows(struct ChainFile *chain_file)
+{
+    hsize_t start[2] = {chain_file->Nrow - chain_file->Nbuffer, 0};
+    hsize_t count[2] = {chain_file->Nbuffer, chain_file->Ncol};
+    hsize_t dims[2]  = {chain_file->Nrow, chain_file->Ncol};
+
+    H5Dset_extent(chain_file->dataset, dims);
+    hid_t fspace = H5Dget_space(chain_file->dataset);
+    H5Sselect_hyperslab(fspace, H5S_SELECT_SET, start, NULL, count, NULL);
+    hid_t mspace = H5Screate_simple(2, count, NULL);
+    H5Dwrite(chain_file->dataset, H5T_NATIVE_DOUBLE, mspace, fspace, H5P_DEFAULT, chain_file->buffer);
+    H5Sclose(mspace);
+    H5Sclose(fspace);
+}
+
+static void read_hdf5_rows(struct ChainFile *chain_file)
+{
+    long Nread = chain_file->Nrow - chain_file->irow;
+    if(Nread>CHAIN_FILE_CHUNK) Nread = CHAIN_FILE_CHUNK;
+
+    hsize_t start[2] = {chain_file->irow, 0};
+    hsize_t count[2] = {Nread, chain_file->Ncol};
+
+    hid_t fspace = H5Dget_space(chain_file->dataset);
+    H5Sselect_hyperslab(fspace, H5S_SELECT_SET, start, NULL, count, NULL);
+    hid_t mspace = H5Screate_simple(2, count, NULL);
+    H5Dread(chain_file->dataset, H5T_NATIVE_DOUBLE, mspace, fspace, H5P_DEFAULT, chain_file->buffer);
+    H5Sclose(mspace);
+    H5Sclose(fspace);
+
+    chain_file->Nbuffer = (int)Nread;
+    chain_file->ibuffer = 0;
+}
+
+
+/* ==================================================================== */
+/*                            ascii backend                             */
+/* ==================================================================== */
+
+static int count_ascii_columns(char *line)
+{
+    int Ncol = 0;
+    char *end;
+    for(;;)
+    {
+        strtod(line, &end);
+        if(end==line) break;
+        Ncol++;
+        line = end;
+    }
+    return Ncol;
+}
+
+/* counts rows and columns of ascii file at fptr */
+static void scan_ascii_file(FILE *fptr, char *line, long *Nrow, int *Ncol)
+{
+    *Nrow = 0;
+    *Ncol = 0;
+    while(fgets(line, CHAIN_FILE_LINE, fptr) != NULL)
+    {
+        if(*Nrow==0) *Ncol = count_ascii_columns(line);
+        (*Nrow)++;
+    }
+    rewind(fptr);
+    if(*Ncol<1) *Ncol = 1;
+}
+
+static int read_ascii_row(struct ChainFile *chain_file, double *row)
+{
+    if(fgets(chain_file->line, CHAIN_FILE_LINE, chain_file->fptr) == NULL) return 1;
+
+    char *column = chain_file->line;
+    char *end;
+    int n;
+    for(n=0; n<chain_file->Ncol; n++)
+    {
+        row[n] = strtod(column, &end);
+        if(end==column) break;
+        column = end;
+    }
+    if(n==0) return 1;
+    for(; n<chain_file->Ncol; n++) row[n] = 0.0;
+
+    return 0;
+}
+
+
+/* ==================================================================== */
+/*                              Interface                               */
+/* ==================================================================== */
+
+/* hands rows in buffer to the binary or HDF5 file */
+static void write_buffered_rows(struct ChainFile *chain_file)
+{
+    if(chain_file->Nbuffer==0) return;
+
+    if(!strcmp(chain_file->format,"hdf5")) write_hdf5_rows(chain_file);
+    else fwrite(chain_file->buffer, sizeof(double), chain_file->Nbuffer*chain_file->Ncol, chain_file->fptr);
+
+    chain_file->Nbuffer = 0;
+}
+
+struct ChainFile *open_chain_file(const char *filename, const char *format, int Ncol, char **names, const char *mode)
+{
+    struct ChainFile *chain_file = NULL;
+
+    if(mode[0]=='r')
+    {
+        FILE *fptr = fopen(filename,"rb");
+        if(fptr==NULL)
+        {
+            fprintf(stderr,"Error opening chain file %s\n",filename);
+            exit(1);
+        }
+
+        //detect format from first bytes of file
+        char magic[8] = {0};
+        size_t Nmagic = fread(magic, sizeof(char), 8, fptr);
+
+        if(Nmagic==8 && !memcmp(magic,CHAIN_FILE_MAGIC,8))
+        {
+            rewind(fptr);
+            chain_file = alloc_chain_file("binary", read_binary_header(fptr, filename), 'r');
+            chain_file->fptr = fptr;
+            open_binary_reader(chain_file, filename);
+        }
+        else if(Nmagic==8 && !memcmp(magic,hdf5_signature,8))
+        {
+            fclose(fptr);
+            hid_t file = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+            if(file<0)
+            {
+                fprintf(stderr,"Error opening chain file %s\n",filename);
+                exit(1);
+            }
+
+            long Nrow;
+            hid_t dataset = open_hdf5_dataset(file, filename, &Nrow, &Ncol);
+
+            chain_file = alloc_chain_file("hdf5", Ncol, 'r');
+            chain_file->file    = file;
+            chain_file->dataset = dataset;
+            chain_file->Nrow    = Nrow;
+            read_hdf5_column_names(chain_file);
+        }
+        else
+        {
+            long Nrow;
+            char *line = malloc(CHAIN_FILE_LINE*sizeof(char));
+            rewind(fptr);
+            scan_ascii_file(fptr, line, &Nrow, &Ncol);
+
+            chain_file = alloc_chain_file("ascii", Ncol, 'r');
+            chain_file->fptr = fptr;
+            chain_file->line = line;
+            chain_file->Nrow = Nrow;
+            set_column_names(chain_file, NULL);
+        }
+
+        return chain_file;
+    }
+
+    if(mode[0]!='w' && mode[0]!='a')
+    {
+        fprintf(stderr,"Unsupported mode %s for chain file %s\n",mode,filename);
+        exit(1);
+    }
+
+    check_chain_format(format);
+
+    chain_file = alloc_chain_file(format, Ncol, mode[0]);
+    set_column_names(chain_file, names);
+
+    if(!strcmp(format,"binary")) open_binary_writer(chain_file, filename);
+    else if(!strcmp(format,"hdf5")) open_hdf5_writer(chain_file, filename);
+    else
+    {
+        chain_file->fptr = fopen(filename, (mode[0]=='a') ? "a" : "w");
+        if(chain_file->fptr==NULL)
+        {
+            fprintf(stderr,"Error opening chain file %s\n",filename);
+            exit(1);
+        }
+    }
+
+    return chain_file;
+}
+
+void write_chain_row(struct ChainFile *chain_file, const double *row)
+{
+    if(!strcmp(chain_file->format,"ascii"))
+    {
+        for(int n=0; n<chain_file->Ncol; n++) fprintf(chain_file->fptr,"%.17g ",row[n]);
+        fprintf(chain_file->fptr,"\n");
+        chain_file->Nrow++;
+        return;
+    }
+
+    memcpy(chain_file->buffer + chain_file->Nbuffer*chain_file->Ncol, row, chain_file->Ncol*sizeof(double));
+    chain_file->Nbuffer++;
+    chain_file->Nrow++;
+
+    if(chain_file->Nbuffer==CHAIN_FILE_CHUNK) write_buffered_rows(chain_file);
+}
+
+int read_chain_row(struct ChainFile *chain_file, double *row)
+{
+    if(chain_file->irow>=chain_file->Nrow) return 1;
+
+    if(!strcmp(chain_file->format,"ascii"))
+    {
+        if(read_ascii_row(chain_file, row)) return 1;
+    }
+    else if(!strcmp(chain_file->format,"binary"))
+    {
+        if(fread(row, sizeof(double), chain_file->Ncol, chain_file->fptr) != (size_t)chain_file->Ncol) return 1;
+    }
+    else
+    {
+        if(chain_file->ibuffer==chain_file->Nbuffer) read_hdf5_rows(chain_file);
+        memcpy(row, chain_file->buffer + chain_file->ibuffer*chain_file->Ncol, chain_file->Ncol*sizeof(double));
+        chain_file->ibuffer++;
+    }
+
+    chain_file->irow++;
+    return 0;
+}
+
+void flush_chain_file(struct ChainFile *chain_file)
+{
+    if(chain_file->mode=='r') return;
+
+    write_buffered_rows(chain_file);
+
+    if(!strcmp(chain_file->format,"hdf5")) H5Fflush(chain_file->file, H5F_SCOPE_LOCAL);
+    else fflush(chain_file->fptr);
+}
+
+void close_chain_file(struct ChainFile *chain_file)
+{
+    if(chain_file==NULL) return;
+
+    flush_chain_file(chain_file);
+
+    if(!strcmp(chain_file->format,"hdf5"))
+    {
+        H5Dclose(chain_file->dataset);
+        H5Fclose(chain_file->file);
+    }
+    else fclose(chain_file->fptr);
+
+    for(int n=0; n<chain_file->Ncol; n++) free(chain_file->names[n]);
+    free(chain_file->names);
+    free(chain_file->buffer);
+    free(chain_file->line);
+    free(chain_file);
+}
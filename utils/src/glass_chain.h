@@ -0,0 +1,115 @@
+/*
+ * Copyright 2025 Tyson B. Littenberg
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+@file glass_chain.h
+\brief Binary chain files shared by the samplers and post processing.
+
+ Chain files are tables of `double` with a fixed number of named columns,
+ appended one row (sample) at a time. Three formats are supported:
+
+ - `ascii`: whitespace separated text, one row per line (the legacy `.dat` files)
+ - `binary`: self-describing binary file (`.bin`), see below
+ - `hdf5`: chunked, compressed extendible dataset `/chain` (`.h5`)
+
+ The `binary` layout is a header followed by the rows in native byte order
+
+ | bytes | content |
+ |-------|---------|
+ | 8 | magic string `GLASSCHN` |
+ | 4 | `int32` format version, CHAIN_FILE_VERSION |
+ | 4 | `int32` number of columns `Ncol` |
+ | `Ncol` x CHAIN_FILE_NAME_SIZE | column names |
+ | `Nrow` x `Ncol` x 8 | `double` samples |
+
+ so a file is appended to by writing more rows, and the number of rows
+ follows from the file size. The `hdf5` dataset stores the column names in
+ its `columns` attribute.
+
+ Readers detect the format of an existing file, so post processing handles
+ all three with open_chain_file() and read_chain_row().
+ */
+
+#ifndef glass_chain_h
+#define glass_chain_h
+
+#define CHAIN_FILE_VERSION 1    //!<version of `binary` chain file layout
+#define CHAIN_FILE_NAME_SIZE 32 //!<bytes reserved for each column name
+#define CHAIN_FILE_CHUNK 1024   //!<rows buffered between writes, and HDF5 chunk size
+
+/**
+ \brief Chain file opened for reading or writing.
+ */
+struct ChainFile
+{
+    char format[16]; //!<`ascii`, `binary`, or `hdf5`
+    char mode;       //!<`r`, `w`, or `a`
+    int Ncol;        //!<number of columns
+    long Nrow;       //!<number of rows in file (reading) or written to it (writing)
+    long irow;       //!<next row to read
+    char **names;    //!<column names
+
+    FILE *fptr;      //!<`ascii` and `binary` file pointer
+    hid_t file;      //!<`hdf5` file
+    hid_t dataset;   //!<`hdf5` dataset `/chain`
+
+    double *buffer;  //!<rows waiting to be written, or read ahead from `hdf5` files
+    int Nbuffer;     //!<number of rows in ChainFile::buffer
+    int ibuffer;     //!<next row to read from ChainFile::buffer
+    char *line;      //!<line buffer for `ascii` files
+};
+
+/**
+ \brief File name extension for chain format `format`: `dat`, `bin`, or `h5`
+ */
+const char *chain_file_extension(const char *format);
+
+/**
+ \brief Open chain file.
+
+ With `mode` = `w` a new file of `Ncol` columns labeled `names` (or
+ `c0`, `c1`, ... if `names` is `NULL`) is created in `format`.
+ With `mode` = `a` rows are appended to an existing file, which must
+ have `Ncol` columns, or a new file is created if none exists.
+ With `mode` = `r` the format, columns, and number of rows are read from
+ the file and `format`, `Ncol` and `names` are ignored.
+ */
+struct ChainFile *open_chain_file(const char *filename, const char *format, int Ncol, char **names, const char *mode);
+
+/**
+ \brief Append `Ncol` values in `row` to chain file
+ */
+void write_chain_row(struct ChainFile *chain_file, const double *row);
+
+/**
+ \brief Read next row of chain file into `row`.
+
+ Returns 0 on success and 1 at the end of the file.
+ Missing columns of short rows in `ascii` files are set to zero.
+ */
+int read_chain_row(struct ChainFile *chain_file, double *row);
+
+/**
+ \brief Write buffered rows to disk
+ */
+void flush_chain_file(struct ChainFile *chain_file);
+
+/**
+ \brief Flush, close, and free chain file
+ */
+void close_chain_file(struct ChainFile *chain_file);
+
+#endif /* glass_chain_h */
@@ -105,6 +105,10 @@ void initialize_chain(struct Chain *chain, struct Flags *flags, unsigned int *se
     if(NC>1) chain->temperature[NC-1] = 1e12;
     chain->logLmax = 0.0;
     
+    chain->cost = calloc(NC,sizeof(double));
+    chain->schedule = calloc(NC,sizeof(int));
+    for(ic=0; ic<NC; ic++) chain->schedule[ic] = ic;
+
     chain->r = malloc(NC*sizeof(unsigned int *));
     
     for(ic=0; ic<NC; ic++)
@@ -116,13 +120,41 @@ void initialize_chain(struct Chain *chain, struct Flags *flags, unsigned int *se
         rand_r_U_0_1(seed);
     }
     
+    //binary chain files replace the ASCII parameter, dimension, likelihood, and temperature chains
+    int binary = strcmp(flags->chainFormat,"ascii");
+    const char *ext = chain_file_extension(flags->chainFormat);
+    chain->likelihoodFile   = NULL;
+    chain->temperatureFile  = NULL;
+    chain->likelihoodTable  = NULL;
+    chain->temperatureTable = NULL;
+
     if(!flags->quiet)
     {
-        sprintf(filename,"%s/log_likelihood_chain.dat",chain->chainDir);
-        chain->likelihoodFile = fopen(filename,mode);
-        
-        sprintf(filename,"%s/temperature_chain.dat",chain->chainDir);
-        chain->temperatureFile = fopen(filename,mode);
+        if(binary)
+        {
+            char **names = malloc((NC+1)*sizeof(char *));
+            for(ic=0; ic<=NC; ic++) names[ic] = malloc(CHAIN_FILE_NAME_SIZE*sizeof(char));
+            sprintf(names[0],"step");
+            
+            for(ic=0; ic<NC; ic++) sprintf(names[ic+1],"logL_%i",ic);
+            sprintf(filename,"%s/log_likelihood_chain.%s",chain->chainDir,ext);
+            chain->likelihoodTable = open_chain_file(filename, flags->chainFormat, NC+1, names, mode);
+            
+            for(ic=0; ic<NC; ic++) sprintf(names[ic+1],"beta_%i",ic);
+            sprintf(filename,"%s/temperature_chain.%s",chain->chainDir,ext);
+            chain->temperatureTable = open_chain_file(filename, flags->chainFormat, NC+1, names, mode);
+            
+            for(ic=0; ic<=NC; ic++) free(names[ic]);
+            free(names);
+        }
+        else
+        {
+            sprintf(filename,"%s/log_likelihood_chain.dat",chain->chainDir);
+            chain->likelihoodFile = fopen(filename,mode);
+            
+            sprintf(filename,"%s/temperature_chain.dat",chain->chainDir);
+            chain->temperatureFile = fopen(filename,mode);
+        }
     }
     
     chain->chainFile = malloc(NC*sizeof(FILE *));
@@ -130,8 +162,12 @@ void initialize_chain(struct Chain *chain, struct Flags *flags, unsigned int *se
     chain->chainFile[0] = fopen(filename,mode);
     
     chain->parameterFile = malloc(NC*sizeof(FILE *));
-    sprintf(filename,"%s/parameter_chain.dat.0",chain->chainDir);
-    chain->parameterFile[0] = fopen(filename,mode);
+    chain->parameterFile[0] = NULL;
+    if(!binary)
+    {
+        sprintf(filename,"%s/parameter_chain.dat.0",chain->chainDir);
+        chain->parameterFile[0] = fopen(filename,mode);
+    }
     
     chain->dimensionFile = malloc(flags->DMAX*sizeof(FILE *));
     for(int i=0; i<flags->DMAX; i++)
@@ -140,6 +176,10 @@ void initialize_chain(struct Chain *chain, struct Flags *flags, unsigned int *se
         chain->dimensionFile[i]=NULL;
     }
     
+    /* binary parameter and dimension files are created when the number of columns is known */
+    chain->parameterTable = calloc(NC,sizeof(struct ChainFile *));
+    chain->dimensionTable = calloc(flags->DMAX,sizeof(struct ChainFile *));
+    
     chain->noiseFile = malloc(NC*sizeof(FILE *));
     sprintf(filename,"%s/noise_chain.dat.0",chain->chainDir);
     chain->noiseFile[0] = fopen(filename,mode);
@@ -419,6 +459,37 @@ void free_noise(struct Noise *noise)
     free(noise);
 }
 
+void run_chain_blocks(struct Chain *chain, void (*block)(void *arg, int ic), void *arg)
+{
+    #pragma omp single
+    {
+        //longest processing time first (insertion sort, chains are nearly in order from the last call)
+        for(int i=1; i<chain->NC; i++)
+        {
+            int ic = chain->schedule[i];
+            int j = i;
+            while(j>0 && chain->cost[chain->schedule[j-1]] < chain->cost[ic])
+            {
+                chain->schedule[j] = chain->schedule[j-1];
+                j--;
+            }
+            chain->schedule[j] = ic;
+        }
+        
+        for(int i=0; i<chain->NC; i++)
+        {
+            int ic = chain->schedule[i];
+            
+            #pragma omp task firstprivate(ic)
+            {
+                double start = omp_get_wtime();
+                (*block)(arg, ic);
+                chain->cost[ic] = omp_get_wtime() - start;
+            }
+        }
+    }//implicit barrier at end of single waits for every task
+}
+
 void free_chain(struct Chain *chain, struct Flags *flags)
 {
     free(chain->index);
@@ -427,23 +498,28 @@ void free_chain(struct Chain *chain, struct Flags *flags)
     free(chain->avgLogL);
     free(chain->dimension);
     free(chain->r);
+    free(chain->cost);
+    free(chain->schedule);
     
-    if(!flags->quiet)
-    {
-        fclose(chain->likelihoodFile);
-        fclose(chain->temperatureFile);
-    }
+    if(chain->likelihoodFile!=NULL)  fclose(chain->likelihoodFile);
+    if(chain->temperatureFile!=NULL) fclose(chain->temperatureFile);
+    close_chain_file(chain->likelihoodTable);
+    close_chain_file(chain->temperatureTable);
 
     fclose(chain->chainFile[0]);
 
-    fclose(chain->parameterFile[0]);
+    if(chain->parameterFile[0]!=NULL) fclose(chain->parameterFile[0]);
+    for(int ic=0; ic<chain->NC; ic++) close_chain_file(chain->parameterTable[ic]);
+    free(chain->parameterTable);
     
     for(int i=0; i<flags->DMAX; i++)
     {
         /* only create these files when needed */
         if(chain->dimensionFile[i]!=NULL) fclose(chain->dimensionFile[i]);
+        close_chain_file(chain->dimensionTable[i]);
     }
     free(chain->dimensionFile);
+    free(chain->dimensionTable);
 
     fclose(chain->noiseFile[0]);
     
@@ -1416,6 +1492,7 @@ void print_glass_usage()
     fprintf(stdout,"       --threads     : number of parallel threads (max)    \n");
     fprintf(stdout,"       --prior       : sample from prior                   \n");
     fprintf(stdout,"       --no-rj       : turn off RJMCMC                     \n");
+    fprintf(stdout,"       --chain-format: ascii, binary, or hdf5 (ascii)      \n");
     fprintf(stdout,"\n");
     
     //Misc.
@@ -1423,6 +1500,7 @@ void print_glass_usage()
     fprintf(stdout,"       --rundir      : top level run directory ['./']\n");
     fprintf(stdout,"       --match-in1   : input paramaters for overlap [filename] \n");
     fprintf(stdout,"       --match-in2   : output match values [filename] \n");
+    fprintf(stdout,"       --profile     : write timing summary to profile.dat \n");
     fprintf(stdout,"\n");
 
     /*
@@ -1462,10 +1540,12 @@ void parse_data_args(int argc, char **argv, struct Data *data, struct Orbit *orb
     flags->orbit       = 0;
     flags->prior       = 0;
     flags->resume      = 0;
+    flags->profile     = 0;
     flags->NMCMC       = 1000;
     flags->NBURN       = 1000;
     flags->threads     = omp_get_max_threads();
     sprintf(flags->runDir,"./");
+    sprintf(flags->chainFormat,"ascii");
     chain->NC          = 12;//number of chains
     int set_fmax_flag  = 0; //flag watching for if fmax is set by CLI
     
@@ -1528,6 +1608,7 @@ void parse_data_args(int argc, char **argv, struct Data *data, struct Orbit *orb
         {"steps",      required_argument, 0, 0},
         {"threads",    required_argument, 0, 0},
         {"rundir",     required_argument, 0, 0},
+        {"chain-format",required_argument, 0, 0},
         
         /* These options don’t set a flag.
          We distinguish them by their indices. */
@@ -1536,6 +1617,7 @@ void parse_data_args(int argc, char **argv, struct Data *data, struct Orbit *orb
         {"quiet",       no_argument, 0,'q'},
         {"debug",       no_argument, 0,'d'},
         {"resume",      no_argument, 0, 0 },
+        {"profile",     no_argument, 0, 0 },
         {"sim-noise",   no_argument, 0, 0 },
         {"conf-noise",  no_argument, 0, 0 },
         {"stationary",  no_argument, 0, 0 },
@@ -1579,6 +1661,7 @@ void parse_data_args(int argc, char **argv, struct Data *data, struct Orbit *orb
                 if(strcmp("no-rj",       long_options[long_index].name) == 0) flags->rj         = 0;
                 if(strcmp("calibration", long_options[long_index].name) == 0) flags->calibration= 1;
                 if(strcmp("resume",      long_options[long_index].name) == 0) flags->resume     = 1;
+                if(strcmp("profile",     long_options[long_index].name) == 0) flags->profile    = 1;
                 if(strcmp("h5-no-mbh",   long_options[long_index].name) == 0) flags->no_mbh     = 1;
                 if(strcmp("h5-no-ucb",   long_options[long_index].name) == 0) flags->no_ucb     = 1;
                 if(strcmp("h5-no-vgb",   long_options[long_index].name) == 0) flags->no_vgb     = 1;
@@ -1586,6 +1669,16 @@ void parse_data_args(int argc, char **argv, struct Data *data, struct Orbit *orb
                 if(strcmp("h5-no-noise", long_options[long_index].name) == 0) flags->no_noise   = 1;
                 if(strcmp("threads",     long_options[long_index].name) == 0) flags->threads    = atoi(optarg);
                 if(strcmp("rundir",      long_options[long_index].name) == 0) strcpy(flags->runDir,optarg);
+                if(strcmp("chain-format",long_options[long_index].name) == 0)
+                {
+                    if(strcmp(optarg,"ascii") && strcmp(optarg,"binary") && strcmp(optarg,"hdf5"))
+                    {
+                        fprintf(stderr,"Unsupported chain file format %s\n",optarg);
+                        fprintf(stderr,"Use --chain-format ascii, binary, or hdf5\n");
+                        exit(1);
+                    }
+                    sprintf(flags->chainFormat,"%s",optarg);
+                }
                 if(strcmp("phase",       long_options[long_index].name) == 0) sprintf(data->format,"phase");
                 if(strcmp("sangria",     long_options[long_index].name) == 0) sprintf(data->format,"sangria");
                 if(strcmp("fmin",        long_options[long_index].name) == 0) sscanf(optarg, "%lg", &data->fmin);
@@ -1663,6 +1756,8 @@ void parse_data_args(int argc, char **argv, struct Data *data, struct Orbit *orb
         exit(1);
     }
     
+    if(flags->profile) enable_profile();
+    
     //Chains should be a multiple of threads for best usage of cores
     if(chain->NC % flags->threads !=0){
         chain->NC += flags->threads - (chain->NC % flags->threads);
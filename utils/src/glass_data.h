@@ -196,6 +196,11 @@ struct Flags
     int resume;     //!<`[--resume; default=FALSE]`: restart sampler from run state saved during checkpointing. Starts from scratch if no checkpointing files are found.
     int catalog;    //!<`[--catalog=FILENAME; default=FALSE]`: use list of previously detected sources supplied in `FILENAME` to clean bandwidth padding (`gb_mcmc`) or for building family tree (`gb_catalog`).
     int grid;       //!<`[--ucb-grid=FILENAME; default=FALSE]`: flag indicating if a gridfile was supplied
+    int summaryLogL;//!<`[--summary-logL; default=FALSE]`: compute the UCB likelihood of extrinsic parameter moves of a single source from F-statistic summary data, see summary_log_likelihood()
+    int delayedAcceptance;//!<`[--delayed-acceptance; default=FALSE]`: screen UCB proposals with surrogate_delta_log_likelihood() before computing the full likelihood
+    int adaptProposals;//!<`[--adapt-proposals; default=FALSE]`: reweight fixed dimension proposals by accepted trials per second during burn in, see adapt_proposal_weights()
+    int fstatAdaptive;//!<`[--fstat-adaptive; default=FALSE]`: build F-statistic proposal on a coarse grid refined only where the F-statistic is large, see build_fstatistic_tree()
+    int profile;    //!<`[--profile; default=FALSE]`: time hot paths of the sampler and write per-thread summary to `profile.dat`, see glass_profile.h
     int threads;    //!<number of openMP threads for parallel tempering
     int psd;        //!<`[--psd=FILENAME; default=FALSE]`: use PSD input as ASCII file from command line
     int help;       //!<`[--help]`: print command line usage and exit
@@ -206,6 +211,7 @@ struct Flags
      */
      ///@{
     char runDir[MAXSTRINGSIZE];       //!<store `DIRECTORY` to serve as top level directory for output files.
+    char chainFormat[16];             //!<`[--chain-format=ascii|binary|hdf5; default=ascii]`: format of parameter, dimension, likelihood, and temperature chain files, see glass_chain.h
     char vbFile[MAXSTRINGSIZE];       //!<store `FILENAME` of list of known binaries `vb_mcmc`
     char ucbGridFile[MAXSTRINGSIZE];  //!<`[--ucb-grid=FILENAME]` frequency grid for multiband UCB analysis
     char **injFile;                   //!<`[--inj=FILENAME]`: list of injection files. Can support up to `NINJ=10` separate injections.
@@ -319,6 +325,23 @@ struct Chain
     FILE *temperatureFile;
     ///@}
     
+    /** @name Binary Chain Files
+     Written in place of Chain::parameterFile, Chain::dimensionFile, Chain::likelihoodFile, and Chain::temperatureFile when Flags::chainFormat is `binary` or `hdf5`.
+     Same columns as the ASCII files, see glass_chain.h.
+     */
+    ///@{
+    struct ChainFile **parameterTable; //!<`chains/parameter_chain.EXT.M`
+    struct ChainFile **dimensionTable; //!<`chains/dimension_chain.EXT.D`
+    struct ChainFile *likelihoodTable; //!<`chains/log_likelihood_chain.EXT`
+    struct ChainFile *temperatureTable;//!<`chains/temperature_chain.EXT`
+    ///@}
+    
+    ///@name Chain scheduling, see run_chain_blocks()
+    ///@{
+    double *cost;  //!<wall time [s] of the last block of steps for each chain
+    int *schedule; //!<chains in order of decreasing Chain::cost
+    ///@}
+    
     char chainDir[MAXSTRINGSIZE]; //!<store chain directory.
     char chkptDir[MAXSTRINGSIZE]; //!<store checkpoint directory.
 
@@ -431,6 +454,21 @@ void initialize_orbit(struct Data *data, struct Orbit *orbit, struct Flags *flag
  */
 void initialize_chain(struct Chain *chain, struct Flags *flags, unsigned int *seed, const char *mode);
 
+/**
+ \brief Runs one block of MCMC steps for every chain, heaviest chains first
+
+ Must be encountered by every thread of the enclosing parallel region.
+ Each chain's block is an OpenMP task, so a thread that finishes early takes
+ the next pending block instead of waiting on a fixed share of the chains.
+ Blocks are started in order of the time they took on the previous call,
+ which is stored in Chain::cost.  Returns once every block has finished.
+
+ @param chain parallel tempering chains
+ @param block runs the block of steps for chain `ic`, must only touch state owned by that chain
+ @param arg passed through to block
+ */
+void run_chain_blocks(struct Chain *chain, void (*block)(void *arg, int ic), void *arg);
+
 /** @name Allocate memory for structures */
 ///@{
 void alloc_data(struct Data *data, struct Flags *flags);
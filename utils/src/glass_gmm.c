@@ -50,6 +50,8 @@ void printUsage(const char *program)
     fprintf( stdout,"\n");
 }
 
+static void read_MVG_record(struct MVG *mode, FILE *fptr, size_t Nminmax);
+
 void read_gmm_binary(struct GMM *gmm, char filename[])
 {
     FILE *fptr = NULL;
@@ -58,6 +60,18 @@ void read_gmm_binary(struct GMM *gmm, char filename[])
     {
         fread(&gmm->NMODE, sizeof gmm->NMODE, 1, fptr);
         
+        /*
+         files written before the support of every parameter was stored
+         only have [min,max] of the first two parameters
+         */
+        size_t N = gmm->NParams;
+        size_t Nminmax = N;
+        long header = (long)sizeof gmm->NMODE;
+        long legacy = (long)(gmm->NMODE*(N*(2+4*N)+3+4)*sizeof(double));
+        fseek(fptr, 0, SEEK_END);
+        if(N > 2 && ftell(fptr) == header + legacy) Nminmax = 2;
+        fseek(fptr, header, SEEK_SET);
+        
         gmm->modes = malloc(gmm->NMODE*sizeof(struct MVG*));
         for(size_t n=0; n<gmm->NMODE; n++)
         {
@@ -65,8 +79,10 @@ void read_gmm_binary(struct GMM *gmm, char filename[])
             alloc_MVG(gmm->modes[n],gmm->NParams);
         }
         
-        for(size_t n=0; n<gmm->NMODE; n++) read_MVG(gmm->modes[n],fptr);
+        for(size_t n=0; n<gmm->NMODE; n++) read_MVG_record(gmm->modes[n],fptr,Nminmax);
         fclose(fptr);
+        
+        compile_gmm(gmm);
     }
     else
     {
@@ -138,11 +154,12 @@ void write_MVG(struct MVG *mode, FILE *fptr)
     glass_matrix_fwrite(fptr,mode->size,mode->evectors);
     glass_vector_fwrite(fptr,mode->size,mode->evalues);
     glass_vector_fwrite(fptr,3,temp);
-    glass_matrix_fwrite(fptr,2,mode->minmax);
+    for(size_t n=0; n<mode->size; n++) glass_vector_fwrite(fptr,2,mode->minmax[n]);
     free_double_vector(temp);
 }
 
-void read_MVG(struct MVG *mode, FILE *fptr)
+/* read MVG with the first Nminmax rows of the support stored in the file */
+static void read_MVG_record(struct MVG *mode, FILE *fptr, size_t Nminmax)
 {
     //vector for holding packed detC,p,and Neff
     double *temp = double_vector(3);
@@ -155,7 +172,14 @@ void read_MVG(struct MVG *mode, FILE *fptr)
     glass_matrix_fread(fptr,mode->size,mode->evectors);
     glass_vector_fread(fptr,mode->size,mode->evalues);
     glass_vector_fread(fptr,3,temp);
-    glass_matrix_fread(fptr,2,mode->minmax);
+    for(size_t n=0; n<Nminmax; n++) glass_vector_fread(fptr,2,mode->minmax[n]);
+
+    //parameters without a stored support are unbounded
+    for(size_t n=Nminmax; n<mode->size; n++)
+    {
+        mode->minmax[n][0] = -INFINITY;
+        mode->minmax[n][1] =  INFINITY;
+    }
 
     //unpack 'em!
     mode->detC = temp[0];
@@ -165,6 +189,11 @@ void read_MVG(struct MVG *mode, FILE *fptr)
     free_double_vector(temp);
 }
 
+void read_MVG(struct MVG *mode, FILE *fptr)
+{
+    read_MVG_record(mode, fptr, mode->size);
+}
+
 static void glass_vector_memcpy(double *copy, double *origin, int n)
 {
     memcpy(copy,origin,n*sizeof(double));
@@ -182,7 +211,7 @@ void copy_MVG(struct MVG *origin, struct MVG *copy)
     glass_matrix_memcpy(copy->L, origin->L, origin->size);
     glass_matrix_memcpy(copy->Cinv, origin->Cinv, origin->size);
     glass_matrix_memcpy(copy->evectors, origin->evectors, origin->size);
-    glass_matrix_memcpy(copy->minmax, origin->minmax, origin->size);
+    for(size_t n=0; n<origin->size; n++) glass_vector_memcpy(copy->minmax[n], origin->minmax[n], 2);
     glass_vector_memcpy(copy->evalues, origin->evalues, origin->size);
     copy->detC = origin->detC;
     copy->p = origin->p;
@@ -227,6 +256,249 @@ double multivariate_gaussian(double *x, struct MVG *mvg, int N)
     return exp(-0.5*chi2)/sqrt(pow(PI2,N)*detC);
 }
 
+struct GMMSortKey
+{
+    double key;
+    int k;
+};
+
+static int compare_gmm_sort_key(const void *a, const void *b)
+{
+    double x = ((const struct GMMSortKey *)a)->key;
+    double y = ((const struct GMMSortKey *)b)->key;
+    return (x > y) - (x < y);
+}
+
+void compile_gmm(struct GMM *gmm)
+{
+    int NP = (int)gmm->NParams;
+    int NMODE = (int)gmm->NMODE;
+    int NR = NP*(NP+1)/2;
+    
+    struct GMMTable *table = malloc(sizeof(struct GMMTable));
+    table->NP      = NP;
+    table->NMODE   = NMODE;
+    table->index   = malloc(NMODE*sizeof(int));
+    table->mu      = malloc(NP*NMODE*sizeof(double));
+    table->R       = malloc(NR*NMODE*sizeof(double));
+    table->lognorm = malloc(NMODE*sizeof(double));
+    table->cdf     = malloc(NMODE*sizeof(double));
+    table->xmin    = malloc(NP*NMODE*sizeof(double));
+    table->xmax    = malloc(NP*NMODE*sizeof(double));
+    table->boxmin  = malloc(NMODE*sizeof(double));
+    table->boxmax  = malloc(NMODE*sizeof(double));
+    
+    //sort modes by the lower edge of their pruning box
+    struct GMMSortKey *order = malloc(NMODE*sizeof(struct GMMSortKey));
+    double *boxmax = malloc(NMODE*sizeof(double));
+    for(int k=0; k<NMODE; k++)
+    {
+        struct MVG *mode = gmm->modes[k];
+        double xmin = mode->minmax[0][0];
+        double xmax = mode->minmax[0][1];
+        double w = sqrt(GMM_PRUNE_CHI2*mode->C[0][0]);
+
+        order[k].k   = k;
+        order[k].key = sigmoid(mode->mu[0]-w,xmin,xmax);
+        boxmax[k]    = sigmoid(mode->mu[0]+w,xmin,xmax);
+        if(order[k].key < xmin) order[k].key = xmin;
+        if(boxmax[k] > xmax) boxmax[k] = xmax;
+    }
+    qsort(order, NMODE, sizeof(struct GMMSortKey), compare_gmm_sort_key);
+    
+    double A[NP*NP];
+    double ptotal = 0.0;
+    table->boxwidth = 0.0;
+    table->supportwidth = 0.0;
+    for(int k=0; k<NMODE; k++)
+    {
+        struct MVG *mode = gmm->modes[order[k].k];
+        table->index[k]  = order[k].k;
+        table->boxmin[k] = order[k].key;
+        table->boxmax[k] = boxmax[order[k].k];
+        if(table->boxmax[k]-table->boxmin[k] > table->boxwidth) table->boxwidth = table->boxmax[k]-table->boxmin[k];
+        if(mode->minmax[0][1]-mode->minmax[0][0] > table->supportwidth) table->supportwidth = mode->minmax[0][1]-mode->minmax[0][0];
+        
+        for(int i=0; i<NP; i++)
+        {
+            table->mu[i*NMODE+k]   = mode->mu[i];
+            table->xmin[i*NMODE+k] = mode->minmax[i][0];
+            table->xmax[i*NMODE+k] = mode->minmax[i][1];
+        }
+        
+        //Cholesky factor of inverse covariance matrix
+        for(int i=0; i<NP; i++) for(int j=0; j<NP; j++) A[i*NP+j] = mode->Cinv[i][j];
+        if(LAPACKE_dpotrf(LAPACK_ROW_MAJOR,'L',NP,A,NP))
+        {
+            fprintf(stderr,"Error: inverse covariance of GMM mode %i is not positive definite in compile_gmm()\n",order[k].k);
+            exit(1);
+        }
+        
+        //pack lower triangle column by column, and get log det C = -log det C^-1
+        double logdetC = 0.0;
+        int p = 0;
+        for(int j=0; j<NP; j++)
+        {
+            logdetC -= 2.0*log(A[j*NP+j]);
+            for(int i=j; i<NP; i++) table->R[(p++)*NMODE+k] = A[i*NP+j];
+        }
+        
+        table->lognorm[k] = log(mode->p) - 0.5*((double)NP*log(PI2) + logdetC);
+        
+        ptotal += mode->p;
+        table->cdf[k] = ptotal;
+    }
+    for(int k=0; k<NMODE; k++) table->cdf[k] /= ptotal;
+    
+    //bound on density of pruned modes
+    double lognormmax = -INFINITY;
+    for(int k=0; k<NMODE; k++) if(table->lognorm[k] > lognormmax) lognormmax = table->lognorm[k];
+    double sum = 0.0;
+    for(int k=0; k<NMODE; k++) sum += exp(table->lognorm[k] - lognormmax);
+    table->logerr = lognormmax + log(sum) - 0.5*GMM_PRUNE_CHI2;
+    
+    free(order);
+    free(boxmax);
+    
+    gmm->table = table;
+}
+
+void free_gmm_table(struct GMMTable *table)
+{
+    free(table->index);
+    free(table->mu);
+    free(table->R);
+    free(table->lognorm);
+    free(table->cdf);
+    free(table->xmin);
+    free(table->xmax);
+    free(table->boxmin);
+    free(table->boxmax);
+    free(table);
+}
+
+/* log-sum-exp of modes [kmin,kmax) of table at x */
+static double gmm_log_density_range(const struct GMMTable *table, const double *x, int kmin, int kmax)
+{
+    int NP = table->NP;
+    int NMODE = table->NMODE;
+    
+    double dx[NP][GMM_TABLE_BLOCK];
+    double chi2[GMM_TABLE_BLOCK];
+    double u[GMM_TABLE_BLOCK];
+    int support[GMM_TABLE_BLOCK];
+    
+    //running log-sum-exp over blocks of modes
+    double logPmax = -INFINITY;
+    double sum = 0.0;
+    
+    for(int k0=kmin; k0<kmax; k0+=GMM_TABLE_BLOCK)
+    {
+        int Nk = (kmax-k0 < GMM_TABLE_BLOCK) ? kmax-k0 : GMM_TABLE_BLOCK;
+        
+        //map x into each mode's support
+        for(int k=0; k<Nk; k++) support[k] = 1;
+        for(int i=0; i<NP; i++)
+        {
+            const double *mu   = table->mu   + i*NMODE + k0;
+            const double *xmin = table->xmin + i*NMODE + k0;
+            const double *xmax = table->xmax + i*NMODE + k0;
+            double xi = x[i];
+            for(int k=0; k<Nk; k++)
+            {
+                int in = (xi >= xmin[k] && xi < xmax[k]);
+                support[k] &= in;
+                dx[i][k] = in ? logit(xi,xmin[k],xmax[k]) - mu[k] : 0.0;
+            }
+        }
+        
+        int Nsupport = 0;
+        for(int k=0; k<Nk; k++) Nsupport += support[k];
+        if(Nsupport == 0) continue;
+        
+        /* (y-mu)^T C^-1 (y-mu) = |R^T (y-mu)|^2 */
+        for(int k=0; k<Nk; k++) chi2[k] = 0.0;
+        int p = 0;
+        for(int j=0; j<NP; j++)
+        {
+            for(int k=0; k<Nk; k++) u[k] = 0.0;
+            for(int i=j; i<NP; i++)
+            {
+                const double *R = table->R + (p++)*NMODE + k0;
+                #pragma omp simd
+                for(int k=0; k<Nk; k++) u[k] += R[k]*dx[i][k];
+            }
+            #pragma omp simd
+            for(int k=0; k<Nk; k++) chi2[k] += u[k]*u[k];
+        }
+        
+        const double *lognorm = table->lognorm + k0;
+        double blockmax = -INFINITY;
+        for(int k=0; k<Nk; k++)
+        {
+            chi2[k] = support[k] ? lognorm[k] - 0.5*chi2[k] : -INFINITY;
+            if(chi2[k] > blockmax) blockmax = chi2[k];
+        }
+        if(blockmax == -INFINITY) continue;
+        
+        if(blockmax > logPmax)
+        {
+            sum *= exp(logPmax - blockmax);
+            logPmax = blockmax;
+        }
+        for(int k=0; k<Nk; k++) sum += exp(chi2[k] - logPmax);
+    }
+    
+    return logPmax + log(sum);
+}
+
+/* first mode with boxmin >= value (strict = 0) or boxmin > value (strict = 1) */
+static int gmm_box_search(const struct GMMTable *table, double value, int strict)
+{
+    int lo = 0;
+    int hi = table->NMODE;
+    while(lo < hi)
+    {
+        int mid = (lo+hi)/2;
+        if(table->boxmin[mid] < value || (strict && table->boxmin[mid] == value)) lo = mid+1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+double gmm_log_density(const struct GMMTable *table, const double *x)
+{
+    //modes whose pruning box can contain x0
+    int kmin = gmm_box_search(table, x[0] - table->boxwidth, 0);
+    int kmax = gmm_box_search(table, x[0], 1);
+    
+    double logP = gmm_log_density_range(table, x, kmin, kmax);
+    
+    //x is far from every mode, sum those whose support can contain x0 rather than return -inf
+    if(logP == -INFINITY)
+    {
+        int jmin = gmm_box_search(table, x[0] - table->supportwidth, 0);
+        int jmax = gmm_box_search(table, x[0] + table->supportwidth, 1);
+        if(jmin < kmin || jmax > kmax) logP = gmm_log_density_range(table, x, jmin, jmax);
+    }
+    
+    return logP;
+}
+
+int gmm_draw_mode(const struct GMMTable *table, double u)
+{
+    //bisection search of cumulative weights
+    int lo = 0;
+    int hi = table->NMODE-1;
+    while(lo < hi)
+    {
+        int mid = (lo+hi)/2;
+        if(table->cdf[mid] > u) hi = mid;
+        else lo = mid+1;
+    }
+    return table->index[lo];
+}
+
 double log_likelihood(struct MVG **modes, struct Sample **samples, int NMCMC, int NMODE)
 {
     
@@ -44,6 +44,7 @@ struct GMM
     size_t NParams;
     size_t NMODE;
     struct MVG **modes;
+    struct GMMTable *table; //!< compiled form of `modes` for fast evaluation, see compile_gmm()
 };
 
 /**
@@ -117,6 +118,79 @@ void copy_MVG(struct MVG *origin, struct MVG *copy);
 double multivariate_gaussian(double *x, struct MVG *mvg, int N);
 double multivariate_gaussian_no_min(double *x, struct MVG *mvg);
 
+#define GMM_TABLE_BLOCK 64   //!< modes evaluated together by gmm_log_density()
+#define GMM_PRUNE_CHI2 64.0  //!< \f$\chi^2\f$ from the mean, in the first parameter, beyond which modes are skipped by gmm_log_density()
+
+/**
+ * \brief GMM flattened for repeated density evaluations and draws.
+ *
+ * Arrays are stored parameter-major so that consecutive modes are
+ * contiguous, and the density of a block of modes is evaluated as
+ * vector operations over the modes.
+ *
+ * Modes are indexed by the first parameter (frequency, for the UCB
+ * catalog). Each mode gets a pruning box
+ * \f$\mu_0 \pm \sqrt{\chi^2_{\rm max} C_{00}}\f$ intersected with its support,
+ * and the table is sorted by the lower edge of the boxes. Outside its box
+ * the \f$\chi^2\f$ of a mode exceeds GMM_PRUNE_CHI2, so the density skipped
+ * by only visiting modes whose box contains the point is bounded by
+ * \f$e^{-\chi^2_{\rm max}/2}\sum_k e^{\rm lognorm_k}\f$, stored as GMMTable::logerr.
+ */
+struct GMMTable
+{
+    int NP;           //!< dimension of parameter space
+    int NMODE;        //!< number of modes
+    int *index;       //!< mode in GMM::modes stored at position `k` of the table
+    double *mu;       //!< means, `mu[i*NMODE+k]` for parameter `i` of mode `k`
+    double *R;        //!< lower Cholesky factor \f$R\f$ of \f$C^{-1} = RR^T\f$, packed column by column, `NP(NP+1)/2` rows of `NMODE`
+    double *lognorm;  //!< \f$\log p_k - \frac{1}{2}\log\left((2\pi)^N \det C_k\right)\f$
+    double *cdf;      //!< cumulative normalized mode weights, for drawing modes
+    double *xmin;     //!< lower bound of support, `xmin[i*NMODE+k]`
+    double *xmax;     //!< upper bound of support, `xmax[i*NMODE+k]`
+    double *boxmin;   //!< lower edge of pruning box in first parameter, ascending
+    double *boxmax;   //!< upper edge of pruning box in first parameter
+    double boxwidth;  //!< widest pruning box
+    double supportwidth; //!< widest support in first parameter
+    double logerr;    //!< log of upper bound on the density skipped by pruning
+};
+
+/**
+ * \brief Build GMM::table from the modes of `gmm`.
+ *
+ * Call after the modes are read or modified, before any evaluations.
+ * Exits if a mode's inverse covariance matrix is not positive definite.
+ */
+void compile_gmm(struct GMM *gmm);
+
+/**
+ * \brief Free GMM::table
+ */
+void free_gmm_table(struct GMMTable *table);
+
+/**
+ * \brief Log probability density of GMM at `x`
+ *
+ * Only modes whose pruning box contains `x[0]` are visited, found by
+ * bisection of GMMTable::boxmin, so the cost does not grow with the number
+ * of well separated modes. If none of them has support at `x` the modes whose
+ * support can contain `x[0]` are summed instead, so the result is never
+ * \f$-\infty\f$ because of pruning.
+ * Each mode maps `x` with logit() using its own support, and modes that
+ * do not support `x` are skipped.
+ *
+ * Sums over modes with a log-sum-exp reduction and allocates no memory, so
+ * it is safe to call concurrently from every thread.
+ * \param[in] table compiled GMM from compile_gmm()
+ * \param[in] x location in parameter space
+ * \return \f$\log \sum_k p_k N(y_k(x)|\mu_k,C_k)\f$, to within GMMTable::logerr
+ */
+double gmm_log_density(const struct GMMTable *table, const double *x);
+
+/**
+ * \brief Select mode of GMM::modes with probability proportional to its weight, given uniform deviate `u`
+ */
+int gmm_draw_mode(const struct GMMTable *table, double u);
+
 
 /**
  * \brief Log-likelihood of Gaussian Mixture Model
@@ -709,6 +709,18 @@ void LISA_tdi_Sangria(double L, double fstar, double T, double ***d, double f0,
     }
 }
 
+LISA_tdi_function select_LISA_tdi(char *format)
+{
+    if(strcmp("phase",format) == 0)          return LISA_tdi;
+    else if(strcmp("frequency",format) == 0) return LISA_tdi_FF;
+    else if(strcmp("sangria",format) == 0)   return LISA_tdi_Sangria;
+    else
+    {
+        fprintf(stderr,"Unsupported data format %s\n",format);
+        exit(1);
+    }
+}
+
 void LISA_spacecraft_to_barycenter_time(struct Orbit *orbit, double costh, double phi, double *time, double *time_shifted, int N, int flag)
 {
     // sky location of source
@@ -243,6 +243,16 @@ void LISA_tdi_FF(double L, double fstar, double T, double ***d, double f0, long
 /// LISA TDI (LDC Sangria data)
 void LISA_tdi_Sangria(double L, double fstar, double T, double ***d, double f0, long q, double *X, double *Y, double *Z, double *A, double *E, int BW, int NI);
 ///@}
+
+/// Function pointer type shared by LISA_tdi(), LISA_tdi_FF(), and LISA_tdi_Sangria()
+typedef void (*LISA_tdi_function)(double L, double fstar, double T, double ***d, double f0, long q, double *X, double *Y, double *Z, double *A, double *E, int BW, int NI);
+
+/**
+ \brief TDI synthesis function for data \p format, "phase", "frequency", or "sangria"
+ 
+ Resolve once at setup and call through the pointer in loops over waveforms.
+ */
+LISA_tdi_function select_LISA_tdi(char *format);
 void LISA_polarization_tensor_njc(double costh, double phi, double eplus[4][4], double ecross[4][4], double k[4]);
 
 
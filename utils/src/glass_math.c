@@ -256,6 +256,59 @@ double ipow(double x, int n)
     return xn;
 }
 
+/*
+ Cody-Waite split of pi/2 into pieces with 27 significant bits so that
+ k*PIO2_{1,2,3} is exact for |k| < 2^26 (arguments up to ~1e8 rad)
+ */
+#define PIO2_1 1.570796325802803
+#define PIO2_2 9.920935739593517e-10
+#define PIO2_3 5.721188709663575e-18
+#define PIO2_4 1.6446256936324258e-26
+
+/* round-to-nearest without a libm call so the loop stays vectorizable */
+#define RINT_SHIFT 6755399441055744.0
+
+/* fdlibm minimax coefficients for sin and cos on [-pi/4,pi/4] */
+#define SIN_S1 -1.66666666666666324348e-01
+#define SIN_S2  8.33333333332248946124e-03
+#define SIN_S3 -1.98412698298579493134e-04
+#define SIN_S4  2.75573137070700676789e-06
+#define SIN_S5 -2.50507602534068634195e-08
+#define SIN_S6  1.58969099521155010221e-10
+#define COS_C1  4.16666666666666019037e-02
+#define COS_C2 -1.38888888888741095749e-03
+#define COS_C3  2.48015872894767294178e-05
+#define COS_C4 -2.75573143513906633035e-07
+#define COS_C5  2.08757232129817482790e-09
+#define COS_C6 -1.13596475577881948265e-11
+
+void sincos_array(double *x, double *s, double *c, int N)
+{
+    #pragma omp simd
+    for(int n=0; n<N; n++)
+    {
+        //reduce to r in [-pi/4,pi/4] and quadrant q
+        double k = (x[n]*M_2_PI + RINT_SHIFT) - RINT_SHIFT;
+        int q = (int)k;
+        double r = x[n] - k*PIO2_1;
+        r -= k*PIO2_2;
+        r -= k*PIO2_3;
+        r -= k*PIO2_4;
+        
+        double z = r*r;
+        double sinr = r + r*z*(SIN_S1 + z*(SIN_S2 + z*(SIN_S3 + z*(SIN_S4 + z*(SIN_S5 + z*SIN_S6)))));
+        double hz = 0.5*z;
+        double w = 1.0 - hz;
+        double cosr = w + (((1.0 - w) - hz) + z*z*(COS_C1 + z*(COS_C2 + z*(COS_C3 + z*(COS_C4 + z*(COS_C5 + z*COS_C6))))));
+        
+        //rotate by q*pi/2
+        double sq = (q & 1) ? cosr : sinr;
+        double cq = (q & 1) ? sinr : cosr;
+        s[n] = (q & 2)     ? -sq : sq;
+        c[n] = ((q+1) & 2) ? -cq : cq;
+    }
+}
+
 double chirpmass(double m1, double m2)
 {
     return pow(m1*m2,3./5.)/pow(m1+m2,1./5.);
@@ -610,6 +663,7 @@ void unpack_fft_output(double *x, double *x_packed, int N)
 
 void glass_forward_complex_fft(double *data, int N)
 {
+    double prof = profile_start();
     kiss_fft_cfg cfg = kiss_fft_alloc(N, 0, NULL, NULL); // 0 indicates forward FFT;
     kiss_fft_cpx *freqdata = malloc(N*sizeof(kiss_fft_cpx));
     kiss_fft_cpx *timedata = malloc(N*sizeof(kiss_fft_cpx));
@@ -635,10 +689,13 @@ void glass_forward_complex_fft(double *data, int N)
     kiss_fft_free(cfg);
     free(freqdata);
     free(timedata);
+    
+    profile_stop_count(PROFILE_FFT, prof, N);
 }
 
 void glass_inverse_complex_fft(double *data, int N)
 {
+    double prof = profile_start();
     kiss_fft_cfg cfg = kiss_fft_alloc(N, 1, NULL, NULL); // 1 indicates backward FFT;
     kiss_fft_cpx *freqdata = malloc(N*sizeof(kiss_fft_cpx));
     kiss_fft_cpx *timedata = malloc(N*sizeof(kiss_fft_cpx));
@@ -663,10 +720,13 @@ void glass_inverse_complex_fft(double *data, int N)
     kiss_fft_free(cfg);
     free(freqdata);
     free(timedata);
+    
+    profile_stop_count(PROFILE_FFT, prof, N);
 }
 
 void glass_forward_real_fft(double *data, int N)
 {
+    double prof = profile_start();
     kiss_fftr_cfg cfg = kiss_fftr_alloc(N, 0, NULL, NULL); // 0 indicates forward FFT;
     kiss_fft_scalar *timedata = malloc(N*sizeof(kiss_fft_scalar));
     kiss_fft_cpx    *freqdata = malloc((N/2+1)*sizeof(kiss_fft_cpx));
@@ -688,10 +748,13 @@ void glass_forward_real_fft(double *data, int N)
     kiss_fftr_free(cfg);
     free(freqdata);
     free(timedata);
+    
+    profile_stop_count(PROFILE_FFT, prof, N);
 }
 
 void glass_inverse_real_fft(double *data, int N)
 {
+    double prof = profile_start();
     kiss_fftr_cfg cfg = kiss_fftr_alloc(N, 1, NULL, NULL); // 0 indicates forward FFT;
     kiss_fft_scalar *timedata = malloc(N*sizeof(kiss_fft_scalar));
     kiss_fft_cpx    *freqdata = malloc((N/2+1)*sizeof(kiss_fft_cpx));
@@ -711,6 +774,8 @@ void glass_inverse_real_fft(double *data, int N)
     kiss_fftr_free(cfg);
     free(timedata);
     free(freqdata);
+    
+    profile_stop_count(PROFILE_FFT, prof, N);
 }
 
 void CubicSplineGLASS(int N, double *x, double *y, int Nint, double *xint, double *yint)
@@ -972,6 +1037,138 @@ void index_sort(int *index, double *data, int N)
     for(int n=0; n<N; n++) index[n] = indexed_arr[n].index;
 }
 
+void alias_table(double *weight, int N, double *prob, int *alias)
+{
+    double norm = 0.0;
+    for(int n=0; n<N; n++) norm += weight[n];
+    
+    //Vose's method, scaled so the mean weight is 1
+    int *small = malloc(N*sizeof(int));
+    int *large = malloc(N*sizeof(int));
+    int Nsmall = 0;
+    int Nlarge = 0;
+    for(int n=0; n<N; n++)
+    {
+        prob[n] = weight[n]*(double)N/norm;
+        alias[n] = n;
+        if(prob[n] < 1.0) small[Nsmall++] = n;
+        else              large[Nlarge++] = n;
+    }
+    while(Nsmall > 0 && Nlarge > 0)
+    {
+        int s = small[--Nsmall];
+        int l = large[--Nlarge];
+        alias[s] = l;
+        prob[l] -= 1.0 - prob[s];
+        if(prob[l] < 1.0) small[Nsmall++] = l;
+        else              large[Nlarge++] = l;
+    }
+    while(Nlarge > 0) prob[large[--Nlarge]] = 1.0;
+    while(Nsmall > 0) prob[small[--Nsmall]] = 1.0;
+    free(small);
+    free(large);
+}
+
+int alias_table_draw(double *prob, int *alias, int N, unsigned int *seed)
+{
+    //rand_r_U_0_1() includes 1
+    int n = (int)(rand_r_U_0_1(seed)*N);
+    if(n == N) n--;
+    if(rand_r_U_0_1(seed) >= prob[n]) n = alias[n];
+    
+    return n;
+}
+
+struct QuantileTable *alloc_quantile_table(double *x, int N, int NQ)
+{
+    double_sort(x,N);
+    
+    if(NQ > N-1) NQ = N-1;
+    if(NQ < 1 || x[0] == x[N-1])
+    {
+        fprintf(stderr,"Error: samples have no spread in alloc_quantile_table()\n");
+        exit(1);
+    }
+    
+    struct QuantileTable *table = malloc(sizeof(struct QuantileTable));
+    table->x     = malloc((NQ+1)*sizeof(double));
+    table->logp  = malloc(NQ*sizeof(double));
+    table->prob  = malloc(NQ*sizeof(double));
+    table->alias = malloc(NQ*sizeof(int));
+    
+    //quantiles, with the mass of zero-width intervals merged into the next one
+    double *mass = table->prob;
+    double pending = 0.0;
+    int n = 0;
+    table->x[0] = x[0];
+    for(int q=1; q<=NQ; q++)
+    {
+        double xq = x[(long)q*(N-1)/NQ];
+        pending += 1./(double)NQ;
+        if(xq > table->x[n])
+        {
+            mass[n] = pending;
+            table->x[++n] = xq;
+            pending = 0.0;
+        }
+    }
+    mass[n-1] += pending;
+    table->N = n;
+    
+    for(n=0; n<table->N; n++) table->logp[n] = log(mass[n]/(table->x[n+1]-table->x[n]));
+    
+    //lookup grid
+    table->Ngrid = 4*table->N;
+    table->invdx = (double)table->Ngrid/(table->x[table->N]-table->x[0]);
+    table->grid  = malloc(table->Ngrid*sizeof(int));
+    n = 0;
+    for(int c=0; c<table->Ngrid; c++)
+    {
+        double xc = table->x[0] + (double)c/table->invdx;
+        while(n < table->N-1 && table->x[n+1] <= xc) n++;
+        table->grid[c] = n;
+    }
+    
+    //alias table, overwriting mass with the keep probability
+    alias_table(mass, table->N, table->prob, table->alias);
+    
+    return table;
+}
+
+void free_quantile_table(struct QuantileTable *table)
+{
+    free(table->x);
+    free(table->logp);
+    free(table->prob);
+    free(table->alias);
+    free(table->grid);
+    free(table);
+}
+
+double quantile_table_log_density(struct QuantileTable *table, double x)
+{
+    if(x < table->x[0] || x >= table->x[table->N]) return -INFINITY;
+    
+    int c = (int)((x - table->x[0])*table->invdx);
+    if(c >= table->Ngrid) c = table->Ngrid-1;
+    
+    int n = table->grid[c];
+    while(x >= table->x[n+1]) n++;
+    
+    return table->logp[n];
+}
+
+double quantile_table_draw(struct QuantileTable *table, unsigned int *seed)
+{
+    int n = alias_table_draw(table->prob, table->alias, table->N, seed);
+    
+    //rand_r_U_0_1() includes 1, but the table density is -inf at the upper edge
+    double x = table->x[n] + rand_r_U_0_1(seed)*(table->x[n+1]-table->x[n]);
+    if(x >= table->x[n+1]) x = table->x[n];
+    
+    return x;
+}
+
 
 void list_union(int *A, int *B, int NA, int NB, int *AUB, int *NAUB)
 {
@@ -163,6 +163,20 @@ double post_newtonian_frequency(double Mchirp, double tc, double t);
  */
 double ipow(double x, int n);
 
+/**
+\brief Sine and cosine of an array of arguments
+ 
+ Branch-free Cody-Waite range reduction and minimax polynomials so that
+ the loop vectorizes. Error is at most 1.5 ulp for \f$\sin\f$ and 2.5 ulp
+ for \f$\cos\f$ when \f$|x| \lesssim 10^8\f$.
+  
+ @param[in] x array of arguments
+ @param[out] s \f$\sin(x)\f$
+ @param[out] c \f$\cos(x)\f$
+ @param[in] N size of arrays
+ */
+void sincos_array(double *x, double *s, double *c, int N);
+
 /**
 \brief Tukey window time series data
    
@@ -334,6 +348,65 @@ void double_sort(double *x, int N);
 */
 void index_sort(int *index, double *data, int N);
 
+/**
+ \brief Alias table to draw one of `N` outcomes with probability proportional to `weight` in \f$O(1)\f$ (Vose's method)
+ 
+ @param[in] weight unnormalized probability of each outcome, may be the same array as `prob`
+ @param[in] N number of outcomes
+ @param[out] prob probability of keeping each outcome
+ @param[out] alias alternative for each outcome
+ */
+void alias_table(double *weight, int N, double *prob, int *alias);
+
+/**
+ \brief Draw an outcome from an alias_table()
+ */
+int alias_table_draw(double *prob, int *alias, int N, unsigned int *seed);
+
+/**
+ \brief Piecewise uniform 1D density built from the quantiles of a set of samples.
+
+ Interval edges are the sample quantiles at `NQ` equally spaced probabilities.
+ Coincident edges, e.g. from point masses in the samples, are merged into
+ the next interval so every interval has nonzero width.
+ The interval of a point is found through a uniform lookup grid, and
+ intervals are drawn with an alias table, so both
+ quantile_table_log_density() and quantile_table_draw() are \f$O(1)\f$.
+ */
+struct QuantileTable
+{
+    int N;         //!<number of intervals
+    double *x;     //!<`N+1` ascending interval edges
+    double *logp;  //!<log density in each interval
+    double *prob;  //!<alias table probability of keeping each interval
+    int *alias;    //!<alias table alternative for each interval
+    int Ngrid;     //!<number of cells in lookup grid
+    double invdx;  //!<inverse width of lookup grid cells
+    int *grid;     //!<interval containing the lower edge of each grid cell
+};
+
+/**
+ \brief Build QuantileTable from `N` samples `x`, which are sorted in place
+ 
+ @param[in,out] x samples
+ @param[in] N number of samples
+ @param[in] NQ number of quantiles, reduced to `N-1` for short inputs
+ @return quantile table, free with free_quantile_table()
+ */
+struct QuantileTable *alloc_quantile_table(double *x, int N, int NQ);
+
+void free_quantile_table(struct QuantileTable *table);
+
+/**
+ \brief Log density of QuantileTable at `x`, or `-INFINITY` outside the range of the samples
+ */
+double quantile_table_log_density(struct QuantileTable *table, double x);
+
+/**
+ \brief Draw from QuantileTable
+ */
+double quantile_table_draw(struct QuantileTable *table, unsigned int *seed);
+
 
 void list_union(int *A, int *B, int NA, int NB, int *AUB, int *NAUB);
 
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2025 Tyson B. Littenberg
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "glass_utils.h"
+
+int glass_profile_enabled = 0;
+
+static const char *profile_section_name[PROFILE_NSECTION] =
+{
+    "waveform", "fft", "likelihood", "proposal", "noise", "mpi", "io"
+};
+
+/*
+ Accumulators for one thread, padded to a cache line so threads
+ updating neighboring slots don't contend.
+ */
+struct ProfileSlot
+{
+    double time[PROFILE_NSECTION];
+    long calls[PROFILE_NSECTION];
+    long count[PROFILE_NSECTION];
+    int omp_thread;
+    char pad[64];
+};
+
+static struct ProfileSlot profile_slot[GLASS_PROFILE_NTHREAD];
+static int profile_nslot = 0;
+static double profile_t0;
+
+//slot of calling thread, assigned on first use.  Covers OpenMP and helper pthreads alike
+static __thread int profile_slot_id = -1;
+
+//last slot is shared by all threads beyond the table and is updated atomically
+#define PROFILE_SHARED_SLOT (GLASS_PROFILE_NTHREAD-1)
+
+static struct ProfileSlot *get_profile_slot(void)
+{
+    if(profile_slot_id < 0)
+    {
+        int id;
+        #pragma omp atomic capture
+        id = profile_nslot++;
+        
+        if(id >= PROFILE_SHARED_SLOT) id = PROFILE_SHARED_SLOT;
+        else profile_slot[id].omp_thread = omp_in_parallel() ? omp_get_thread_num() : -1;
+        profile_slot_id = id;
+    }
+    return &profile_slot[profile_slot_id];
+}
+
+void enable_profile(void)
+{
+    memset(profile_slot, 0, sizeof(profile_slot));
+    profile_slot[PROFILE_SHARED_SLOT].omp_thread = -1;
+    profile_nslot = 0;
+    profile_t0 = omp_get_wtime();
+    glass_profile_enabled = 1;
+}
+
+void profile_record(int section, double dt, long n)
+{
+    struct ProfileSlot *slot = get_profile_slot();
+    if(profile_slot_id == PROFILE_SHARED_SLOT)
+    {
+        #pragma omp atomic
+        slot->time[section]  += dt;
+        #pragma omp atomic
+        slot->calls[section] += 1;
+        #pragma omp atomic
+        slot->count[section] += n;
+        return;
+    }
+    slot->time[section]  += dt;
+    slot->calls[section] += 1;
+    slot->count[section] += n;
+}
+
+void print_profile(FILE *fptr)
+{
+    int Nslot = profile_nslot < GLASS_PROFILE_NTHREAD ? profile_nslot : GLASS_PROFILE_NTHREAD;
+    double wall = omp_get_wtime() - profile_t0;
+    
+    fprintf(fptr,"# GLASS profile: wall time %.3f s, %i threads\n",wall,Nslot);
+    fprintf(fptr,"# thread omp_id section time[s] calls count us/call\n");
+    
+    double time[PROFILE_NSECTION];
+    long calls[PROFILE_NSECTION];
+    long count[PROFILE_NSECTION];
+    memset(time,  0, sizeof(time));
+    memset(calls, 0, sizeof(calls));
+    memset(count, 0, sizeof(count));
+
+    for(int i=0; i<Nslot; i++)
+    {
+        struct ProfileSlot *slot = &profile_slot[i];
+        for(int n=0; n<PROFILE_NSECTION; n++)
+        {
+            time[n]  += slot->time[n];
+            calls[n] += slot->calls[n];
+            count[n] += slot->count[n];
+            if(slot->calls[n]==0) continue;
+            fprintf(fptr,"%i %i %-10s %.6f %li %li %.3f\n",i,slot->omp_thread,profile_section_name[n],slot->time[n],slot->calls[n],slot->count[n],1e6*slot->time[n]/(double)slot->calls[n]);
+        }
+    }
+    
+    fprintf(fptr,"# total (all threads)\n");
+    for(int n=0; n<PROFILE_NSECTION; n++)
+    {
+        if(calls[n]==0) continue;
+        fprintf(fptr,"all -1 %-10s %.6f %li %li %.3f\n",profile_section_name[n],time[n],calls[n],count[n],1e6*time[n]/(double)calls[n]);
+    }
+}
+
+void write_profile(const char *filename)
+{
+    if(!glass_profile_enabled) return;
+    
+    FILE *fptr = fopen(filename,"w");
+    if(fptr==NULL)
+    {
+        fprintf(stderr,"Error: could not open profile file %s\n",filename);
+        return;
+    }
+    print_profile(fptr);
+    fclose(fptr);
+}
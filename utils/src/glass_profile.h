@@ -0,0 +1,109 @@
+/*
+ * Copyright 2025 Tyson B. Littenberg
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+@file glass_profile.h
+\brief Scoped timers and counters for the hot paths of the samplers.
+
+ Sections of code are timed by bracketing them with
+ 
+     double t0 = profile_start();
+     ...
+     profile_stop(PROFILE_WAVEFORM, t0);
+ 
+ Each thread accumulates the wall time, number of calls, and an optional
+ work counter (e.g. number of frequency bins or FFT points) for every
+ section into its own slot, so no locking is needed on the hot path.
+ When profiling is disabled (the default) profile_start() and
+ profile_stop() reduce to a test of ::glass_profile_enabled.
+ 
+ Profiling is enabled with the `--profile` command line flag, after which
+ the apps write a per-thread summary with print_profile() at the end of the run.
+ Sections nest, so e.g. FFT time inside waveform generation is counted in both.
+ */
+
+#ifndef glass_profile_h
+#define glass_profile_h
+
+#define GLASS_PROFILE_NTHREAD 256 //!<max number of threads with their own profiling slot
+
+/**
+ \brief Profiled sections of code
+ */
+enum ProfileSection
+{
+    PROFILE_WAVEFORM,   //!<waveform and derivative generation
+    PROFILE_FFT,        //!<Fourier and wavelet transforms
+    PROFILE_LIKELIHOOD, //!<full and delta log likelihood evaluations
+    PROFILE_PROPOSAL,   //!<drawing from, and evaluating density of, proposals
+    PROFILE_NOISE,      //!<noise model updates
+    PROFILE_MPI,        //!<MPI exchanges between global fit blocks
+    PROFILE_IO,         //!<chain files, checkpoints, and other output
+    PROFILE_NSECTION    //!<number of profiled sections
+};
+
+/**
+ \brief `TRUE` when profiling is enabled with enable_profile()
+ */
+extern int glass_profile_enabled;
+
+/**
+ \brief Turn on profiling and zero all timers.
+ 
+ Call once, before any parallel regions, when Flags::profile is set.
+ */
+void enable_profile(void);
+
+/**
+ \brief Add elapsed time `dt` and work count `n` to `section` for the calling thread.
+ */
+void profile_record(int section, double dt, long n);
+
+/**
+ \brief Start a timer, returns 0 when profiling is disabled
+ */
+static inline double profile_start(void)
+{
+    return glass_profile_enabled ? omp_get_wtime() : 0.0;
+}
+
+/**
+ \brief Stop timer started at `start` and credit `section`
+ */
+static inline void profile_stop(int section, double start)
+{
+    if(glass_profile_enabled) profile_record(section, omp_get_wtime()-start, 0);
+}
+
+/**
+ \brief Stop timer started at `start` and credit `section` with `n` units of work
+ */
+static inline void profile_stop_count(int section, double start, long n)
+{
+    if(glass_profile_enabled) profile_record(section, omp_get_wtime()-start, n);
+}
+
+/**
+ \brief Print per-thread and total time, calls, and work count of each section to `fptr`
+ */
+void print_profile(FILE *fptr);
+
+/**
+ \brief Write profile summary to `filename` if profiling is enabled
+ */
+void write_profile(const char *filename);
+
+#endif /* glass_profile_h */
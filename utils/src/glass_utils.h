@@ -48,6 +48,8 @@
 #include "glass_constants.h"
 #include "glass_lisa.h"
 #include "glass_wavelet.h"
+#include "glass_chain.h"
+#include "glass_profile.h"
 #include "glass_data.h"
 #include "glass_math.h"
 #include "glass_gmm.h"